@@ -1,4 +1,5 @@
 #include "miniyaml.h"
+#include "mem_account.h"
 
 #include <ctype.h>
 #include <limits.h>
@@ -30,9 +31,9 @@ typedef struct {
 static void free_block_pieces(BlockPiece *pieces, size_t count) {
     if (!pieces) return;
     for (size_t i = 0; i < count; ++i) {
-        free(pieces[i].text);
+        mem_free(pieces[i].text);
     }
-    free(pieces);
+    mem_free(pieces);
 }
 
 typedef enum {
@@ -49,14 +50,14 @@ typedef struct {
 static void free_lines(YamlLine *lines, size_t count) {
     if (!lines) return;
     for (size_t i = 0; i < count; ++i) {
-        free(lines[i].key);
-        free(lines[i].value);
+        mem_free(lines[i].key);
+        mem_free(lines[i].value);
     }
-    free(lines);
+    mem_free(lines);
 }
 
 static char *mini_strdup_range(const char *start, size_t len) {
-    char *out = (char *)malloc(len + 1);
+    char *out = (char *)mem_malloc(len + 1);
     if (!out) return NULL;
     memcpy(out, start, len);
     out[len] = '\0';
@@ -167,7 +168,7 @@ static char *collect_block_scalar(int parent_indent, int *line_no, const char **
 
         if (count == cap) {
             size_t newcap = cap ? cap * 2 : 8;
-            BlockPiece *tmp = (BlockPiece *)realloc(pieces, newcap * sizeof(BlockPiece));
+            BlockPiece *tmp = (BlockPiece *)mem_realloc(pieces, newcap * sizeof(BlockPiece));
             if (!tmp) {
                 free_block_pieces(pieces, count);
                 if (error_msg) *error_msg = make_error(*line_no, "Memoria insufficiente");
@@ -215,7 +216,7 @@ static char *collect_block_scalar(int parent_indent, int *line_no, const char **
         total += (size_t)rel + strlen(pieces[i].text) + 1;
     }
 
-    char *result = (char *)malloc(total + 1);
+    char *result = (char *)mem_malloc(total + 1);
     if (!result) {
         free_block_pieces(pieces, count);
         if (error_msg) *error_msg = make_error(*line_no, "Memoria insufficiente");
@@ -254,7 +255,7 @@ static char *collect_block_scalar(int parent_indent, int *line_no, const char **
 static int parse_lines(const char *input, YamlLine **out_lines, size_t *out_count, char **error_msg) {
     size_t cap = 32;
     size_t count = 0;
-    YamlLine *lines = (YamlLine *)calloc(cap, sizeof(YamlLine));
+    YamlLine *lines = (YamlLine *)mem_calloc(cap, sizeof(YamlLine));
     if (!lines) {
         *error_msg = make_error(0, "Memoria insufficiente");
         return 0;
@@ -285,7 +286,7 @@ static int parse_lines(const char *input, YamlLine **out_lines, size_t *out_coun
         int indent = 0;
         while (line_buf[indent] == ' ') ++indent;
         if (line_buf[indent] == '\t') {
-            free(line_buf);
+            mem_free(line_buf);
             free_lines(lines, count);
             *error_msg = make_error(line_no, "Tabulazioni non supportate");
             return 0;
@@ -307,22 +308,22 @@ static int parse_lines(const char *input, YamlLine **out_lines, size_t *out_coun
         }
 
         char *trimmed = mini_strdup_trim(content);
-        free(line_buf);
+        mem_free(line_buf);
         if (!trimmed) {
             free_lines(lines, count);
             *error_msg = make_error(line_no, "Memoria insufficiente");
             return 0;
         }
         if (trimmed[0] == '\0') {
-            free(trimmed);
+            mem_free(trimmed);
             continue;
         }
 
         if (count == cap) {
             cap *= 2;
-            YamlLine *tmp = (YamlLine *)realloc(lines, cap * sizeof(YamlLine));
+            YamlLine *tmp = (YamlLine *)mem_realloc(lines, cap * sizeof(YamlLine));
             if (!tmp) {
-                free(trimmed);
+                mem_free(trimmed);
                 free_lines(lines, count);
                 *error_msg = make_error(line_no, "Memoria insufficiente");
                 return 0;
@@ -341,7 +342,7 @@ static int parse_lines(const char *input, YamlLine **out_lines, size_t *out_coun
             rest = skip_spaces(rest);
             dst->value = mini_strdup_trim(rest);
             if (!dst->value) {
-                free(trimmed);
+                mem_free(trimmed);
                 free_lines(lines, count - 1);
                 *error_msg = make_error(line_no, "Memoria insufficiente");
                 return 0;
@@ -349,19 +350,19 @@ static int parse_lines(const char *input, YamlLine **out_lines, size_t *out_coun
             if (dst->value[0] == '|' || dst->value[0] == '>') {
                 char *block = collect_block_scalar(indent, &line_no, &cursor, dst->value, error_msg);
                 if (!block) {
-                    free(trimmed);
+                    mem_free(trimmed);
                     free_lines(lines, count - 1);
-                    free(dst->value);
+                    mem_free(dst->value);
                     return 0;
                 }
-                free(dst->value);
+                mem_free(dst->value);
                 dst->value = block;
             }
-            free(trimmed);
+            mem_free(trimmed);
         } else {
             const char *colon = find_unquoted_colon(trimmed);
             if (!colon) {
-                free(trimmed);
+                mem_free(trimmed);
                 free_lines(lines, count - 1);
                 *error_msg = make_error(line_no, "Atteso ':' in riga YAML");
                 return 0;
@@ -369,16 +370,16 @@ static int parse_lines(const char *input, YamlLine **out_lines, size_t *out_coun
             dst->type = LINE_MAP;
             dst->key = mini_strdup_range(trimmed, (size_t)(colon - trimmed));
             if (!dst->key) {
-                free(trimmed);
+                mem_free(trimmed);
                 free_lines(lines, count - 1);
                 *error_msg = make_error(line_no, "Memoria insufficiente");
                 return 0;
             }
             char *key_trim = mini_strdup_trim(dst->key);
-            free(dst->key);
+            mem_free(dst->key);
             dst->key = key_trim;
             if (!dst->key) {
-                free(trimmed);
+                mem_free(trimmed);
                 free_lines(lines, count - 1);
                 *error_msg = make_error(line_no, "Memoria insufficiente");
                 return 0;
@@ -387,20 +388,20 @@ static int parse_lines(const char *input, YamlLine **out_lines, size_t *out_coun
             while (*valstart && isspace((unsigned char)*valstart)) ++valstart;
             dst->value = mini_strdup_trim(valstart);
             if (!dst->value) {
-                free(trimmed);
+                mem_free(trimmed);
                 free_lines(lines, count - 1);
                 *error_msg = make_error(line_no, "Memoria insufficiente");
                 return 0;
             }
             dst->has_value = dst->value[0] != '\0';
-            free(trimmed);
+            mem_free(trimmed);
             if (dst->has_value && (dst->value[0] == '|' || dst->value[0] == '>')) {
                 char *block = collect_block_scalar(indent, &line_no, &cursor, dst->value, error_msg);
                 if (!block) {
                     free_lines(lines, count);
                     return 0;
                 }
-                free(dst->value);
+                mem_free(dst->value);
                 dst->value = block;
             }
         }
@@ -429,7 +430,7 @@ static int next_child_index(const YamlLine *lines, size_t count, size_t idx) {
 
 static cJSON *parse_double_quoted(const char *value, char **error_msg, int line_no) {
     size_t len = strlen(value);
-    char *out = (char *)malloc(len + 1);
+    char *out = (char *)mem_malloc(len + 1);
     if (!out) {
         *error_msg = make_error(line_no, "Memoria insufficiente");
         return NULL;
@@ -448,7 +449,7 @@ static cJSON *parse_double_quoted(const char *value, char **error_msg, int line_
                 case 'b': out[j++] = '\b'; break;
                 case 'f': out[j++] = '\f'; break;
                 default:
-                    free(out);
+                    mem_free(out);
                     *error_msg = make_error(line_no, "Sequenza di escape non supportata in stringa");
                     return NULL;
             }
@@ -460,7 +461,7 @@ static cJSON *parse_double_quoted(const char *value, char **error_msg, int line_
                 const char *rest = value + i + 1;
                 while (*rest) {
                     if (!isspace((unsigned char)*rest)) {
-                        free(out);
+                        mem_free(out);
                         *error_msg = make_error(line_no, "Contenuto non atteso dopo stringa");
                         return NULL;
                     }
@@ -469,20 +470,20 @@ static cJSON *parse_double_quoted(const char *value, char **error_msg, int line_
             }
             out[j] = '\0';
             cJSON *node = cJSON_CreateString(out);
-            free(out);
+            mem_free(out);
             return node;
         } else {
             out[j++] = c;
         }
     }
-    free(out);
+    mem_free(out);
     *error_msg = make_error(line_no, "Stringa senza chiusura");
     return NULL;
 }
 
 static cJSON *parse_single_quoted(const char *value, char **error_msg, int line_no) {
     size_t len = strlen(value);
-    char *out = (char *)malloc(len + 1);
+    char *out = (char *)mem_malloc(len + 1);
     if (!out) {
         *error_msg = make_error(line_no, "Memoria insufficiente");
         return NULL;
@@ -499,7 +500,7 @@ static cJSON *parse_single_quoted(const char *value, char **error_msg, int line_
                     const char *rest = value + i + 1;
                     while (*rest) {
                         if (!isspace((unsigned char)*rest)) {
-                            free(out);
+                            mem_free(out);
                             *error_msg = make_error(line_no, "Contenuto non atteso dopo stringa");
                             return NULL;
                         }
@@ -508,14 +509,14 @@ static cJSON *parse_single_quoted(const char *value, char **error_msg, int line_
                 }
                 out[j] = '\0';
                 cJSON *node = cJSON_CreateString(out);
-                free(out);
+                mem_free(out);
                 return node;
             }
         } else {
             out[j++] = c;
         }
     }
-    free(out);
+    mem_free(out);
     *error_msg = make_error(line_no, "Stringa senza chiusura");
     return NULL;
 }
@@ -634,7 +635,7 @@ static int append_sequence_item(Container *container, const YamlLine *line, cons
             return 0;
         }
         char *key_trim = mini_strdup_trim(key);
-        free(key);
+        mem_free(key);
         if (!key_trim) {
             *error_msg = make_error(line->line_no, "Memoria insufficiente");
             return 0;
@@ -643,21 +644,21 @@ static int append_sequence_item(Container *container, const YamlLine *line, cons
         while (*valstart && isspace((unsigned char)*valstart)) ++valstart;
         char *value_trim = mini_strdup_trim(valstart);
         if (!value_trim) {
-            free(key_trim);
+            mem_free(key_trim);
             *error_msg = make_error(line->line_no, "Memoria insufficiente");
             return 0;
         }
         cJSON *item_obj = cJSON_CreateObject();
         if (!item_obj) {
-            free(key_trim);
-            free(value_trim);
+            mem_free(key_trim);
+            mem_free(value_trim);
             *error_msg = make_error(line->line_no, "Memoria insufficiente");
             return 0;
         }
         cJSON_AddItemToArray(container->node, item_obj);
         if (*stack_sz >= MINIYAML_MAX_STACK) {
-            free(key_trim);
-            free(value_trim);
+            mem_free(key_trim);
+            mem_free(value_trim);
             *error_msg = make_error(line->line_no, "Nidificazione YAML troppo profonda");
             return 0;
         }
@@ -674,14 +675,14 @@ static int append_sequence_item(Container *container, const YamlLine *line, cons
                 child = cJSON_CreateObject();
             }
             if (!child) {
-                free(key_trim);
-                free(value_trim);
+                mem_free(key_trim);
+                mem_free(value_trim);
                 *error_msg = make_error(line->line_no, "Memoria insufficiente");
                 return 0;
             }
             cJSON_AddItemToObject(item_obj, key_trim, child);
-            free(key_trim);
-            free(value_trim);
+            mem_free(key_trim);
+            mem_free(value_trim);
             if (*stack_sz >= MINIYAML_MAX_STACK) {
                 *error_msg = make_error(line->line_no, "Nidificazione YAML troppo profonda");
                 return 0;
@@ -691,13 +692,13 @@ static int append_sequence_item(Container *container, const YamlLine *line, cons
         }
 
         cJSON *val = parse_scalar_value(value_trim, error_msg, line->line_no);
-        free(value_trim);
+        mem_free(value_trim);
         if (!val) {
-            free(key_trim);
+            mem_free(key_trim);
             return 0;
         }
         cJSON_AddItemToObject(item_obj, key_trim, val);
-        free(key_trim);
+        mem_free(key_trim);
         return 1;
     }
 
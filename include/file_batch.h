@@ -0,0 +1,67 @@
+#ifndef FILE_BATCH_H
+#define FILE_BATCH_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Elenco di percorsi raccolti da una directory o da un pattern glob.
+typedef struct file_list
+{
+  char **paths;
+  size_t count;
+  size_t cap;
+} file_list;
+
+// Raccoglie in `out` i file regolari indicati da `pattern`: un pattern glob
+// (se contiene '*', '?' o '['), una directory (visitata ricorsivamente) o un
+// singolo file. I percorsi sono ordinati. In caso di errore restituisce false
+// e scrive in `*error` un messaggio da liberare con free.
+bool file_list_collect(const char *pattern, file_list *out, char **error);
+void file_list_free(file_list *l);
+
+typedef enum file_batch_backend
+{
+  FILE_BATCH_AUTO,    // io_uring se disponibile, altrimenti thread con pread
+  FILE_BATCH_URING,   // solo io_uring (Linux)
+  FILE_BATCH_THREADS, // pool di thread che leggono con pread
+} file_batch_backend;
+
+typedef struct file_batch_options
+{
+  file_batch_backend backend;
+  unsigned depth;   // file letti in anticipo al massimo (0 = predefinito)
+  unsigned threads; // thread del pool di ripiego (0 = predefinito)
+  size_t max_bytes; // file più grandi non vengono letti (0 = nessun limite)
+} file_batch_options;
+
+// File letto. `data` è terminato da NUL e passa al chiamante, che lo libera
+// con free; è NULL se la lettura non è riuscita (`error` contiene errno) o se
+// il file supera max_bytes (`too_large`).
+typedef struct file_batch_item
+{
+  size_t index; // posizione nell'elenco passato a file_batch_open
+  const char *path;
+  char *data;
+  size_t len;
+  int error;
+  bool too_large;
+} file_batch_item;
+
+// Lettore di molti file con più letture in corso contemporaneamente: mentre
+// il chiamante elabora un file, i successivi vengono aperti e letti dal
+// kernel (io_uring) o dai thread del pool. I file vengono restituiti
+// nell'ordine in cui la lettura termina.
+typedef struct file_batch file_batch;
+
+// `paths` deve restare valido fino a file_batch_close. NULL se il backend
+// richiesto non è disponibile o la memoria non basta.
+file_batch *file_batch_open(const char *const *paths, size_t count, const file_batch_options *opts);
+// Attende il prossimo file letto; false quando tutti sono stati restituiti.
+bool file_batch_next(file_batch *b, file_batch_item *out);
+// Nome del backend in uso ("io_uring" oppure "pread").
+const char *file_batch_backend_name(const file_batch *b);
+// Profondità effettiva (letture contemporanee al massimo).
+unsigned file_batch_depth(const file_batch *b);
+// Interrompe le letture in corso e libera le risorse.
+void file_batch_close(file_batch *b);
+
+#endif
@@ -1,7 +1,27 @@
 #ifndef FILEUTIL_H
 #define FILEUTIL_H
 #include <stddef.h>
+#include <stdio.h>
 // Legge completamente il file in `path`, restituisce buffer terminato da NUL.
 // Scrive in `out_len` la dimensione (se non NULL). Restituisce NULL su errore.
 char *read_entire_file(const char *path, size_t *out_len);
+// Come read_entire_file, ma se `max_len` è diverso da zero e il file lo supera
+// non legge nulla (o smette di leggere, per gli stream), imposta
+// `*too_large` e restituisce NULL.
+char *read_file_limited(const char *path, size_t max_len, size_t *out_len, int *too_large);
+// 1 se `path` è "-" (standard input) oppure una pipe, un socket o un
+// dispositivo: dati senza dimensione nota da leggere a blocchi.
+int is_stream_path(const char *path);
+// Apre `path` in lettura binaria ("-" = standard input); NULL con messaggio
+// su stderr in caso di errore. Da chiudere con close_input.
+FILE *open_input(const char *path);
+void close_input(FILE *f);
+// Parte in nanosecondi della data di modifica di una struct stat: una
+// riscrittura nello stesso secondo con la stessa dimensione cambia solo
+// questa.
+#if defined(_MSC_VER)
+#define STAT_MTIME_NSEC(st) 0L
+#else
+#define STAT_MTIME_NSEC(st) ((long)(st).st_mtim.tv_nsec)
+#endif
 #endif
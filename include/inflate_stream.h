@@ -0,0 +1,67 @@
+#ifndef INFLATE_STREAM_H
+#define INFLATE_STREAM_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Codifiche del body (Content-Encoding) accettate dal validatore.
+typedef enum
+{
+  CONTENT_IDENTITY,
+  CONTENT_GZIP,    // RFC 1952, anche più membri concatenati
+  CONTENT_DEFLATE  // RFC 1950 (zlib); se l'intestazione manca, deflate grezzo (RFC 1951)
+} content_encoding;
+
+// Interpreta il nome di una codifica ("gzip", "x-gzip", "deflate",
+// "identity", senza distinzione tra maiuscole e minuscole) lungo `len` byte;
+// false se non supportata.
+bool content_encoding_parse(const char *name, size_t len, content_encoding *out);
+// Nome della codifica, ad esempio per i messaggi e le fasi del profilo.
+const char *content_encoding_name(content_encoding e);
+
+// Limite predefinito dei byte decompressi di un body, contro i payload che
+// si espandono di ordini di grandezza ("zip bomb").
+#define INFLATE_DEFAULT_MAX_OUTPUT ((size_t)256 * 1024 * 1024)
+
+typedef enum
+{
+  INFLATE_OK,
+  INFLATE_BAD_DATA,  // intestazione, blocco o checksum non validi
+  INFLATE_TRUNCATED, // i dati compressi finiscono prima dello stream
+  INFLATE_TOO_LARGE, // oltre il limite dei byte decompressi
+  INFLATE_NO_MEMORY
+} inflate_status;
+
+// Sorgente dei dati compressi: scrive in `buf` fino a `cap` byte e
+// restituisce quanti ne ha scritti, 0 alla fine dei dati (o in caso di
+// errore, che il chiamante verifica da sé).
+typedef size_t (*inflate_read_fn)(void *arg, void *buf, size_t cap);
+
+// Decompressore in streaming: legge i dati compressi da `read` a blocchi e
+// restituisce i byte decompressi a richiesta, con una finestra circolare di
+// dimensione fissa. La memoria occupata non dipende dalla dimensione del
+// body; un body che supera `max_output` byte (0 = nessun limite) viene
+// interrotto appena il limite è superato.
+typedef struct inflate_stream inflate_stream;
+
+// NULL se `enc` è CONTENT_IDENTITY o la memoria non basta.
+inflate_stream *inflate_stream_create(content_encoding enc, size_t max_output, inflate_read_fn read, void *arg);
+void inflate_stream_free(inflate_stream *s);
+// Scrive in `out` fino a `cap` byte decompressi e restituisce quanti ne ha
+// scritti: 0 solo alla fine dello stream (checksum verificati) o in caso di
+// errore, distinti da inflate_stream_status.
+size_t inflate_stream_read(inflate_stream *s, void *out, size_t cap);
+inflate_status inflate_stream_status(const inflate_stream *s);
+// Descrizione dell'errore (statica), NULL se lo stato è INFLATE_OK.
+const char *inflate_stream_error(const inflate_stream *s);
+// Byte decompressi finora.
+uint64_t inflate_stream_total_out(const inflate_stream *s);
+
+// Decompressione di un body già in memoria: in caso di successo `*out`
+// (terminato da NUL, da liberare con free) e `*out_len` ricevono il body
+// decompresso; altrimenti `*out` è NULL e `*error_msg`, se non NULL, la
+// descrizione statica dell'errore.
+inflate_status inflate_buffer(content_encoding enc, const void *data, size_t len, size_t max_output, char **out,
+                              size_t *out_len, const char **error_msg);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef JSON_NUMBER_H
+#define JSON_NUMBER_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Lunghezza del letterale numerico all'inizio di [p, end) secondo la
+// grammatica accettata da strtod per i decimali; 0 se non è un numero.
+size_t js_number_lexeme_len(const char *p, const char *end);
+
+// Converte il letterale [p, p + len) nel double correttamente arrotondato
+// quando mantissa ed esponente sono abbastanza piccoli da richiedere una
+// sola operazione esatta; restituisce false negli altri casi.
+bool js_number_decode_fast(const char *p, size_t len, double *out);
+// Come js_number_decode_fast, ricadendo su strtod quando serve.
+double js_number_decode(const char *p, size_t len);
+
+// true se `d` è finito e privo di parte frazionaria (anche oltre INT_MAX).
+bool js_number_is_integral(double d);
+
+#endif
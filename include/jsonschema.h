@@ -2,13 +2,22 @@
 #define JSONSCHEMA_H
 #include <stdbool.h>
 #include "cJSON.h"
+#include "mem_account.h"
+#include "schema_compile.h"
+#include "payload_tape.h"
+#include "profile.h"
+#include "req_budget.h"
+#include "work_pool.h"
 
 // Risultato della validazione: `ok` indica successo, `error_msg` contiene
-// il motivo del fallimento (heap-allocated) quando `ok` è false.
+// il motivo del fallimento (heap-allocated) quando `ok` è false. Con
+// `ctx->memory` impostato, `memory` riporta la memoria della richiesta fino
+// al termine della validazione (altrimenti è azzerato).
 typedef struct
 {
   bool ok;
   char *error_msg;
+  mem_stats memory;
 } jsval_result;
 
 // Modalità di validazione disponibili.
@@ -18,21 +27,78 @@ typedef enum
   JSVAL_MODE_LEXICAL
 } jsval_mode;
 
+// Tabella di memoizzazione dei risultati (sotto-schema, nodo istanza) per i
+// target di $ref: evita di rivalidare lo stesso nodo contro lo stesso schema
+// (o uno strutturalmente identico) all'interno di una singola richiesta.
+typedef struct jsval_memo jsval_memo;
+
+jsval_memo *jsval_memo_create(void);
+void jsval_memo_free(jsval_memo *m);
+// Numero di risultati riutilizzati dalla tabella.
+size_t jsval_memo_hits(const jsval_memo *m);
+
 // Contesto di validazione: consente l'accesso alla radice del documento OAS
 // per future estensioni (es. risoluzione di $ref/components) e conserva la
-// modalità richiesta.
+// modalità richiesta. `index` (opzionale) fornisce i dati precompilati degli
+// schemi, ad esempio le regex già compilate; `memo` (opzionale) abilita la
+// memoizzazione dei $ref per la richiesta corrente. `max_depth` limita i
+// livelli di annidamento dell'istanza visitati dal validatore (0 = nessun
+// limite oltre la memoria disponibile). `symbols` (opzionale) è la tabella
+// in cui sono internati i nomi delle proprietà dello schema: le chiavi del
+// payload cercate nella stessa tabella si confrontano per simbolo.
+// `profile` (opzionale) riceve un intervallo per ogni sotto-schema raggiunto
+// tramite $ref se creato con profile_create(true). Con `pool` (opzionale)
+// gli elementi degli array con almeno `parallel_min_items` elementi vengono
+// validati contro "items" dai thread del pool: l'esito, compreso il
+// messaggio, è quello dell'elemento non valido di indice minore, come nella
+// validazione seriale. `memory` (opzionale) è l'account della richiesta:
+// parser e validatore lo attivano nel thread corrente (e nei thread del
+// pool) e, se il suo limite viene superato, respingono il body con un
+// motivo dedicato invece di segnalare memoria esaurita. Con
+// `adaptive_order` le proprietà di un oggetto vengono validate a partire da
+// quelle che hanno respinto più payload con la stessa specifica (statistiche
+// nei nodi compilati di `index`): l'esito non cambia, ma con più proprietà
+// non valide il motivo riportato può essere quello di un'altra proprietà.
+// `budget` (opzionale, avviato dal chiamante con req_budget_start) limita
+// tempo e passi di parser e validatore: esaurito, la validazione si ferma e
+// restituisce un errore "Budget della richiesta esaurito", che il chiamante
+// distingue da un body non valido con req_budget_exceeded.
 typedef struct
 {
   cJSON *oas_root; // per step futuri ($ref/components)
   jsval_mode mode;
+  const js_schema_index *index;
+  jsval_memo *memo;
+  size_t max_depth;
+  const js_symtab *symbols;
+  profile *profile;
+  work_pool *pool;
+  size_t parallel_min_items;
+  mem_account *memory;
+  bool adaptive_order;
+  req_budget *budget;
 } jsval_ctx;
 
+// Profondità massima predefinita, allineata al limite del parser.
+#define JSVAL_DEFAULT_MAX_DEPTH CJSON_NESTING_LIMIT
+// Elementi oltre i quali un array viene diviso tra i thread di `pool`.
+#define JSVAL_DEFAULT_PARALLEL_ITEMS 4096
+// Numero massimo di $ref consecutivi seguiti per lo stesso nodo: oltre si
+// assume una catena ciclica.
+#define JSVAL_MAX_REF_HOPS 64
+
 // Inizializza un contesto di validazione partendo dal nodo radice OAS.
 jsval_ctx jsval_ctx_make(cJSON *oas_root, jsval_mode mode);
 // Libera le risorse allocate all'interno di un jsval_result (se presenti).
 void jsval_result_free(jsval_result *r);
 
-// Validatore ricorsivo base per subset OAS Schema Object.
+// Risolve un $ref interno (#/...) rispetto a `ctx->oas_root`; NULL se assente.
+cJSON *jsval_resolve_ref(const char *ref, const jsval_ctx *ctx);
+
+// Validatore base per subset OAS Schema Object (iterativo, senza ricorsione)
+// sul payload in forma di tape (vedi payload_tape.h).
+jsval_result js_validate_tape(payload_tape *tape, cJSON *schema, const jsval_ctx *ctx);
+// Come js_validate_tape per un'istanza cJSON, convertita prima in tape.
 jsval_result js_validate(cJSON *instance, cJSON *schema, const jsval_ctx *ctx);
 
 #endif
@@ -0,0 +1,37 @@
+#ifndef KEY_MATCHER_H
+#define KEY_MATCHER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Automa deterministico che riunisce i pattern di "patternProperties" e i
+// nomi di "properties" di uno schema: una sola passata sui byte della chiave
+// indica quali pattern trovano corrispondenza e se la chiave è uno dei nomi,
+// invece di eseguire ogni regex e cercare il nome tra le proprietà.
+typedef struct js_key_matcher js_key_matcher;
+
+typedef struct js_key_match
+{
+  const uint32_t *patterns; // indici dei pattern con corrispondenza, crescenti
+  size_t pattern_count;
+  long literal;             // indice del nome uguale alla chiave, -1 se nessuno
+} js_key_match;
+
+// Costruisce l'automa per `pattern_count` espressioni regolari estese POSIX,
+// cercate in qualunque punto della chiave come fa regexec, e `literal_count`
+// nomi esatti. Restituisce NULL se un pattern usa costrutti fuori dal
+// sottoinsieme riconosciuto (classi [:nome:], escape come \d o \b, intervalli
+// oltre 255), se l'automa supererebbe i limiti di dimensione o se la memoria
+// non basta: il chiamante usa allora le regex dei singoli pattern.
+js_key_matcher *js_key_matcher_build(const char *const *patterns, size_t pattern_count,
+                                     const char *const *literals, size_t literal_count);
+void js_key_matcher_free(js_key_matcher *m);
+
+// Esegue l'automa sulla chiave `key` (terminata da NUL). I puntatori in
+// `*out` restano validi finché l'automa esiste.
+void js_key_matcher_run(const js_key_matcher *m, const char *key, js_key_match *out);
+
+// Byte occupati dall'automa.
+size_t js_key_matcher_bytes(const js_key_matcher *m);
+
+#endif
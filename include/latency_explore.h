@@ -0,0 +1,72 @@
+#ifndef LATENCY_EXPLORE_H
+#define LATENCY_EXPLORE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "cJSON.h"
+#include "jsonschema.h"
+#include "payload_parse.h"
+
+// Ricerca dei payload più costosi da validare per uno schema. Lo schema
+// viene visitato seguendo i $ref per individuarne i punti a rischio: i
+// `pattern` delle stringhe e di patternProperties, i $ref ricorsivi, gli
+// oggetti e gli array che il validatore scorre per intero. Per ciascun punto
+// vengono generati payload validi nel resto del documento, che fanno crescere
+// la dimensione pericolosa (stringhe quasi conformi sempre più lunghe,
+// annidamento, numero di chiavi o di elementi) finché la validazione resta
+// sotto il limite di durata o il payload entro la dimensione massima; le
+// stringhe migliori vengono poi mutate a caso. Ogni payload attraversa lo
+// stesso percorso di una richiesta reale (payload_parse e js_validate_tape).
+
+typedef enum
+{
+  EXPLORE_PATTERN,     // valore stringa contro "pattern"
+  EXPLORE_KEY_PATTERN, // chiave contro un pattern di patternProperties
+  EXPLORE_RECURSION,   // annidamento lungo un $ref ricorsivo
+  EXPLORE_WIDE_OBJECT, // oggetto con molte chiavi
+  EXPLORE_LONG_ARRAY   // array con molti elementi
+} explore_kind;
+
+typedef struct explore_options
+{
+  payload_limits limits; // come nella validazione reale; max_bytes è anche la dimensione massima dei payload
+  bool memo;             // memoizzazione dei $ref per ogni payload, come con --memo
+  double seconds;        // durata complessiva della ricerca
+  double limit_seconds;  // durata di validazione oltre la quale un payload è pericoloso
+  unsigned seed;
+} explore_options;
+
+#define EXPLORE_DEFAULT_MAX_BYTES ((size_t)1024 * 1024)
+#define EXPLORE_DEFAULT_SECONDS 10.0
+#define EXPLORE_DEFAULT_LIMIT_SECONDS 0.1
+
+// Caso peggiore trovato per un punto dello schema.
+typedef struct explore_case
+{
+  explore_kind kind;
+  char *location; // JSON pointer dello schema responsabile
+  char *detail;   // descrizione del payload (ad esempio pattern e lunghezza della stringa)
+  char *payload;
+  size_t payload_len;
+  double seconds; // parsing e validazione, il minimo di più ripetizioni
+  size_t memory;  // picco dei byte vivi in parsing e validazione (mem_account)
+  bool valid;
+} explore_case;
+
+typedef struct explore_report
+{
+  explore_case *cases; // ordinati per durata decrescente
+  size_t count;
+  size_t probes; // payload validati
+  double elapsed;
+} explore_report;
+
+const char *explore_kind_name(explore_kind k);
+
+// Esplora `schema` con il contesto `ctx` (radice della specifica, indice,
+// simboli, modalità; senza profilo). Ogni payload usa un proprio account
+// della memoria con il limite di `ctx->memory`, se presente. false se la
+// memoria non basta.
+bool explore_latency(cJSON *schema, const jsval_ctx *ctx, const explore_options *opts, explore_report *out);
+void explore_report_free(explore_report *r);
+
+#endif
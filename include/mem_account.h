@@ -0,0 +1,65 @@
+#ifndef MEM_ACCOUNT_H
+#define MEM_ACCOUNT_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Contabilità della memoria di una richiesta. Le allocazioni del percorso di
+// una richiesta (lettura e decompressione del body, parser, tape, YAML,
+// validatore, cJSON tramite cJSON_InitHooks) passano per mem_malloc e
+// mem_free, che aggiornano l'account attivo nel thread corrente, se c'è:
+// byte allocati, numero di allocazioni, byte vivi e picco, per la richiesta
+// e per la fase in corso. Con un limite, un'allocazione che porterebbe i
+// byte vivi oltre il limite fallisce come una memoria esaurita e l'account
+// resta segnato come superato: i chiamanti la trattano come un rifiuto del
+// body. Le dimensioni vengono lette dall'allocatore di sistema, quindi un
+// blocco può essere liberato con free o con mem_free indifferentemente.
+typedef struct mem_account mem_account;
+
+typedef struct mem_stats
+{
+  size_t allocated;   // byte allocati (anche quelli già liberati)
+  size_t allocations; // numero di allocazioni
+  size_t peak;        // massimo dei byte vivi
+  size_t live;        // byte vivi al momento della lettura
+} mem_stats;
+
+// Fasi registrate al massimo per richiesta; le successive sommano sull'ultima.
+#define MEM_ACCOUNT_MAX_PHASES 16
+
+// Crea un account; `limit` è il massimo dei byte vivi (0 = nessun limite).
+mem_account *mem_account_create(size_t limit);
+void mem_account_free(mem_account *a);
+size_t mem_account_limit(const mem_account *a);
+// Azzera contatori e fasi per una nuova richiesta (NULL è ammesso).
+void mem_account_reset(mem_account *a);
+
+// Attiva `a` (anche NULL) per il thread corrente e restituisce l'account
+// attivo in precedenza, da ripristinare con un'altra chiamata.
+mem_account *mem_account_enter(mem_account *a);
+mem_account *mem_account_current(void);
+
+// Chiude la fase in corso e ne apre una di nome `name` (statico, non
+// copiato); NULL chiude soltanto. Da chiamare dal thread che possiede
+// l'account: le allocazioni dei thread di supporto contano nella fase
+// aperta. Una fase con lo stesso nome di una precedente si somma a quella.
+void mem_account_phase(mem_account *a, const char *name);
+
+// Statistiche della richiesta (zero con `a` NULL).
+mem_stats mem_account_stats(const mem_account *a);
+bool mem_account_exceeded(const mem_account *a);
+size_t mem_account_phase_count(const mem_account *a);
+// Nome e statistiche della fase `i` (il picco è quello dei byte vivi
+// durante la fase, `live` i byte vivi alla sua chiusura).
+const char *mem_account_phase_stats(const mem_account *a, size_t i, mem_stats *out);
+
+// Stampa una riga per fase e il totale della richiesta.
+void mem_account_print(const mem_account *a, FILE *f);
+
+void *mem_malloc(size_t size);
+void *mem_calloc(size_t count, size_t size);
+void *mem_realloc(void *p, size_t size);
+void mem_free(void *p);
+char *mem_strdup(const char *s);
+
+#endif
@@ -1,5 +1,7 @@
 #ifndef OAS_EXTRACT_H
 #define OAS_EXTRACT_H
+#include <stdbool.h>
+#include <stddef.h>
 #include "cJSON.h"
 
 // Ritorna lo schema del primo requestBody application/json trovato
@@ -8,7 +10,25 @@
 cJSON *oas_first_request_body_schema(cJSON *oas_root);
 
 // Restituisce lo schema JSON associato al requestBody dell'endpoint indicato
-// (method/path). L'oggetto ritornato è un puntatore preso in prestito dal DOM cJSON.
+// (method/path). Il path viene cercato prima come chiave esatta di `paths`,
+// poi tra i template con parametri ("/users/{id}"). L'oggetto ritornato è un
+// puntatore preso in prestito dal DOM cJSON.
 cJSON *oas_request_body_schema(cJSON *oas_root, const char *http_method, const char *endpoint_path);
 
+// Confronta un path concreto con un template OpenAPI ("/users/{id}"): ogni
+// segmento "{...}" accetta un segmento non vuoto qualsiasi.
+bool oas_path_matches_template(const char *tmpl, const char *path);
+
+// Rimuove da `oas_root` tutto ciò che il validatore non può raggiungere a
+// partire dagli schemi dei requestBody application/json: di tutte le
+// operazioni, oppure della sola `http_method` (minuscolo) su `endpoint_path`
+// se non sono NULL. Restano "openapi", le chiavi di `paths` (anche vuote,
+// così la scelta tra path esatti e template non cambia), gli schemi
+// raggiunti con la chiusura dei loro $ref e i contenitori che portano ai
+// target; negli schemi vengono eliminate le parole chiave di sola
+// annotazione (description, title, example, estensioni x-, ...). Scrive in
+// `removed` (se non NULL) il numero di nodi eliminati. Restituisce false,
+// lasciando il DOM invariato, se la memoria non basta.
+bool oas_prune(cJSON *oas_root, const char *http_method, const char *endpoint_path, size_t *removed);
+
 #endif
@@ -0,0 +1,55 @@
+#ifndef OAS_LAZY_H
+#define OAS_LAZY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "cJSON.h"
+
+// Specifica JSON caricata su richiesta: il file viene mappato in memoria e
+// una sola scansione costruisce un indice strutturale (estensione di ogni
+// oggetto e array e collegamenti tra contenitori fratelli), senza creare
+// nodi cJSON. Il DOM parte da una radice vuota e si popola solo con le parti
+// lette: i contenitori attraversati restano scheletri con i soli membri
+// richiesti, i valori richiesti vengono interpretati per intero una volta
+// sola e poi riutilizzati. Le parti mai lette non vengono verificate.
+typedef struct oas_lazy oas_lazy;
+
+typedef enum
+{
+  OAS_LAZY_OK,
+  OAS_LAZY_NOT_JSON,  // il documento non è un oggetto JSON (ad esempio YAML)
+  OAS_LAZY_IO,        // apertura o lettura del file non riuscite
+  OAS_LAZY_BAD_JSON,  // struttura o valore letto non validi
+  OAS_LAZY_TOO_LARGE, // oltre 4 GiB, il limite degli offset dell'indice
+  OAS_LAZY_NO_MEMORY
+} oas_lazy_status;
+
+// Descrizione statica di uno stato.
+const char *oas_lazy_status_message(oas_lazy_status st);
+
+// Mappa `path` e ne costruisce l'indice; in caso di errore `*out` è NULL.
+oas_lazy_status oas_lazy_open(const char *path, oas_lazy **out);
+void oas_lazy_free(oas_lazy *lz);
+
+// DOM materializzato finora (preso in prestito, NULL dopo oas_lazy_detach).
+cJSON *oas_lazy_root(const oas_lazy *lz);
+// Materializza il target di un $ref interno ("#/components/schemas/A") e
+// lo restituisce; NULL se assente o in caso di errore (oas_lazy_error).
+cJSON *oas_lazy_resolve(oas_lazy *lz, const char *ref);
+// Materializza "openapi", l'operazione `http_method` (minuscolo) del path
+// item scelto per `endpoint_path` con le stesse regole di
+// oas_request_body_schema e la chiusura dei $ref raggiungibili dal suo
+// requestBody. Un'operazione assente non è un errore: lo schema mancante
+// viene segnalato dalla ricerca successiva sul DOM.
+oas_lazy_status oas_lazy_require_operation(oas_lazy *lz, const char *http_method, const char *endpoint_path);
+// Primo errore incontrato durante la materializzazione.
+oas_lazy_status oas_lazy_error(const oas_lazy *lz);
+// Cede il DOM al chiamante (da liberare con cJSON_Delete o oas_spec_build):
+// dopo la cessione non si materializza più nulla.
+cJSON *oas_lazy_detach(oas_lazy *lz);
+
+// Byte del documento, contenitori indicizzati e byte occupati dall'indice.
+size_t oas_lazy_source_bytes(const oas_lazy *lz);
+size_t oas_lazy_containers(const oas_lazy *lz);
+size_t oas_lazy_index_bytes(const oas_lazy *lz);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef OAS_SPEC_H
+#define OAS_SPEC_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "schema_compile.h"
+
+// Potatura del DOM al caricamento (vedi oas_prune): restano solo gli schemi
+// dei requestBody, di tutte le operazioni oppure della sola `method`
+// (minuscolo) su `path` se non sono NULL, e i target dei loro $ref.
+typedef struct oas_prune_opts
+{
+  bool enabled;
+  const char *method;
+  const char *path;
+} oas_prune_opts;
+
+// Unità di compilazione: uno schema di components/schemas con il proprio
+// hash di contenuto. Le unità invariate sono condivise tra versioni successive.
+typedef struct oas_component oas_component;
+
+// Versione immutabile di una specifica caricata e compilata. Gli schemi in
+// components/schemas sono sostituiti nel DOM da nodi cJSON_IsReference che
+// puntano al contenuto delle unità, così il DOM resta navigabile come prima.
+typedef struct oas_spec
+{
+  cJSON *root;
+  uint64_t version;
+  uint64_t uid; // unico nel processo per ogni versione costruita
+  oas_component **components;
+  size_t component_count;
+  size_t recompiled_count; // unità compilate ex novo in questa versione
+  js_compiled *inline_compiled; // schemi fuori da components/schemas
+  js_schema_index *index;
+  js_compile_pool *pool; // regex/enum condivise con le versioni precedenti
+  js_symtab *symbols;    // del pool: stringhe del DOM internate
+  size_t interned_bytes; // byte di stringhe duplicate liberati dal DOM
+  size_t live_symbols;   // stringhe distinte del DOM di questa versione
+  size_t memory_bytes;   // stima della memoria occupata (vedi oas_spec_memory)
+  oas_prune_opts prune;  // potatura applicata (stringhe proprie), ereditata dai ricaricamenti
+  size_t dom_bytes_full;   // byte del DOM prima della potatura (0 se non potato)
+  size_t dom_bytes_pruned; // byte del DOM dopo la potatura
+  size_t pruned_nodes;     // nodi eliminati dalla potatura
+} oas_spec;
+
+// Interpreta un documento JSON o YAML (riconosciuto dal primo carattere utile).
+// In caso di errore restituisce NULL e, se disponibile, un messaggio in
+// `*error_msg` da liberare con free().
+cJSON *oas_parse_text(const char *text, size_t len, char **error_msg);
+
+// Costruisce una versione a partire dal DOM `root`, di cui prende possesso.
+// Se `prev` non è NULL le unità con nome e hash invariati vengono riutilizzate
+// senza ricompilarle, salvo quando la tabella dei simboli condivisa è
+// composta soprattutto da stringhe di versioni passate: allora la versione
+// riparte da un pool nuovo. Con `prune` attivo il DOM viene potato prima della
+// compilazione; NULL applica la stessa potatura di `prev` (nessuna senza
+// `prev`), così i ricaricamenti conservano la scelta iniziale.
+oas_spec *oas_spec_build(cJSON *root, const oas_spec *prev, const oas_prune_opts *prune);
+// Interpreta, verifica ('openapi' 3.x) e compila il testo di una specifica.
+oas_spec *oas_spec_load_text(const char *text, size_t len, const oas_spec *prev, const oas_prune_opts *prune,
+                             char **error_msg);
+// Legge, interpreta, verifica ('openapi' 3.x) e compila il file `path`.
+oas_spec *oas_spec_load_file(const char *path, const oas_spec *prev, const oas_prune_opts *prune,
+                             char **error_msg);
+// Stima dei byte occupati dalla versione: DOM, unità compilate, indice e
+// pool. Le unità e il pool condivisi con altre versioni sono contati per
+// intero in ciascuna.
+size_t oas_spec_memory(const oas_spec *spec);
+void oas_spec_free(oas_spec *spec);
+
+// Slot che pubblica la versione corrente con uno scambio atomico in stile RCU:
+// i lettori non prendono lock, lo scrittore attende che i lettori ancora
+// attivi sulla versione precedente abbiano terminato prima di liberarla.
+typedef struct oas_spec_slot oas_spec_slot;
+
+// Crea uno slot con `max_readers` lettori concorrenti (identificati da 0..n-1).
+oas_spec_slot *oas_spec_slot_create(oas_spec *initial, size_t max_readers);
+// Libera lo slot e la versione corrente (nessun lettore deve essere attivo).
+void oas_spec_slot_free(oas_spec_slot *slot);
+// Inizio/fine di una sezione di lettura per il lettore `reader_id`.
+const oas_spec *oas_spec_read_lock(oas_spec_slot *slot, size_t reader_id);
+void oas_spec_read_unlock(oas_spec_slot *slot, size_t reader_id);
+// Versione corrente vista dallo scrittore (non protetta: usare solo dal
+// thread che pubblica).
+const oas_spec *oas_spec_slot_peek(oas_spec_slot *slot);
+// Pubblica `next`, attende il periodo di grazia e libera la versione precedente.
+void oas_spec_publish(oas_spec_slot *slot, oas_spec *next);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PAYLOAD_PARSE_H
+#define PAYLOAD_PARSE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "cJSON.h"
+#include "jsonschema.h"
+#include "payload_tape.h"
+
+// Limiti globali applicati al payload indipendentemente dallo schema.
+// Il valore 0 disattiva il singolo limite.
+typedef struct payload_limits
+{
+  size_t max_bytes;    // dimensione massima del body
+  size_t max_depth;    // livelli di annidamento di oggetti/array
+  size_t max_elements; // numero totale di valori (contenitori compresi)
+} payload_limits;
+
+typedef enum
+{
+  PAYLOAD_OK,
+  PAYLOAD_SYNTAX_ERROR,   // JSON non valido
+  PAYLOAD_LIMIT_EXCEEDED, // limite globale o dello schema superato: payload non valido
+  PAYLOAD_NO_MEMORY,
+  PAYLOAD_BUDGET_EXCEEDED // budget della richiesta (ctx->budget) esaurito: nessun verdetto
+} payload_status;
+
+// Limiti predefiniti: annidamento come CJSON_NESTING_LIMIT, nessun altro limite.
+payload_limits payload_limits_default(void);
+
+// Interpreta `text` come JSON costruendo il tape (vedi payload_tape.h) e
+// seguendo in parallelo `schema`: maxLength, maxItems e maxProperties delle
+// posizioni che il validatore visiterebbe vengono verificati durante il
+// parsing, così un payload che non potrà mai essere valido viene interrotto
+// senza leggerlo tutto. I sottoalberi che il validatore non esaminerà (chiavi
+// fuori da "properties" senza patternProperties, schemi senza vincoli come
+// `{}`) vengono solo verificati sintatticamente e occupano una voce
+// TAPE_SKIPPED. Le stringhe vengono decodificate sul posto in `text`: in caso
+// di successo il tape ne acquisisce la proprietà (liberata da
+// payload_tape_free), altrimenti resta al chiamante, `*out` è vuoto e
+// `*error_msg` (da liberare con free()) descrive il motivo.
+payload_status payload_parse(char *text, size_t len, cJSON *schema, const jsval_ctx *ctx,
+                             const payload_limits *limits, payload_tape *out, char **error_msg);
+
+// Parser incrementale con lo stesso risultato di payload_parse per input che
+// arriva a blocchi (pipe, socket, standard input): i byte vengono passati
+// con payload_push_feed man mano che arrivano, in blocchi di dimensione
+// qualsiasi, e il tape viene costruito e verificato contro i limiti durante
+// la ricezione. Il body non viene conservato: le stringhe decodificate (e i
+// lessemi dei numeri) vengono copiate nell'area di testo propria del tape,
+// i valori saltati non occupano memoria.
+typedef struct payload_push payload_push;
+
+// NULL se la memoria non basta. `schema`, `ctx` e `limits` come per
+// payload_parse; `ctx` deve restare valido fino a payload_push_finish.
+payload_push *payload_push_create(cJSON *schema, const jsval_ctx *ctx, const payload_limits *limits);
+// Interpreta i prossimi `len` byte. Restituisce PAYLOAD_OK se il body può
+// ancora essere valido, altrimenti l'esito definitivo (ad esempio
+// PAYLOAD_LIMIT_EXCEEDED appena un limite viene superato): il resto
+// dell'input può non essere letto.
+payload_status payload_push_feed(payload_push *pp, const char *data, size_t len);
+// Segnala la fine dell'input e trasferisce il tape in `*out` (con l'area di
+// testo propria, liberata da payload_tape_free). In caso di errore `*out` è
+// vuoto e `*error_msg` (da liberare con free()) descrive il motivo.
+payload_status payload_push_finish(payload_push *pp, payload_tape *out, char **error_msg);
+void payload_push_free(payload_push *pp);
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef PAYLOAD_TAPE_H
+#define PAYLOAD_TAPE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "symtab.h"
+
+// Rappresentazione compatta di un payload: un unico array di voci da 64 bit
+// con il tag negli 8 bit alti e il dato nei 56 bassi. Ogni valore occupa
+// voci consecutive:
+//   TAPE_NULL, TAPE_TRUE, TAPE_FALSE, TAPE_SKIPPED   1 voce
+//   TAPE_STRING  offset in `text` della stringa (terminata da NUL), poi la
+//                lunghezza misurata come strlen (40 bit bassi) e, per le
+//                chiavi, il simbolo nella tabella `symbols` (24 bit alti)
+//   TAPE_INT     poi il valore int64 esatto
+//   TAPE_DOUBLE  poi i bit del double
+//   TAPE_RAWNUM  offset in `text` del lessema non ancora decodificato, poi
+//                la sua lunghezza
+//   TAPE_OBJECT, TAPE_ARRAY  indice della voce di chiusura (TAPE_END), il
+//                cui dato è il numero di figli; nei membri di un oggetto la
+//                chiave (TAPE_STRING) precede il valore.
+// TAPE_SKIPPED rappresenta un valore che il validatore non esaminerà e che
+// il parser ha solo verificato sintatticamente.
+typedef enum
+{
+  TAPE_NULL = 'n',
+  TAPE_TRUE = 't',
+  TAPE_FALSE = 'f',
+  TAPE_SKIPPED = '_',
+  TAPE_STRING = '"',
+  TAPE_INT = 'l',
+  TAPE_DOUBLE = 'd',
+  TAPE_RAWNUM = 'r',
+  TAPE_OBJECT = '{',
+  TAPE_ARRAY = '[',
+  TAPE_END = '}'
+} payload_tape_tag;
+
+#define TAPE_PAYLOAD_MASK ((UINT64_C(1) << 56) - 1)
+#define TAPE_LEN_BITS 40
+#define TAPE_LEN_MASK ((UINT64_C(1) << TAPE_LEN_BITS) - 1)
+// Indice restituito dalle ricerche senza risultato.
+#define TAPE_NONE ((size_t)-1)
+
+typedef struct payload_tape
+{
+  uint64_t *entries;
+  size_t count;
+  size_t cap;
+  char *text;       // stringhe e lessemi a cui puntano gli offset
+  size_t text_len;
+  size_t text_cap;  // != 0 se `text` è un'area propria che cresce
+  // Tabella in cui sono stati cercati i simboli delle chiavi (NULL se le
+  // chiavi non hanno simbolo). Una chiave con simbolo 0 non compare nella
+  // tabella e quindi in nessuno schema che la usa.
+  const js_symtab *symbols;
+} payload_tape;
+
+static inline payload_tape_tag payload_tape_tag_at(const payload_tape *t, size_t i)
+{
+  return (payload_tape_tag)(t->entries[i] >> 56);
+}
+
+static inline uint64_t payload_tape_data(const payload_tape *t, size_t i)
+{
+  return t->entries[i] & TAPE_PAYLOAD_MASK;
+}
+
+// Indice del valore successivo a quello che inizia in `i`.
+static inline size_t payload_tape_next(const payload_tape *t, size_t i)
+{
+  switch (payload_tape_tag_at(t, i))
+  {
+  case TAPE_OBJECT:
+  case TAPE_ARRAY:
+    return (size_t)payload_tape_data(t, i) + 1;
+  case TAPE_STRING:
+  case TAPE_INT:
+  case TAPE_DOUBLE:
+  case TAPE_RAWNUM:
+    return i + 2;
+  default:
+    return i + 1;
+  }
+}
+
+static inline const char *payload_tape_string(const payload_tape *t, size_t i)
+{
+  return t->text + payload_tape_data(t, i);
+}
+
+static inline size_t payload_tape_string_len(const payload_tape *t, size_t i)
+{
+  return (size_t)(t->entries[i + 1] & TAPE_LEN_MASK);
+}
+
+// Simbolo della chiave alla voce `k` (0 se assente o non internata).
+static inline js_symbol payload_tape_key_symbol(const payload_tape *t, size_t k)
+{
+  return (js_symbol)(t->entries[k + 1] >> TAPE_LEN_BITS);
+}
+
+// Numero di figli di un oggetto o array.
+static inline size_t payload_tape_size(const payload_tape *t, size_t i)
+{
+  return (size_t)payload_tape_data(t, (size_t)payload_tape_data(t, i));
+}
+
+static inline bool payload_tape_is_number(const payload_tape *t, size_t i)
+{
+  payload_tape_tag tag = payload_tape_tag_at(t, i);
+  return tag == TAPE_INT || tag == TAPE_DOUBLE || tag == TAPE_RAWNUM;
+}
+
+void payload_tape_init(payload_tape *t);
+void payload_tape_free(payload_tape *t);
+// Aggiunge una voce con tag e dato; false se la memoria non basta.
+bool payload_tape_emit(payload_tape *t, payload_tape_tag tag, uint64_t data);
+// Aggiunge una voce grezza (seconda voce di stringhe e numeri).
+bool payload_tape_emit_word(payload_tape *t, uint64_t word);
+
+// Aggiunge `n` byte in fondo all'area di testo propria del tape (text_cap
+// != 0 oppure ancora vuota), che cresce per raddoppio: gli offset già
+// emessi restano validi. false se la memoria non basta.
+bool payload_tape_append_text(payload_tape *t, const char *s, size_t n);
+
+// Valore numerico della voce `i`: i lessemi vengono decodificati alla prima
+// richiesta e la voce diventa TAPE_DOUBLE.
+double payload_tape_number(payload_tape *t, size_t i);
+// true se il numero ha valore intero (anche oltre INT_MAX).
+bool payload_tape_is_integer(payload_tape *t, size_t i);
+
+// Valore del membro `name` (prima occorrenza) dell'oggetto in `obj`. Con
+// `sym` != 0, valido solo se il nome proviene dalla stessa tabella
+// `t->symbols`, il confronto avviene sui simboli.
+size_t payload_tape_find(const payload_tape *t, size_t obj, const char *name, js_symbol sym);
+// Come payload_tape_find ma senza distinzione tra maiuscole e minuscole,
+// come cJSON_HasObjectItem.
+bool payload_tape_has_ci(const payload_tape *t, size_t obj, const char *name);
+
+// Costruisce il tape equivalente a un DOM cJSON (es. body YAML); le stringhe
+// vengono copiate in un'area propria del tape e le chiavi cercate in
+// `symbols` (opzionale).
+bool payload_tape_from_cjson(payload_tape *out, const cJSON *root, const js_symtab *symbols);
+// Vista di compatibilità: DOM cJSON equivalente al tape (i valori saltati
+// diventano nodi cJSON_Raw vuoti). NULL se la memoria non basta.
+cJSON *payload_tape_to_cjson(payload_tape *t);
+
+// Libera un DOM come cJSON_Delete ma senza ricorsione, così anche payload
+// annidati oltre i limiti predefiniti (--max-depth 0) non esauriscono lo stack.
+void payload_free(cJSON *item);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Profilo delle fasi di una validazione: intervalli annidati con orologio
+// monotono, aggregati per nome e conservati singolarmente (fino a un limite)
+// per l'esportazione nel formato trace_event di Chrome. Gli intervalli si
+// chiudono in ordine inverso di apertura; un profilo non è condiviso tra
+// thread.
+typedef struct profile profile;
+
+// Crea un profilo; con `schemas` il validatore apre un intervallo per ogni
+// sotto-schema raggiunto tramite $ref.
+profile *profile_create(bool schemas);
+void profile_free(profile *p);
+bool profile_schemas(const profile *p);
+
+// Nome degli intervalli aperti dal validatore per i target di $ref (il
+// dettaglio è il riferimento): nella tabella sono elencati a parte.
+#define PROFILE_SCHEMA_SPAN "$ref"
+
+// Apre un intervallo. `name` e `detail` (opzionale, ad esempio il $ref) non
+// vengono copiati e devono restare validi fino all'ultimo uso del profilo.
+void profile_begin(profile *p, const char *name, const char *detail);
+// Chiude l'intervallo aperto più di recente.
+void profile_end(profile *p);
+
+// Stampa la tabella dei tempi: le fasi nell'ordine in cui compaiono, con
+// tempo totale e proprio (al netto degli intervalli annidati), e i
+// sotto-schemi più costosi per tempo proprio.
+void profile_print(const profile *p, FILE *f);
+// Scrive gli intervalli in `path` come JSON trace_event (eventi "X"),
+// apribile con chrome://tracing o Perfetto. false se il file non è scrivibile.
+bool profile_write_trace(const profile *p, const char *path);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PROXY_H
+#define PROXY_H
+#include <stdbool.h>
+#include "inflate_stream.h"
+#include "jsonschema.h"
+#include "oas_spec.h"
+#include "payload_parse.h"
+#include "result_cache.h"
+
+// Body più grande accettato dal proxy senza --max-bytes: il body viene
+// tenuto in memoria per intero prima della validazione.
+#define PROXY_DEFAULT_MAX_BYTES ((size_t)64 * 1024 * 1024)
+
+// Configurazione del proxy di validazione.
+typedef struct proxy_options
+{
+  const char *listen;   // "porta" oppure "host:porta"
+  const char *upstream; // "host:porta" a cui inoltrare le richieste valide
+  payload_limits limits; // max_bytes 0 = PROXY_DEFAULT_MAX_BYTES
+  jsval_mode mode;
+  bool memo;
+  result_cache *cache; // esiti dei body già visti (NULL = disattivata)
+  work_pool *pool;     // thread per gli array grandi (NULL = validazione seriale)
+  size_t parallel_items;
+  size_t max_inflated; // byte decompressi dei body con Content-Encoding (0 = nessun limite)
+  mem_account *memory; // memoria di ogni richiesta, con il suo limite (NULL = nessuna contabilità)
+  bool adaptive_order; // proprietà in ordine di rifiuti osservati (jsval_ctx.adaptive_order)
+  req_budget *budget;  // tempo e passi di ogni validazione (NULL = nessun limite)
+} proxy_options;
+
+// Reverse proxy HTTP/1.1 con keep-alive (epoll, un solo thread): per ogni
+// richiesta individua l'operazione (metodo e path, anche con parametri) nella
+// versione corrente di `slot`, valida il body (decompresso se la richiesta ha
+// Content-Encoding gzip o deflate) e risponde 400 con il motivo
+// oppure inoltra la richiesta invariata a `upstream`, restituendone la
+// risposta. Per ogni richiesta scrive su stderr i tempi di validazione,
+// dell'upstream e l'overhead introdotto (con `memory` anche il picco di
+// memoria della validazione; oltre il limite il body riceve 400; con
+// `budget` esaurito la richiesta riceve 503 e non viene inoltrata). Le
+// connessioni lente o inattive vengono chiuse allo scadere dei tempi
+// PROXY_*_TIMEOUT_MS di proxy.c. Termina con SIGINT/SIGTERM e
+// restituisce il codice di uscita del programma.
+int proxy_run(oas_spec_slot *slot, const proxy_options *opts);
+
+#endif
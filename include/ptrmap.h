@@ -0,0 +1,32 @@
+#ifndef PTRMAP_H
+#define PTRMAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Tabella hash a indirizzamento aperto con chiavi puntatore. Non possiede né
+// le chiavi né i valori: serve a indicizzare nodi cJSON già esistenti.
+typedef struct ptrmap_entry
+{
+  const void *key;
+  void *value;
+} ptrmap_entry;
+
+typedef struct ptrmap
+{
+  ptrmap_entry *entries;
+  size_t cap;
+  size_t count;
+} ptrmap;
+
+// Inizializza una mappa vuota dimensionata per circa `hint` elementi.
+bool ptrmap_init(ptrmap *m, size_t hint);
+// Libera la tabella (non i valori puntati).
+void ptrmap_free(ptrmap *m);
+// Inserisce o sostituisce il valore associato a `key`.
+bool ptrmap_put(ptrmap *m, const void *key, void *value);
+// Restituisce il valore associato a `key` oppure NULL se assente.
+void *ptrmap_get(const ptrmap *m, const void *key);
+// Svuota la mappa mantenendo la capacità allocata.
+void ptrmap_clear(ptrmap *m);
+
+#endif
@@ -7,6 +7,7 @@ typedef struct regex_compat_result
 {
   bool valid;
   bool matched;
+  bool interrupted; // budget della richiesta (req_budget_current) esaurito: matched è false
 } regex_compat_result;
 
 regex_compat_result regex_compat_match(const char *pattern, const char *text);
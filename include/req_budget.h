@@ -0,0 +1,65 @@
+#ifndef REQ_BUDGET_H
+#define REQ_BUDGET_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Budget di tempo e di passi di una richiesta. Parser, validatore e motore
+// regex contano un passo a ogni iterazione dei propri cicli (un valore del
+// body, un frame del validatore, un tentativo del backtracking) e ogni
+// REQ_BUDGET_CHECK_STEPS passi li addebitano al budget, che confronta il
+// totale con il limite di passi e l'orologio con la scadenza. Un budget
+// esaurito resta segnato: tutti i thread che lavorano sulla richiesta si
+// fermano al controllo successivo e il chiamante riporta un esito distinto
+// da un body non valido. regexec di POSIX non è interrompibile: il controllo
+// avviene tra una regex e l'altra.
+typedef struct req_budget req_budget;
+
+// Passi accumulati localmente tra due addebiti.
+#define REQ_BUDGET_CHECK_STEPS 256
+
+// Crea un budget di `seconds` secondi e `steps` passi (0 = nessun limite).
+req_budget *req_budget_create(double seconds, unsigned long long steps);
+void req_budget_free(req_budget *b);
+// Inizia una nuova richiesta: azzera i passi e fissa la scadenza da adesso
+// (NULL è ammesso).
+void req_budget_start(req_budget *b);
+
+// Attiva `b` (anche NULL) per il thread corrente, per i componenti che non
+// ricevono il contesto (regex_compat); restituisce il budget attivo in
+// precedenza, da ripristinare con un'altra chiamata.
+req_budget *req_budget_enter(req_budget *b);
+req_budget *req_budget_current(void);
+
+// Addebita `steps` passi e controlla la scadenza: false se il budget è
+// esaurito (da ora o in precedenza).
+bool req_budget_charge(req_budget *b, unsigned long long steps);
+bool req_budget_exceeded(const req_budget *b);
+// Passi addebitati dall'inizio della richiesta.
+unsigned long long req_budget_used(const req_budget *b);
+// Descrive il limite superato ("durata oltre 50 ms", "oltre 1000000 passi").
+void req_budget_describe(const req_budget *b, char *buf, size_t size);
+
+// Contatore locale di un ciclo: req_budget_tick costa un incremento e un
+// confronto, l'addebito avviene ogni REQ_BUDGET_CHECK_STEPS passi.
+typedef struct req_budget_meter
+{
+  req_budget *budget; // NULL = nessun budget
+  unsigned ticks;
+} req_budget_meter;
+
+static inline req_budget_meter req_budget_meter_of(req_budget *b)
+{
+  req_budget_meter m = {b, 0};
+  return m;
+}
+
+// Conta un passo; false se il budget è esaurito.
+static inline bool req_budget_tick(req_budget_meter *m)
+{
+  if (!m->budget || ++m->ticks < REQ_BUDGET_CHECK_STEPS)
+    return true;
+  m->ticks = 0;
+  return req_budget_charge(m->budget, REQ_BUDGET_CHECK_STEPS);
+}
+
+#endif
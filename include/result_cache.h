@@ -0,0 +1,55 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cache degli esiti di validazione: a parità di versione della specifica,
+// operazione e byte del body l'esito non cambia, quindi un body già visto
+// (retry dei client, probe e heartbeat ripetuti) riceve il verdetto
+// memorizzato senza essere interpretato. La cache è divisa in shard, ognuno
+// con il proprio lock e la propria lista LRU.
+typedef struct result_cache result_cache;
+
+// Chiave a 128 bit; vedi result_cache_key.
+typedef struct result_cache_key
+{
+  uint64_t lo;
+  uint64_t hi;
+} result_cache_key;
+
+typedef struct result_cache_stats
+{
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t insertions;
+  uint64_t evictions;
+  uint64_t invalidations; // svuotamenti dovuti a una nuova versione
+  size_t entries;
+  size_t capacity;
+} result_cache_stats;
+
+// Crea una cache da `capacity` esiti al massimo, distribuiti su `shards`
+// shard (0 = predefinito). NULL se `capacity` è 0 o la memoria non basta.
+result_cache *result_cache_create(size_t capacity, unsigned shards);
+void result_cache_free(result_cache *c);
+
+// Hash con seme casuale del processo di (versione della specifica, metodo,
+// endpoint, modalità, body): con un seme non prevedibile un client non può
+// costruire un body che collida con quello di un esito già memorizzato.
+result_cache_key result_cache_key_of(const result_cache *c, uint64_t spec_uid, const char *method,
+                                     const char *endpoint, int mode, const void *body, size_t len);
+
+// Cerca l'esito di `key`: restituisce true e scrive in `*verdict` il codice
+// memorizzato e in `*reason` (se non NULL) una copia del motivo da liberare
+// con free (NULL se l'esito non ha motivo).
+bool result_cache_get(result_cache *c, const result_cache_key *key, int *verdict, char **reason);
+// Memorizza l'esito di `key`, sostituendo il meno recente dello shard se pieno.
+void result_cache_put(result_cache *c, const result_cache_key *key, int verdict, const char *reason);
+// Elimina tutti gli esiti (da chiamare quando viene pubblicata una nuova
+// versione della specifica: le chiavi precedenti non verrebbero più cercate).
+void result_cache_clear(result_cache *c);
+
+void result_cache_get_stats(result_cache *c, result_cache_stats *out);
+
+#endif
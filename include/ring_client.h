@@ -0,0 +1,41 @@
+#ifndef RING_CLIENT_H
+#define RING_CLIENT_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Produttore per l'anello in memoria condivisa (vedi shm_ring.h): invia al
+// validatore avviato con --ring i body letti da file e ne raccoglie gli
+// esiti.
+
+// Attesa massima di uno slot libero o di un esito prima di considerare il
+// validatore non più in grado di rispondere.
+#define RING_SEND_TIMEOUT_MS 30000
+
+// Operazione con cui validare i body: id della specifica nel registro del
+// validatore, metodo, path e modalità (jsval_mode).
+typedef struct ring_send_request
+{
+  const char *spec_id;
+  const char *method;
+  const char *path;
+  unsigned mode;
+} ring_send_request;
+
+// Esito del file `index` di ring_send_files: codice come quelli di uscita
+// del programma e motivo ("" se valido).
+typedef void (*ring_send_fn)(void *arg, size_t index, int code, const char *reason);
+
+// Si registra come produttore sull'anello `name` e invia i `count` file
+// `files` ("-" = standard input) con l'operazione `req`. Ogni body viene
+// letto direttamente nel proprio slot e le richieste restano in corso fino
+// a una per slot: quando non ci sono slot liberi raccoglie un esito prima
+// di riservarne un altro. `done` viene chiamata una volta per file,
+// nell'ordine in cui arrivano gli esiti; un file illeggibile riceve il
+// codice 3 e uno più grande dello slot il codice 2, senza essere inviati.
+// false con un messaggio in `*error_msg` (da liberare con free) se l'anello
+// non è disponibile o il validatore termina o smette di rispondere; i file
+// rimasti senza esito non ricevono chiamate.
+bool ring_send_files(const char *name, const ring_send_request *req, const char *const *files, size_t count,
+                     ring_send_fn done, void *arg, char **error_msg);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef RING_SERVER_H
+#define RING_SERVER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "jsonschema.h"
+#include "payload_parse.h"
+#include "result_cache.h"
+#include "spec_registry.h"
+
+// Configurazione del validatore che riceve le richieste da un anello in
+// memoria condivisa (vedi shm_ring.h).
+typedef struct ring_server_options
+{
+  const char *name; // segmento "/nome"
+  size_t slots;     // 0 = SHM_RING_DEFAULT_SLOTS
+  size_t slot_size; // byte di body per slot, 0 = SHM_RING_DEFAULT_SLOT_SIZE
+  payload_limits limits;
+  bool memo;
+  result_cache *cache; // esiti dei body già visti (NULL = disattivata)
+  work_pool *pool;     // thread per gli array grandi (NULL = validazione seriale)
+  size_t parallel_items;
+  mem_account *memory; // memoria di ogni richiesta, con il suo limite (NULL = nessuna contabilità)
+  bool adaptive_order; // proprietà in ordine di rifiuti osservati (jsval_ctx.adaptive_order)
+  req_budget *budget;  // tempo e passi di ogni validazione (NULL = nessun limite)
+} ring_server_options;
+
+// Crea l'anello `opts->name` e valida, nell'ordine in cui sono state
+// riservate, le richieste pubblicate dai produttori: la specifica è quella
+// dell'id indicato nello slot in `reg`, l'operazione è scelta da metodo e
+// path come in modalità proxy e il body viene interpretato sul posto nello
+// slot. Codice (come quelli di uscita del programma) e motivo tornano al
+// produttore nello slot stesso. Termina con SIGINT/SIGTERM, scrive su stderr
+// un riepilogo e restituisce il codice di uscita del programma.
+int ring_server_run(spec_registry *reg, const ring_server_options *opts);
+
+#endif
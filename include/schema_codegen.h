@@ -0,0 +1,28 @@
+#ifndef SCHEMA_CODEGEN_H
+#define SCHEMA_CODEGEN_H
+#include <stdbool.h>
+#include <stdio.h>
+#include "cJSON.h"
+
+// Generatore di validatori specializzati: traduce uno schema (con i $ref
+// risolti rispetto a `oas_root`) in un file C autonomo che contiene la
+// funzione
+//
+//   jsval_result <name>(payload_tape *tape, const jsval_ctx *ctx);
+//
+// con la stessa interfaccia e gli stessi esiti (messaggi compresi) di
+// js_validate_tape sullo stesso schema. Del contesto vengono usati solo
+// `mode` e `max_depth`. Ogni sotto-schema raggiungibile diventa una funzione
+// con i vincoli come costanti; i nomi delle proprietà e i valori "enum"
+// vengono riconosciuti da uno switch sulla lunghezza e su un carattere
+// discriminante, i pattern sono compilati una sola volta al primo uso. Il
+// file include "jsonschema.h" e va collegato con le sorgenti del validatore
+// (o caricato come libreria condivisa da un eseguibile che le esporta).
+//
+// `title` (opzionale) compare nel commento iniziale del file. Restituisce
+// false con `*error` allocato (da liberare con free) se `name` non è un
+// identificatore C, la memoria non basta o la scrittura fallisce.
+bool js_codegen_emit(FILE *out, const cJSON *schema, cJSON *oas_root, const char *name, const char *title,
+                     char **error);
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef SCHEMA_COMPILE_H
+#define SCHEMA_COMPILE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "key_matcher.h"
+#include "symtab.h"
+#ifndef _MSC_VER
+#include <regex.h>
+#endif
+
+// Espressione regolare precompilata: su POSIX conserva il regex_t, con MSVC
+// (regex_compat non ha una fase di compilazione) conserva solo il pattern.
+typedef struct js_regex
+{
+  bool valid;
+#ifndef _MSC_VER
+  regex_t re;
+#else
+  char *pattern;
+#endif
+} js_regex;
+
+// Compila `pattern`; `out->valid` è false se il pattern non è valido.
+void js_regex_compile(js_regex *out, const char *pattern);
+// Restituisce true se `text` contiene una corrispondenza di `re`.
+bool js_regex_match(const js_regex *re, const char *text);
+void js_regex_free(js_regex *re);
+
+// Tabella ordinata dei valori di un "enum" composto solo da stringhe.
+typedef struct js_enum_table
+{
+  char **values;
+  size_t count;
+} js_enum_table;
+
+// Restituisce true se `s` è uno dei valori della tabella (ricerca binaria).
+bool js_enum_table_contains(const js_enum_table *t, const char *s);
+
+// Vincoli dimensionali di uno schema; -1 indica un vincolo assente.
+typedef struct js_size_limits
+{
+  long long min_length;
+  long long max_length;
+  long long min_items;
+  long long max_items;
+  long long min_properties;
+  long long max_properties;
+} js_size_limits;
+
+// Legge min/maxLength, min/maxItems e min/maxProperties da `schema`.
+void js_size_limits_read(const cJSON *schema, js_size_limits *out);
+
+// Voce compilata di patternProperties: pattern della chiave e sotto-schema.
+typedef struct js_pattern_prop
+{
+  const char *pattern;
+  const js_regex *re;
+  cJSON *schema;
+} js_pattern_prop;
+
+// Rifiuti osservati per le proprietà di "properties" di un nodo, usati
+// dall'ordine adattivo del validatore (jsval_ctx.adaptive_order): le
+// proprietà che respingono più spesso i payload vengono validate per prime.
+// I contatori sono atomici e condivisi tra i thread che validano con la
+// stessa specifica; l'insieme delle proprietà da anticipare viene letto e
+// pubblicato come una sola parola, quindi un frame non vede mai un ordine
+// parziale.
+typedef struct js_prop_stats js_prop_stats;
+
+// Proprietà anticipate al massimo per nodo.
+#define JS_PROP_HOT 4
+
+// Numero di proprietà (sotto-schemi oggetto con nome, nell'ordine dello schema).
+size_t js_prop_stats_count(const js_prop_stats *s);
+cJSON *js_prop_stats_prop(const js_prop_stats *s, size_t i);
+// Indici delle proprietà da validare per prime, JS_PROP_HOT campi da 16 bit
+// che contengono indice + 1 (0 = campo vuoto), a partire dai bit bassi.
+uint64_t js_prop_stats_hot(const js_prop_stats *s);
+// Registra un payload respinto dalla proprietà `i`.
+void js_prop_stats_reject(js_prop_stats *s, size_t i);
+
+// Dati precalcolati per un nodo schema, ricavati una volta al caricamento
+// della specifica invece che a ogni validazione. Regex e tabelle enum sono
+// condivise tramite il pool tra tutti i nodi che usano lo stesso valore.
+typedef struct js_compiled_node
+{
+  const cJSON *schema;
+  const js_regex *pattern; // NULL se lo schema non ha "pattern"
+  js_pattern_prop *pattern_props;
+  size_t pattern_prop_count;
+  // Automa di nomi di "properties" e pattern di "patternProperties",
+  // condiviso tramite il pool (NULL se lo schema non ne ha bisogno o i
+  // pattern escono dal sottoinsieme riconosciuto): gli indici dei pattern
+  // sono quelli di `pattern_props`.
+  const js_key_matcher *keys;
+  const js_enum_table *enum_strings; // NULL se "enum" assente o non di sole stringhe
+  js_size_limits limits;
+  js_prop_stats *prop_stats; // NULL con meno di due proprietà
+} js_compiled_node;
+
+// Pool con conteggio dei riferimenti di regex, tabelle enum e automi delle
+// chiavi: pattern, enum e insiemi di proprietà identici vengono compilati una
+// sola volta, anche tra versioni successive della stessa specifica. Il pool
+// possiede anche la tabella dei simboli in cui vengono internate le stringhe
+// dei DOM che lo condividono.
+typedef struct js_compile_pool js_compile_pool;
+
+js_compile_pool *js_compile_pool_create(void);
+js_compile_pool *js_compile_pool_retain(js_compile_pool *pool);
+void js_compile_pool_release(js_compile_pool *pool);
+// Numero di regex, tabelle enum e automi distinti attualmente nel pool.
+size_t js_compile_pool_size(const js_compile_pool *pool);
+js_symtab *js_compile_pool_symbols(js_compile_pool *pool);
+// Stima dei byte occupati dal pool, tabella dei simboli compresa. Lo stato
+// interno delle regex non è visibile: ne viene stimato il costo dal pattern.
+size_t js_compile_pool_bytes(js_compile_pool *pool);
+
+// Insieme dei nodi compilati di un sottoalbero di schema (ne possiede i dati).
+// Gli oggetti strutturalmente identici (stesso hash e stesso contenuto)
+// condividono un solo nodo compilato.
+typedef struct js_compiled js_compiled;
+
+// Compila tutti gli oggetti del sottoalbero `schema` usando `pool` (se NULL
+// ne viene creato uno privato). I nodi marcati come cJSON_IsReference non
+// vengono attraversati: appartengono a un'altra unità.
+js_compiled *js_compile_schema(const cJSON *schema, js_compile_pool *pool);
+void js_compiled_free(js_compiled *c);
+// Numero di nodi compilati distinti contenuti nell'unità.
+size_t js_compiled_count(const js_compiled *c);
+// Numero di oggetti schema ricondotti a un nodo compilato già esistente.
+size_t js_compiled_shared_count(const js_compiled *c);
+// Byte occupati dai nodi compilati dell'unità (escluse le voci del pool).
+size_t js_compiled_bytes(const js_compiled *c);
+
+// Indice non proprietario che unisce più unità compilate e permette al
+// validatore di trovare i dati compilati a partire dal nodo cJSON.
+typedef struct js_schema_index js_schema_index;
+
+js_schema_index *js_schema_index_create(size_t hint);
+void js_schema_index_free(js_schema_index *idx);
+bool js_schema_index_add(js_schema_index *idx, const js_compiled *unit);
+// Associa `alias` allo stesso nodo compilato di `target` (già indicizzato).
+bool js_schema_index_alias(js_schema_index *idx, const cJSON *alias, const cJSON *target);
+const js_compiled_node *js_schema_index_lookup(const js_schema_index *idx, const cJSON *schema);
+size_t js_schema_index_bytes(const js_schema_index *idx);
+
+// Hash strutturale di un sottoalbero: indipendente dall'ordine delle chiavi
+// degli oggetti, dipendente dall'ordine degli elementi degli array.
+uint64_t js_hash_node(const cJSON *node);
+
+#endif
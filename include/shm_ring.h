@@ -0,0 +1,112 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Trasporto delle richieste tra processi sullo stesso host tramite un
+// segmento di memoria condivisa (shm_open), creato dal validatore e aperto
+// dai processi produttori. Il segmento contiene slot di dimensione fissa:
+// un produttore prende uno slot libero, scrive body, metodo, path e id della
+// specifica direttamente nello slot e ne pubblica l'indice nell'anello
+// delle richieste (MPSC: la posizione viene presa con una compare-and-swap,
+// come nelle code limitate a numeri di sequenza); il validatore legge lo
+// slot sul posto, senza copie, e vi scrive codice e motivo dell'esito. Ogni
+// produttore registrato ha un anello di completamento SPSC in cui il
+// validatore accoda gli slot terminati; il produttore li raccoglie e
+// restituisce gli slot liberi. Le attese usano i futex sulle parole del
+// segmento e le system call avvengono solo quando una delle due parti è
+// ferma ad aspettare: finché validatore e produttori hanno lavoro lo scambio
+// non entra nel kernel.
+typedef struct shm_ring shm_ring;
+
+#define SHM_RING_DEFAULT_SLOTS 256
+#define SHM_RING_MAX_SLOTS 65536
+#define SHM_RING_DEFAULT_SLOT_SIZE ((size_t)64 * 1024)
+#define SHM_RING_MAX_SLOT_SIZE ((size_t)1024 * 1024 * 1024)
+#define SHM_RING_MAX_CLIENTS 32
+#define SHM_RING_ID_MAX 64
+#define SHM_RING_METHOD_MAX 16
+#define SHM_RING_PATH_MAX 1024
+#define SHM_RING_REASON_MAX 512
+
+// Richiesta pubblicata in uno slot, come la vede il validatore. Le stringhe
+// sono terminate da NUL e puntano nello slot; il body può essere modificato
+// sul posto (il parser decodifica le stringhe nello slot) ed è seguito da un
+// byte NUL.
+typedef struct shm_ring_request
+{
+  uint32_t slot;
+  const char *spec_id;
+  const char *method;
+  const char *path;
+  unsigned mode; // jsval_mode
+  char *body;
+  size_t len;
+  bool truncated; // `len` dichiarato oltre la dimensione dello slot
+} shm_ring_request;
+
+// Esito di una richiesta, come lo vede il produttore.
+typedef struct shm_ring_completion
+{
+  uint32_t slot;
+  uint64_t tag;       // valore passato a shm_ring_submit
+  int code;           // codici di uscita del programma: 0 valido, 1 non valido, ...
+  const char *reason; // nello slot, "" se valido; resta valido fino a shm_ring_release
+} shm_ring_completion;
+
+// --- validatore ---
+
+// Crea il segmento `name` ("/nome", come per shm_open) con `slots` slot
+// (arrotondati a una potenza di due) da `slot_size` byte di body ciascuno,
+// sostituendo un segmento rimasto da un'esecuzione precedente. NULL con un
+// messaggio in `*error_msg` (da liberare con free) se non riesce.
+shm_ring *shm_ring_create(const char *name, size_t slots, size_t slot_size, char **error_msg);
+// Attende fino a `timeout_ms` millisecondi (-1 = senza limite) la prossima
+// richiesta, nell'ordine di pubblicazione. false allo scadere del tempo o
+// se un segnale interrompe l'attesa.
+bool shm_ring_next(shm_ring *r, shm_ring_request *out, int timeout_ms);
+// Scrive l'esito nello slot di `req` (il motivo viene troncato a
+// SHM_RING_REASON_MAX - 1 byte) e lo accoda al completamento del suo
+// produttore, svegliandolo se sta aspettando.
+void shm_ring_complete(shm_ring *r, const shm_ring_request *req, int code, const char *reason);
+// Rimette tra i liberi gli slot dei produttori terminati, anche per un
+// crash, o scollegati senza averli restituiti: riservati, in attesa di
+// essere raccolti o raccolti e non rilasciati. Restituisce il numero di
+// slot recuperati. Il validatore la chiama periodicamente; la chiama anche
+// shm_ring_attach.
+size_t shm_ring_reclaim(shm_ring *r);
+// Segnala ai produttori la chiusura, li sveglia e rimuove il segmento.
+void shm_ring_destroy(shm_ring *r);
+
+// --- produttore ---
+
+// Apre il segmento `name` creato dal validatore e registra il processo come
+// produttore (fino a SHM_RING_MAX_CLIENTS contemporaneamente). La
+// registrazione è legata a un lock sul file del segmento: quando il
+// processo termina, anche senza shm_ring_detach, l'indice torna
+// disponibile e i suoi slot vengono recuperati. Un handle va usato da un
+// solo thread alla volta.
+shm_ring *shm_ring_attach(const char *name, char **error_msg);
+void shm_ring_detach(shm_ring *r);
+// Byte di body disponibili in ogni slot.
+size_t shm_ring_slot_size(const shm_ring *r);
+
+// Riserva uno slot, attendendo fino a `timeout_ms` se sono tutti in uso, e
+// restituisce in `*body` l'area in cui scrivere il body. -1 allo scadere
+// del tempo o se il validatore è terminato: gli slot degli esiti non ancora
+// raccolti restano del produttore, che con molte richieste in corso deve
+// raccoglierli (shm_ring_wait) per liberarne.
+long shm_ring_reserve(shm_ring *r, char **body, int timeout_ms);
+// Pubblica lo slot riservato con i `len` byte di body già scritti. Le
+// stringhe vengono copiate nello slot (troncate alle dimensioni massime);
+// `tag` torna nel completamento.
+void shm_ring_submit(shm_ring *r, long slot, const char *spec_id, const char *method, const char *path,
+                     unsigned mode, size_t len, uint64_t tag);
+// Raccoglie il prossimo esito di questo produttore, attendendo fino a
+// `timeout_ms`. false allo scadere del tempo o se il validatore è terminato.
+bool shm_ring_wait(shm_ring *r, shm_ring_completion *out, int timeout_ms);
+// Rimette tra i liberi lo slot di un esito raccolto.
+void shm_ring_release(shm_ring *r, uint32_t slot);
+
+#endif
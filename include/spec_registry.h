@@ -0,0 +1,53 @@
+#ifndef SPEC_REGISTRY_H
+#define SPEC_REGISTRY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "oas_spec.h"
+
+// Registro di più specifiche (una per tenant o integrazione) identificate da
+// un id. Le versioni compilate sono indicizzate per hash del contenuto, così
+// id diversi con lo stesso file condividono una sola compilazione, e restano
+// in memoria entro un budget: quando viene superato si liberano le meno
+// usate di recente, che verranno ricaricate al prossimo uso.
+typedef struct spec_registry spec_registry;
+
+typedef struct spec_registry_stats
+{
+  uint64_t hits;      // richieste servite da una versione già in memoria
+  uint64_t misses;    // richieste che hanno richiesto una compilazione
+  uint64_t evictions; // versioni liberate per rientrare nel budget
+  uint64_t reloads;   // compilazioni dovute a un file modificato
+  uint64_t shared;    // hit su una versione compilata per un altro id
+  size_t registered;  // id registrati
+  size_t resident;    // versioni compilate in memoria
+  size_t resident_bytes;
+  size_t budget_bytes;
+} spec_registry_stats;
+
+// Crea un registro con budget di `budget_bytes` (0 = nessun limite). Con
+// `prune` le specifiche vengono potate al caricamento (vedi oas_prune), così
+// nel budget ne restano di più.
+spec_registry *spec_registry_create(size_t budget_bytes, bool prune);
+// Libera il registro e le versioni in memoria (nessuna deve essere in uso).
+void spec_registry_free(spec_registry *r);
+
+// Registra `id` associandolo al file `path`; la specifica verrà caricata al
+// primo uso. Restituisce false se l'id è già registrato o la memoria non basta.
+bool spec_registry_add(spec_registry *r, const char *id, const char *path);
+// Registra gli id elencati nel file `list_path`, una coppia "id percorso" per
+// riga (righe vuote e commenti '#' ignorati; i percorsi relativi sono
+// relativi alla cartella dell'elenco). Restituisce il numero di id registrati
+// oppure -1 con un messaggio in `*error_msg` da liberare con free.
+long spec_registry_add_list(spec_registry *r, const char *list_path, char **error_msg);
+
+// Restituisce la versione corrente di `id`, caricandola se non è in memoria
+// o se il file è cambiato, e la protegge dallo sfratto fino a
+// spec_registry_release. NULL con un messaggio in `*error_msg` se l'id non
+// esiste o la specifica non si carica.
+const oas_spec *spec_registry_acquire(spec_registry *r, const char *id, char **error_msg);
+void spec_registry_release(spec_registry *r, const oas_spec *spec);
+
+void spec_registry_get_stats(spec_registry *r, spec_registry_stats *out);
+
+#endif
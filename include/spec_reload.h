@@ -0,0 +1,19 @@
+#ifndef SPEC_RELOAD_H
+#define SPEC_RELOAD_H
+#include <stdbool.h>
+#include "oas_spec.h"
+
+// Ricaricatore in background: su richiesta esplicita o (opzionalmente) su
+// modifica del file, reinterpreta la specifica, ricompila solo le unità
+// cambiate e pubblica la nuova versione nello slot.
+typedef struct spec_reloader spec_reloader;
+
+// Avvia il thread di ricaricamento. Con `watch_file` osserva il file tramite
+// inotify (su Linux) o confrontando periodicamente la data di modifica.
+spec_reloader *spec_reloader_start(oas_spec_slot *slot, const char *path, bool watch_file);
+// Chiede un ricaricamento asincrono (comando "reload").
+void spec_reloader_request(spec_reloader *r);
+// Ferma il thread e libera le risorse (lo slot resta al chiamante).
+void spec_reloader_stop(spec_reloader *r);
+
+#endif
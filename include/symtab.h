@@ -0,0 +1,54 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+
+// Identificativo di una stringa internata; 0 indica nessun simbolo.
+typedef uint32_t js_symbol;
+
+// Identificativi disponibili: il tape del payload riserva 24 bit al simbolo
+// di ogni chiave. Oltre il limite le stringhe vengono ancora condivise ma
+// ricevono il simbolo 0 e si confrontano come testo.
+#define JS_SYMBOL_MAX 0xFFFFFFu
+
+// Tabella dei simboli: ogni stringa distinta è memorizzata una sola volta e
+// riceve un identificativo, così nomi di proprietà dello schema e chiavi del
+// payload si confrontano come interi. L'inserimento è serializzato da un
+// mutex, la ricerca non prende lock e può procedere in parallelo a un
+// inserimento (ricaricamento della specifica mentre si validano richieste).
+typedef struct js_symtab js_symtab;
+
+js_symtab *js_symtab_create(void);
+// Libera la tabella e tutte le stringhe internate.
+void js_symtab_free(js_symtab *t);
+
+// Restituisce la copia condivisa (terminata da NUL) dei `len` byte di `s`,
+// inserendola se assente; NULL se la memoria non basta.
+const char *js_symtab_intern(js_symtab *t, const char *s, size_t len);
+// Simbolo dei `len` byte di `s` se già internati, altrimenti 0.
+js_symbol js_symtab_lookup(const js_symtab *t, const char *s, size_t len);
+// Simbolo di una stringa restituita da js_symtab_intern.
+js_symbol js_symbol_of(const char *interned);
+
+// Numero di stringhe distinte e byte occupati dalla tabella.
+size_t js_symtab_count(const js_symtab *t);
+size_t js_symtab_bytes(const js_symtab *t);
+
+// Sostituisce nomi dei membri e valori stringa del DOM con le copie internate
+// (marcate cJSON_StringIsConst e cJSON_IsReference, quindi cJSON_Delete non
+// le libera: la tabella deve sopravvivere al DOM). I sottoalberi marcati
+// cJSON_IsReference non vengono attraversati. Restituisce i byte di stringhe
+// duplicate liberati e, in `*distinct` se non è NULL, il numero di stringhe
+// distinte del DOM: la tabella non rimuove voci, e il confronto con
+// js_symtab_count dice quante appartengono solo ad altri DOM.
+size_t js_symtab_intern_dom(js_symtab *t, cJSON *root, size_t *distinct);
+
+// Simbolo del nome del membro `item` se è stato internato, altrimenti 0.
+static inline js_symbol js_symbol_of_key(const cJSON *item)
+{
+  return item->string && (item->type & cJSON_StringIsConst) ? js_symbol_of(item->string) : 0;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+#include <stdbool.h>
+
+// Pool di thread persistenti che eseguono la stessa funzione insieme al
+// chiamante: serve a dividere un singolo lavoro grande (ad esempio gli
+// elementi di un array enorme) senza creare thread per ogni richiesta. Il
+// pool esegue un lavoro alla volta; la distribuzione del lavoro tra i
+// partecipanti spetta alla funzione.
+typedef struct work_pool work_pool;
+
+// Crea un pool con `threads` thread oltre al chiamante. NULL se la memoria
+// non basta o nessun thread può essere avviato.
+work_pool *work_pool_create(unsigned threads);
+// Ferma e attende i thread. Nessun lavoro deve essere in corso.
+void work_pool_free(work_pool *p);
+// Thread del pool (escluso il chiamante di work_pool_run).
+unsigned work_pool_threads(const work_pool *p);
+
+// Esegue `fn(arg)` su ogni thread del pool e sul chiamante, e ritorna quando
+// tutte le chiamate sono terminate. Restituisce false, senza eseguire nulla,
+// se il pool è già occupato da un altro lavoro: il chiamante procede allora
+// da solo.
+bool work_pool_run(work_pool *p, void (*fn)(void *), void *arg);
+
+#endif
@@ -0,0 +1,949 @@
+#if defined(__linux__)
+#define _DEFAULT_SOURCE
+#endif
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file_batch.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <threads.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define FILE_BATCH_DEFAULT_DEPTH 64
+#define FILE_BATCH_MAX_DEPTH 4096
+#define FILE_BATCH_DEFAULT_THREADS 4
+
+// Messaggio di errore allocato, da liberare con free.
+static char *error_printf(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return NULL;
+  char *s = (char *)malloc((size_t)n + 1);
+  if (!s)
+    return NULL;
+  va_start(ap, fmt);
+  vsnprintf(s, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  return s;
+}
+
+void file_list_free(file_list *l)
+{
+  if (!l)
+    return;
+  for (size_t i = 0; i < l->count; ++i)
+    free(l->paths[i]);
+  free(l->paths);
+  l->paths = NULL;
+  l->count = l->cap = 0;
+}
+
+#if !defined(_WIN32)
+
+static bool list_push(file_list *l, const char *path)
+{
+  if (l->count == l->cap)
+  {
+    size_t ncap = l->cap ? l->cap * 2 : 256;
+    char **np = (char **)realloc(l->paths, ncap * sizeof(char *));
+    if (!np)
+      return false;
+    l->paths = np;
+    l->cap = ncap;
+  }
+  size_t len = strlen(path);
+  char *copy = (char *)malloc(len + 1);
+  if (!copy)
+    return false;
+  memcpy(copy, path, len + 1);
+  l->paths[l->count++] = copy;
+  return true;
+}
+
+static int cmp_paths(const void *a, const void *b)
+{
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Visita ricorsiva di `dir`; i collegamenti simbolici vengono seguiti solo se
+// puntano a file regolari, così un ciclo tra directory non è possibile.
+static bool walk_dir(const char *dir, file_list *out, char **error)
+{
+  DIR *d = opendir(dir);
+  if (!d)
+  {
+    *error = error_printf("impossibile aprire la directory '%s': %s", dir, strerror(errno));
+    return false;
+  }
+  size_t dlen = strlen(dir);
+  bool slash = dlen > 0 && dir[dlen - 1] == '/';
+  char *path = NULL;
+  size_t path_cap = 0;
+  bool ok = true;
+  struct dirent *e;
+  while (ok && (e = readdir(d)) != NULL)
+  {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+      continue;
+    size_t need = dlen + 1 + strlen(e->d_name) + 1;
+    if (need > path_cap)
+    {
+      char *np = (char *)realloc(path, need);
+      if (!np)
+      {
+        ok = false;
+        *error = error_printf("memoria insufficiente");
+        break;
+      }
+      path = np;
+      path_cap = need;
+    }
+    snprintf(path, path_cap, slash ? "%s%s" : "%s/%s", dir, e->d_name);
+    struct stat st;
+    if (lstat(path, &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode))
+      ok = walk_dir(path, out, error);
+    else if ((S_ISREG(st.st_mode) || (S_ISLNK(st.st_mode) && stat(path, &st) == 0 && S_ISREG(st.st_mode))) &&
+             !list_push(out, path))
+    {
+      ok = false;
+      *error = error_printf("memoria insufficiente");
+    }
+  }
+  free(path);
+  closedir(d);
+  return ok;
+}
+
+bool file_list_collect(const char *pattern, file_list *out, char **error)
+{
+  memset(out, 0, sizeof(*out));
+  *error = NULL;
+  bool ok = true;
+  if (strpbrk(pattern, "*?["))
+  {
+    glob_t g;
+    int rc = glob(pattern, GLOB_MARK, NULL, &g);
+    if (rc == GLOB_NOMATCH)
+    {
+      *error = error_printf("nessun file corrisponde a '%s'", pattern);
+      return false;
+    }
+    if (rc != 0)
+    {
+      *error = error_printf("espansione di '%s' non riuscita", pattern);
+      return false;
+    }
+    for (size_t i = 0; ok && i < g.gl_pathc; ++i)
+    {
+      const char *p = g.gl_pathv[i];
+      size_t len = strlen(p);
+      if (len > 0 && p[len - 1] == '/')
+        continue; // GLOB_MARK: directory
+      if (!list_push(out, p))
+      {
+        ok = false;
+        *error = error_printf("memoria insufficiente");
+      }
+    }
+    globfree(&g);
+  }
+  else
+  {
+    struct stat st;
+    if (stat(pattern, &st) != 0)
+    {
+      *error = error_printf("impossibile accedere a '%s': %s", pattern, strerror(errno));
+      return false;
+    }
+    if (S_ISDIR(st.st_mode))
+      ok = walk_dir(pattern, out, error);
+    else if (!list_push(out, pattern))
+    {
+      ok = false;
+      *error = error_printf("memoria insufficiente");
+    }
+  }
+  if (!ok)
+  {
+    file_list_free(out);
+    return false;
+  }
+  if (out->count > 1)
+    qsort(out->paths, out->count, sizeof(char *), cmp_paths);
+  return true;
+}
+
+// Stato di un file in lettura.
+typedef enum
+{
+  SLOT_FREE,
+  SLOT_OPENING,
+  SLOT_READING,
+} slot_state;
+
+typedef struct batch_slot
+{
+  slot_state state;
+  size_t index;
+  int fd;
+  char *data;
+  size_t size;
+  size_t got;
+  struct iovec iov;
+} batch_slot;
+
+#ifdef __linux__
+// Anelli di io_uring mappati in memoria; l'interfaccia è quella del kernel
+// (linux/io_uring.h), senza liburing.
+typedef struct uring
+{
+  int fd;
+  void *sq_ptr;
+  size_t sq_len;
+  void *cq_ptr;
+  size_t cq_len;
+  struct io_uring_sqe *sqes;
+  size_t sqes_len;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+  unsigned to_submit;
+} uring;
+#endif
+
+struct file_batch
+{
+  const char *const *paths;
+  size_t count;
+  size_t next;        // primo file non ancora avviato
+  unsigned depth;
+  size_t max_bytes;
+  file_batch_backend backend;
+
+  // file letti in attesa del chiamante (coda circolare di `depth` voci)
+  file_batch_item *ready;
+  size_t ready_head;
+  size_t ready_count;
+
+#ifdef __linux__
+  uring ring;
+  batch_slot *slots;
+  size_t *free_slots;
+  size_t free_count;
+  size_t inflight;
+  bool sync_open; // il kernel non supporta IORING_OP_OPENAT
+#endif
+
+  bool stop; // chiusura in corso
+
+  // pool di thread
+  thrd_t *threads;
+  unsigned thread_count;
+  mtx_t lock;
+  cnd_t ready_cond;
+  cnd_t space_cond;
+  size_t outstanding; // file avviati e non ancora restituiti
+  size_t returned;
+  bool pool_ready;
+};
+
+static void ready_push(file_batch *b, const file_batch_item *item)
+{
+  b->ready[(b->ready_head + b->ready_count) % b->depth] = *item;
+  ++b->ready_count;
+}
+
+static void ready_pop(file_batch *b, file_batch_item *out)
+{
+  *out = b->ready[b->ready_head];
+  b->ready_head = (b->ready_head + 1) % b->depth;
+  --b->ready_count;
+}
+
+// Dimensione del file aperto in `fd`; false (con errno) se non è un file
+// regolare leggibile.
+static bool regular_size(int fd, size_t *size)
+{
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    return false;
+  if (!S_ISREG(st.st_mode))
+  {
+    errno = S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+    return false;
+  }
+  *size = (size_t)st.st_size;
+  return true;
+}
+
+#ifdef __linux__
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static bool uring_init(uring *r, unsigned entries)
+{
+  memset(r, 0, sizeof(*r));
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  r->fd = uring_setup(entries, &p);
+  if (r->fd < 0)
+    return false;
+  r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single && r->cq_len > r->sq_len)
+    r->sq_len = r->cq_len;
+  r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+  if (r->sq_ptr == MAP_FAILED)
+    goto fail;
+  if (single)
+  {
+    r->cq_ptr = r->sq_ptr;
+  }
+  else
+  {
+    r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_ptr == MAP_FAILED)
+      goto fail;
+  }
+  r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = (struct io_uring_sqe *)mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        r->fd, IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED)
+    goto fail;
+  unsigned char *sq = (unsigned char *)r->sq_ptr;
+  unsigned char *cq = (unsigned char *)r->cq_ptr;
+  r->sq_head = (unsigned *)(sq + p.sq_off.head);
+  r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned *)(sq + p.sq_off.array);
+  r->cq_head = (unsigned *)(cq + p.cq_off.head);
+  r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  return true;
+
+fail:
+  if (r->sq_ptr && r->sq_ptr != MAP_FAILED)
+    munmap(r->sq_ptr, r->sq_len);
+  if (r->cq_ptr && r->cq_ptr != MAP_FAILED && r->cq_ptr != r->sq_ptr)
+    munmap(r->cq_ptr, r->cq_len);
+  close(r->fd);
+  r->fd = -1;
+  return false;
+}
+
+static void uring_destroy(uring *r)
+{
+  if (r->fd < 0)
+    return;
+  munmap(r->sqes, r->sqes_len);
+  if (r->cq_ptr != r->sq_ptr)
+    munmap(r->cq_ptr, r->cq_len);
+  munmap(r->sq_ptr, r->sq_len);
+  close(r->fd);
+  r->fd = -1;
+}
+
+// Prepara una nuova voce nella coda di sottomissione. La coda ha almeno
+// `depth` voci e ogni slot ne usa al più una, quindi non si riempie mai.
+static struct io_uring_sqe *uring_get_sqe(uring *r)
+{
+  unsigned tail = *r->sq_tail;
+  unsigned idx = tail & *r->sq_mask;
+  struct io_uring_sqe *sqe = &r->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  r->sq_array[idx] = idx;
+  __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ++r->to_submit;
+  return sqe;
+}
+
+static int uring_submit(uring *r, unsigned wait)
+{
+  unsigned n = r->to_submit;
+  if (n == 0 && wait == 0)
+    return 0;
+  int rc;
+  do
+    rc = uring_enter(r->fd, n, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+  while (rc < 0 && errno == EINTR);
+  if (rc >= 0)
+    r->to_submit -= (unsigned)rc < n ? (unsigned)rc : n;
+  return rc;
+}
+
+static void slot_release(file_batch *b, size_t s)
+{
+  batch_slot *slot = &b->slots[s];
+  if (slot->fd >= 0)
+    close(slot->fd);
+  slot->fd = -1;
+  slot->state = SLOT_FREE;
+  b->free_slots[b->free_count++] = s;
+  --b->inflight;
+}
+
+// Conclude la lettura dello slot `s` e mette il file nella coda dei pronti.
+static void slot_finish(file_batch *b, size_t s, int err, bool too_large)
+{
+  batch_slot *slot = &b->slots[s];
+  file_batch_item item;
+  memset(&item, 0, sizeof(item));
+  item.index = slot->index;
+  item.path = b->paths[slot->index];
+  item.error = err;
+  item.too_large = too_large;
+  if (!err && !too_large)
+  {
+    slot->data[slot->got] = '\0';
+    item.data = slot->data;
+    item.len = slot->got;
+  }
+  else
+  {
+    free(slot->data);
+  }
+  slot->data = NULL;
+  ready_push(b, &item);
+  slot_release(b, s);
+}
+
+static void slot_submit_read(file_batch *b, size_t s)
+{
+  batch_slot *slot = &b->slots[s];
+  struct io_uring_sqe *sqe = uring_get_sqe(&b->ring);
+  size_t left = slot->size - slot->got;
+  slot->iov.iov_base = slot->data + slot->got;
+  slot->iov.iov_len = left > 0x40000000u ? 0x40000000u : left;
+  // READV è disponibile da Linux 5.1, READ solo dalla 5.6
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = slot->fd;
+  sqe->addr = (unsigned long long)(uintptr_t)&slot->iov;
+  sqe->len = 1;
+  sqe->off = (unsigned long long)slot->got;
+  sqe->user_data = s;
+  slot->state = SLOT_READING;
+}
+
+// Il file dello slot è aperto: alloca il buffer e avvia la lettura.
+static void slot_opened(file_batch *b, size_t s)
+{
+  batch_slot *slot = &b->slots[s];
+  size_t size = 0;
+  if (!regular_size(slot->fd, &size))
+  {
+    slot_finish(b, s, errno, false);
+    return;
+  }
+  if (b->max_bytes && size > b->max_bytes)
+  {
+    slot_finish(b, s, 0, true);
+    return;
+  }
+  slot->data = (char *)malloc(size + 1);
+  if (!slot->data)
+  {
+    slot_finish(b, s, ENOMEM, false);
+    return;
+  }
+  slot->size = size;
+  slot->got = 0;
+  if (size == 0)
+    slot_finish(b, s, 0, false);
+  else
+    slot_submit_read(b, s);
+}
+
+static void slot_open_sync(file_batch *b, size_t s)
+{
+  batch_slot *slot = &b->slots[s];
+  slot->fd = open(b->paths[slot->index], O_RDONLY | O_CLOEXEC);
+  if (slot->fd < 0)
+    slot_finish(b, s, errno, false);
+  else
+    slot_opened(b, s);
+}
+
+// Avvia la lettura dei file successivi finché ci sono slot liberi e la coda
+// dei pronti non è piena.
+static void uring_refill(file_batch *b)
+{
+  while (b->next < b->count && b->free_count > 0 && b->inflight + b->ready_count < b->depth)
+  {
+    size_t s = b->free_slots[--b->free_count];
+    batch_slot *slot = &b->slots[s];
+    slot->index = b->next++;
+    slot->fd = -1;
+    slot->data = NULL;
+    ++b->inflight;
+    if (b->sync_open)
+    {
+      slot_open_sync(b, s);
+      continue;
+    }
+    struct io_uring_sqe *sqe = uring_get_sqe(&b->ring);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long long)(uintptr_t)b->paths[slot->index];
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    sqe->user_data = s;
+    slot->state = SLOT_OPENING;
+  }
+}
+
+static void uring_complete(file_batch *b, size_t s, int res)
+{
+  batch_slot *slot = &b->slots[s];
+  if (b->stop)
+  {
+    if (slot->state == SLOT_OPENING && res >= 0)
+      slot->fd = res;
+    slot_finish(b, s, ECANCELED, false);
+    return;
+  }
+  if (slot->state == SLOT_OPENING)
+  {
+    if (res == -EINVAL || res == -EOPNOTSUPP)
+    {
+      // kernel precedente alla 5.6: le aperture diventano sincrone
+      b->sync_open = true;
+      slot_open_sync(b, s);
+      return;
+    }
+    if (res < 0)
+    {
+      slot_finish(b, s, -res, false);
+      return;
+    }
+    slot->fd = res;
+    slot_opened(b, s);
+    return;
+  }
+  if (res == -EINTR || res == -EAGAIN)
+  {
+    slot_submit_read(b, s);
+    return;
+  }
+  if (res < 0)
+  {
+    slot_finish(b, s, -res, false);
+    return;
+  }
+  slot->got += (size_t)res;
+  if (res == 0 || slot->got == slot->size)
+    slot_finish(b, s, 0, false); // res == 0: il file si è accorciato
+  else
+    slot_submit_read(b, s);
+}
+
+// Consuma le completion disponibili senza attendere.
+static void uring_reap(file_batch *b)
+{
+  uring *r = &b->ring;
+  unsigned head = *r->cq_head;
+  unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail)
+  {
+    struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+    size_t s = (size_t)cqe->user_data;
+    int res = cqe->res;
+    ++head;
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    uring_complete(b, s, res);
+    tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+  }
+}
+
+static bool uring_next(file_batch *b, file_batch_item *out)
+{
+  for (;;)
+  {
+    uring_reap(b);
+    if (b->ready_count > 0)
+    {
+      ready_pop(b, out);
+      // le letture successive procedono mentre il chiamante elabora il file
+      uring_refill(b);
+      uring_submit(&b->ring, 0);
+      return true;
+    }
+    uring_refill(b);
+    if (b->inflight == 0 && b->ready_count == 0)
+      return false;
+    if (b->ready_count > 0)
+      continue; // aperture sincrone già concluse
+    if (uring_submit(&b->ring, 1) < 0)
+    {
+      // errore dell'anello: i file in corso vengono segnalati come non letti
+      int err = errno;
+      for (size_t s = 0; s < b->depth; ++s)
+        if (b->slots[s].state != SLOT_FREE)
+          slot_finish(b, s, err, false);
+      b->next = b->count;
+    }
+  }
+}
+
+static bool uring_open(file_batch *b)
+{
+  unsigned entries = 1;
+  while (entries < b->depth)
+    entries <<= 1;
+  if (!uring_init(&b->ring, entries))
+    return false;
+  b->slots = (batch_slot *)calloc(b->depth, sizeof(batch_slot));
+  b->free_slots = (size_t *)malloc(b->depth * sizeof(size_t));
+  if (!b->slots || !b->free_slots)
+  {
+    free(b->slots);
+    free(b->free_slots);
+    b->slots = NULL;
+    b->free_slots = NULL;
+    uring_destroy(&b->ring);
+    return false;
+  }
+  for (size_t s = 0; s < b->depth; ++s)
+  {
+    b->slots[s].fd = -1;
+    b->free_slots[s] = b->depth - 1 - s;
+  }
+  b->free_count = b->depth;
+  return true;
+}
+
+// Attende che il kernel abbia finito di usare i buffer dei file in corso.
+static void uring_close(file_batch *b)
+{
+  if (b->ring.fd >= 0)
+  {
+    b->stop = true;
+    while (b->inflight > 0)
+    {
+      uring_reap(b);
+      if (b->inflight == 0)
+        break;
+      if (uring_submit(&b->ring, 1) < 0)
+        break;
+    }
+    uring_destroy(&b->ring);
+  }
+  free(b->slots);
+  free(b->free_slots);
+}
+#endif
+
+// Legge l'intero file `path` con pread.
+static void read_with_pread(const char *path, size_t max_bytes, file_batch_item *item)
+{
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    item->error = errno;
+    return;
+  }
+  size_t size = 0;
+  if (!regular_size(fd, &size))
+  {
+    item->error = errno;
+    close(fd);
+    return;
+  }
+  if (max_bytes && size > max_bytes)
+  {
+    item->too_large = true;
+    close(fd);
+    return;
+  }
+  char *data = (char *)malloc(size + 1);
+  if (!data)
+  {
+    item->error = ENOMEM;
+    close(fd);
+    return;
+  }
+  size_t got = 0;
+  while (got < size)
+  {
+    ssize_t n = pread(fd, data + got, size - got, (off_t)got);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+    {
+      item->error = errno;
+      free(data);
+      close(fd);
+      return;
+    }
+    if (n == 0)
+      break;
+    got += (size_t)n;
+  }
+  close(fd);
+  data[got] = '\0';
+  item->data = data;
+  item->len = got;
+}
+
+static int pool_worker(void *arg)
+{
+  file_batch *b = (file_batch *)arg;
+  mtx_lock(&b->lock);
+  for (;;)
+  {
+    while (!b->stop && b->next < b->count && b->outstanding >= b->depth)
+      cnd_wait(&b->space_cond, &b->lock);
+    if (b->stop || b->next >= b->count)
+      break;
+    size_t index = b->next++;
+    ++b->outstanding;
+    mtx_unlock(&b->lock);
+
+    file_batch_item item;
+    memset(&item, 0, sizeof(item));
+    item.index = index;
+    item.path = b->paths[index];
+    read_with_pread(item.path, b->max_bytes, &item);
+
+    mtx_lock(&b->lock);
+    ready_push(b, &item);
+    cnd_signal(&b->ready_cond);
+  }
+  mtx_unlock(&b->lock);
+  return 0;
+}
+
+static bool pool_next(file_batch *b, file_batch_item *out)
+{
+  mtx_lock(&b->lock);
+  while (b->ready_count == 0 && b->returned < b->count)
+    cnd_wait(&b->ready_cond, &b->lock);
+  bool got = b->ready_count > 0;
+  if (got)
+  {
+    ready_pop(b, out);
+    --b->outstanding;
+    ++b->returned;
+    cnd_signal(&b->space_cond);
+  }
+  mtx_unlock(&b->lock);
+  return got;
+}
+
+static bool pool_open(file_batch *b, unsigned threads)
+{
+  if (threads == 0)
+    threads = FILE_BATCH_DEFAULT_THREADS;
+  if (threads > b->depth)
+    threads = b->depth;
+  b->threads = (thrd_t *)calloc(threads, sizeof(thrd_t));
+  if (!b->threads)
+    return false;
+  if (mtx_init(&b->lock, mtx_plain) != thrd_success)
+    return false;
+  if (cnd_init(&b->ready_cond) != thrd_success)
+  {
+    mtx_destroy(&b->lock);
+    return false;
+  }
+  if (cnd_init(&b->space_cond) != thrd_success)
+  {
+    cnd_destroy(&b->ready_cond);
+    mtx_destroy(&b->lock);
+    return false;
+  }
+  b->pool_ready = true;
+  for (unsigned i = 0; i < threads; ++i)
+  {
+    if (thrd_create(&b->threads[i], pool_worker, b) != thrd_success)
+      break;
+    ++b->thread_count;
+  }
+  return b->thread_count > 0;
+}
+
+static void pool_close(file_batch *b)
+{
+  mtx_lock(&b->lock);
+  b->stop = true;
+  cnd_broadcast(&b->space_cond);
+  mtx_unlock(&b->lock);
+  for (unsigned i = 0; i < b->thread_count; ++i)
+    thrd_join(b->threads[i], NULL);
+  free(b->threads);
+  cnd_destroy(&b->space_cond);
+  cnd_destroy(&b->ready_cond);
+  mtx_destroy(&b->lock);
+}
+
+file_batch *file_batch_open(const char *const *paths, size_t count, const file_batch_options *opts)
+{
+  file_batch *b = (file_batch *)calloc(1, sizeof(file_batch));
+  if (!b)
+    return NULL;
+  b->paths = paths;
+  b->count = count;
+  b->depth = opts && opts->depth ? opts->depth : FILE_BATCH_DEFAULT_DEPTH;
+  if (b->depth > FILE_BATCH_MAX_DEPTH)
+    b->depth = FILE_BATCH_MAX_DEPTH;
+  b->max_bytes = opts ? opts->max_bytes : 0;
+  b->ready = (file_batch_item *)calloc(b->depth, sizeof(file_batch_item));
+  if (!b->ready)
+  {
+    free(b);
+    return NULL;
+  }
+  file_batch_backend want = opts ? opts->backend : FILE_BATCH_AUTO;
+#ifdef __linux__
+  b->ring.fd = -1;
+  if (want != FILE_BATCH_THREADS)
+  {
+    if (uring_open(b))
+    {
+      b->backend = FILE_BATCH_URING;
+      return b;
+    }
+    if (want == FILE_BATCH_URING)
+    {
+      file_batch_close(b);
+      return NULL;
+    }
+  }
+#else
+  if (want == FILE_BATCH_URING)
+  {
+    free(b->ready);
+    free(b);
+    return NULL;
+  }
+#endif
+  b->backend = FILE_BATCH_THREADS;
+  if (!pool_open(b, opts ? opts->threads : 0))
+  {
+    file_batch_close(b);
+    return NULL;
+  }
+  return b;
+}
+
+bool file_batch_next(file_batch *b, file_batch_item *out)
+{
+#ifdef __linux__
+  if (b->backend == FILE_BATCH_URING)
+    return uring_next(b, out);
+#endif
+  return pool_next(b, out);
+}
+
+const char *file_batch_backend_name(const file_batch *b)
+{
+  return b->backend == FILE_BATCH_URING ? "io_uring" : "pread";
+}
+
+unsigned file_batch_depth(const file_batch *b)
+{
+  return b->depth;
+}
+
+void file_batch_close(file_batch *b)
+{
+  if (!b)
+    return;
+#ifdef __linux__
+  if (b->backend != FILE_BATCH_THREADS)
+    uring_close(b);
+#endif
+  if (b->backend == FILE_BATCH_THREADS && b->pool_ready)
+    pool_close(b);
+  else
+    free(b->threads);
+  while (b->ready_count > 0)
+  {
+    file_batch_item item;
+    ready_pop(b, &item);
+    free(item.data);
+  }
+  free(b->ready);
+  free(b);
+}
+
+#else // _WIN32
+
+bool file_list_collect(const char *pattern, file_list *out, char **error)
+{
+  memset(out, 0, sizeof(*out));
+  *error = error_printf("la lettura di directory ('%s') non è supportata su questa piattaforma", pattern);
+  return false;
+}
+
+file_batch *file_batch_open(const char *const *paths, size_t count, const file_batch_options *opts)
+{
+  (void)paths;
+  (void)count;
+  (void)opts;
+  return NULL;
+}
+
+bool file_batch_next(file_batch *b, file_batch_item *out)
+{
+  (void)b;
+  (void)out;
+  return false;
+}
+
+const char *file_batch_backend_name(const file_batch *b)
+{
+  (void)b;
+  return "";
+}
+
+unsigned file_batch_depth(const file_batch *b)
+{
+  (void)b;
+  return 0;
+}
+
+void file_batch_close(file_batch *b)
+{
+  (void)b;
+}
+
+#endif
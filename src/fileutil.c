@@ -1,38 +1,108 @@
-#include "fileutil.h"
-
 #if !defined(_MSC_VER)
 #define _POSIX_C_SOURCE 200809L
 #endif
 
+#include "fileutil.h"
+#include "mem_account.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #ifdef _MSC_VER
 #define FSEEK _fseeki64
 #define FTELL _ftelli64
+#define S_ISREG(m) (((m) & _S_IFMT) == _S_IFREG)
+#define S_ISDIR(m) (((m) & _S_IFMT) == _S_IFDIR)
 #else
 #define FSEEK fseeko
 #define FTELL ftello
 #endif
 
+// Blocco di lettura degli stream senza dimensione nota.
+#define STREAM_CHUNK 65536
+
 // Legge l'intero contenuto di un file binario e restituisce un buffer
 // terminato da NUL. In caso di successo popola `out_len` (se non NULL)
 // con il numero di byte letti. In caso di errore stampa un messaggio
 // su stderr e restituisce NULL.
 char *read_entire_file(const char *path, size_t *out_len) {
+    return read_file_limited(path, 0, out_len, NULL);
+}
+
+int is_stream_path(const char *path) {
+    if (strcmp(path, "-") == 0) return 1;
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    return !S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode);
+}
+
+FILE *open_input(const char *path) {
+    if (strcmp(path, "-") == 0) return stdin;
     FILE *f = fopen(path, "rb");
-    if (!f) { fprintf(stderr, "Errore aprendo '%s': %s\n", path, strerror(errno)); return NULL; }
-    if (FSEEK(f, 0, SEEK_END) != 0) { fclose(f); return NULL; }
+    if (!f) fprintf(stderr, "Errore aprendo '%s': %s\n", path, strerror(errno));
+    return f;
+}
+
+void close_input(FILE *f) {
+    if (f && f != stdin) fclose(f);
+}
+
+// Legge `f` fino alla fine a blocchi: pipe e socket non hanno una dimensione
+// da conoscere in anticipo, quindi il limite viene verificato durante la
+// lettura.
+static char *read_stream(FILE *f, size_t max_len, size_t *out_len, int *too_large) {
+    size_t len = 0, cap = STREAM_CHUNK;
+    char *buf = (char*)mem_malloc(cap + 1);
+    if (!buf) return NULL;
+    for (;;) {
+        if (cap - len < STREAM_CHUNK / 2) {
+            char *nb = (char*)mem_realloc(buf, cap * 2 + 1);
+            if (!nb) { mem_free(buf); return NULL; }
+            buf = nb;
+            cap *= 2;
+        }
+        size_t n = fread(buf + len, 1, cap - len, f);
+        len += n;
+        if (max_len && len > max_len) {
+            mem_free(buf);
+            if (too_large) *too_large = 1;
+            return NULL;
+        }
+        if (n == 0) break;
+    }
+    if (ferror(f)) { mem_free(buf); return NULL; }
+    buf[len] = '\0';
+    if (out_len) *out_len = len;
+    return buf;
+}
+
+// Variante con limite di dimensione: la dimensione viene controllata prima
+// di allocare il buffer, così un file troppo grande non viene mai letto.
+// "-" (standard input) e i file non posizionabili vengono letti a blocchi.
+char *read_file_limited(const char *path, size_t max_len, size_t *out_len, int *too_large) {
+    if (too_large) *too_large = 0;
+    FILE *f = open_input(path);
+    if (!f) return NULL;
+    if (f == stdin || FSEEK(f, 0, SEEK_END) != 0) {
+        char *buf = read_stream(f, max_len, out_len, too_large);
+        close_input(f);
+        return buf;
+    }
     long long size = FTELL(f);
     if (size < 0) { fclose(f); return NULL; }
+    if (max_len && (unsigned long long)size > (unsigned long long)max_len) {
+        fclose(f);
+        if (too_large) *too_large = 1;
+        return NULL;
+    }
     if (FSEEK(f, 0, SEEK_SET) != 0) { fclose(f); return NULL; }
-    char *buf = (char*)malloc((size_t)size + 1);
+    char *buf = (char*)mem_malloc((size_t)size + 1);
     if (!buf) { fclose(f); return NULL; }
     size_t n = fread(buf, 1, (size_t)size, f);
     fclose(f);
-    if (n != (size_t)size) { free(buf); return NULL; }
+    if (n != (size_t)size) { mem_free(buf); return NULL; }
     buf[size] = '\0';
     if (out_len) *out_len = (size_t)size;
     return buf;
@@ -0,0 +1,750 @@
+#include "inflate_stream.h"
+#include "mem_account.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Finestra circolare: 32 KiB di storia (la distanza massima del deflate) più
+// i byte decompressi in attesa di essere consegnati al chiamante.
+#define WINDOW_SIZE 65536u
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+#define MAX_MATCH 258u
+#define INPUT_CHUNK 65536u
+#define MAX_BITS 15
+// Bit decodificati con una sola lettura di tabella; i codici più lunghi (rari)
+// seguono la decodifica canonica bit per bit.
+#define FAST_BITS 10
+
+typedef struct
+{
+  uint16_t count[MAX_BITS + 1]; // codici per lunghezza
+  uint16_t symbol[288];         // simboli in ordine canonico
+  uint16_t fast[1u << FAST_BITS]; // (lunghezza << 9) | simbolo, 0 = codice lungo o assente
+} huffman;
+
+typedef enum
+{
+  ST_HEADER,
+  ST_BLOCK,
+  ST_STORED,
+  ST_CODES,
+  ST_TRAILER,
+  ST_DONE,
+  ST_FAILED
+} inflate_stage;
+
+struct inflate_stream
+{
+  content_encoding enc;
+  size_t max_output;
+  inflate_read_fn read;
+  void *read_arg;
+  bool eof;
+  size_t in_pos, in_len;
+  uint64_t bits; // bit in attesa, dal meno significativo
+  unsigned bit_count;
+  inflate_stage stage;
+  bool zlib; // CONTENT_DEFLATE con intestazione RFC 1950
+  bool last_block;
+  uint32_t stored_left;
+  const huffman *lencode, *distcode;
+  huffman dyn_len, dyn_dist, fixed_len, fixed_dist;
+  uint64_t total_out;  // byte scritti nella finestra
+  uint64_t delivered;  // byte consegnati al chiamante
+  uint64_t checked;    // byte inclusi nel checksum
+  uint64_t member_out; // byte del membro gzip (o dello stream) corrente
+  uint32_t check;      // CRC-32 (gzip) o Adler-32 (zlib) del membro corrente
+  inflate_status status;
+  const char *error;
+  uint32_t crc_table[256];
+  unsigned char window[WINDOW_SIZE];
+  unsigned char in[INPUT_CHUNK];
+};
+
+static const uint16_t len_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                       193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+bool content_encoding_parse(const char *name, size_t len, content_encoding *out)
+{
+  static const struct
+  {
+    const char *name;
+    content_encoding enc;
+  } names[] = {{"identity", CONTENT_IDENTITY}, {"gzip", CONTENT_GZIP}, {"x-gzip", CONTENT_GZIP},
+               {"deflate", CONTENT_DEFLATE}};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+  {
+    size_t j = 0;
+    while (j < len && names[i].name[j] && tolower((unsigned char)name[j]) == names[i].name[j])
+      ++j;
+    if (j == len && names[i].name[j] == '\0')
+    {
+      *out = names[i].enc;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *content_encoding_name(content_encoding e)
+{
+  return e == CONTENT_GZIP ? "gzip" : e == CONTENT_DEFLATE ? "deflate" : "identity";
+}
+
+static bool fail(inflate_stream *s, inflate_status status, const char *msg)
+{
+  if (s->stage != ST_FAILED)
+  {
+    s->stage = ST_FAILED;
+    s->status = status;
+    s->error = msg;
+  }
+  return false;
+}
+
+// Carica il blocco successivo di dati compressi; false alla fine dei dati.
+static bool fill_input(inflate_stream *s)
+{
+  if (s->eof)
+    return false;
+  s->in_pos = 0;
+  s->in_len = s->read(s->read_arg, s->in, INPUT_CHUNK);
+  if (s->in_len == 0)
+    s->eof = true;
+  return s->in_len > 0;
+}
+
+// Porta nel buffer dei bit i byte già letti, senza chiedere nuovi dati.
+static void refill(inflate_stream *s)
+{
+  while (s->bit_count <= 56 && s->in_pos < s->in_len)
+  {
+    s->bits |= (uint64_t)s->in[s->in_pos++] << s->bit_count;
+    s->bit_count += 8;
+  }
+}
+
+// Garantisce almeno `n` bit (n <= 57) nel buffer; false se i dati finiscono.
+static bool need_bits(inflate_stream *s, unsigned n)
+{
+  while (s->bit_count < n)
+  {
+    if (s->in_pos == s->in_len && !fill_input(s))
+      return false;
+    refill(s);
+  }
+  return true;
+}
+
+static void drop_bits(inflate_stream *s, unsigned n)
+{
+  s->bits >>= n;
+  s->bit_count -= n;
+}
+
+// Legge `n` bit (n <= 32) nell'ordine del deflate.
+static bool take(inflate_stream *s, unsigned n, uint32_t *v)
+{
+  if (!need_bits(s, n))
+    return fail(s, INFLATE_TRUNCATED, "dati compressi troncati");
+  *v = n ? (uint32_t)(s->bits & ((UINT64_C(1) << n) - 1)) : 0;
+  drop_bits(s, n);
+  return true;
+}
+
+static bool skip_bytes(inflate_stream *s, uint32_t n)
+{
+  uint32_t v;
+  while (n-- > 0)
+    if (!take(s, 8, &v))
+      return false;
+  return true;
+}
+
+// Costruisce il codice canonico dalle lunghezze; false se il codice assegna
+// più combinazioni di quante ne esistano. I codici incompleti sono ammessi:
+// le combinazioni mancanti vengono rifiutate durante la decodifica.
+static bool build(huffman *h, const uint8_t *lengths, unsigned n)
+{
+  memset(h->count, 0, sizeof(h->count));
+  memset(h->fast, 0, sizeof(h->fast));
+  for (unsigned i = 0; i < n; ++i)
+    h->count[lengths[i]]++;
+  int left = 1;
+  for (unsigned len = 1; len <= MAX_BITS; ++len)
+  {
+    left <<= 1;
+    left -= h->count[len];
+    if (left < 0)
+      return false;
+  }
+  uint16_t offs[MAX_BITS + 1];
+  offs[1] = 0;
+  for (unsigned len = 1; len < MAX_BITS; ++len)
+    offs[len + 1] = (uint16_t)(offs[len] + h->count[len]);
+  for (unsigned i = 0; i < n; ++i)
+    if (lengths[i])
+      h->symbol[offs[lengths[i]]++] = (uint16_t)i;
+
+  unsigned code = 0, k = 0;
+  for (unsigned len = 1; len <= FAST_BITS; ++len)
+  {
+    for (unsigned c = 0; c < h->count[len]; ++c, ++k, ++code)
+    {
+      // i codici sono scritti dal bit più significativo: l'indice è invertito
+      unsigned rev = 0;
+      for (unsigned b = 0; b < len; ++b)
+        rev |= ((code >> b) & 1u) << (len - 1 - b);
+      uint16_t e = (uint16_t)(len << 9 | h->symbol[k]);
+      for (unsigned i = rev; i < (1u << FAST_BITS); i += 1u << len)
+        h->fast[i] = e;
+    }
+    code <<= 1;
+  }
+  return true;
+}
+
+// Decodifica un simbolo; -1 in caso di errore.
+static int decode(inflate_stream *s, const huffman *h)
+{
+  refill(s);
+  if (s->bit_count < FAST_BITS)
+    need_bits(s, FAST_BITS); // a fine stream i bit possono essere meno
+  uint16_t e = h->fast[s->bits & ((1u << FAST_BITS) - 1)];
+  if (e && (unsigned)(e >> 9) <= s->bit_count)
+  {
+    drop_bits(s, e >> 9);
+    return e & 511;
+  }
+  int code = 0, first = 0, index = 0;
+  for (unsigned len = 1; len <= MAX_BITS; ++len)
+  {
+    if (!need_bits(s, 1))
+    {
+      fail(s, INFLATE_TRUNCATED, "dati compressi troncati");
+      return -1;
+    }
+    code |= (int)(s->bits & 1);
+    drop_bits(s, 1);
+    int count = h->count[len];
+    if (code - count < first)
+      return h->symbol[index + (code - first)];
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  fail(s, INFLATE_BAD_DATA, "codice di Huffman non valido");
+  return -1;
+}
+
+static bool check_output(inflate_stream *s, uint32_t n)
+{
+  if (s->max_output && s->total_out + n > s->max_output)
+    return fail(s, INFLATE_TOO_LARGE, "body decompresso oltre il limite");
+  return true;
+}
+
+// Aggiorna il checksum con i byte scritti nella finestra dall'ultima volta.
+static void update_check(inflate_stream *s)
+{
+  while (s->checked < s->total_out)
+  {
+    size_t off = (size_t)(s->checked & WINDOW_MASK);
+    size_t n = (size_t)(s->total_out - s->checked);
+    if (n > WINDOW_SIZE - off)
+      n = WINDOW_SIZE - off;
+    const unsigned char *p = s->window + off;
+    s->checked += n;
+    if (s->enc == CONTENT_GZIP)
+    {
+      uint32_t c = s->check;
+      for (size_t i = 0; i < n; ++i)
+        c = s->crc_table[(c ^ p[i]) & 0xff] ^ (c >> 8);
+      s->check = c;
+    }
+    else if (s->zlib)
+    {
+      uint32_t a = s->check & 0xffff, b = s->check >> 16;
+      while (n > 0)
+      {
+        // 5552 è il massimo di byte sommabili prima del modulo senza overflow
+        size_t chunk = n < 5552 ? n : 5552;
+        n -= chunk;
+        while (chunk-- > 0)
+        {
+          a += *p++;
+          b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+      }
+      s->check = b << 16 | a;
+    }
+  }
+}
+
+static bool read_header(inflate_stream *s)
+{
+  s->member_out = 0;
+  if (s->enc == CONTENT_GZIP)
+  {
+    s->check = 0xffffffffu;
+    uint32_t id1, id2, cm, flags, v;
+    if (!take(s, 8, &id1) || !take(s, 8, &id2) || !take(s, 8, &cm) || !take(s, 8, &flags))
+      return false;
+    if (id1 != 0x1f || id2 != 0x8b)
+      return fail(s, INFLATE_BAD_DATA, "intestazione gzip non valida");
+    if (cm != 8 || (flags & 0xe0))
+      return fail(s, INFLATE_BAD_DATA, "formato gzip non supportato");
+    if (!skip_bytes(s, 6)) // mtime, xfl, os
+      return false;
+    if (flags & 4) // FEXTRA
+    {
+      uint32_t xlen;
+      if (!take(s, 16, &xlen) || !skip_bytes(s, xlen))
+        return false;
+    }
+    for (uint32_t bit = 8; bit <= 16; bit <<= 1) // FNAME, FCOMMENT
+    {
+      if (!(flags & bit))
+        continue;
+      do
+      {
+        if (!take(s, 8, &v))
+          return false;
+      } while (v != 0);
+    }
+    if ((flags & 2) && !skip_bytes(s, 2)) // FHCRC
+      return false;
+  }
+  else
+  {
+    // intestazione zlib se i primi due byte la descrivono, altrimenti
+    // deflate grezzo come inviato da alcuni client
+    s->check = 1;
+    if (need_bits(s, 16))
+    {
+      uint32_t cmf = (uint32_t)(s->bits & 0xff), flg = (uint32_t)(s->bits >> 8 & 0xff);
+      s->zlib = (cmf & 0x0f) == 8 && (cmf >> 4) <= 7 && (cmf * 256 + flg) % 31 == 0;
+      if (s->zlib && (flg & 0x20))
+        return fail(s, INFLATE_BAD_DATA, "dizionario zlib preimpostato non supportato");
+      if (s->zlib)
+        drop_bits(s, 16);
+    }
+  }
+  s->stage = ST_BLOCK;
+  return true;
+}
+
+static bool read_dynamic(inflate_stream *s)
+{
+  static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  uint32_t nlen, ndist, ncode, v;
+  if (!take(s, 5, &nlen) || !take(s, 5, &ndist) || !take(s, 4, &ncode))
+    return false;
+  nlen += 257;
+  ndist += 1;
+  ncode += 4;
+  if (nlen > 286 || ndist > 30)
+    return fail(s, INFLATE_BAD_DATA, "blocco deflate non valido");
+  uint8_t lengths[320] = {0};
+  for (uint32_t i = 0; i < ncode; ++i)
+  {
+    if (!take(s, 3, &v))
+      return false;
+    lengths[order[i]] = (uint8_t)v;
+  }
+  if (!build(&s->dyn_len, lengths, 19))
+    return fail(s, INFLATE_BAD_DATA, "blocco deflate non valido");
+  uint32_t index = 0;
+  while (index < nlen + ndist)
+  {
+    int sym = decode(s, &s->dyn_len);
+    if (sym < 0)
+      return false;
+    if (sym < 16)
+    {
+      lengths[index++] = (uint8_t)sym;
+      continue;
+    }
+    uint8_t len = 0;
+    uint32_t rep;
+    if (sym == 16)
+    {
+      if (index == 0)
+        return fail(s, INFLATE_BAD_DATA, "blocco deflate non valido");
+      len = lengths[index - 1];
+      if (!take(s, 2, &rep))
+        return false;
+      rep += 3;
+    }
+    else if (sym == 17)
+    {
+      if (!take(s, 3, &rep))
+        return false;
+      rep += 3;
+    }
+    else
+    {
+      if (!take(s, 7, &rep))
+        return false;
+      rep += 11;
+    }
+    if (index + rep > nlen + ndist)
+      return fail(s, INFLATE_BAD_DATA, "blocco deflate non valido");
+    while (rep-- > 0)
+      lengths[index++] = len;
+  }
+  if (lengths[256] == 0 || !build(&s->dyn_len, lengths, nlen) || !build(&s->dyn_dist, lengths + nlen, ndist))
+    return fail(s, INFLATE_BAD_DATA, "blocco deflate non valido");
+  s->lencode = &s->dyn_len;
+  s->distcode = &s->dyn_dist;
+  return true;
+}
+
+static bool read_block_header(inflate_stream *s)
+{
+  uint32_t v;
+  if (!take(s, 3, &v))
+    return false;
+  s->last_block = v & 1;
+  switch (v >> 1)
+  {
+  case 0:
+  {
+    uint32_t len, nlen;
+    drop_bits(s, s->bit_count & 7);
+    if (!take(s, 16, &len) || !take(s, 16, &nlen))
+      return false;
+    if (len != (~nlen & 0xffff))
+      return fail(s, INFLATE_BAD_DATA, "blocco deflate non valido");
+    s->stored_left = len;
+    s->stage = ST_STORED;
+    return true;
+  }
+  case 1:
+    s->lencode = &s->fixed_len;
+    s->distcode = &s->fixed_dist;
+    break;
+  case 2:
+    if (!read_dynamic(s))
+      return false;
+    break;
+  default:
+    return fail(s, INFLATE_BAD_DATA, "blocco deflate non valido");
+  }
+  s->stage = ST_CODES;
+  return true;
+}
+
+static void put_bytes(inflate_stream *s, const unsigned char *p, size_t n)
+{
+  size_t off = (size_t)(s->total_out & WINDOW_MASK);
+  size_t first = n < WINDOW_SIZE - off ? n : WINDOW_SIZE - off;
+  memcpy(s->window + off, p, first);
+  memcpy(s->window, p + first, n - first);
+  s->total_out += n;
+  s->member_out += n;
+}
+
+static bool run_stored(inflate_stream *s)
+{
+  while (s->stored_left > 0)
+  {
+    size_t room = WINDOW_SIZE - (size_t)(s->total_out - s->delivered);
+    if (room == 0)
+      return true;
+    if (s->bit_count >= 8)
+    {
+      if (!check_output(s, 1))
+        return false;
+      unsigned char b = (unsigned char)s->bits;
+      drop_bits(s, 8);
+      put_bytes(s, &b, 1);
+      s->stored_left--;
+      continue;
+    }
+    if (s->in_pos == s->in_len && !fill_input(s))
+      return fail(s, INFLATE_TRUNCATED, "dati compressi troncati");
+    size_t n = s->in_len - s->in_pos;
+    if (n > s->stored_left)
+      n = s->stored_left;
+    if (n > room)
+      n = room;
+    if (!check_output(s, (uint32_t)n))
+      return false;
+    put_bytes(s, s->in + s->in_pos, n);
+    s->in_pos += n;
+    s->stored_left -= (uint32_t)n;
+  }
+  s->stage = s->last_block ? ST_TRAILER : ST_BLOCK;
+  return true;
+}
+
+static bool run_codes(inflate_stream *s)
+{
+  while (s->total_out - s->delivered <= WINDOW_SIZE - MAX_MATCH)
+  {
+    int sym = decode(s, s->lencode);
+    if (sym < 0)
+      return false;
+    if (sym < 256)
+    {
+      if (!check_output(s, 1))
+        return false;
+      s->window[s->total_out++ & WINDOW_MASK] = (unsigned char)sym;
+      s->member_out++;
+      continue;
+    }
+    if (sym == 256)
+    {
+      s->stage = s->last_block ? ST_TRAILER : ST_BLOCK;
+      return true;
+    }
+    sym -= 257;
+    if (sym >= 29)
+      return fail(s, INFLATE_BAD_DATA, "lunghezza deflate non valida");
+    uint32_t len, dist, extra;
+    if (!take(s, len_extra[sym], &extra))
+      return false;
+    len = len_base[sym] + extra;
+    int dsym = decode(s, s->distcode);
+    if (dsym < 0)
+      return false;
+    if (dsym >= 30)
+      return fail(s, INFLATE_BAD_DATA, "distanza deflate non valida");
+    if (!take(s, dist_extra[dsym], &extra))
+      return false;
+    dist = dist_base[dsym] + extra;
+    if (dist > s->member_out)
+      return fail(s, INFLATE_BAD_DATA, "distanza deflate oltre l'inizio dei dati");
+    if (!check_output(s, len))
+      return false;
+    size_t to = (size_t)(s->total_out & WINDOW_MASK), from = (size_t)((s->total_out - dist) & WINDOW_MASK);
+    if (dist >= len && to + len <= WINDOW_SIZE && from + len <= WINDOW_SIZE)
+      memcpy(s->window + to, s->window + from, len);
+    else // sovrapposta (ripetizione) o a cavallo della fine della finestra
+      for (uint32_t i = 0; i < len; ++i)
+        s->window[(to + i) & WINDOW_MASK] = s->window[(from + i) & WINDOW_MASK];
+    s->total_out += len;
+    s->member_out += len;
+  }
+  return true;
+}
+
+static bool read_trailer(inflate_stream *s)
+{
+  update_check(s);
+  drop_bits(s, s->bit_count & 7);
+  uint32_t a, b;
+  if (s->enc == CONTENT_GZIP)
+  {
+    if (!take(s, 32, &a) || !take(s, 32, &b))
+      return false;
+    if (a != ~s->check || b != (uint32_t)s->member_out)
+      return fail(s, INFLATE_BAD_DATA, "checksum gzip non valido");
+    // altri membri concatenati proseguono lo stesso body
+    if (s->bit_count > 0 || s->in_pos < s->in_len || fill_input(s))
+    {
+      s->stage = ST_HEADER;
+      return true;
+    }
+  }
+  else if (s->zlib)
+  {
+    uint32_t sum = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (!take(s, 8, &a))
+        return false;
+      sum = sum << 8 | a;
+    }
+    if (sum != s->check)
+      return fail(s, INFLATE_BAD_DATA, "checksum zlib non valido");
+  }
+  s->stage = ST_DONE;
+  return true;
+}
+
+// Decomprime finché la finestra ha spazio o lo stream termina.
+static void step(inflate_stream *s)
+{
+  while (s->stage != ST_DONE && s->stage != ST_FAILED && s->total_out - s->delivered <= WINDOW_SIZE - MAX_MATCH)
+  {
+    switch (s->stage)
+    {
+    case ST_HEADER:
+      read_header(s);
+      break;
+    case ST_BLOCK:
+      read_block_header(s);
+      break;
+    case ST_STORED:
+      run_stored(s);
+      break;
+    case ST_CODES:
+      run_codes(s);
+      break;
+    case ST_TRAILER:
+      read_trailer(s);
+      break;
+    default:
+      break;
+    }
+  }
+  update_check(s);
+}
+
+inflate_stream *inflate_stream_create(content_encoding enc, size_t max_output, inflate_read_fn read, void *arg)
+{
+  if (enc == CONTENT_IDENTITY)
+    return NULL;
+  inflate_stream *s = (inflate_stream *)mem_malloc(sizeof(*s));
+  if (!s)
+    return NULL;
+  memset(s, 0, offsetof(inflate_stream, crc_table));
+  s->enc = enc;
+  s->max_output = max_output;
+  s->read = read;
+  s->read_arg = arg;
+  s->stage = ST_HEADER;
+  for (uint32_t n = 0; n < 256; ++n)
+  {
+    uint32_t c = n;
+    for (int k = 0; k < 8; ++k)
+      c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+    s->crc_table[n] = c;
+  }
+  uint8_t lengths[288];
+  for (unsigned i = 0; i < 288; ++i)
+    lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+  build(&s->fixed_len, lengths, 288);
+  for (unsigned i = 0; i < 30; ++i)
+    lengths[i] = 5;
+  build(&s->fixed_dist, lengths, 30);
+  return s;
+}
+
+void inflate_stream_free(inflate_stream *s)
+{
+  mem_free(s);
+}
+
+size_t inflate_stream_read(inflate_stream *s, void *out, size_t cap)
+{
+  unsigned char *dst = (unsigned char *)out;
+  size_t done = 0;
+  while (done < cap && s->stage != ST_FAILED)
+  {
+    size_t pending = (size_t)(s->total_out - s->delivered);
+    if (pending == 0)
+    {
+      if (s->stage == ST_DONE)
+        break;
+      step(s);
+      continue;
+    }
+    size_t off = (size_t)(s->delivered & WINDOW_MASK);
+    size_t n = cap - done;
+    if (n > pending)
+      n = pending;
+    if (n > WINDOW_SIZE - off)
+      n = WINDOW_SIZE - off;
+    memcpy(dst + done, s->window + off, n);
+    done += n;
+    s->delivered += n;
+  }
+  return done;
+}
+
+inflate_status inflate_stream_status(const inflate_stream *s)
+{
+  return s->status;
+}
+
+const char *inflate_stream_error(const inflate_stream *s)
+{
+  return s->error;
+}
+
+uint64_t inflate_stream_total_out(const inflate_stream *s)
+{
+  return s->total_out;
+}
+
+typedef struct
+{
+  const unsigned char *p;
+  size_t left;
+} memory_source;
+
+static size_t memory_read(void *arg, void *buf, size_t cap)
+{
+  memory_source *m = (memory_source *)arg;
+  size_t n = m->left < cap ? m->left : cap;
+  memcpy(buf, m->p, n);
+  m->p += n;
+  m->left -= n;
+  return n;
+}
+
+inflate_status inflate_buffer(content_encoding enc, const void *data, size_t len, size_t max_output, char **out,
+                              size_t *out_len, const char **error_msg)
+{
+  *out = NULL;
+  *out_len = 0;
+  memory_source src = {(const unsigned char *)data, len};
+  inflate_stream *s = inflate_stream_create(enc, max_output, memory_read, &src);
+  size_t cap = len < 4096 ? 8192 : len * 4, used = 0;
+  char *buf = s ? (char *)mem_malloc(cap + 1) : NULL;
+  if (!buf)
+  {
+    inflate_stream_free(s);
+    if (error_msg)
+      *error_msg = "memoria insufficiente per la decompressione";
+    return INFLATE_NO_MEMORY;
+  }
+  for (;;)
+  {
+    if (used == cap)
+    {
+      char *nb = (char *)mem_realloc(buf, cap * 2 + 1);
+      if (!nb)
+      {
+        mem_free(buf);
+        inflate_stream_free(s);
+        if (error_msg)
+          *error_msg = "memoria insufficiente per la decompressione";
+        return INFLATE_NO_MEMORY;
+      }
+      buf = nb;
+      cap *= 2;
+    }
+    size_t n = inflate_stream_read(s, buf + used, cap - used);
+    if (n == 0)
+      break;
+    used += n;
+  }
+  inflate_status st = inflate_stream_status(s);
+  if (st != INFLATE_OK)
+  {
+    if (error_msg)
+      *error_msg = inflate_stream_error(s);
+    mem_free(buf);
+  }
+  else
+  {
+    buf[used] = '\0';
+    *out = buf;
+    *out_len = used;
+  }
+  inflate_stream_free(s);
+  return st;
+}
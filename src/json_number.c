@@ -0,0 +1,148 @@
+#include "json_number.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Potenze di 10 rappresentabili esattamente in double.
+static const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+size_t js_number_lexeme_len(const char *p, const char *end)
+{
+  const char *q = p;
+  if (q < end && (*q == '-' || *q == '+'))
+    ++q;
+  size_t digits = 0;
+  while (q < end && is_digit(*q))
+  {
+    ++q;
+    ++digits;
+  }
+  if (q < end && *q == '.')
+  {
+    ++q;
+    while (q < end && is_digit(*q))
+    {
+      ++q;
+      ++digits;
+    }
+  }
+  if (digits == 0)
+    return 0;
+  // l'esponente conta solo se seguito da almeno una cifra
+  if (q < end && (*q == 'e' || *q == 'E'))
+  {
+    const char *e = q + 1;
+    if (e < end && (*e == '-' || *e == '+'))
+      ++e;
+    if (e < end && is_digit(*e))
+    {
+      while (e < end && is_digit(*e))
+        ++e;
+      q = e;
+    }
+  }
+  return (size_t)(q - p);
+}
+
+// Percorso lento: strtod su una copia terminata da NUL.
+static double decode_slow(const char *p, size_t len)
+{
+  char buf[64];
+  char *num = len < sizeof(buf) ? buf : (char *)malloc(len + 1);
+  if (!num)
+    return 0.0;
+  memcpy(num, p, len);
+  num[len] = '\0';
+  double d = strtod(num, NULL);
+  if (num != buf)
+    free(num);
+  return d;
+}
+
+bool js_number_decode_fast(const char *p, size_t len, double *out)
+{
+  const char *q = p;
+  const char *end = p + len;
+  bool neg = false;
+  if (q < end && (*q == '-' || *q == '+'))
+    neg = *q++ == '-';
+
+  uint64_t mant = 0;
+  int digits = 0;
+  int exp10 = 0;
+  for (; q < end && is_digit(*q); ++q)
+  {
+    if (digits == 0 && *q == '0')
+      continue;
+    if (++digits > 19)
+      return false;
+    mant = mant * 10 + (uint64_t)(*q - '0');
+  }
+  if (q < end && *q == '.')
+  {
+    for (++q; q < end && is_digit(*q); ++q)
+    {
+      if (digits == 0 && *q == '0')
+      {
+        --exp10;
+        continue;
+      }
+      if (++digits > 19)
+        return false;
+      mant = mant * 10 + (uint64_t)(*q - '0');
+      --exp10;
+    }
+  }
+  if (q < end && (*q == 'e' || *q == 'E'))
+  {
+    ++q;
+    bool eneg = false;
+    if (q < end && (*q == '-' || *q == '+'))
+      eneg = *q++ == '-';
+    int e = 0;
+    for (; q < end && is_digit(*q); ++q)
+    {
+      if (e > 10000)
+        return false;
+      e = e * 10 + (*q - '0');
+    }
+    exp10 += eneg ? -e : e;
+  }
+
+  // Clinger: mantissa esatta e potenza di 10 esatta, quindi una sola
+  // operazione IEEE restituisce il risultato correttamente arrotondato.
+  double d = (double)mant;
+  if (mant != 0)
+  {
+    if (mant > (UINT64_C(1) << 53) || exp10 < -22 || exp10 > 22)
+      return false;
+    d = exp10 < 0 ? d / exact_pow10[-exp10] : d * exact_pow10[exp10];
+  }
+  *out = neg ? -d : d;
+  return true;
+}
+
+double js_number_decode(const char *p, size_t len)
+{
+  double d;
+  if (js_number_decode_fast(p, len, &d))
+    return d;
+  return decode_slow(p, len);
+}
+
+bool js_number_is_integral(double d)
+{
+  if (d != d)
+    return false;
+  // oltre 2^53 ogni double finito è intero (inf - inf dà NaN)
+  if (d >= 9007199254740992.0 || d <= -9007199254740992.0)
+    return d - d == 0.0;
+  return d == (double)(int64_t)d;
+}
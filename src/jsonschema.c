@@ -1,9 +1,14 @@
 #include "jsonschema.h"
+#include "mem_account.h"
+#include "ptrmap.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <threads.h>
 #ifndef _MSC_VER
 #include <regex.h>
 #else
@@ -11,28 +16,37 @@
 #endif
 
 // Restituisce un risultato di validazione positivo senza messaggio di errore.
-static jsval_result ok(void) { return (jsval_result){true, NULL}; }
+static jsval_result ok(void) { return (jsval_result){true, NULL, {0, 0, 0, 0}}; }
 
 // Helper per creare un jsval_result di errore formattando il messaggio.
 static jsval_result errf(const char *fmt, ...)
 {
-  jsval_result r = {false, NULL};
+  jsval_result r = {false, NULL, {0, 0, 0, 0}};
   va_list ap;
   va_start(ap, fmt);
   char buf[512];
   vsnprintf(buf, sizeof(buf), fmt, ap);
   va_end(ap);
-  r.error_msg = (char *)malloc(strlen(buf) + 1);
-  strcpy(r.error_msg, buf);
+  r.error_msg = (char *)mem_malloc(strlen(buf) + 1);
+  if (r.error_msg)
+    strcpy(r.error_msg, buf);
   return r;
 }
 
+// Esito di una validazione interrotta dal budget della richiesta.
+static jsval_result budget_failure(const req_budget *b)
+{
+  char what[64];
+  req_budget_describe(b, what, sizeof(what));
+  return errf("Budget della richiesta esaurito: %s", what);
+}
+
 // Libera l'eventuale messaggio di errore contenuto in un jsval_result.
 void jsval_result_free(jsval_result *r)
 {
   if (r && r->error_msg)
   {
-    free(r->error_msg);
+    mem_free(r->error_msg);
     r->error_msg = NULL;
   }
 }
@@ -41,7 +55,8 @@ void jsval_result_free(jsval_result *r)
 // Attualmente si limita a memorizzare il nodo radice dell'OAS.
 jsval_ctx jsval_ctx_make(cJSON *oas_root, jsval_mode mode)
 {
-  jsval_ctx c = {oas_root, mode};
+  jsval_ctx c = {oas_root, mode, NULL, NULL, JSVAL_DEFAULT_MAX_DEPTH, NULL, NULL, NULL, JSVAL_DEFAULT_PARALLEL_ITEMS,
+                 NULL, false, NULL};
   return c;
 }
 
@@ -52,33 +67,48 @@ static const char *get_type(cJSON *schema)
   return cJSON_IsString(t) ? t->valuestring : NULL;
 }
 
-// Verifica che l'istanza `inst` corrisponda al tipo JSON Schema `t`.
-// Se `t` è NULL la funzione accetta qualsiasi tipo.
-static bool is_type(cJSON *inst, const char *t)
+// Verifica che l'istanza alla voce `i` del tape corrisponda al tipo JSON
+// Schema `t`. Se `t` è NULL la funzione accetta qualsiasi tipo.
+static bool is_type(payload_tape *tape, size_t i, const char *t)
 {
   if (!t)
     return true; // se assente, non imponiamo tipo
+  payload_tape_tag tag = payload_tape_tag_at(tape, i);
   if (strcmp(t, "object") == 0)
-    return cJSON_IsObject(inst);
+    return tag == TAPE_OBJECT;
   if (strcmp(t, "array") == 0)
-    return cJSON_IsArray(inst);
+    return tag == TAPE_ARRAY;
   if (strcmp(t, "string") == 0)
-    return cJSON_IsString(inst);
+    return tag == TAPE_STRING;
   if (strcmp(t, "number") == 0)
-    return cJSON_IsNumber(inst);
+    return payload_tape_is_number(tape, i);
   if (strcmp(t, "integer") == 0)
-    return cJSON_IsNumber(inst) && (inst->valuedouble == (double)inst->valueint);
+    return payload_tape_is_number(tape, i) && payload_tape_is_integer(tape, i);
   if (strcmp(t, "boolean") == 0)
-    return cJSON_IsBool(inst);
+    return tag == TAPE_TRUE || tag == TAPE_FALSE;
   if (strcmp(t, "null") == 0)
-    return cJSON_IsNull(inst);
+    return tag == TAPE_NULL;
   return true; // tipi non standard: ignora
 }
 
+// Restituisce i dati precompilati per `schema`, se il contesto ne dispone.
+static const js_compiled_node *compiled_for(cJSON *schema, const jsval_ctx *ctx)
+{
+  return ctx ? js_schema_index_lookup(ctx->index, schema) : NULL;
+}
+
 // Valida la presenza (opzionale) di un vincolo "enum" nello schema.
 // Restituisce errore se il valore non è presente nella lista enumerata.
-static jsval_result validate_enum(cJSON *inst, cJSON *schema)
+static jsval_result validate_enum(payload_tape *tape, size_t i, cJSON *schema, const js_compiled_node *cn)
 {
+  payload_tape_tag tag = payload_tape_tag_at(tape, i);
+  if (cn && cn->enum_strings)
+  {
+    if (tag == TAPE_STRING && js_enum_table_contains(cn->enum_strings, payload_tape_string(tape, i)))
+      return ok();
+    return errf("Valore non incluso in 'enum'.");
+  }
+
   cJSON *enm = cJSON_GetObjectItemCaseSensitive(schema, "enum");
   if (!cJSON_IsArray(enm))
     return ok();
@@ -86,9 +116,9 @@ static jsval_result validate_enum(cJSON *inst, cJSON *schema)
   cJSON *it = NULL;
   cJSON_ArrayForEach(it, enm)
   {
-    if ((cJSON_IsString(inst) && cJSON_IsString(it) && strcmp(inst->valuestring, it->valuestring) == 0) ||
-        (cJSON_IsNumber(inst) && cJSON_IsNumber(it) && inst->valuedouble == it->valuedouble) ||
-        (cJSON_IsBool(inst) && cJSON_IsBool(it) && !!inst->valueint == !!it->valueint))
+    if ((tag == TAPE_STRING && cJSON_IsString(it) && strcmp(payload_tape_string(tape, i), it->valuestring) == 0) ||
+        (payload_tape_is_number(tape, i) && cJSON_IsNumber(it) && payload_tape_number(tape, i) == it->valuedouble) ||
+        (tag == TAPE_TRUE && cJSON_IsTrue(it)) || (tag == TAPE_FALSE && cJSON_IsFalse(it)))
     {
       return ok();
     }
@@ -96,33 +126,89 @@ static jsval_result validate_enum(cJSON *inst, cJSON *schema)
   return errf("Valore non incluso in 'enum'.");
 }
 
+// Restituisce i vincoli dimensionali dello schema, precompilati se possibile.
+static const js_size_limits *size_limits_for(cJSON *schema, const js_compiled_node *cn, js_size_limits *tmp)
+{
+  if (cn)
+    return &cn->limits;
+  js_size_limits_read(schema, tmp);
+  return tmp;
+}
+
 // Applica i limiti minLength/maxLength per stringhe se definiti.
-static jsval_result validate_string_bounds(cJSON *inst, cJSON *schema)
+static jsval_result validate_string_bounds(const payload_tape *tape, size_t i, cJSON *schema,
+                                           const js_compiled_node *cn)
 {
-  if (!cJSON_IsString(inst))
+  if (payload_tape_tag_at(tape, i) != TAPE_STRING)
+    return ok();
+  js_size_limits tmp;
+  const js_size_limits *lim = size_limits_for(schema, cn, &tmp);
+  if (lim->min_length < 0 && lim->max_length < 0)
     return ok();
-  const char *s = inst->valuestring;
-  cJSON *minL = cJSON_GetObjectItemCaseSensitive(schema, "minLength");
-  cJSON *maxL = cJSON_GetObjectItemCaseSensitive(schema, "maxLength");
-  if (cJSON_IsNumber(minL) && (int)strlen(s) < minL->valueint)
+  long long len = (long long)payload_tape_string_len(tape, i);
+  if (lim->min_length >= 0 && len < lim->min_length)
     return errf("Stringa più corta di minLength");
-  if (cJSON_IsNumber(maxL) && (int)strlen(s) > maxL->valueint)
+  if (lim->max_length >= 0 && len > lim->max_length)
     return errf("Stringa più lunga di maxLength");
   return ok();
 }
 
+// Applica minItems/maxItems agli array e minProperties/maxProperties agli oggetti.
+static jsval_result validate_container_bounds(const payload_tape *tape, size_t i, cJSON *schema,
+                                              const js_compiled_node *cn)
+{
+  payload_tape_tag tag = payload_tape_tag_at(tape, i);
+  if (tag != TAPE_ARRAY && tag != TAPE_OBJECT)
+    return ok();
+  js_size_limits tmp;
+  const js_size_limits *lim = size_limits_for(schema, cn, &tmp);
+  long long min = tag == TAPE_ARRAY ? lim->min_items : lim->min_properties;
+  long long max = tag == TAPE_ARRAY ? lim->max_items : lim->max_properties;
+  if (min < 0 && max < 0)
+    return ok();
+  long long n = (long long)payload_tape_size(tape, i);
+  if (tag == TAPE_ARRAY)
+  {
+    if (min >= 0 && n < min)
+      return errf("Array con meno elementi di minItems");
+    if (max >= 0 && n > max)
+      return errf("Array con più elementi di maxItems");
+  }
+  else
+  {
+    if (min >= 0 && n < min)
+      return errf("Oggetto con meno proprietà di minProperties");
+    if (max >= 0 && n > max)
+      return errf("Oggetto con più proprietà di maxProperties");
+  }
+  return ok();
+}
+
 // Applica il vincolo pattern per le stringhe se definito.
-static jsval_result validate_string_pattern(cJSON *inst, cJSON *schema)
+static jsval_result validate_string_pattern(const payload_tape *tape, size_t i, cJSON *schema,
+                                            const js_compiled_node *cn)
 {
-  if (!cJSON_IsString(inst))
+  if (payload_tape_tag_at(tape, i) != TAPE_STRING)
     return ok();
+  const char *str = payload_tape_string(tape, i);
+
+  if (cn)
+  {
+    if (!cn->pattern)
+      return ok();
+    if (!cn->pattern->valid)
+      return errf("Pattern non valido nello schema.");
+    if (js_regex_match(cn->pattern, str))
+      return ok();
+    return errf("Stringa non conforme al pattern.");
+  }
 
   cJSON *pattern = cJSON_GetObjectItemCaseSensitive(schema, "pattern");
   if (!cJSON_IsString(pattern))
     return ok();
 
 #ifdef _MSC_VER
-  regex_compat_result re = regex_compat_match(pattern->valuestring, inst->valuestring);
+  regex_compat_result re = regex_compat_match(pattern->valuestring, str);
   if (!re.valid)
     return errf("Pattern non valido nello schema.");
   if (re.matched)
@@ -134,7 +220,7 @@ static jsval_result validate_string_pattern(cJSON *inst, cJSON *schema)
   if (rc != 0)
     return errf("Pattern non valido nello schema.");
 
-  rc = regexec(&re, inst->valuestring, 0, NULL, 0);
+  rc = regexec(&re, str, 0, NULL, 0);
   regfree(&re);
   if (rc == 0)
     return ok();
@@ -143,20 +229,109 @@ static jsval_result validate_string_pattern(cJSON *inst, cJSON *schema)
 }
 
 // Applica i limiti minimum/maximum per numeri se definiti nello schema.
-static jsval_result validate_numeric_bounds(cJSON *inst, cJSON *schema)
+static jsval_result validate_numeric_bounds(payload_tape *tape, size_t i, cJSON *schema)
 {
-  if (!cJSON_IsNumber(inst))
+  if (!payload_tape_is_number(tape, i))
     return ok();
   cJSON *min = cJSON_GetObjectItemCaseSensitive(schema, "minimum");
   cJSON *max = cJSON_GetObjectItemCaseSensitive(schema, "maximum");
-  if (cJSON_IsNumber(min) && inst->valuedouble < min->valuedouble)
+  if (cJSON_IsNumber(min) && payload_tape_number(tape, i) < min->valuedouble)
     return errf("Numero < minimum");
-  if (cJSON_IsNumber(max) && inst->valuedouble > max->valuedouble)
+  if (cJSON_IsNumber(max) && payload_tape_number(tape, i) > max->valuedouble)
     return errf("Numero > maximum");
   return ok();
 }
 
-static jsval_result js_validate_impl(cJSON *inst, cJSON *schema, const jsval_ctx *ctx);
+// Voce della tabella di memoizzazione: chiave (schema canonico, voce del tape
+// dell'istanza).
+// Si conservano solo i successi: un fallimento interrompe comunque la
+// validazione della richiesta.
+typedef struct memo_entry
+{
+  const void *schema;
+  size_t inst;
+} memo_entry;
+
+struct jsval_memo
+{
+  memo_entry *entries;
+  size_t cap;
+  size_t count;
+  size_t hits;
+};
+
+jsval_memo *jsval_memo_create(void)
+{
+  jsval_memo *m = (jsval_memo *)mem_calloc(1, sizeof(jsval_memo));
+  if (!m)
+    return NULL;
+  m->cap = 64;
+  m->entries = (memo_entry *)mem_calloc(m->cap, sizeof(memo_entry));
+  if (!m->entries)
+  {
+    mem_free(m);
+    return NULL;
+  }
+  return m;
+}
+
+void jsval_memo_free(jsval_memo *m)
+{
+  if (!m)
+    return;
+  mem_free(m->entries);
+  mem_free(m);
+}
+
+size_t jsval_memo_hits(const jsval_memo *m)
+{
+  return m ? m->hits : 0;
+}
+
+static size_t memo_slot(const jsval_memo *m, const void *schema, size_t inst)
+{
+  uint64_t x = (uint64_t)(uintptr_t)schema * 0x9e3779b97f4a7c15ULL ^ (uint64_t)inst;
+  x ^= x >> 29;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 32;
+  size_t i = (size_t)x & (m->cap - 1);
+  while (m->entries[i].schema && !(m->entries[i].schema == schema && m->entries[i].inst == inst))
+    i = (i + 1) & (m->cap - 1);
+  return i;
+}
+
+static bool memo_contains(const jsval_memo *m, const void *schema, size_t inst)
+{
+  return m->entries[memo_slot(m, schema, inst)].schema != NULL;
+}
+
+// Memorizza un successo; se la tabella non può crescere il risultato
+// semplicemente non viene conservato.
+static void memo_store(jsval_memo *m, const void *schema, size_t inst)
+{
+  if ((m->count + 1) * 2 > m->cap)
+  {
+    size_t old_cap = m->cap;
+    memo_entry *old = m->entries;
+    memo_entry *ne = (memo_entry *)mem_calloc(old_cap * 2, sizeof(memo_entry));
+    if (!ne)
+      return;
+    m->entries = ne;
+    m->cap = old_cap * 2;
+    for (size_t i = 0; i < old_cap; ++i)
+    {
+      if (old[i].schema)
+        m->entries[memo_slot(m, old[i].schema, old[i].inst)] = old[i];
+    }
+    mem_free(old);
+  }
+  memo_entry *e = &m->entries[memo_slot(m, schema, inst)];
+  if (e->schema)
+    return;
+  e->schema = schema;
+  e->inst = inst;
+  ++m->count;
+}
 
 // Decodifica un token JSON Pointer sostituendo le sequenze ~0 e ~1.
 static bool decode_pointer_token(const char *start, size_t len, char *out, size_t out_sz)
@@ -192,7 +367,7 @@ static bool decode_pointer_token(const char *start, size_t len, char *out, size_
 }
 
 // Risolve un riferimento JSON Pointer limitato a riferimenti interni (#/...) dell'OAS.
-static cJSON *resolve_ref(const char *ref, const jsval_ctx *ctx)
+cJSON *jsval_resolve_ref(const char *ref, const jsval_ctx *ctx)
 {
   if (!ref || !ctx || !ctx->oas_root)
     return NULL;
@@ -235,82 +410,240 @@ static cJSON *resolve_ref(const char *ref, const jsval_ctx *ctx)
   return node;
 }
 
-// Valida gli elementi di un array utilizzando ricorsivamente lo schema `items`.
-static jsval_result validate_array(cJSON *inst, cJSON *schema, const jsval_ctx *ctx)
+// Frame disponibili sullo stack C prima di passare all'heap.
+#define JSVAL_LOCAL_FRAMES 64
+
+// Fasi di un frame del validatore iterativo.
+typedef enum
 {
-  cJSON *items = cJSON_GetObjectItemCaseSensitive(schema, "items");
-  if (!items)
-    return ok();
-  if (!cJSON_IsArray(inst))
-    return errf("Atteso array.");
-  cJSON *el = NULL;
-  cJSON_ArrayForEach(el, inst)
+  VF_START,    // $ref, vincoli sul nodo e preparazione della discesa
+  VF_PROPS,    // sotto-schemi di "properties"
+  VF_PATTERNS, // chiavi dell'istanza contro patternProperties / modalità lexical
+  VF_ITEMS,    // elementi dell'array contro "items"
+  VF_DONE
+} vframe_phase;
+
+// Stato di validazione di una coppia (istanza, schema): sostituisce il frame
+// di chiamata della versione ricorsiva.
+typedef struct vframe
+{
+  size_t inst; // voce del tape
+  cJSON *schema;
+  const js_compiled_node *cn;
+  const void *memo_key; // se non NULL il successo viene memorizzato
+  const char *ref_name; // $ref da cui proviene lo schema (profilo)
+  bool spanned;         // intervallo di profilo aperto per il frame
+  size_t level;         // livello di annidamento dell'istanza
+  unsigned hops;        // $ref già seguiti per questo nodo
+  vframe_phase phase;
+  cJSON *cursor;        // proprietà dello schema corrente
+  size_t pos;           // chiave o elemento corrente dell'istanza
+  size_t end;           // voce TAPE_END dell'istanza
+  cJSON *sub;           // "properties" oppure "items"
+  cJSON *pattern_props;
+  cJSON *pp_cursor;     // pattern corrente (schema non precompilato)
+  size_t pp_index;      // pattern corrente (schema precompilato)
+  const uint32_t *pp_hits; // pattern della chiave trovati dall'automa
+  size_t pp_hit_count;
+  bool keyed;           // automa già eseguito sulla chiave corrente
+  bool matched;
+  js_prop_stats *order; // ordine adattivo di "properties", NULL se disattivo
+  uint64_t hot;         // proprietà anticipate (js_prop_stats_hot)
+  size_t prop_next;     // passo successivo: campi di `hot`, poi proprietà in ordine
+  size_t prop_current;  // proprietà in corso di validazione
+} vframe;
+
+typedef struct vstack
+{
+  vframe *frames;
+  size_t count;
+  size_t cap;
+  bool on_heap;
+  size_t max_depth;
+  payload_tape *tape;
+  bool by_symbol; // chiavi del tape e nomi dello schema dalla stessa tabella
+  ptrmap refs; // nodo "$ref" -> target risolto, creato al primo $ref
+  req_budget_meter meter; // passi non ancora addebitati, anche tra un nodo e l'altro
+} vstack;
+
+// Risolve il $ref contenuto in `ref`, ricordando il risultato per la durata
+// della validazione: lo stesso $ref viene incontrato per ogni elemento di un
+// array e la risoluzione testuale scandisce ogni volta i components.
+static cJSON *vstack_resolve(vstack *st, cJSON *ref, const jsval_ctx *ctx)
+{
+  cJSON *target = st->refs.entries ? (cJSON *)ptrmap_get(&st->refs, ref) : NULL;
+  if (target)
+    return target;
+  target = jsval_resolve_ref(ref->valuestring, ctx);
+  if (target && (st->refs.entries || ptrmap_init(&st->refs, 16)))
+    ptrmap_put(&st->refs, ref, target);
+  return target;
+}
+
+// Aggiunge un frame per (inst, schema). In caso di errore (profondità o
+// memoria) valorizza `res` e restituisce false. Invalida i puntatori ai frame.
+static bool vstack_push(vstack *st, size_t inst, cJSON *schema, size_t level, unsigned hops,
+                        const void *memo_key, jsval_result *res)
+{
+  if (st->max_depth && level > st->max_depth)
   {
-    jsval_result r = js_validate_impl(el, items, ctx);
-    if (!r.ok)
-      return r;
+    *res = errf("Profondità di validazione oltre il limite di %zu livelli", st->max_depth);
+    return false;
   }
-  return ok();
+  if (st->count == st->cap)
+  {
+    size_t ncap = st->cap * 2;
+    vframe *nf = st->on_heap ? (vframe *)mem_realloc(st->frames, ncap * sizeof(vframe))
+                             : (vframe *)mem_malloc(ncap * sizeof(vframe));
+    if (!nf)
+    {
+      *res = errf("Memoria insufficiente per la validazione.");
+      return false;
+    }
+    if (!st->on_heap)
+      memcpy(nf, st->frames, st->count * sizeof(vframe));
+    st->frames = nf;
+    st->cap = ncap;
+    st->on_heap = true;
+  }
+  // gli altri campi vengono impostati dalla fase che li usa
+  vframe *f = &st->frames[st->count++];
+  f->inst = inst;
+  f->schema = schema;
+  f->level = level;
+  f->hops = hops;
+  f->memo_key = memo_key;
+  f->ref_name = NULL;
+  f->spanned = false;
+  f->phase = VF_START;
+  return true;
 }
 
-// Applica i sotto-schemi di patternProperties alle chiavi che combaciano.
-static jsval_result apply_pattern_properties_to_child(
-    cJSON *child, cJSON *pattern_props, const jsval_ctx *ctx, bool *matched_out)
+static bool items_parallel(vstack *st, vframe *f, const jsval_ctx *ctx, jsval_result *res);
+
+// Segue i $ref, applica i vincoli sul nodo e prepara la discesa nei figli.
+static bool vframe_start(vstack *st, vframe *f, const jsval_ctx *ctx, jsval_result *res)
 {
-  if (matched_out)
-    *matched_out = false;
+  cJSON *ref = cJSON_GetObjectItemCaseSensitive(f->schema, "$ref");
+  const char *ref_name = f->ref_name;
+  while (cJSON_IsString(ref))
+  {
+    ref_name = ref->valuestring;
+    if (++f->hops > JSVAL_MAX_REF_HOPS)
+    {
+      *res = errf("Catena di $ref troppo lunga o ciclica: '%s'.", ref->valuestring);
+      return false;
+    }
+    cJSON *resolved = vstack_resolve(st, ref, ctx);
+    if (!resolved)
+    {
+      *res = errf("Impossibile risolvere $ref '%s'.", ref->valuestring);
+      return false;
+    }
+    if (ctx && ctx->memo)
+    {
+      // La chiave usa il nodo compilato canonico, così anche schemi
+      // strutturalmente identici condividono lo stesso risultato.
+      const js_compiled_node *rcn = compiled_for(resolved, ctx);
+      const void *key = rcn ? (const void *)rcn : (const void *)resolved;
+      f->phase = VF_DONE;
+      if (memo_contains(ctx->memo, key, f->inst))
+      {
+        ++ctx->memo->hits;
+        return true;
+      }
+      if (!vstack_push(st, f->inst, resolved, f->level, f->hops, key, res))
+        return false;
+      st->frames[st->count - 1].ref_name = ref_name;
+      return true;
+    }
+    f->schema = resolved;
+    ref = cJSON_GetObjectItemCaseSensitive(resolved, "$ref");
+  }
 
-  if (!cJSON_IsObject(pattern_props) || !child)
-    return ok();
+  if (ref_name && ctx && profile_schemas(ctx->profile))
+  {
+    // chiuso quando il frame termina (VF_DONE) o la validazione fallisce
+    profile_begin(ctx->profile, PROFILE_SCHEMA_SPAN, ref_name);
+    f->spanned = true;
+  }
 
-#ifndef _MSC_VER
-  cJSON *pp = NULL;
-  const char *prop_name = child->string ? child->string : "";
-  cJSON_ArrayForEach(pp, pattern_props)
+  cJSON *schema = f->schema;
+  payload_tape *tape = st->tape;
+  size_t inst = f->inst;
+  payload_tape_tag tag = payload_tape_tag_at(tape, inst);
+  const js_compiled_node *cn = compiled_for(schema, ctx);
+  f->cn = cn;
+
+  // type
+  const char *t = get_type(schema);
+  if (t && !is_type(tape, inst, t))
   {
-    const char *pattern = pp->string;
-    if (!pattern)
-      continue;
+    *res = errf("Tipo non valido: atteso '%s'.", t);
+    return false;
+  }
 
-    regex_t re;
-    int rc = regcomp(&re, pattern, REG_EXTENDED | REG_NOSUB);
-    if (rc != 0)
-      return errf("Pattern non valido nello schema: '%s'.", pattern);
+  // vincoli in ordine di costo: prima i confronti con la lunghezza o il
+  // valore già nel tape, poi la ricerca nell'enum e per ultima la regex, che
+  // non viene eseguita se un vincolo più economico ha già respinto il valore
+  *res = validate_string_bounds(tape, inst, schema, cn);
+  if (!res->ok)
+    return false;
+  *res = validate_numeric_bounds(tape, inst, schema);
+  if (!res->ok)
+    return false;
+  *res = validate_container_bounds(tape, inst, schema, cn);
+  if (!res->ok)
+    return false;
+  *res = validate_enum(tape, inst, schema, cn);
+  if (!res->ok)
+    return false;
+  *res = validate_string_pattern(tape, inst, schema, cn);
+  if (!res->ok)
+    return false;
 
-    rc = regexec(&re, prop_name, 0, NULL, 0);
-    regfree(&re);
-    if (rc == 0)
+  if (t && strcmp(t, "array") == 0)
+  {
+    cJSON *items = cJSON_GetObjectItemCaseSensitive(schema, "items");
+    if (!items)
     {
-      if (matched_out)
-        *matched_out = true;
-
-      if (cJSON_IsObject(pp) || cJSON_IsArray(pp))
-      {
-        jsval_result sub = js_validate_impl(child, pp, ctx);
-        if (!sub.ok)
-          return sub;
-      }
-      else if (cJSON_IsBool(pp))
-      {
-        if (cJSON_IsFalse(pp))
-          return errf("Chiave '%s' non ammessa da patternProperties.", prop_name);
-      }
+      f->phase = VF_DONE;
+      return true;
+    }
+    if (tag != TAPE_ARRAY)
+    {
+      *res = errf("Atteso array.");
+      return false;
     }
+    f->sub = items;
+    f->pos = inst + 1;
+    f->end = (size_t)payload_tape_data(tape, inst);
+    f->phase = VF_ITEMS;
+    if (ctx && ctx->pool && payload_tape_size(tape, inst) >= ctx->parallel_min_items &&
+        items_parallel(st, f, ctx, res))
+      return res->ok;
+    return true;
   }
-#else
-  (void)pattern_props;
-  (void)ctx;
-  (void)child;
-#endif
 
-  return ok();
-}
+  bool as_object = t && strcmp(t, "object") == 0;
+  cJSON *props = NULL;
+  if (as_object || !t)
+  {
+    props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+    // se nessun 'type', proviamo euristica: se schema ha 'properties' → object
+    as_object = as_object || cJSON_IsObject(props);
+  }
+  if (!as_object)
+  {
+    f->phase = VF_DONE;
+    return true;
+  }
 
-// Valida un oggetto JSON confrontando proprietà richieste e sotto-schemi.
-static jsval_result validate_object(cJSON *inst, cJSON *schema, const jsval_ctx *ctx)
-{
-  if (!cJSON_IsObject(inst))
-    return errf("Atteso object.");
+  if (tag != TAPE_OBJECT)
+  {
+    *res = errf("Atteso object.");
+    return false;
+  }
 
   // required
   if (!ctx || ctx->mode == JSVAL_MODE_STRICT)
@@ -321,117 +654,531 @@ static jsval_result validate_object(cJSON *inst, cJSON *schema, const jsval_ctx
       cJSON *r = NULL;
       cJSON_ArrayForEach(r, req)
       {
-        if (cJSON_IsString(r))
+        if (cJSON_IsString(r) && !payload_tape_has_ci(tape, inst, r->valuestring))
         {
-          if (!cJSON_HasObjectItem(inst, r->valuestring))
-          {
-            return errf("Campo richiesto mancante: '%s'", r->valuestring);
-          }
+          *res = errf("Campo richiesto mancante: '%s'", r->valuestring);
+          return false;
         }
       }
     }
   }
 
-  // properties
-  cJSON *props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
-  if (cJSON_IsObject(props))
+  f->sub = cJSON_IsObject(props) ? props : NULL;
+  f->cursor = f->sub ? f->sub->child : NULL;
+  // le proprietà delle statistiche sono quelle del nodo canonico, identiche
+  // per contenuto a quelle di `props`
+  f->order = ctx && ctx->adaptive_order && cn && f->sub ? cn->prop_stats : NULL;
+  f->hot = js_prop_stats_hot(f->order);
+  f->prop_next = 0;
+  f->pattern_props = cJSON_GetObjectItemCaseSensitive(schema, "patternProperties");
+  f->phase = VF_PROPS;
+  return true;
+}
+
+static bool is_hot(uint64_t hot, size_t i)
+{
+  for (size_t k = 0; k < JS_PROP_HOT; ++k)
   {
-    cJSON *p = NULL;
-    cJSON_ArrayForEach(p, props)
+    if (((hot >> (16 * k)) & 0xFFFF) == i + 1)
+      return true;
+  }
+  return false;
+}
+
+// Prossima proprietà di "properties": nell'ordine dello schema oppure, con
+// l'ordine adattivo, prima quelle indicate da `hot` e poi le altre.
+static cJSON *vframe_next_prop(vframe *f)
+{
+  if (!f->order)
+  {
+    cJSON *p = f->cursor;
+    if (p)
+      f->cursor = p->next;
+    return p;
+  }
+  size_t count = js_prop_stats_count(f->order);
+  while (f->prop_next < JS_PROP_HOT + count)
+  {
+    size_t step = f->prop_next++;
+    if (step < JS_PROP_HOT)
     {
-      const char *name = p->string;
-      cJSON *subschema = p;
-      if (!name || !cJSON_IsObject(subschema))
+      size_t i = (size_t)(f->hot >> (16 * step)) & 0xFFFF;
+      if (!i)
+      {
+        f->prop_next = JS_PROP_HOT; // i campi sono riempiti dal primo
         continue;
+      }
+      f->prop_current = i - 1;
+      return js_prop_stats_prop(f->order, i - 1);
+    }
+    if (!is_hot(f->hot, step - JS_PROP_HOT))
+    {
+      f->prop_current = step - JS_PROP_HOT;
+      return js_prop_stats_prop(f->order, f->prop_current);
+    }
+  }
+  return NULL;
+}
+
+// Scende nel prossimo figlio descritto da "properties".
+static bool vframe_props(vstack *st, vframe *f, const jsval_ctx *ctx, jsval_result *res)
+{
+  cJSON *p;
+  while ((p = vframe_next_prop(f)))
+  {
+    if (!p->string || !cJSON_IsObject(p))
+      continue;
+    js_symbol sym = st->by_symbol ? js_symbol_of_key(p) : 0;
+    size_t child = payload_tape_find(st->tape, f->inst, p->string, sym);
+    if (child != TAPE_NONE)
+      return vstack_push(st, child, p, f->level + 1, 0, NULL, res);
+  }
+
+  if (cJSON_IsObject(f->pattern_props) || (ctx && ctx->mode == JSVAL_MODE_LEXICAL))
+  {
+    f->pos = f->inst + 1;
+    f->end = (size_t)payload_tape_data(st->tape, f->inst);
+    f->pp_index = 0;
+    f->pp_cursor = cJSON_IsObject(f->pattern_props) ? f->pattern_props->child : NULL;
+    f->matched = false;
+    f->keyed = false;
+    f->phase = VF_PATTERNS;
+  }
+  else
+  {
+    f->phase = VF_DONE;
+  }
+  return true;
+}
+
+// true se l'oggetto "properties" `props` descrive la chiave `name`. Con
+// `by_symbol` i nomi internati si confrontano con il simbolo `sym` della
+// chiave (0 se la chiave non è nella tabella, quindi in nessuno schema).
+static bool schema_has_key(const cJSON *props, const char *name, js_symbol sym, bool by_symbol)
+{
+  for (const cJSON *p = props->child; p; p = p->next)
+  {
+    js_symbol ps = by_symbol ? js_symbol_of_key(p) : 0;
+    if (ps ? ps == sym : (p->string && strcmp(p->string, name) == 0))
+      return true;
+  }
+  return false;
+}
+
+// Applica patternProperties e la regola lexical alle chiavi dell'istanza,
+// riprendendo dal pattern successivo a quello che ha causato la discesa.
+// Con l'automa delle chiavi una sola passata sul nome fornisce sia i pattern
+// che corrispondono sia l'appartenenza a "properties".
+static bool vframe_patterns(vstack *st, vframe *f, const jsval_ctx *ctx, jsval_result *res)
+{
+  bool has_patterns = cJSON_IsObject(f->pattern_props);
+  const js_key_matcher *keys = f->cn ? f->cn->keys : NULL;
+  bool lexical = ctx && ctx->mode == JSVAL_MODE_LEXICAL;
+  while (f->pos < f->end)
+  {
+    const char *prop_name = payload_tape_string(st->tape, f->pos);
+    size_t child = f->pos + 2;
+
+    if (keys)
+    {
+      if (!f->keyed)
+      {
+        js_key_match km;
+        js_key_matcher_run(keys, prop_name, &km);
+        if (lexical && km.literal < 0 && km.pattern_count == 0)
+        {
+          *res = errf("Chiave non prevista: '%s'", prop_name);
+          return false;
+        }
+        f->pp_hits = km.patterns;
+        f->pp_hit_count = km.pattern_count;
+        f->pp_index = 0;
+        f->keyed = true;
+      }
+      while (f->pp_index < f->pp_hit_count)
+      {
+        const js_pattern_prop *pp = &f->cn->pattern_props[f->pp_hits[f->pp_index++]];
+        if (cJSON_IsObject(pp->schema) || cJSON_IsArray(pp->schema))
+          return vstack_push(st, child, pp->schema, f->level + 1, 0, NULL, res);
+        if (cJSON_IsFalse(pp->schema))
+        {
+          *res = errf("Chiave '%s' non ammessa da patternProperties.", prop_name);
+          return false;
+        }
+      }
+    }
+    else if (has_patterns && f->cn)
+    {
+      while (f->pp_index < f->cn->pattern_prop_count)
+      {
+        const js_pattern_prop *pp = &f->cn->pattern_props[f->pp_index++];
+        if (!pp->re->valid)
+        {
+          *res = errf("Pattern non valido nello schema: '%s'.", pp->pattern);
+          return false;
+        }
+        if (!js_regex_match(pp->re, prop_name))
+          continue;
+        f->matched = true;
+        if (cJSON_IsObject(pp->schema) || cJSON_IsArray(pp->schema))
+          return vstack_push(st, child, pp->schema, f->level + 1, 0, NULL, res);
+        if (cJSON_IsFalse(pp->schema))
+        {
+          *res = errf("Chiave '%s' non ammessa da patternProperties.", prop_name);
+          return false;
+        }
+      }
+    }
+    else if (has_patterns)
+    {
+      while (f->pp_cursor)
+      {
+        cJSON *pp = f->pp_cursor;
+        f->pp_cursor = pp->next;
+        if (!pp->string)
+          continue;
+        js_regex re;
+        js_regex_compile(&re, pp->string);
+        if (!re.valid)
+        {
+          js_regex_free(&re);
+          *res = errf("Pattern non valido nello schema: '%s'.", pp->string);
+          return false;
+        }
+        bool m = js_regex_match(&re, prop_name);
+        js_regex_free(&re);
+        if (!m)
+          continue;
+        f->matched = true;
+        if (cJSON_IsObject(pp) || cJSON_IsArray(pp))
+          return vstack_push(st, child, pp, f->level + 1, 0, NULL, res);
+        if (cJSON_IsFalse(pp))
+        {
+          *res = errf("Chiave '%s' non ammessa da patternProperties.", prop_name);
+          return false;
+        }
+      }
+    }
 
-      cJSON *child = cJSON_GetObjectItemCaseSensitive(inst, name);
-      if (child)
+    if (lexical && !keys)
+    {
+      bool in_props = f->sub && schema_has_key(f->sub, prop_name, payload_tape_key_symbol(st->tape, f->pos),
+                                               st->by_symbol);
+      if (!in_props && !f->matched)
       {
-        jsval_result r = js_validate_impl(child, subschema, ctx);
-        if (!r.ok)
-          return r;
+        *res = errf("Chiave non prevista: '%s'", prop_name);
+        return false;
       }
     }
+
+    f->pos = payload_tape_next(st->tape, child);
+    f->pp_index = 0;
+    f->pp_cursor = has_patterns ? f->pattern_props->child : NULL;
+    f->matched = false;
+    f->keyed = false;
   }
+  f->phase = VF_DONE;
+  return true;
+}
+
+// Valida il nodo `inst` (al livello `level`) contro `schema` con lo stack
+// `st`, che al ritorno è vuoto e può essere riusato per altri nodi dello
+// stesso tape.
+static jsval_result vstack_run(vstack *st, size_t inst, cJSON *schema, size_t level, const jsval_ctx *ctx)
+{
+  payload_tape *tape = st->tape;
+  jsval_result res = ok();
+  bool good = vstack_push(st, inst, schema, level, 0, NULL, &res);
 
-  cJSON *pattern_props = cJSON_GetObjectItemCaseSensitive(schema, "patternProperties");
-  if (cJSON_IsObject(pattern_props) || (ctx && ctx->mode == JSVAL_MODE_LEXICAL))
+  while (good && st->count > 0)
   {
-    cJSON *child = NULL;
-    cJSON_ArrayForEach(child, inst)
+    if (!req_budget_tick(&st->meter))
     {
-      bool matched_pattern = false;
-      if (cJSON_IsObject(pattern_props))
+      res = budget_failure(st->meter.budget);
+      good = false;
+      break;
+    }
+    vframe *f = &st->frames[st->count - 1];
+    switch (f->phase)
+    {
+    case VF_START:
+      good = vframe_start(st, f, ctx, &res);
+      break;
+    case VF_PROPS:
+      good = vframe_props(st, f, ctx, &res);
+      break;
+    case VF_PATTERNS:
+      good = vframe_patterns(st, f, ctx, &res);
+      break;
+    case VF_ITEMS:
+      if (f->pos < f->end)
       {
-        jsval_result r = apply_pattern_properties_to_child(child, pattern_props, ctx, &matched_pattern);
-        if (!r.ok)
-          return r;
+        size_t el = f->pos;
+        f->pos = payload_tape_next(tape, el);
+        good = vstack_push(st, el, f->sub, f->level + 1, 0, NULL, &res);
       }
+      else
+      {
+        f->phase = VF_DONE;
+      }
+      break;
+    case VF_DONE:
+      if (f->memo_key)
+        memo_store(ctx->memo, f->memo_key, f->inst);
+      if (f->spanned)
+        profile_end(ctx->profile);
+      --st->count;
+      break;
+    }
+  }
+  // il rifiuto viene attribuito alla proprietà in corso in ogni oggetto
+  // sul percorso fino al valore non valido (non a quella interrotta dal budget)
+  bool rejected = !good && !req_budget_exceeded(st->meter.budget);
+  for (size_t k = 0; rejected && k + 1 < st->count; ++k)
+  {
+    vframe *f = &st->frames[k];
+    if (f->phase == VF_PROPS && f->order)
+      js_prop_stats_reject(f->order, f->prop_current);
+  }
+  // dopo un errore i frame rimasti chiudono i propri intervalli
+  while (st->count > 0)
+  {
+    if (st->frames[--st->count].spanned)
+      profile_end(ctx->profile);
+  }
+  return res;
+}
+
+static void vstack_release(vstack *st)
+{
+  if (st->on_heap)
+    mem_free(st->frames);
+  ptrmap_free(&st->refs);
+}
+
+// Elementi assegnati a un thread alla volta nella validazione parallela.
+#define JSVAL_PARALLEL_CHUNK 256
 
-      if (ctx && ctx->mode == JSVAL_MODE_LEXICAL)
+// Validazione parallela degli elementi di un array. Il primo thread che
+// parte scorre l'array e pubblica l'inizio di ogni blocco di elementi dopo
+// averlo superato, poi valida come gli altri. I blocchi vengono assegnati in
+// ordine crescente e un elemento viene saltato solo se un elemento di indice
+// minore è già risultato non valido, quindi alla fine `first_fail` è
+// l'indice del primo elemento non valido.
+typedef struct par_items
+{
+  payload_tape *tape;
+  cJSON *items;
+  size_t level;
+  const jsval_ctx *ctx;
+  size_t first;              // voce del primo elemento
+  size_t count;              // elementi dell'array
+  size_t *chunk_start;       // voce del primo elemento di ogni blocco
+  size_t chunk_count;
+  atomic_flag walking;       // impostato dal thread che scorre l'array
+  atomic_size_t published;   // blocchi con l'inizio già in chunk_start
+  atomic_size_t next_chunk;
+  atomic_size_t first_fail;  // SIZE_MAX finché nessun elemento fallisce
+  atomic_size_t memo_hits;
+  mtx_t lock;                // protegge `error_msg`
+  char *error_msg;
+} par_items;
+
+static void par_items_fail(par_items *p, size_t index, jsval_result *r)
+{
+  mtx_lock(&p->lock);
+  if (index < atomic_load(&p->first_fail))
+  {
+    mem_free(p->error_msg);
+    p->error_msg = r->error_msg;
+    r->error_msg = NULL;
+    atomic_store(&p->first_fail, index);
+  }
+  mtx_unlock(&p->lock);
+  jsval_result_free(r);
+}
+
+// Un blocco viene pubblicato solo dopo averne letto gli elementi: i thread
+// che lo validano possono riscrivere le voci dei numeri (TAPE_RAWNUM).
+static void par_items_walk(par_items *p)
+{
+  size_t el = p->first;
+  for (size_t c = 0; c < p->chunk_count; ++c)
+  {
+    if (c * JSVAL_PARALLEL_CHUNK > atomic_load_explicit(&p->first_fail, memory_order_relaxed))
+      break;
+    p->chunk_start[c] = el;
+    if (c + 1 < p->chunk_count)
+    {
+      for (size_t k = 0; k < JSVAL_PARALLEL_CHUNK; ++k)
+        el = payload_tape_next(p->tape, el);
+    }
+    atomic_store_explicit(&p->published, c + 1, memory_order_release);
+  }
+}
+
+static void par_items_worker(void *arg)
+{
+  par_items *p = (par_items *)arg;
+  if (!atomic_flag_test_and_set(&p->walking))
+    par_items_walk(p);
+  // memo e profilo non sono condivisibili tra thread; gli array annidati
+  // restano seriali
+  mem_account *prev = mem_account_enter(p->ctx->memory);
+  req_budget *prev_budget = req_budget_enter(p->ctx->budget);
+  jsval_ctx wctx = *p->ctx;
+  wctx.memo = p->ctx->memo ? jsval_memo_create() : NULL;
+  wctx.profile = NULL;
+  wctx.pool = NULL;
+  vframe local[JSVAL_LOCAL_FRAMES];
+  vstack st = {local, 0, JSVAL_LOCAL_FRAMES, false, wctx.max_depth, p->tape,
+               wctx.symbols && p->tape->symbols == wctx.symbols, {NULL, 0, 0}, req_budget_meter_of(wctx.budget)};
+  bool stop = false;
+  while (!stop)
+  {
+    size_t c = atomic_fetch_add(&p->next_chunk, 1);
+    size_t index = c * JSVAL_PARALLEL_CHUNK;
+    if (c >= p->chunk_count || index > atomic_load_explicit(&p->first_fail, memory_order_relaxed))
+      break;
+    while (atomic_load_explicit(&p->published, memory_order_acquire) <= c)
+    {
+      // chi scorre l'array si ferma dopo il primo elemento non valido
+      if (index > atomic_load(&p->first_fail))
+        break;
+      thrd_yield();
+    }
+    if (atomic_load_explicit(&p->published, memory_order_acquire) <= c)
+      break;
+    size_t n = p->count - index < JSVAL_PARALLEL_CHUNK ? p->count - index : JSVAL_PARALLEL_CHUNK;
+    size_t el = p->chunk_start[c];
+    for (size_t k = 0; k < n; ++k, ++index, el = payload_tape_next(p->tape, el))
+    {
+      if (index > atomic_load_explicit(&p->first_fail, memory_order_relaxed))
+        break;
+      jsval_result r = vstack_run(&st, el, p->items, p->level, &wctx);
+      if (!r.ok)
       {
-        bool in_props = cJSON_IsObject(props) &&
-                        child->string &&
-                        cJSON_GetObjectItemCaseSensitive(props, child->string) != NULL;
-        if (!in_props && !matched_pattern)
-        {
-          return errf("Chiave non prevista: '%s'", child->string ? child->string : "(null)");
-        }
+        par_items_fail(p, index, &r);
+        stop = true;
+        break;
       }
     }
   }
-  return ok();
+  vstack_release(&st);
+  if (wctx.memo)
+  {
+    atomic_fetch_add(&p->memo_hits, wctx.memo->hits);
+    jsval_memo_free(wctx.memo);
+  }
+  req_budget_enter(prev_budget);
+  mem_account_enter(prev);
 }
 
-// Implementazione ricorsiva del validatore per un sottoalbero JSON.
-static jsval_result js_validate_impl(cJSON *inst, cJSON *schema, const jsval_ctx *ctx)
+// Valida gli elementi dell'array del frame `f` (in fase VF_ITEMS) con i
+// thread di ctx->pool. Restituisce false, lasciando il frame invariato, se
+// il pool è occupato o la memoria non basta: gli elementi vengono allora
+// validati in serie. Altrimenti valorizza `res` e chiude il frame.
+static bool items_parallel(vstack *st, vframe *f, const jsval_ctx *ctx, jsval_result *res)
 {
-  // Risolvi $ref se presente
-  cJSON *ref = cJSON_GetObjectItemCaseSensitive(schema, "$ref");
-  if (cJSON_IsString(ref))
+  par_items p;
+  p.count = payload_tape_size(st->tape, f->inst);
+  p.chunk_count = (p.count + JSVAL_PARALLEL_CHUNK - 1) / JSVAL_PARALLEL_CHUNK;
+  if (p.chunk_count < 2)
+    return false;
+  p.chunk_start = (size_t *)mem_malloc(p.chunk_count * sizeof(size_t));
+  if (!p.chunk_start)
+    return false;
+  if (mtx_init(&p.lock, mtx_plain) != thrd_success)
   {
-    cJSON *resolved = resolve_ref(ref->valuestring, ctx);
-    if (!resolved)
-      return errf("Impossibile risolvere $ref '%s'.", ref->valuestring);
-    return js_validate_impl(inst, resolved, ctx);
+    mem_free(p.chunk_start);
+    return false;
   }
+  p.tape = st->tape;
+  p.items = f->sub;
+  p.level = f->level + 1;
+  p.ctx = ctx;
+  p.first = f->pos;
+  atomic_flag_clear(&p.walking);
+  atomic_init(&p.published, 0);
+  atomic_init(&p.next_chunk, 0);
+  atomic_init(&p.first_fail, SIZE_MAX);
+  atomic_init(&p.memo_hits, 0);
+  p.error_msg = NULL;
 
-  // type
-  const char *t = get_type(schema);
-  if (t && !is_type(inst, t))
-    return errf("Tipo non valido: atteso '%s'.", t);
-
-  // enum / bounds
-  jsval_result r;
-  r = validate_enum(inst, schema);
-  if (!r.ok)
-    return r;
-  r = validate_string_pattern(inst, schema);
-  if (!r.ok)
-    return r;
-  r = validate_string_bounds(inst, schema);
-  if (!r.ok)
-    return r;
-  r = validate_numeric_bounds(inst, schema);
-  if (!r.ok)
-    return r;
-
-  // ricorsione su object/array
-  if (t && strcmp(t, "object") == 0)
-    return validate_object(inst, schema, ctx);
-  if (t && strcmp(t, "array") == 0)
-    return validate_array(inst, schema, ctx);
+  profile_begin(ctx->profile, "elementi in parallelo", NULL);
+  bool ran = work_pool_run(ctx->pool, par_items_worker, &p);
+  profile_end(ctx->profile);
+  mtx_destroy(&p.lock);
+  mem_free(p.chunk_start);
+  if (!ran)
+    return false;
+  if (ctx->memo)
+    ctx->memo->hits += atomic_load(&p.memo_hits);
+  if (atomic_load(&p.first_fail) != SIZE_MAX)
+  {
+    *res = (jsval_result){false, p.error_msg, {0, 0, 0, 0}};
+    return true;
+  }
+  *res = ok();
+  f->phase = VF_DONE;
+  return true;
+}
 
-  // se nessun 'type', proviamo euristica: se schema ha 'properties' → object
-  if (!t && cJSON_IsObject(cJSON_GetObjectItemCaseSensitive(schema, "properties")))
-    return validate_object(inst, schema, ctx);
+// Validatore iterativo: la discesa nell'istanza usa uno stack esplicito di
+// frame (prima sullo stack C, poi sull'heap), quindi la profondità del
+// payload non può esaurire lo stack del processo.
+static jsval_result js_validate_iter(payload_tape *tape, cJSON *schema, const jsval_ctx *ctx)
+{
+  vframe local[JSVAL_LOCAL_FRAMES];
+  bool by_symbol = ctx && ctx->symbols && tape->symbols == ctx->symbols;
+  vstack st = {local, 0, JSVAL_LOCAL_FRAMES, false, ctx ? ctx->max_depth : JSVAL_DEFAULT_MAX_DEPTH,
+               tape, by_symbol, {NULL, 0, 0}, req_budget_meter_of(ctx ? ctx->budget : NULL)};
+  jsval_result res = vstack_run(&st, 0, schema, 0, ctx);
+  vstack_release(&st);
+  return res;
+}
 
-  return ok();
+// Punto di ingresso pubblico per validare il payload `tape` rispetto a
+// `schema`. Il contesto permette future estensioni per la risoluzione di
+// riferimenti.
+jsval_result js_validate_tape(payload_tape *tape, cJSON *schema, const jsval_ctx *ctx)
+{
+  mem_account *acct = ctx ? ctx->memory : NULL;
+  req_budget *budget = ctx ? ctx->budget : NULL;
+  if (!acct && !budget)
+    return !tape || tape->count == 0 ? errf("Payload vuoto.") : js_validate_iter(tape, schema, ctx);
+
+  mem_account *prev = acct ? mem_account_enter(acct) : NULL;
+  req_budget *prev_budget = req_budget_enter(budget);
+  mem_account_phase(acct, "validazione");
+  jsval_result r = !tape || tape->count == 0 ? errf("Payload vuoto.") : js_validate_iter(tape, schema, ctx);
+  // il messaggio del limite non è a carico della richiesta
+  req_budget_enter(prev_budget);
+  if (acct)
+    mem_account_enter(prev);
+  if (mem_account_exceeded(acct))
+  {
+    jsval_result_free(&r);
+    r = errf("Memoria della richiesta oltre il limite di %zu byte", mem_account_limit(acct));
+  }
+  else if (req_budget_exceeded(budget))
+  {
+    // anche una regex interrotta, che ha dato esito negativo
+    jsval_result_free(&r);
+    r = budget_failure(budget);
+  }
+  r.memory = mem_account_stats(acct);
+  return r;
 }
 
-// Punto di ingresso pubblico per validare `instance` rispetto a `schema`.
-// Il contesto permette future estensioni per la risoluzione di riferimenti.
+// Variante per istanze già in forma di DOM cJSON: costruisce il tape
+// equivalente e lo valida.
 jsval_result js_validate(cJSON *instance, cJSON *schema, const jsval_ctx *ctx)
 {
-  return js_validate_impl(instance, schema, ctx);
+  payload_tape tape;
+  if (!payload_tape_from_cjson(&tape, instance, ctx ? ctx->symbols : NULL))
+    return errf("Memoria insufficiente per la validazione.");
+  jsval_result r = js_validate_tape(&tape, schema, ctx);
+  payload_tape_free(&tape);
+  return r;
 }
@@ -0,0 +1,966 @@
+#include "key_matcher.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Limiti oltre i quali si rinuncia all'automa e si usano le regex singole.
+#define KM_MAX_PATTERN_LEN 4096
+#define KM_MAX_NESTING 64
+#define KM_MAX_REPEAT 255
+#define KM_MAX_NFA 16384
+#define KM_MAX_DFA 4096
+#define KM_MAX_TABLE (1u << 18) // voci della tabella di transizione
+#define KM_MAX_WORK (1u << 25)  // stati NFA visitati durante la costruzione
+
+// Insieme di byte.
+typedef struct km_set
+{
+  uint8_t bits[32];
+} km_set;
+
+static inline bool set_has(const km_set *s, unsigned c)
+{
+  return (s->bits[c >> 3] >> (c & 7)) & 1;
+}
+
+static inline void set_add(km_set *s, unsigned c)
+{
+  s->bits[c >> 3] |= (uint8_t)(1u << (c & 7));
+}
+
+// Albero sintattico di un pattern.
+typedef enum
+{
+  RX_SET,
+  RX_CAT,
+  RX_ALT,
+  RX_REPEAT,
+  RX_BOL,
+  RX_EOL
+} rx_kind;
+
+typedef struct rx_node
+{
+  rx_kind kind;
+  uint32_t set; // RX_SET
+  int a;        // RX_CAT, RX_ALT, RX_REPEAT
+  int b;        // RX_CAT, RX_ALT
+  int min;      // RX_REPEAT
+  int max;      // RX_REPEAT, -1 = illimitato
+} rx_node;
+
+// Stati dell'NFA di Thompson. NS_ACCEPT chiude il pattern o il nome `arg`;
+// NS_MARK ricorda che il pattern `arg` ha già trovato corrispondenza e
+// consuma qualunque byte restando se stesso, così la corrispondenza resta
+// valida fino alla fine della chiave come in regexec.
+typedef enum
+{
+  NS_SET,
+  NS_SPLIT,
+  NS_EPS,
+  NS_BOL,
+  NS_EOL,
+  NS_ACCEPT,
+  NS_MARK
+} ns_kind;
+
+typedef struct nfa_state
+{
+  ns_kind kind;
+  uint32_t arg; // NS_SET: insieme; NS_ACCEPT, NS_MARK: pattern o nome
+  uint32_t out;
+  uint32_t out1; // NS_SPLIT
+} nfa_state;
+
+typedef struct km_result
+{
+  uint32_t off; // in `hits`
+  uint32_t count;
+  long literal;
+} km_result;
+
+struct js_key_matcher
+{
+  uint8_t classes[256]; // byte -> classe di equivalenza
+  uint32_t class_count;
+  uint32_t state_count;
+  uint16_t *trans;     // state_count * class_count, lo stato 0 è quello morto
+  km_result *results;  // esito alla fine della chiave per ogni stato
+  uint32_t *hits;
+  size_t hit_count;
+  km_result empty;     // esito per la chiave vuota
+};
+
+typedef struct km_builder
+{
+  rx_node *ast;
+  size_t ast_count;
+  size_t ast_cap;
+  km_set *sets;
+  size_t set_count;
+  size_t set_cap;
+  int byte_set[256]; // insieme di un solo byte già creato, -1 se assente
+  nfa_state *nfa;
+  size_t nfa_count;
+  size_t nfa_cap;
+  size_t patterns;
+  size_t literals;
+  uint32_t *starts; // stato iniziale di ogni pattern e poi di ogni nome
+  uint32_t *marks;  // stato NS_MARK di ogni pattern
+  // visita degli stati
+  uint32_t *stack;
+  uint32_t *seen;
+  uint32_t gen;
+  size_t work;
+} km_builder;
+
+static bool grow(void **buf, size_t *cap, size_t need, size_t elem)
+{
+  if (need <= *cap)
+    return true;
+  size_t ncap = *cap ? *cap * 2 : 64;
+  while (ncap < need)
+    ncap *= 2;
+  void *nb = realloc(*buf, ncap * elem);
+  if (!nb)
+    return false;
+  *buf = nb;
+  *cap = ncap;
+  return true;
+}
+
+static int ast_new(km_builder *b, rx_kind kind, int x, int y)
+{
+  if (!grow((void **)&b->ast, &b->ast_cap, b->ast_count + 1, sizeof(rx_node)))
+    return -1;
+  rx_node *n = &b->ast[b->ast_count];
+  memset(n, 0, sizeof(*n));
+  n->kind = kind;
+  n->a = x;
+  n->b = y;
+  return (int)b->ast_count++;
+}
+
+static int set_new(km_builder *b, const km_set *s)
+{
+  for (size_t i = 0; i < b->set_count; ++i)
+  {
+    if (memcmp(&b->sets[i], s, sizeof(*s)) == 0)
+      return (int)i;
+  }
+  if (!grow((void **)&b->sets, &b->set_cap, b->set_count + 1, sizeof(km_set)))
+    return -1;
+  b->sets[b->set_count] = *s;
+  return (int)b->set_count++;
+}
+
+static int ast_set(km_builder *b, const km_set *s)
+{
+  int idx = set_new(b, s);
+  if (idx < 0)
+    return -1;
+  int n = ast_new(b, RX_SET, -1, -1);
+  if (n >= 0)
+    b->ast[n].set = (uint32_t)idx;
+  return n;
+}
+
+static int ast_byte(km_builder *b, unsigned char c)
+{
+  if (b->byte_set[c] < 0)
+  {
+    if (!grow((void **)&b->sets, &b->set_cap, b->set_count + 1, sizeof(km_set)))
+      return -1;
+    memset(&b->sets[b->set_count], 0, sizeof(km_set));
+    set_add(&b->sets[b->set_count], c);
+    b->byte_set[c] = (int)b->set_count++;
+  }
+  int n = ast_new(b, RX_SET, -1, -1);
+  if (n >= 0)
+    b->ast[n].set = (uint32_t)b->byte_set[c];
+  return n;
+}
+
+// ---------------------------------------------------------------------------
+// Parser del sottoinsieme delle espressioni regolari estese POSIX con lo
+// stesso significato in regcomp (locale C) e in regex_compat: letterali,
+// '.', espressioni tra parentesi quadre con intervalli, gruppi, alternative,
+// quantificatori *, +, ?, {m}, {m,}, {m,n} e ancore ^ e $.
+
+typedef struct rx_parser
+{
+  km_builder *b;
+  const char *p;
+} rx_parser;
+
+static int parse_alt(rx_parser *ps, int depth);
+
+// Escape con significato letterale in entrambi i motori: la punteggiatura
+// tranne \< \> \` \' (confini di parola e di buffer in glibc).
+static bool plain_escape(unsigned char c)
+{
+  return c && c < 0x80 && !(c >= '0' && c <= '9') && !(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z') &&
+         c > ' ' && c != '<' && c != '>' && c != '`' && c != '\'';
+}
+
+static int parse_bracket(rx_parser *ps)
+{
+  const unsigned char *p = (const unsigned char *)ps->p + 1;
+  km_set s;
+  memset(&s, 0, sizeof(s));
+  bool negate = false;
+  if (*p == '^')
+  {
+    negate = true;
+    ++p;
+  }
+  bool first = true;
+  for (;;)
+  {
+    unsigned lo = *p;
+    if (!lo)
+      return -1;
+    if (lo == ']' && !first)
+    {
+      ++p;
+      break;
+    }
+    if (lo == '[' && (p[1] == ':' || p[1] == '=' || p[1] == '.'))
+      return -1;
+    unsigned hi = lo;
+    ++p;
+    if (*p == '-' && p[1] && p[1] != ']')
+    {
+      hi = p[1];
+      if (hi == '[' || hi < lo)
+        return -1;
+      p += 2;
+    }
+    for (unsigned c = lo; c <= hi; ++c)
+      set_add(&s, c);
+    first = false;
+  }
+  if (negate)
+  {
+    for (size_t i = 0; i < sizeof(s.bits); ++i)
+      s.bits[i] = (uint8_t)~s.bits[i];
+  }
+  s.bits[0] &= (uint8_t)~1u; // il NUL termina la chiave
+  ps->p = (const char *)p;
+  return ast_set(ps->b, &s);
+}
+
+static int parse_atom(rx_parser *ps, int depth)
+{
+  unsigned char c = (unsigned char)*ps->p;
+  switch (c)
+  {
+  case '(':
+  {
+    if (depth >= KM_MAX_NESTING)
+      return -1;
+    ++ps->p;
+    int n = parse_alt(ps, depth + 1);
+    if (n < 0 || *ps->p != ')')
+      return -1;
+    ++ps->p;
+    return n;
+  }
+  case '[':
+    return parse_bracket(ps);
+  case '.':
+  {
+    km_set s;
+    memset(&s, 0xff, sizeof(s));
+    s.bits[0] &= (uint8_t)~1u;
+    ++ps->p;
+    return ast_set(ps->b, &s);
+  }
+  case '^':
+    ++ps->p;
+    return ast_new(ps->b, RX_BOL, -1, -1);
+  case '$':
+    ++ps->p;
+    return ast_new(ps->b, RX_EOL, -1, -1);
+  case '\\':
+  {
+    unsigned char e = (unsigned char)ps->p[1];
+    if (!plain_escape(e))
+      return -1;
+    ps->p += 2;
+    return ast_byte(ps->b, e);
+  }
+  case '*':
+  case '+':
+  case '?':
+  case '{':
+  case '\0':
+    return -1;
+  default:
+    ++ps->p;
+    return ast_byte(ps->b, c);
+  }
+}
+
+// Legge "{m}", "{m,}" o "{m,n}".
+static bool parse_bound(rx_parser *ps, int *min, int *max)
+{
+  const char *p = ps->p + 1;
+  int m = 0, n = 0, digits = 0;
+  while (*p >= '0' && *p <= '9' && digits < 4)
+  {
+    m = m * 10 + (*p++ - '0');
+    ++digits;
+  }
+  if (!digits || m > KM_MAX_REPEAT)
+    return false;
+  n = m;
+  if (*p == ',')
+  {
+    ++p;
+    if (*p == '}')
+    {
+      n = -1;
+    }
+    else
+    {
+      n = 0;
+      digits = 0;
+      while (*p >= '0' && *p <= '9' && digits < 4)
+      {
+        n = n * 10 + (*p++ - '0');
+        ++digits;
+      }
+      if (!digits || n > KM_MAX_REPEAT || n < m)
+        return false;
+    }
+  }
+  if (*p != '}')
+    return false;
+  ps->p = p + 1;
+  *min = m;
+  *max = n;
+  return true;
+}
+
+static int parse_piece(rx_parser *ps, int depth)
+{
+  int atom = parse_atom(ps, depth);
+  if (atom < 0)
+    return -1;
+  for (;;)
+  {
+    int min, max;
+    char c = *ps->p;
+    if (c == '*')
+    {
+      min = 0;
+      max = -1;
+      ++ps->p;
+    }
+    else if (c == '+')
+    {
+      min = 1;
+      max = -1;
+      ++ps->p;
+    }
+    else if (c == '?')
+    {
+      min = 0;
+      max = 1;
+      ++ps->p;
+    }
+    else if (c == '{')
+    {
+      if (!parse_bound(ps, &min, &max))
+        return -1;
+    }
+    else
+    {
+      return atom;
+    }
+    rx_kind k = ps->b->ast[atom].kind;
+    if (k == RX_BOL || k == RX_EOL)
+      return -1;
+    atom = ast_new(ps->b, RX_REPEAT, atom, -1);
+    if (atom < 0)
+      return -1;
+    ps->b->ast[atom].min = min;
+    ps->b->ast[atom].max = max;
+  }
+}
+
+static int parse_cat(rx_parser *ps, int depth)
+{
+  int left = -1;
+  while (*ps->p && *ps->p != '|' && *ps->p != ')')
+  {
+    int piece = parse_piece(ps, depth);
+    if (piece < 0)
+      return -1;
+    left = left < 0 ? piece : ast_new(ps->b, RX_CAT, left, piece);
+    if (left < 0)
+      return -1;
+  }
+  return left; // -1 per un'alternativa vuota
+}
+
+static int parse_alt(rx_parser *ps, int depth)
+{
+  int left = parse_cat(ps, depth);
+  while (left >= 0 && *ps->p == '|')
+  {
+    ++ps->p;
+    int right = parse_cat(ps, depth);
+    if (right < 0)
+      return -1;
+    left = ast_new(ps->b, RX_ALT, left, right);
+  }
+  return left;
+}
+
+// ---------------------------------------------------------------------------
+// Costruzione dell'NFA: ogni nodo viene compilato a partire dallo stato che
+// lo segue, quindi non servono liste di uscite da completare.
+
+#define NFA_NONE UINT32_MAX
+
+static uint32_t nfa_new(km_builder *b, ns_kind kind, uint32_t arg, uint32_t out, uint32_t out1)
+{
+  if (b->nfa_count >= KM_MAX_NFA || !grow((void **)&b->nfa, &b->nfa_cap, b->nfa_count + 1, sizeof(nfa_state)))
+    return NFA_NONE;
+  nfa_state *s = &b->nfa[b->nfa_count];
+  s->kind = kind;
+  s->arg = arg;
+  s->out = out;
+  s->out1 = out1;
+  return (uint32_t)b->nfa_count++;
+}
+
+static uint32_t nfa_build(km_builder *b, int n, uint32_t next)
+{
+  if (next == NFA_NONE)
+    return NFA_NONE;
+  const rx_node node = b->ast[n];
+  switch (node.kind)
+  {
+  case RX_SET:
+    return nfa_new(b, NS_SET, node.set, next, 0);
+  case RX_BOL:
+    return nfa_new(b, NS_BOL, 0, next, 0);
+  case RX_EOL:
+    return nfa_new(b, NS_EOL, 0, next, 0);
+  case RX_CAT:
+    return nfa_build(b, node.a, nfa_build(b, node.b, next));
+  case RX_ALT:
+  {
+    uint32_t x = nfa_build(b, node.a, next);
+    uint32_t y = nfa_build(b, node.b, next);
+    if (x == NFA_NONE || y == NFA_NONE)
+      return NFA_NONE;
+    return nfa_new(b, NS_SPLIT, 0, x, y);
+  }
+  case RX_REPEAT:
+  {
+    uint32_t cur = next;
+    if (node.max < 0)
+    {
+      uint32_t loop = nfa_new(b, NS_SPLIT, 0, NFA_NONE, next);
+      if (loop == NFA_NONE)
+        return NFA_NONE;
+      uint32_t body = nfa_build(b, node.a, loop);
+      if (body == NFA_NONE)
+        return NFA_NONE;
+      b->nfa[loop].out = body;
+      cur = loop;
+    }
+    else
+    {
+      // x{m,n} = x^m (x(x(...)?)?)? con n - m copie opzionali annidate
+      for (int k = 0; k < node.max - node.min && cur != NFA_NONE; ++k)
+      {
+        uint32_t body = nfa_build(b, node.a, cur);
+        cur = body == NFA_NONE ? NFA_NONE : nfa_new(b, NS_SPLIT, 0, body, next);
+      }
+    }
+    for (int k = 0; k < node.min && cur != NFA_NONE; ++k)
+      cur = nfa_build(b, node.a, cur);
+    return cur;
+  }
+  }
+  return NFA_NONE;
+}
+
+static bool add_pattern(km_builder *b, size_t i, const char *pattern)
+{
+  if (strlen(pattern) > KM_MAX_PATTERN_LEN)
+    return false;
+  b->ast_count = 0;
+  rx_parser ps = {b, pattern};
+  int root = parse_alt(&ps, 0);
+  if (root < 0 || *ps.p != '\0')
+    return false;
+  uint32_t accept = nfa_new(b, NS_ACCEPT, (uint32_t)i, 0, 0);
+  b->marks[i] = nfa_new(b, NS_MARK, (uint32_t)i, 0, 0);
+  if (accept == NFA_NONE || b->marks[i] == NFA_NONE)
+    return false;
+  b->starts[i] = nfa_build(b, root, accept);
+  return b->starts[i] != NFA_NONE;
+}
+
+// Un nome equivale al pattern ^nome$.
+static bool add_literal(km_builder *b, size_t j, const char *name)
+{
+  uint32_t id = (uint32_t)(b->patterns + j);
+  uint32_t cur = nfa_new(b, NS_ACCEPT, id, 0, 0);
+  cur = cur == NFA_NONE ? NFA_NONE : nfa_new(b, NS_EOL, 0, cur, 0);
+  for (size_t k = strlen(name); k-- > 0 && cur != NFA_NONE;)
+  {
+    unsigned char c = (unsigned char)name[k];
+    int set = b->byte_set[c];
+    if (set < 0)
+    {
+      km_set s;
+      memset(&s, 0, sizeof(s));
+      set_add(&s, c);
+      if (!grow((void **)&b->sets, &b->set_cap, b->set_count + 1, sizeof(km_set)))
+        return false;
+      b->sets[b->set_count] = s;
+      set = b->byte_set[c] = (int)b->set_count++;
+    }
+    cur = nfa_new(b, NS_SET, (uint32_t)set, cur, 0);
+  }
+  cur = cur == NFA_NONE ? NFA_NONE : nfa_new(b, NS_BOL, 0, cur, 0);
+  b->starts[id] = cur;
+  return cur != NFA_NONE;
+}
+
+// ---------------------------------------------------------------------------
+// Costruzione per sottoinsiemi. Uno stato dell'automa è l'insieme ordinato
+// degli stati NFA che consumano un byte (NS_SET, NS_MARK) più le ancore $
+// ancora da verificare.
+
+static int cmp_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Chiusura epsilon dei `n` stati in `seeds`; scrive in `out` gli stati
+// raccolti e ne restituisce il numero, oppure (size_t)-1 se il lavoro
+// supera il limite. Con `at_end` le ancore $ vengono attraversate e gli
+// NS_ACCEPT raccolti, altrimenti ogni NS_ACCEPT di pattern diventa il suo
+// NS_MARK.
+static size_t closure(km_builder *b, const uint32_t *seeds, size_t n, bool at_begin, bool at_end, uint32_t *out)
+{
+  if (++b->gen == 0)
+  {
+    memset(b->seen, 0, b->nfa_count * sizeof(uint32_t));
+    b->gen = 1;
+  }
+  size_t top = 0, count = 0;
+  for (size_t i = n; i-- > 0;)
+    b->stack[top++] = seeds[i];
+  while (top > 0)
+  {
+    uint32_t s = b->stack[--top];
+    if (b->seen[s] == b->gen)
+      continue;
+    b->seen[s] = b->gen;
+    if (++b->work > KM_MAX_WORK)
+      return (size_t)-1;
+    const nfa_state *st = &b->nfa[s];
+    switch (st->kind)
+    {
+    case NS_SET:
+    case NS_MARK:
+      out[count++] = s;
+      break;
+    case NS_SPLIT:
+      b->stack[top++] = st->out1;
+      b->stack[top++] = st->out;
+      break;
+    case NS_EPS:
+      b->stack[top++] = st->out;
+      break;
+    case NS_BOL:
+      if (at_begin)
+        b->stack[top++] = st->out;
+      break;
+    case NS_EOL:
+      if (at_end)
+        b->stack[top++] = st->out;
+      else
+        out[count++] = s;
+      break;
+    case NS_ACCEPT:
+      if (at_end)
+        out[count++] = s;
+      else if (st->arg < b->patterns)
+        b->stack[top++] = b->marks[st->arg];
+      break;
+    }
+  }
+  return count;
+}
+
+typedef struct dfa_build
+{
+  uint32_t *pool; // insiemi concatenati
+  size_t pool_count;
+  size_t pool_cap;
+  size_t *off;    // per stato: inizio in `pool`
+  uint32_t *len;  // per stato: numero di stati NFA
+  uint64_t *hash;
+  size_t state_cap;
+  uint32_t *slots; // tabella hash: stato + 1
+  size_t slot_cap;
+  uint32_t count;
+} dfa_build;
+
+static uint64_t hash_set(const uint32_t *s, size_t n)
+{
+  uint64_t h = 0xcbf29ce484222325ULL ^ n;
+  for (size_t i = 0; i < n; ++i)
+  {
+    h ^= s[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h ^ (h >> 29);
+}
+
+static bool dfa_rehash(dfa_build *d, size_t cap)
+{
+  uint32_t *ns = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!ns)
+    return false;
+  for (uint32_t i = 0; i < d->count; ++i)
+  {
+    size_t k = (size_t)d->hash[i] & (cap - 1);
+    while (ns[k])
+      k = (k + 1) & (cap - 1);
+    ns[k] = i + 1;
+  }
+  free(d->slots);
+  d->slots = ns;
+  d->slot_cap = cap;
+  return true;
+}
+
+// Restituisce lo stato con l'insieme `s` (ordinato), creandolo se nuovo;
+// UINT32_MAX se si superano i limiti o la memoria non basta.
+static uint32_t dfa_intern(dfa_build *d, const uint32_t *s, size_t n)
+{
+  uint64_t h = hash_set(s, n);
+  if (d->slot_cap)
+  {
+    size_t k = (size_t)h & (d->slot_cap - 1);
+    while (d->slots[k])
+    {
+      uint32_t id = d->slots[k] - 1;
+      if (d->hash[id] == h && d->len[id] == n && (!n || memcmp(d->pool + d->off[id], s, n * sizeof(uint32_t)) == 0))
+        return id;
+      k = (k + 1) & (d->slot_cap - 1);
+    }
+  }
+  if (d->count >= KM_MAX_DFA)
+    return UINT32_MAX;
+  if ((d->count + 1) * 2 > d->slot_cap && !dfa_rehash(d, d->slot_cap ? d->slot_cap * 2 : 64))
+    return UINT32_MAX;
+  if (d->count == d->state_cap)
+  {
+    size_t ncap = d->state_cap ? d->state_cap * 2 : 64;
+    size_t *no = (size_t *)realloc(d->off, ncap * sizeof(size_t));
+    if (no)
+      d->off = no;
+    uint32_t *nl = (uint32_t *)realloc(d->len, ncap * sizeof(uint32_t));
+    if (nl)
+      d->len = nl;
+    uint64_t *nh = (uint64_t *)realloc(d->hash, ncap * sizeof(uint64_t));
+    if (nh)
+      d->hash = nh;
+    if (!no || !nl || !nh)
+      return UINT32_MAX;
+    d->state_cap = ncap;
+  }
+  if (!grow((void **)&d->pool, &d->pool_cap, d->pool_count + n + 1, sizeof(uint32_t)))
+    return UINT32_MAX;
+  uint32_t id = d->count++;
+  if (n)
+    memcpy(d->pool + d->pool_count, s, n * sizeof(uint32_t));
+  d->off[id] = d->pool_count;
+  d->len[id] = (uint32_t)n;
+  d->hash[id] = h;
+  d->pool_count += n;
+  size_t k = (size_t)h & (d->slot_cap - 1);
+  while (d->slots[k])
+    k = (k + 1) & (d->slot_cap - 1);
+  d->slots[k] = id + 1;
+  return id;
+}
+
+// Classi di equivalenza dei byte: due byte sono nella stessa classe se
+// nessun insieme dell'NFA li distingue.
+static uint32_t byte_classes(const km_builder *b, uint8_t classes[256])
+{
+  memset(classes, 0, 256);
+  uint32_t count = 1;
+  for (size_t i = 0; i < b->set_count && count < 256; ++i)
+  {
+    int remap[512];
+    for (size_t k = 0; k < 2 * (size_t)count; ++k)
+      remap[k] = -1;
+    uint32_t next = 0;
+    for (unsigned c = 0; c < 256; ++c)
+    {
+      size_t key = (size_t)classes[c] * 2 + set_has(&b->sets[i], c);
+      if (remap[key] < 0)
+        remap[key] = (int)next++;
+      classes[c] = (uint8_t)remap[key];
+    }
+    count = next;
+  }
+  return count;
+}
+
+// Esito alla fine della chiave per l'insieme `s`.
+static bool end_result(km_builder *b, const uint32_t *s, size_t n, bool at_begin, uint32_t *scratch,
+                       js_key_matcher *m, size_t *hit_cap, km_result *out)
+{
+  size_t cn = closure(b, s, n, at_begin, true, scratch);
+  if (cn == (size_t)-1)
+    return false;
+  out->off = (uint32_t)m->hit_count;
+  out->count = 0;
+  out->literal = -1;
+  for (size_t i = 0; i < cn; ++i)
+  {
+    const nfa_state *st = &b->nfa[scratch[i]];
+    if (st->kind != NS_ACCEPT && st->kind != NS_MARK)
+      continue;
+    if (st->arg < b->patterns)
+    {
+      if (!grow((void **)&m->hits, hit_cap, m->hit_count + 1, sizeof(uint32_t)))
+        return false;
+      m->hits[m->hit_count++] = st->arg;
+      ++out->count;
+    }
+    else
+    {
+      long lit = (long)(st->arg - b->patterns);
+      if (out->literal < 0 || lit < out->literal)
+        out->literal = lit;
+    }
+  }
+  // NS_ACCEPT e NS_MARK dello stesso pattern possono comparire entrambi
+  if (out->count < 2)
+    return true;
+  uint32_t *h = m->hits + out->off;
+  qsort(h, out->count, sizeof(uint32_t), cmp_u32);
+  uint32_t w = 0;
+  for (uint32_t i = 0; i < out->count; ++i)
+  {
+    if (w == 0 || h[w - 1] != h[i])
+      h[w++] = h[i];
+  }
+  m->hit_count -= out->count - w;
+  out->count = w;
+  return true;
+}
+
+static bool build_dfa(km_builder *b, js_key_matcher *m)
+{
+  m->class_count = byte_classes(b, m->classes);
+  unsigned char rep[256];
+  bool have[256] = {false};
+  for (unsigned c = 0; c < 256; ++c)
+  {
+    if (!have[m->classes[c]])
+    {
+      have[m->classes[c]] = true;
+      rep[m->classes[c]] = (unsigned char)c;
+    }
+  }
+
+  size_t total = b->patterns + b->literals;
+  size_t scratch_len = b->nfa_count + total + 1;
+  uint32_t *seeds = (uint32_t *)malloc(scratch_len * sizeof(uint32_t));
+  uint32_t *set = (uint32_t *)malloc(scratch_len * sizeof(uint32_t));
+  dfa_build d;
+  memset(&d, 0, sizeof(d));
+  size_t trans_cap = 0, result_cap = 0, hit_cap = 0;
+  bool ok = seeds && set;
+
+  // stato 0: insieme vuoto (nessuna corrispondenza possibile)
+  ok = ok && dfa_intern(&d, NULL, 0) == 0;
+  // stato 1: inizio della chiave
+  size_t n = 0;
+  if (ok)
+  {
+    n = closure(b, b->starts, total, true, false, set);
+    ok = n != (size_t)-1;
+  }
+  if (ok)
+  {
+    qsort(set, n, sizeof(uint32_t), cmp_u32);
+    ok = dfa_intern(&d, set, n) == 1;
+  }
+  if (ok)
+    ok = end_result(b, b->starts, total, true, set, m, &hit_cap, &m->empty);
+
+  for (uint32_t id = 0; ok && id < d.count; ++id)
+  {
+    if ((size_t)d.count * m->class_count > KM_MAX_TABLE)
+    {
+      ok = false;
+      break;
+    }
+    if (!grow((void **)&m->trans, &trans_cap, ((size_t)id + 1) * m->class_count, sizeof(uint16_t)) ||
+        !grow((void **)&m->results, &result_cap, (size_t)id + 1, sizeof(km_result)))
+    {
+      ok = false;
+      break;
+    }
+    for (uint32_t cls = 0; ok && cls < m->class_count; ++cls)
+    {
+      if (id == 0)
+      {
+        m->trans[cls] = 0;
+        continue;
+      }
+      unsigned char c = rep[cls];
+      const uint32_t *cur = d.pool + d.off[id];
+      size_t len = d.len[id], ns = 0;
+      for (size_t i = 0; i < len; ++i)
+      {
+        const nfa_state *st = &b->nfa[cur[i]];
+        if (st->kind == NS_SET && set_has(&b->sets[st->arg], c))
+          seeds[ns++] = st->out;
+        else if (st->kind == NS_MARK)
+          seeds[ns++] = cur[i];
+      }
+      // la ricerca può iniziare in qualunque punto della chiave
+      for (size_t i = 0; i < b->patterns; ++i)
+        seeds[ns++] = b->starts[i];
+      n = closure(b, seeds, ns, false, false, set);
+      if (n == (size_t)-1)
+      {
+        ok = false;
+        break;
+      }
+      qsort(set, n, sizeof(uint32_t), cmp_u32);
+      uint32_t to = dfa_intern(&d, set, n);
+      if (to == UINT32_MAX)
+      {
+        ok = false;
+        break;
+      }
+      m->trans[(size_t)id * m->class_count + cls] = (uint16_t)to;
+    }
+    if (ok)
+    {
+      // `set` viene riusato come spazio di lavoro: l'insieme è già in d.pool
+      ok = end_result(b, d.pool + d.off[id], d.len[id], false, set, m, &hit_cap, &m->results[id]);
+    }
+  }
+  m->state_count = d.count;
+  free(seeds);
+  free(set);
+  free(d.pool);
+  free(d.off);
+  free(d.len);
+  free(d.hash);
+  free(d.slots);
+  return ok;
+}
+
+js_key_matcher *js_key_matcher_build(const char *const *patterns, size_t pattern_count,
+                                     const char *const *literals, size_t literal_count)
+{
+  size_t total = pattern_count + literal_count;
+  if (total == 0 || total > KM_MAX_NFA)
+    return NULL;
+  km_builder b;
+  memset(&b, 0, sizeof(b));
+  for (int c = 0; c < 256; ++c)
+    b.byte_set[c] = -1;
+  b.patterns = pattern_count;
+  b.literals = literal_count;
+  b.starts = (uint32_t *)malloc(total * sizeof(uint32_t));
+  b.marks = (uint32_t *)malloc((pattern_count ? pattern_count : 1) * sizeof(uint32_t));
+  js_key_matcher *m = (js_key_matcher *)calloc(1, sizeof(js_key_matcher));
+  bool ok = b.starts && b.marks && m;
+  for (size_t i = 0; ok && i < pattern_count; ++i)
+    ok = patterns[i] && add_pattern(&b, i, patterns[i]);
+  for (size_t j = 0; ok && j < literal_count; ++j)
+    ok = literals[j] && add_literal(&b, j, literals[j]);
+  if (ok)
+  {
+    // sullo stack: i semi (al più un insieme più i pattern) e una voce per
+    // arco uscente di ogni stato visitato (al più 2)
+    b.stack = (uint32_t *)malloc((3 * b.nfa_count + total + 1) * sizeof(uint32_t));
+    b.seen = (uint32_t *)calloc(b.nfa_count, sizeof(uint32_t));
+    ok = b.stack && b.seen && build_dfa(&b, m);
+  }
+  free(b.ast);
+  free(b.sets);
+  free(b.nfa);
+  free(b.starts);
+  free(b.marks);
+  free(b.stack);
+  free(b.seen);
+  if (!ok)
+  {
+    js_key_matcher_free(m);
+    return NULL;
+  }
+  // le tabelle sono cresciute per raddoppi: restituire l'eccedenza
+  uint16_t *trans = (uint16_t *)realloc(m->trans, (size_t)m->state_count * m->class_count * sizeof(uint16_t));
+  if (trans)
+    m->trans = trans;
+  km_result *results = (km_result *)realloc(m->results, (size_t)m->state_count * sizeof(km_result));
+  if (results)
+    m->results = results;
+  if (m->hit_count)
+  {
+    uint32_t *hits = (uint32_t *)realloc(m->hits, m->hit_count * sizeof(uint32_t));
+    if (hits)
+      m->hits = hits;
+  }
+  return m;
+}
+
+void js_key_matcher_free(js_key_matcher *m)
+{
+  if (!m)
+    return;
+  free(m->trans);
+  free(m->results);
+  free(m->hits);
+  free(m);
+}
+
+void js_key_matcher_run(const js_key_matcher *m, const char *key, js_key_match *out)
+{
+  const km_result *r = &m->empty;
+  if (*key)
+  {
+    const unsigned char *p = (const unsigned char *)key;
+    uint32_t s = 1;
+    const uint16_t *trans = m->trans;
+    uint32_t stride = m->class_count;
+    while (*p && s)
+      s = trans[(size_t)s * stride + m->classes[*p++]];
+    r = &m->results[s];
+  }
+  out->patterns = m->hits + r->off;
+  out->pattern_count = r->count;
+  out->literal = r->literal;
+}
+
+size_t js_key_matcher_bytes(const js_key_matcher *m)
+{
+  if (!m)
+    return 0;
+  return sizeof(*m) + (size_t)m->state_count * (m->class_count * sizeof(uint16_t) + sizeof(km_result)) +
+         m->hit_count * sizeof(uint32_t);
+}
@@ -0,0 +1,1458 @@
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "latency_explore.h"
+#include "ptrmap.h"
+#include "schema_compile.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Punti dello schema esplorati al massimo e profondità della visita.
+#define EXPLORE_MAX_TARGETS 256
+#define EXPLORE_MAX_WALK_DEPTH 32
+// Profondità massima delle istanze minime generate per i campi richiesti.
+#define EXPLORE_MIN_DEPTH 16
+// Ripetizioni di una misura e durata oltre la quale non si ripete.
+#define EXPLORE_REPEATS 5
+#define EXPLORE_REPEAT_SECONDS 0.05
+// Caratteri dell'alfabeto di un pattern provati come ripetizione.
+#define EXPLORE_MAX_ALPHABET 8
+
+typedef struct ex_buf
+{
+  char *data;
+  size_t len;
+  size_t cap;
+  bool failed;
+} ex_buf;
+
+// Punto dello schema da esplorare: il payload è `prefix` + valore +
+// `suffix`, dove prefisso e suffisso contengono i contenitori che portano al
+// punto con le proprietà richieste dagli schemi attraversati.
+typedef struct explore_target
+{
+  explore_kind kind;
+  cJSON *schema;
+  char *location;
+  char *prefix;
+  char *suffix;
+  char *pattern;     // EXPLORE_PATTERN / EXPLORE_KEY_PATTERN
+  size_t max_length; // maxLength della stringa, 0 se assente
+  char *pump_open;   // EXPLORE_RECURSION: un giro del ciclo
+  char *pump_close;
+  char *element; // istanza minima: elemento dell'array, valore delle chiavi, fondo della ricorsione
+  // miglior caso trovato
+  char *best;
+  size_t best_len;
+  char *best_string; // stringa del miglior caso (pattern)
+  size_t best_string_len;
+  double best_seconds;
+  size_t best_memory;
+  bool best_valid;
+  char *detail;
+} explore_target;
+
+// Antenato nella visita: serve a riconoscere i $ref ricorsivi.
+typedef struct walk_frame
+{
+  const cJSON *schema;
+  const char *prefix;
+  const char *suffix;
+  struct walk_frame *parent;
+  bool recursion; // ciclo verso questo antenato già registrato
+} walk_frame;
+
+typedef struct explorer
+{
+  cJSON *root_schema;
+  const jsval_ctx *ctx;
+  const explore_options *opts;
+  size_t max_bytes;
+  explore_target *targets;
+  size_t target_count;
+  ptrmap visited;
+  mem_account *memory; // memoria di ogni payload, con il limite della richiesta
+  uint64_t rng;
+  double deadline;
+  size_t probes;
+  bool failed;
+} explorer;
+
+const char *explore_kind_name(explore_kind k)
+{
+  switch (k)
+  {
+  case EXPLORE_PATTERN:
+    return "pattern";
+  case EXPLORE_KEY_PATTERN:
+    return "chiave/patternProperties";
+  case EXPLORE_RECURSION:
+    return "annidamento ricorsivo";
+  case EXPLORE_WIDE_OBJECT:
+    return "oggetto largo";
+  case EXPLORE_LONG_ARRAY:
+    return "array lungo";
+  }
+  return "?";
+}
+
+static double now_seconds(void)
+{
+  struct timespec ts;
+#ifdef _MSC_VER
+  timespec_get(&ts, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_next(uint64_t *s)
+{
+  uint64_t x = *s;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *s = x;
+}
+
+static size_t rng_below(uint64_t *s, size_t n)
+{
+  return n ? (size_t)(rng_next(s) % n) : 0;
+}
+
+// Logaritmo in base 2 approssimato (errore sotto 0,1), senza libm.
+static double log2_approx(double x)
+{
+  if (x <= 0)
+    return -64;
+  double e = 0;
+  while (x >= 2)
+  {
+    x /= 2;
+    ++e;
+  }
+  while (x < 1)
+  {
+    x *= 2;
+    --e;
+  }
+  return e + (x - 1);
+}
+
+static bool buf_reserve(ex_buf *b, size_t extra)
+{
+  if (b->failed)
+    return false;
+  if (b->len + extra + 1 <= b->cap)
+    return true;
+  size_t ncap = b->cap ? b->cap : 256;
+  while (ncap < b->len + extra + 1)
+    ncap *= 2;
+  char *nd = (char *)realloc(b->data, ncap);
+  if (!nd)
+  {
+    b->failed = true;
+    return false;
+  }
+  b->data = nd;
+  b->cap = ncap;
+  return true;
+}
+
+static void buf_put(ex_buf *b, const char *s, size_t len)
+{
+  if (!buf_reserve(b, len))
+    return;
+  memcpy(b->data + b->len, s, len);
+  b->len += len;
+  b->data[b->len] = '\0';
+}
+
+static void buf_puts(ex_buf *b, const char *s)
+{
+  buf_put(b, s, strlen(s));
+}
+
+static void buf_putc(ex_buf *b, char c)
+{
+  buf_put(b, &c, 1);
+}
+
+static void buf_printf(ex_buf *b, const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0 || !buf_reserve(b, (size_t)n))
+    return;
+  va_start(ap, fmt);
+  vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  b->len += (size_t)n;
+}
+
+// Stringa JSON (tra virgolette) con i caratteri di controllo codificati.
+static void buf_json_string(ex_buf *b, const char *s, size_t len)
+{
+  buf_putc(b, '"');
+  for (size_t i = 0; i < len; ++i)
+  {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\')
+    {
+      buf_putc(b, '\\');
+      buf_putc(b, (char)c);
+    }
+    else if (c < 0x20)
+    {
+      buf_printf(b, "\\u%04x", c);
+    }
+    else
+    {
+      buf_putc(b, (char)c);
+    }
+  }
+  buf_putc(b, '"');
+}
+
+// Segmento di JSON pointer con ~ e / codificati.
+static void buf_pointer_token(ex_buf *b, const char *s)
+{
+  for (; *s; ++s)
+  {
+    if (*s == '~')
+      buf_puts(b, "~0");
+    else if (*s == '/')
+      buf_puts(b, "~1");
+    else
+      buf_putc(b, *s);
+  }
+}
+
+// Cede il contenuto del buffer (NULL se un'allocazione è fallita).
+static char *buf_take(ex_buf *b)
+{
+  if (b->failed || !buf_reserve(b, 0))
+  {
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+    return NULL;
+  }
+  char *s = b->data;
+  memset(b, 0, sizeof(*b));
+  return s;
+}
+
+static char *str_dup(const char *s)
+{
+  size_t len = strlen(s);
+  char *out = (char *)malloc(len + 1);
+  if (out)
+    memcpy(out, s, len + 1);
+  return out;
+}
+
+// Segue i $ref di `schema`; in `*ref` (se non NULL) l'ultimo seguito.
+static cJSON *resolve(cJSON *schema, const jsval_ctx *ctx, const char **ref)
+{
+  for (unsigned hops = 0; schema && hops <= JSVAL_MAX_REF_HOPS; ++hops)
+  {
+    cJSON *r = cJSON_GetObjectItemCaseSensitive(schema, "$ref");
+    if (!cJSON_IsString(r))
+      return schema;
+    if (ref)
+      *ref = r->valuestring;
+    schema = jsval_resolve_ref(r->valuestring, ctx);
+  }
+  return NULL;
+}
+
+static const char *type_of(const cJSON *schema)
+{
+  cJSON *t = cJSON_GetObjectItemCaseSensitive(schema, "type");
+  return cJSON_IsString(t) ? t->valuestring : NULL;
+}
+
+static bool is_object_schema(const cJSON *schema)
+{
+  const char *t = type_of(schema);
+  return t ? strcmp(t, "object") == 0 : cJSON_IsObject(cJSON_GetObjectItemCaseSensitive(schema, "properties"));
+}
+
+static bool is_array_schema(const cJSON *schema)
+{
+  const char *t = type_of(schema);
+  return t && strcmp(t, "array") == 0 && cJSON_GetObjectItemCaseSensitive(schema, "items");
+}
+
+static long long number_or(const cJSON *schema, const char *key, long long fallback)
+{
+  cJSON *n = cJSON_GetObjectItemCaseSensitive(schema, key);
+  return cJSON_IsNumber(n) ? (long long)n->valuedouble : fallback;
+}
+
+// ---------------------------------------------------------------------------
+// Stringhe generate da un pattern (sottoinsieme ERE/ECMAScript): ogni
+// quantificatore viene ripetuto `reps` volte entro i propri limiti; con
+// `rng` rami delle alternative e caratteri delle classi sono scelti a caso.
+
+typedef struct sampler
+{
+  const char *p;
+  ex_buf *out;
+  size_t reps;
+  uint64_t *rng;
+  unsigned depth;
+} sampler;
+
+static void sample_alt(sampler *s, bool emit);
+
+static char class_escape(char c)
+{
+  switch (c)
+  {
+  case 'd':
+    return '0';
+  case 'w':
+  case 'S':
+  case 'D':
+    return 'a';
+  case 's':
+    return ' ';
+  case 'W':
+    return '!';
+  case 'n':
+    return '\n';
+  case 't':
+    return '\t';
+  default:
+    return c;
+  }
+}
+
+static void sample_class(sampler *s, bool emit)
+{
+  const char *p = s->p + 1;
+  bool negated = *p == '^';
+  if (negated)
+    ++p;
+  unsigned char lo[64], hi[64];
+  size_t n = 0;
+  bool first = true;
+  while (*p && (*p != ']' || first))
+  {
+    first = false;
+    unsigned char a = (unsigned char)*p, b;
+    if (p[0] == '[' && p[1] == ':')
+    {
+      const char *end = strstr(p + 2, ":]");
+      if (end)
+      {
+        a = strncmp(p + 2, "digit", 5) == 0 || strncmp(p + 2, "xdigit", 6) == 0 ? '0'
+            : strncmp(p + 2, "space", 5) == 0                                    ? ' '
+            : strncmp(p + 2, "upper", 5) == 0                                    ? 'A'
+            : strncmp(p + 2, "punct", 5) == 0                                    ? '!'
+                                                                                 : 'a';
+        p = end + 2;
+        if (n < 64)
+        {
+          lo[n] = hi[n] = a;
+          ++n;
+        }
+        continue;
+      }
+    }
+    if (*p == '\\' && p[1])
+    {
+      a = (unsigned char)class_escape(p[1]);
+      p += 2;
+    }
+    else
+    {
+      ++p;
+    }
+    b = a;
+    if (p[0] == '-' && p[1] && p[1] != ']')
+    {
+      b = (unsigned char)p[1];
+      p += 2;
+      if (b < a)
+        b = a;
+    }
+    if (n < 64)
+    {
+      lo[n] = a;
+      hi[n] = b;
+      ++n;
+    }
+  }
+  s->p = *p ? p + 1 : p;
+  if (!emit)
+    return;
+  if (!negated && n > 0)
+  {
+    size_t r = s->rng ? rng_below(s->rng, n) : 0;
+    unsigned span = (unsigned)(hi[r] - lo[r]) + 1;
+    buf_putc(s->out, (char)(lo[r] + (s->rng ? rng_below(s->rng, span) : 0)));
+    return;
+  }
+  static const char candidates[] = "a0A_! -.~";
+  for (const char *c = candidates; *c; ++c)
+  {
+    bool inside = false;
+    for (size_t i = 0; i < n && !inside; ++i)
+      inside = (unsigned char)*c >= lo[i] && (unsigned char)*c <= hi[i];
+    if (!inside)
+    {
+      buf_putc(s->out, *c);
+      return;
+    }
+  }
+}
+
+static void sample_atom(sampler *s, bool emit)
+{
+  char c = *s->p;
+  switch (c)
+  {
+  case '^':
+  case '$':
+    ++s->p;
+    return;
+  case '(':
+    ++s->p;
+    if (s->p[0] == '?' && s->p[1] == ':')
+      s->p += 2;
+    if (s->depth < 64)
+    {
+      ++s->depth;
+      sample_alt(s, emit);
+      --s->depth;
+    }
+    if (*s->p == ')')
+      ++s->p;
+    return;
+  case '[':
+    sample_class(s, emit);
+    return;
+  case '.':
+    ++s->p;
+    if (emit)
+      buf_putc(s->out, s->rng ? (char)('a' + rng_below(s->rng, 26)) : 'a');
+    return;
+  case '\\':
+    if (!s->p[1])
+    {
+      ++s->p;
+      return;
+    }
+    c = s->p[1];
+    s->p += 2;
+    // \b e i riferimenti all'indietro non producono caratteri
+    if (emit && c != 'b' && c != 'B' && !(c >= '1' && c <= '9'))
+      buf_putc(s->out, class_escape(c));
+    return;
+  default:
+    ++s->p;
+    if (emit)
+      buf_putc(s->out, c);
+    return;
+  }
+}
+
+// Legge un quantificatore dopo un atomo: false se non ce n'è uno.
+static bool sample_quantifier(sampler *s, size_t *lo, size_t *hi)
+{
+  const char *p = s->p;
+  if (*p == '*' || *p == '+' || *p == '?')
+  {
+    *lo = *p == '+' ? 1 : 0;
+    *hi = *p == '?' ? 1 : SIZE_MAX;
+    ++p;
+  }
+  else if (*p == '{' && p[1] >= '0' && p[1] <= '9')
+  {
+    char *end = NULL;
+    unsigned long a = strtoul(p + 1, &end, 10), b = a;
+    if (*end == ',')
+    {
+      b = end[1] == '}' ? (unsigned long)-1 : strtoul(end + 1, &end, 10);
+      if (b == (unsigned long)-1)
+        ++end;
+    }
+    if (*end != '}')
+      return false;
+    *lo = a;
+    *hi = b == (unsigned long)-1 ? SIZE_MAX : b;
+    p = end + 1;
+  }
+  else
+  {
+    return false;
+  }
+  if (*p == '?' || *p == '+')
+    ++p;
+  s->p = p;
+  return true;
+}
+
+static void sample_seq(sampler *s, bool emit)
+{
+  while (*s->p && *s->p != '|' && *s->p != ')')
+  {
+    const char *atom = s->p;
+    sample_atom(s, false);
+    size_t lo = 1, hi = 1;
+    sample_quantifier(s, &lo, &hi);
+    if (!emit)
+      continue;
+    size_t k = s->reps < lo ? lo : s->reps > hi ? hi : s->reps;
+    if (s->rng && k > lo)
+      k = lo + rng_below(s->rng, k - lo + 1);
+    const char *after = s->p;
+    for (size_t i = 0; i < k && !s->out->failed; ++i)
+    {
+      s->p = atom;
+      sample_atom(s, true);
+    }
+    s->p = after;
+  }
+}
+
+static void sample_alt(sampler *s, bool emit)
+{
+  const char *start = s->p;
+  size_t branches = 1;
+  for (;;)
+  {
+    sample_seq(s, false);
+    if (*s->p != '|')
+      break;
+    ++s->p;
+    ++branches;
+  }
+  size_t pick = s->rng ? rng_below(s->rng, branches) : 0;
+  s->p = start;
+  for (size_t b = 0;; ++b)
+  {
+    sample_seq(s, emit && b == pick);
+    if (*s->p != '|')
+      break;
+    ++s->p;
+  }
+}
+
+static void sample_pattern(ex_buf *out, const char *pattern, size_t reps, uint64_t *rng)
+{
+  sampler s = {pattern, out, reps, rng, 0};
+  while (*s.p)
+  {
+    sample_alt(&s, true);
+    if (*s.p == ')')
+      ++s.p; // parentesi non bilanciata: ignorata
+  }
+}
+
+// Caratteri stampabili che compaiono nel pattern come letterali o estremi
+// di classi: il materiale delle stringhe quasi conformi.
+static size_t pattern_alphabet(const char *pattern, char *out, size_t cap)
+{
+  bool seen[128] = {false};
+  size_t n = 0;
+  for (const char *p = pattern; *p && n < cap; ++p)
+  {
+    char c = *p;
+    if (c == '\\' && p[1])
+      c = class_escape(*++p);
+    else if (strchr("^$.|?*+()[]{}", c))
+      continue;
+    if ((unsigned char)c < 0x20 || (unsigned char)c >= 0x7f || seen[(unsigned char)c])
+      continue;
+    seen[(unsigned char)c] = true;
+    out[n++] = c;
+  }
+  if (n == 0 && cap > 0)
+    out[n++] = 'a';
+  return n;
+}
+
+// ---------------------------------------------------------------------------
+// Istanze minime: valori che soddisfano i vincoli più comuni dello schema,
+// usati per le proprietà richieste intorno al punto esplorato.
+
+static void gen_min(explorer *ex, ex_buf *b, cJSON *schema, unsigned depth)
+{
+  schema = resolve(schema, ex->ctx, NULL);
+  if (!schema || depth > EXPLORE_MIN_DEPTH)
+  {
+    buf_puts(b, "null");
+    return;
+  }
+  cJSON *en = cJSON_GetObjectItemCaseSensitive(schema, "enum");
+  if (cJSON_IsArray(en) && en->child)
+  {
+    char *s = cJSON_PrintUnformatted(en->child);
+    buf_puts(b, s ? s : "null");
+    cJSON_free(s);
+    return;
+  }
+  const char *t = type_of(schema);
+  if (t && strcmp(t, "string") == 0)
+  {
+    cJSON *pattern = cJSON_GetObjectItemCaseSensitive(schema, "pattern");
+    ex_buf s = {0};
+    long long min_len = number_or(schema, "minLength", 0);
+    if (cJSON_IsString(pattern))
+      sample_pattern(&s, pattern->valuestring, min_len > 0 ? (size_t)min_len : 1, NULL);
+    while (!s.failed && (long long)s.len < min_len && s.len < 4096)
+      buf_putc(&s, 'a');
+    buf_json_string(b, s.data ? s.data : "", s.len);
+    free(s.data);
+  }
+  else if (t && (strcmp(t, "integer") == 0 || strcmp(t, "number") == 0))
+  {
+    buf_printf(b, "%lld", number_or(schema, "minimum", 0));
+  }
+  else if (t && strcmp(t, "boolean") == 0)
+  {
+    buf_puts(b, "true");
+  }
+  else if (is_array_schema(schema))
+  {
+    long long n = number_or(schema, "minItems", 0);
+    buf_putc(b, '[');
+    for (long long i = 0; i < n && i < 64; ++i)
+    {
+      if (i)
+        buf_putc(b, ',');
+      gen_min(ex, b, cJSON_GetObjectItemCaseSensitive(schema, "items"), depth + 1);
+    }
+    buf_putc(b, ']');
+  }
+  else if (is_object_schema(schema))
+  {
+    ex_buf members = {0};
+    cJSON *props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+    cJSON *req = cJSON_GetObjectItemCaseSensitive(schema, "required");
+    cJSON *r = NULL;
+    cJSON_ArrayForEach(r, req)
+    {
+      if (!cJSON_IsString(r))
+        continue;
+      if (members.len)
+        buf_putc(&members, ',');
+      buf_json_string(&members, r->valuestring, strlen(r->valuestring));
+      buf_putc(&members, ':');
+      gen_min(ex, &members, cJSON_GetObjectItemCaseSensitive(props, r->valuestring), depth + 1);
+    }
+    buf_putc(b, '{');
+    if (members.data)
+      buf_put(b, members.data, members.len);
+    buf_putc(b, '}');
+    if (members.failed)
+      b->failed = true;
+    free(members.data);
+  }
+  else
+  {
+    buf_puts(b, "null");
+  }
+}
+
+// Membri richiesti di `schema` tranne `except`, ciascuno seguito da ','.
+static void gen_required(explorer *ex, ex_buf *b, cJSON *schema, const char *except)
+{
+  cJSON *props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+  cJSON *r = NULL;
+  cJSON_ArrayForEach(r, cJSON_GetObjectItemCaseSensitive(schema, "required"))
+  {
+    if (!cJSON_IsString(r) || (except && strcmp(r->valuestring, except) == 0))
+      continue;
+    buf_json_string(b, r->valuestring, strlen(r->valuestring));
+    buf_putc(b, ':');
+    gen_min(ex, b, cJSON_GetObjectItemCaseSensitive(props, r->valuestring), 1);
+    buf_putc(b, ',');
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Visita dello schema e raccolta dei punti da esplorare.
+
+static explore_target *add_target(explorer *ex, explore_kind kind, cJSON *schema, const char *location,
+                                  const char *prefix, const char *suffix)
+{
+  if (ex->target_count == EXPLORE_MAX_TARGETS)
+    return NULL;
+  explore_target *t = &ex->targets[ex->target_count];
+  memset(t, 0, sizeof(*t));
+  t->kind = kind;
+  t->schema = schema;
+  t->location = str_dup(location);
+  t->prefix = str_dup(prefix);
+  t->suffix = str_dup(suffix);
+  if (!t->location || !t->prefix || !t->suffix)
+  {
+    free(t->location);
+    free(t->prefix);
+    free(t->suffix);
+    ex->failed = true;
+    return NULL;
+  }
+  t->best_seconds = -1;
+  ++ex->target_count;
+  return t;
+}
+
+static char *min_instance(explorer *ex, cJSON *schema)
+{
+  ex_buf b = {0};
+  gen_min(ex, &b, schema, 0);
+  char *s = buf_take(&b);
+  if (!s)
+    ex->failed = true;
+  return s;
+}
+
+static void walk(explorer *ex, cJSON *schema, const char *location, const char *prefix, const char *suffix,
+                 walk_frame *parent, unsigned depth);
+
+// Scende nel figlio `child` racchiuso da `open` ... `close`.
+static void walk_child(explorer *ex, cJSON *child, const char *location, const char *prefix, const char *open,
+                       const char *close, const char *suffix, walk_frame *frame, unsigned depth)
+{
+  ex_buf p = {0}, s = {0};
+  buf_puts(&p, prefix);
+  buf_puts(&p, open);
+  buf_puts(&s, close);
+  buf_puts(&s, suffix);
+  if (p.failed || s.failed)
+    ex->failed = true;
+  else
+    walk(ex, child, location, p.data, s.data, frame, depth + 1);
+  free(p.data);
+  free(s.data);
+}
+
+static void walk_object(explorer *ex, cJSON *schema, const char *location, const char *prefix, const char *suffix,
+                        walk_frame *frame, unsigned depth)
+{
+  cJSON *props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+  cJSON *patterns = cJSON_GetObjectItemCaseSensitive(schema, "patternProperties");
+  ex_buf required = {0};
+  gen_required(ex, &required, schema, NULL);
+  ex_buf open = {0};
+  buf_putc(&open, '{');
+  if (required.data)
+    buf_put(&open, required.data, required.len);
+
+  // tutte le chiavi passano per properties/required/patternProperties
+  if (cJSON_IsObject(props) || cJSON_IsObject(patterns) || cJSON_GetObjectItemCaseSensitive(schema, "required"))
+  {
+    explore_target *t = add_target(ex, EXPLORE_WIDE_OBJECT, schema, location, prefix, suffix);
+    if (t)
+    {
+      t->pump_open = open.data ? str_dup(open.data) : NULL;
+      if (!t->pump_open)
+        ex->failed = true;
+    }
+  }
+
+  cJSON *pp = NULL;
+  cJSON_ArrayForEach(pp, patterns)
+  {
+    if (!pp->string)
+      continue;
+    ex_buf loc = {0}, p = {0}, s = {0};
+    buf_printf(&loc, "%s/patternProperties/", location);
+    buf_pointer_token(&loc, pp->string);
+    buf_puts(&p, prefix);
+    if (open.data)
+      buf_puts(&p, open.data);
+    char *value = min_instance(ex, pp);
+    buf_putc(&s, ':');
+    buf_puts(&s, value ? value : "null");
+    buf_putc(&s, '}');
+    buf_puts(&s, suffix);
+    free(value);
+    explore_target *t = loc.failed || p.failed || s.failed
+                            ? NULL
+                            : add_target(ex, EXPLORE_KEY_PATTERN, pp, loc.data, p.data, s.data);
+    if (t && !(t->pattern = str_dup(pp->string)))
+      ex->failed = true;
+
+    // per scendere nel sotto-schema serve una chiave conforme al pattern
+    js_regex re;
+    js_regex_compile(&re, pp->string);
+    ex_buf key = {0};
+    sample_pattern(&key, pp->string, 1, NULL);
+    if (re.valid && key.data && js_regex_match(&re, key.data) && !(cJSON_IsObject(props) &&
+                                                                  cJSON_GetObjectItemCaseSensitive(props, key.data)))
+    {
+      ex_buf o = {0};
+      buf_putc(&o, '{');
+      if (required.data)
+        buf_puts(&o, required.data);
+      buf_json_string(&o, key.data, key.len);
+      buf_putc(&o, ':');
+      if (!o.failed)
+        walk_child(ex, pp, loc.data ? loc.data : location, prefix, o.data, "}", suffix, frame, depth);
+      free(o.data);
+    }
+    js_regex_free(&re);
+    free(key.data);
+    free(loc.data);
+    free(p.data);
+    free(s.data);
+  }
+
+  cJSON *prop = NULL;
+  cJSON_ArrayForEach(prop, props)
+  {
+    if (!prop->string || !cJSON_IsObject(prop))
+      continue;
+    ex_buf loc = {0}, o = {0};
+    buf_printf(&loc, "%s/properties/", location);
+    buf_pointer_token(&loc, prop->string);
+    buf_putc(&o, '{');
+    gen_required(ex, &o, schema, prop->string);
+    buf_json_string(&o, prop->string, strlen(prop->string));
+    buf_putc(&o, ':');
+    if (loc.failed || o.failed)
+      ex->failed = true;
+    else
+      walk_child(ex, prop, loc.data, prefix, o.data, "}", suffix, frame, depth);
+    free(loc.data);
+    free(o.data);
+  }
+  if (required.failed || open.failed)
+    ex->failed = true;
+  free(required.data);
+  free(open.data);
+}
+
+static void walk(explorer *ex, cJSON *schema, const char *location, const char *prefix, const char *suffix,
+                 walk_frame *parent, unsigned depth)
+{
+  if (ex->failed || depth > EXPLORE_MAX_WALK_DEPTH || ex->target_count == EXPLORE_MAX_TARGETS)
+    return;
+  const char *ref = NULL;
+  cJSON *resolved = resolve(schema, ex->ctx, &ref);
+  if (!resolved)
+    return;
+  if (ref)
+    location = ref;
+
+  // Un antenato con lo stesso schema chiude un ciclo: il tratto di payload
+  // tra i due punti si può ripetere a piacere.
+  for (walk_frame *f = parent; f; f = f->parent)
+  {
+    if (f->schema != resolved)
+      continue;
+    if (f->recursion)
+      return;
+    f->recursion = true;
+    explore_target *t = add_target(ex, EXPLORE_RECURSION, resolved, location, f->prefix, f->suffix);
+    if (t)
+    {
+      size_t open_len = strlen(prefix) - strlen(f->prefix);
+      size_t close_len = strlen(suffix) - strlen(f->suffix);
+      t->pump_open = (char *)malloc(open_len + 1);
+      t->pump_close = (char *)malloc(close_len + 1);
+      t->element = min_instance(ex, resolved);
+      if (!t->pump_open || !t->pump_close)
+      {
+        ex->failed = true;
+        return;
+      }
+      memcpy(t->pump_open, prefix + strlen(f->prefix), open_len);
+      t->pump_open[open_len] = '\0';
+      memcpy(t->pump_close, suffix, close_len);
+      t->pump_close[close_len] = '\0';
+    }
+    return;
+  }
+  if (ptrmap_get(&ex->visited, resolved))
+    return;
+  walk_frame frame = {resolved, prefix, suffix, parent, false};
+  if (!ptrmap_put(&ex->visited, resolved, (void *)1))
+  {
+    ex->failed = true;
+    return;
+  }
+
+  cJSON *pattern = cJSON_GetObjectItemCaseSensitive(resolved, "pattern");
+  const char *t = type_of(resolved);
+  if (cJSON_IsString(pattern) && (!t || strcmp(t, "string") == 0))
+  {
+    ex_buf loc = {0};
+    buf_printf(&loc, "%s/pattern", location);
+    explore_target *tg = loc.failed ? NULL : add_target(ex, EXPLORE_PATTERN, resolved, loc.data, prefix, suffix);
+    if (tg)
+    {
+      tg->pattern = str_dup(pattern->valuestring);
+      long long max_len = number_or(resolved, "maxLength", -1);
+      tg->max_length = max_len >= 0 ? (size_t)max_len : 0;
+      if (!tg->pattern)
+        ex->failed = true;
+    }
+    free(loc.data);
+  }
+
+  if (is_array_schema(resolved))
+  {
+    cJSON *items = cJSON_GetObjectItemCaseSensitive(resolved, "items");
+    explore_target *tg = add_target(ex, EXPLORE_LONG_ARRAY, resolved, location, prefix, suffix);
+    if (tg)
+      tg->element = min_instance(ex, items);
+    ex_buf loc = {0};
+    buf_printf(&loc, "%s/items", location);
+    if (!loc.failed)
+      walk_child(ex, items, loc.data, prefix, "[", "]", suffix, &frame, depth);
+    free(loc.data);
+  }
+  else if (is_object_schema(resolved))
+  {
+    walk_object(ex, resolved, location, prefix, suffix, &frame, depth);
+  }
+}
+
+// JSON pointer del nodo `target` nel DOM, per indicare lo schema radice.
+static bool find_pointer(const cJSON *node, const cJSON *target, ex_buf *out)
+{
+  if (node == target)
+    return true;
+  size_t mark = out->len;
+  int index = 0;
+  for (const cJSON *c = node->child; c; c = c->next, ++index)
+  {
+    buf_putc(out, '/');
+    if (c->string)
+      buf_pointer_token(out, c->string);
+    else
+      buf_printf(out, "%d", index);
+    if (find_pointer(c, target, out))
+      return true;
+    out->len = mark;
+    if (out->data)
+      out->data[mark] = '\0';
+  }
+  return false;
+}
+
+// ---------------------------------------------------------------------------
+// Misura e ricerca.
+
+// Parsing e validazione di `text` come una richiesta reale; il minimo di
+// alcune ripetizioni riduce il rumore. false se la memoria non basta.
+static bool measure(explorer *ex, const char *text, size_t len, double *seconds, size_t *memory, bool *valid)
+{
+  double best = -1, spent = 0;
+  for (int rep = 0; rep < EXPLORE_REPEATS; ++rep)
+  {
+    mem_account_reset(ex->memory);
+    mem_account *prev = mem_account_enter(ex->memory);
+    char *copy = (char *)mem_malloc(len + 1);
+    if (!copy)
+    {
+      mem_account_enter(prev);
+      return false;
+    }
+    memcpy(copy, text, len + 1);
+    jsval_ctx ctx = *ex->ctx;
+    ctx.memory = ex->memory;
+    ctx.budget = NULL; // la durata della validazione è ciò che viene misurato
+    if (ex->opts->memo)
+      ctx.memo = jsval_memo_create();
+    payload_tape tape;
+    char *err = NULL;
+    jsval_result r = {false, NULL, {0, 0, 0, 0}};
+    double t0 = now_seconds();
+    payload_status st = payload_parse(copy, len, ex->root_schema, &ctx, &ex->opts->limits, &tape, &err);
+    if (st == PAYLOAD_OK)
+      r = js_validate_tape(&tape, ex->root_schema, &ctx);
+    double dt = now_seconds() - t0;
+    *memory = mem_account_stats(ex->memory).peak;
+    if (st == PAYLOAD_OK)
+      payload_tape_free(&tape);
+    else
+      mem_free(copy);
+    *valid = r.ok;
+    jsval_result_free(&r);
+    jsval_memo_free(ctx.memo);
+    mem_free(err);
+    mem_account_enter(prev);
+    ++ex->probes;
+    if (st == PAYLOAD_NO_MEMORY)
+      return false;
+    if (best < 0 || dt < best)
+      best = dt;
+    spent += dt;
+    if (dt >= ex->opts->limit_seconds || spent >= EXPLORE_REPEAT_SECONDS)
+      break;
+  }
+  *seconds = best;
+  return true;
+}
+
+// Misura il payload e lo conserva se è il peggiore del punto. `string` è
+// la stringa esplorata (pattern), `detail` la descrizione del payload.
+static bool consider(explorer *ex, explore_target *t, const ex_buf *payload, const char *string, size_t string_len,
+                     const char *detail, double *seconds)
+{
+  size_t memory = 0;
+  bool valid = false;
+  if (!measure(ex, payload->data, payload->len, seconds, &memory, &valid))
+  {
+    ex->failed = true;
+    return false;
+  }
+  if (*seconds <= t->best_seconds)
+    return true;
+  char *p = (char *)malloc(payload->len + 1);
+  char *s = string ? (char *)malloc(string_len + 1) : NULL;
+  char *d = str_dup(detail);
+  if (!p || (string && !s) || !d)
+  {
+    free(p);
+    free(s);
+    free(d);
+    ex->failed = true;
+    return false;
+  }
+  memcpy(p, payload->data, payload->len + 1);
+  if (s)
+  {
+    memcpy(s, string, string_len);
+    s[string_len] = '\0';
+  }
+  free(t->best);
+  free(t->best_string);
+  free(t->detail);
+  t->best = p;
+  t->best_len = payload->len;
+  t->best_string = s;
+  t->best_string_len = string_len;
+  t->detail = d;
+  t->best_seconds = *seconds;
+  t->best_memory = memory;
+  t->best_valid = valid;
+  return true;
+}
+
+static bool out_of_time(const explorer *ex, double stop)
+{
+  double now = now_seconds();
+  return ex->failed || now >= stop || now >= ex->deadline;
+}
+
+// Contenitori aperti e non chiusi in un frammento di JSON.
+static long nesting(const char *s)
+{
+  long depth = 0;
+  bool in_string = false;
+  for (; *s; ++s)
+  {
+    if (in_string)
+    {
+      if (*s == '\\' && s[1])
+        ++s;
+      else if (*s == '"')
+        in_string = false;
+    }
+    else if (*s == '"')
+      in_string = true;
+    else if (*s == '{' || *s == '[')
+      ++depth;
+    else if (*s == '}' || *s == ']')
+      --depth;
+  }
+  return depth;
+}
+
+// Famiglia di valori di dimensione `n` per un punto.
+typedef struct family
+{
+  int kind; // per i pattern: 0 esempio conforme, 1 esempio casuale, 2 ripetizione di `c`
+  char c;
+  const char *tail; // carattere finale che rompe la corrispondenza
+  uint64_t seed;
+} family;
+
+// Costruisce il payload di dimensione `n`; in `*fill` la frazione dei
+// limiti (byte del payload, maxLength) occupata. `string` riceve la
+// stringa esplorata per i pattern.
+static void build(explorer *ex, explore_target *t, const family *fam, size_t n, ex_buf *out, ex_buf *string,
+                  double *fill)
+{
+  out->len = 0;
+  string->len = 0;
+  buf_puts(out, t->prefix);
+  switch (t->kind)
+  {
+  case EXPLORE_PATTERN:
+  case EXPLORE_KEY_PATTERN:
+  {
+    uint64_t seed = fam->seed;
+    if (fam->kind == 2)
+    {
+      for (size_t i = 0; i < n && !string->failed; ++i)
+        buf_putc(string, fam->c);
+    }
+    else
+    {
+      sample_pattern(string, t->pattern, n, fam->kind == 1 ? &seed : NULL);
+    }
+    buf_puts(string, fam->tail);
+    buf_json_string(out, string->data ? string->data : "", string->len);
+    break;
+  }
+  case EXPLORE_WIDE_OBJECT:
+    buf_puts(out, t->pump_open);
+    for (size_t i = 0; i < n; ++i)
+      buf_printf(out, "%s\"k%zu\":0", i ? "," : "", i);
+    buf_putc(out, '}');
+    break;
+  case EXPLORE_LONG_ARRAY:
+    buf_putc(out, '[');
+    for (size_t i = 0; i < n && !out->failed; ++i)
+    {
+      if (i)
+        buf_putc(out, ',');
+      buf_puts(out, t->element);
+    }
+    buf_putc(out, ']');
+    break;
+  case EXPLORE_RECURSION:
+    for (size_t i = 0; i < n && !out->failed; ++i)
+      buf_puts(out, t->pump_open);
+    buf_puts(out, t->element);
+    for (size_t i = 0; i < n && !out->failed; ++i)
+      buf_puts(out, t->pump_close);
+    break;
+  }
+  buf_puts(out, t->suffix);
+  *fill = (double)out->len / (double)ex->max_bytes;
+  if (t->kind == EXPLORE_PATTERN && t->max_length)
+  {
+    double f = (double)string->len / (double)t->max_length;
+    if (f > *fill)
+      *fill = f;
+  }
+  // oltre il limite di annidamento il payload viene rifiutato subito
+  if (t->kind == EXPLORE_RECURSION && ex->opts->limits.max_depth)
+  {
+    double depth = (double)(nesting(t->prefix) + (long)n * nesting(t->pump_open)) + 1;
+    double f = depth / (double)ex->opts->limits.max_depth;
+    if (f > *fill)
+      *fill = f;
+  }
+}
+
+static void describe(const explore_target *t, size_t n, const ex_buf *string, char *out, size_t cap)
+{
+  switch (t->kind)
+  {
+  case EXPLORE_PATTERN:
+  case EXPLORE_KEY_PATTERN:
+    snprintf(out, cap, "%s di %zu caratteri contro '%s'", t->kind == EXPLORE_PATTERN ? "stringa" : "chiave",
+             string->len, t->pattern);
+    break;
+  case EXPLORE_WIDE_OBJECT:
+    snprintf(out, cap, "%zu chiavi", n);
+    break;
+  case EXPLORE_LONG_ARRAY:
+    snprintf(out, cap, "%zu elementi", n);
+    break;
+  case EXPLORE_RECURSION:
+    snprintf(out, cap, "%zu livelli di ricorsione", n);
+    break;
+  }
+}
+
+// Fa crescere `n` finché il payload resta nei limiti e la validazione sotto
+// il limite di durata. Il passo raddoppia finché la crescita osservata dei
+// tempi, supposta esponenziale, non prevede di superare il doppio del limite:
+// così i pattern catastrofici non bloccano la ricerca per minuti.
+static void grow(explorer *ex, explore_target *t, const family *fam, double stop)
+{
+  ex_buf out = {0}, string = {0};
+  size_t n = 1, prev_n = 0, prev_len = 0;
+  double prev_t = 0, prev_fill = 0;
+  bool fitted = false;
+  char detail[256];
+  while (!out_of_time(ex, stop))
+  {
+    double fill = 0, secs = 0;
+    build(ex, t, fam, n, &out, &string, &fill);
+    if (out.failed || string.failed)
+    {
+      ex->failed = true;
+      break;
+    }
+    if (fill > 1)
+    {
+      // ultimo tentativo con la dimensione stimata per riempire i limiti
+      if (fitted || prev_n == 0 || fill <= prev_fill)
+        break;
+      fitted = true;
+      size_t fit = prev_n + (size_t)((double)(n - prev_n) * (1 - prev_fill) / (fill - prev_fill));
+      if (fit <= prev_n)
+        break;
+      n = fit;
+      continue;
+    }
+    describe(t, n, &string, detail, sizeof(detail));
+    if (!consider(ex, t, &out, string.data, string.len, detail, &secs) || secs >= ex->opts->limit_seconds)
+      break;
+    // il modello usa i byte del payload: nei campioni casuali la lunghezza
+    // non cresce in proporzione a `n`
+    size_t step = n;
+    if (prev_n && secs > prev_t * 1.2 && secs > 1e-5 && out.len > prev_len)
+    {
+      double per_byte = log2_approx(secs / prev_t) / (double)(out.len - prev_len);
+      double allowed = log2_approx(2 * ex->opts->limit_seconds / secs) / per_byte * (double)n / (double)out.len;
+      if (allowed < (double)step)
+        step = allowed < 1 ? 1 : (size_t)allowed;
+    }
+    // vicino al limite la crescita resta graduale anche se il modello sbaglia
+    if (secs * 64 > ex->opts->limit_seconds && step > n / 4)
+      step = n / 4 ? n / 4 : 1;
+    prev_n = n;
+    prev_len = out.len;
+    prev_t = secs;
+    prev_fill = fill;
+    if (fitted)
+      break;
+    n += step;
+  }
+  free(out.data);
+  free(string.data);
+}
+
+// Mutazioni casuali della stringa peggiore di un pattern: si conserva ogni
+// variante più lenta della migliore (oltre il rumore di misura).
+static void mutate(explorer *ex, explore_target *t, const char *alphabet, size_t alpha_len, double stop)
+{
+  ex_buf out = {0}, cur = {0};
+  char detail[256];
+  size_t max_len = t->max_length ? t->max_length : ex->max_bytes;
+  while (!out_of_time(ex, stop) && t->best_string && t->best_seconds < ex->opts->limit_seconds)
+  {
+    cur.len = 0;
+    buf_put(&cur, t->best_string, t->best_string_len);
+    if (cur.failed)
+      break;
+    size_t len = cur.len, pos = rng_below(&ex->rng, len + 1);
+    char c = alphabet[rng_below(&ex->rng, alpha_len)];
+    switch (rng_below(&ex->rng, 5))
+    {
+    case 0: // sostituzione
+      if (pos < len)
+        cur.data[pos] = c;
+      break;
+    case 1: // inserimento
+      if (len < max_len && buf_reserve(&cur, 1))
+      {
+        memmove(cur.data + pos + 1, cur.data + pos, len - pos + 1);
+        cur.data[pos] = c;
+        ++cur.len;
+      }
+      break;
+    case 2: // cancellazione
+      if (pos < len)
+      {
+        memmove(cur.data + pos, cur.data + pos + 1, len - pos);
+        --cur.len;
+      }
+      break;
+    case 3: // duplicazione di un tratto
+    {
+      size_t from = rng_below(&ex->rng, len + 1), span = rng_below(&ex->rng, len - from + 1);
+      if (span > len / 8 + 1)
+        span = len / 8 + 1;
+      if (span && len + span <= max_len && buf_reserve(&cur, span))
+      {
+        memmove(cur.data + pos + span, cur.data + pos, len - pos + 1);
+        memcpy(cur.data + pos, t->best_string + from, span);
+        cur.len += span;
+      }
+      break;
+    }
+    default: // carattere finale diverso
+      if (len)
+        cur.data[len - 1] = rng_below(&ex->rng, 2) ? c : '!';
+      break;
+    }
+    if (cur.failed)
+      break;
+    out.len = 0;
+    buf_puts(&out, t->prefix);
+    buf_json_string(&out, cur.data, cur.len);
+    buf_puts(&out, t->suffix);
+    if (out.failed || out.len > ex->max_bytes)
+      continue;
+    double best = t->best_seconds, secs = 0;
+    snprintf(detail, sizeof(detail), "%s di %zu caratteri contro '%s' (mutata)",
+             t->kind == EXPLORE_PATTERN ? "stringa" : "chiave", cur.len, t->pattern);
+    // sotto il 10% di differenza la variante non sostituisce la migliore
+    double saved = t->best_seconds;
+    t->best_seconds = best * 1.1;
+    if (!consider(ex, t, &out, cur.data, cur.len, detail, &secs))
+      break;
+    if (t->best_seconds == best * 1.1)
+      t->best_seconds = saved;
+  }
+  free(out.data);
+  free(cur.data);
+}
+
+static void explore_target_run(explorer *ex, explore_target *t, double budget)
+{
+  double start = now_seconds();
+  double stop = start + budget;
+  if (t->kind != EXPLORE_PATTERN && t->kind != EXPLORE_KEY_PATTERN)
+  {
+    family fam = {0, 0, "", 0};
+    grow(ex, t, &fam, stop);
+    return;
+  }
+  char alphabet[EXPLORE_MAX_ALPHABET];
+  size_t alpha_len = pattern_alphabet(t->pattern, alphabet, sizeof(alphabet));
+  family fams[2 * (2 + EXPLORE_MAX_ALPHABET)];
+  size_t nf = 0;
+  static const char *const tails[] = {"!", ""};
+  for (size_t k = 0; k < 2; ++k)
+  {
+    fams[nf++] = (family){0, 0, tails[k], 0};
+    fams[nf++] = (family){1, 0, tails[k], rng_next(&ex->rng)};
+    for (size_t i = 0; i < alpha_len; ++i)
+      fams[nf++] = (family){2, alphabet[i], tails[k], 0};
+  }
+  // ogni famiglia riceve una parte del tempo rimasto, lasciandone una alle
+  // mutazioni: le famiglie che raggiungono presto i limiti cedono il resto
+  for (size_t i = 0; i < nf && !out_of_time(ex, stop); ++i)
+    grow(ex, t, &fams[i], now_seconds() + (stop - now_seconds()) / (double)(nf - i + 1));
+  mutate(ex, t, alphabet, alpha_len, stop);
+}
+
+static void target_free(explore_target *t)
+{
+  free(t->location);
+  free(t->prefix);
+  free(t->suffix);
+  free(t->pattern);
+  free(t->pump_open);
+  free(t->pump_close);
+  free(t->element);
+  free(t->best);
+  free(t->best_string);
+  free(t->detail);
+}
+
+static int case_cmp(const void *a, const void *b)
+{
+  double x = ((const explore_case *)a)->seconds, y = ((const explore_case *)b)->seconds;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+bool explore_latency(cJSON *schema, const jsval_ctx *ctx, const explore_options *opts, explore_report *out)
+{
+  memset(out, 0, sizeof(*out));
+  explorer ex;
+  memset(&ex, 0, sizeof(ex));
+  ex.root_schema = schema;
+  ex.ctx = ctx;
+  ex.opts = opts;
+  ex.max_bytes = opts->limits.max_bytes ? opts->limits.max_bytes : EXPLORE_DEFAULT_MAX_BYTES;
+  ex.rng = opts->seed ? opts->seed : 0x9e3779b97f4a7c15u;
+  double start = now_seconds();
+  ex.deadline = start + opts->seconds;
+  ex.targets = (explore_target *)calloc(EXPLORE_MAX_TARGETS, sizeof(explore_target));
+  ex.memory = mem_account_create(mem_account_limit(ctx->memory));
+  if (!ex.targets || !ex.memory || !ptrmap_init(&ex.visited, 64))
+  {
+    free(ex.targets);
+    mem_account_free(ex.memory);
+    return false;
+  }
+
+  ex_buf loc = {0};
+  buf_putc(&loc, '#');
+  if (!ctx->oas_root || !find_pointer(ctx->oas_root, schema, &loc))
+  {
+    loc.len = 0;
+    buf_puts(&loc, "requestBody");
+  }
+  if (loc.failed)
+    ex.failed = true;
+  else
+    walk(&ex, schema, loc.data, "", "", NULL, 0);
+  free(loc.data);
+
+  // il tempo rimasto viene diviso tra i punti non ancora esplorati
+  for (size_t i = 0; i < ex.target_count && !ex.failed; ++i)
+  {
+    double left = ex.deadline - now_seconds();
+    if (left <= 0)
+      break;
+    explore_target_run(&ex, &ex.targets[i], left / (double)(ex.target_count - i));
+  }
+
+  if (!ex.failed && ex.target_count)
+  {
+    out->cases = (explore_case *)calloc(ex.target_count, sizeof(explore_case));
+    if (!out->cases)
+      ex.failed = true;
+  }
+  for (size_t i = 0; i < ex.target_count; ++i)
+  {
+    explore_target *t = &ex.targets[i];
+    if (!ex.failed && t->best)
+    {
+      explore_case *c = &out->cases[out->count++];
+      c->kind = t->kind;
+      c->location = t->location;
+      c->detail = t->detail;
+      c->payload = t->best;
+      c->payload_len = t->best_len;
+      c->seconds = t->best_seconds;
+      c->memory = t->best_memory;
+      c->valid = t->best_valid;
+      t->location = t->detail = t->best = NULL;
+    }
+    target_free(t);
+  }
+  free(ex.targets);
+  mem_account_free(ex.memory);
+  ptrmap_free(&ex.visited);
+  out->probes = ex.probes;
+  out->elapsed = now_seconds() - start;
+  if (ex.failed)
+  {
+    explore_report_free(out);
+    return false;
+  }
+  qsort(out->cases, out->count, sizeof(explore_case), case_cmp);
+  return true;
+}
+
+void explore_report_free(explore_report *r)
+{
+  if (!r)
+    return;
+  for (size_t i = 0; i < r->count; ++i)
+  {
+    free(r->cases[i].location);
+    free(r->cases[i].detail);
+    free(r->cases[i].payload);
+  }
+  free(r->cases);
+  memset(r, 0, sizeof(*r));
+}
@@ -1,20 +1,122 @@
-// Uso: openapi_validator <request.json> <openapi.json> <http-method> <endpoint> [strict-rule|lexical-rule]
+// Uso: openapi_validator [opzioni] <request.json|-> <openapi.json> <http-method> <endpoint> [strict-rule|lexical-rule]
+//      openapi_validator [opzioni] --serve <openapi.json> [--watch]
+//      openapi_validator [opzioni] --registry <elenco> [--spec-budget MB]
+//      openapi_validator [opzioni] --registry <elenco> --ring /nome [--ring-slots N] [--ring-slot-size N]
+//      openapi_validator --ring-send /nome <request.(json|yaml)|-> <id> <http-method> <endpoint> [strict-rule|lexical-rule]
+//      openapi_validator --ring-send /nome --dir <directory|glob> <id> <http-method> <endpoint> [strict-rule|lexical-rule]
+//      openapi_validator [opzioni] --dir <directory|glob> <openapi.json> <http-method> <endpoint> [strict-rule|lexical-rule]
+//      openapi_validator [opzioni] --proxy <openapi.json> --listen [host:]porta --upstream host:porta [--watch] [strict-rule|lexical-rule]
+//      openapi_validator --emit-c <file.c> [--emit-name nome] <openapi.json> <http-method> <endpoint>
+//      openapi_validator [opzioni] --explore <openapi.json> <http-method> <endpoint> [strict-rule|lexical-rule]
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include "file_batch.h"
 #include "fileutil.h"
+#include "inflate_stream.h"
 #include "jsonschema.h"
+#include "latency_explore.h"
+#include "mem_account.h"
 #include "oas_extract.h"
+#include "oas_lazy.h"
+#include "oas_spec.h"
+#include "payload_parse.h"
+#include "profile.h"
+#include "proxy.h"
+#include "req_budget.h"
+#include "result_cache.h"
+#include "schema_codegen.h"
+#include "ring_client.h"
+#include "ring_server.h"
+#include "shm_ring.h"
+#include "spec_registry.h"
+#include "spec_reload.h"
+#include "work_pool.h"
 #include "cJSON.h"
 #include "miniyaml.h"
 
 // Stampa su stderr la sintassi corretta del programma.
 static void print_usage(const char *prog) {
-    fprintf(stderr, "Uso: %s <request.(json|yaml)> <openapi.(json|yaml)> <http-method> <endpoint> [strict-rule|lexical-rule]\n", prog);
+    fprintf(stderr, "Uso: %s [opzioni] <request.(json|yaml)|-> <openapi.(json|yaml)> <http-method> <endpoint> [strict-rule|lexical-rule]\n", prog);
+    fprintf(stderr, "     %s [opzioni] --serve <openapi.(json|yaml)> [--watch]\n", prog);
+    fprintf(stderr, "     %s [opzioni] --registry <elenco> [--spec-budget MB]\n", prog);
+    fprintf(stderr, "     %s [opzioni] --registry <elenco> --ring /nome [--ring-slots N] [--ring-slot-size N]\n", prog);
+    fprintf(stderr, "     %s --ring-send /nome <request.(json|yaml)|-> <id> <http-method> <endpoint> [strict-rule|lexical-rule]\n", prog);
+    fprintf(stderr, "     %s --ring-send /nome --dir <directory|glob> <id> <http-method> <endpoint> [strict-rule|lexical-rule]\n", prog);
+    fprintf(stderr, "     %s [opzioni] --dir <directory|glob> <openapi.(json|yaml)> <http-method> <endpoint> [strict-rule|lexical-rule]\n", prog);
+    fprintf(stderr, "     %s [opzioni] --proxy <openapi.(json|yaml)> --listen [host:]porta --upstream host:porta [--watch] [strict-rule|lexical-rule]\n", prog);
+    fprintf(stderr, "     %s --emit-c <file.c> [--emit-name nome] <openapi.(json|yaml)> <http-method> <endpoint>\n", prog);
+    fprintf(stderr, "     %s [opzioni] --explore <openapi.(json|yaml)> <http-method> <endpoint> [strict-rule|lexical-rule]\n", prog);
+    fprintf(stderr, "Opzioni:\n");
+    fprintf(stderr, "  --memo              memoizza i risultati dei $ref ripetuti sulla stessa richiesta\n");
+    fprintf(stderr, "  --adaptive-order    valida per prime le proprietà che respingono più body\n");
+    fprintf(stderr, "  --max-bytes N       rifiuta body più grandi di N byte\n");
+    fprintf(stderr, "  --max-depth N       rifiuta body annidati oltre N livelli (predefinito %d)\n", CJSON_NESTING_LIMIT);
+    fprintf(stderr, "  --max-elements N    rifiuta body con più di N valori\n");
+    fprintf(stderr, "  --encoding gzip|deflate  body compressi, decompressi durante la lettura\n");
+    fprintf(stderr, "  --max-inflated N    con --encoding, rifiuta body oltre N byte decompressi (predefinito %zu)\n",
+            INFLATE_DEFAULT_MAX_OUTPUT);
+    fprintf(stderr, "  --result-cache N    memorizza gli esiti di N body (stessa versione, operazione e byte)\n");
+    fprintf(stderr, "  --parallel N        valida gli elementi degli array grandi con N thread aggiuntivi\n");
+    fprintf(stderr, "  --parallel-items N  con --parallel, elementi minimi di un array diviso tra i thread (predefinito %d)\n",
+            JSVAL_DEFAULT_PARALLEL_ITEMS);
+    fprintf(stderr, "  --prune-spec        conserva della specifica solo gli schemi raggiungibili dalle operazioni\n");
+    fprintf(stderr, "  --lazy-spec         indicizza la specifica JSON e ne legge solo l'operazione richiesta\n");
+    fprintf(stderr, "  --max-request-memory N  respinge le richieste che tengono in memoria più di N byte\n");
+    fprintf(stderr, "  --memory-stats      stampa su stderr la memoria di ogni richiesta per fase\n");
+    fprintf(stderr, "  --max-request-ms N  interrompe la validazione di una richiesta dopo N millisecondi\n");
+    fprintf(stderr, "  --max-request-steps N  interrompe la validazione di una richiesta dopo N passi\n");
+    fprintf(stderr, "  --spec-budget MB    con --registry, memoria massima delle specifiche compilate\n");
+    fprintf(stderr, "  --ring-slots N      con --ring, slot dell'anello in memoria condivisa (predefinito %d)\n",
+            SHM_RING_DEFAULT_SLOTS);
+    fprintf(stderr, "  --ring-slot-size N  con --ring, byte di body per slot (predefinito %zu)\n",
+            SHM_RING_DEFAULT_SLOT_SIZE);
+    fprintf(stderr, "  --io-depth N        con --dir, file letti in anticipo (predefinito 64)\n");
+    fprintf(stderr, "  --io uring|pread    con --dir, forza io_uring oppure il pool di thread con pread\n");
+    fprintf(stderr, "  --explore-seconds N con --explore, durata della ricerca in secondi (predefinito %d)\n",
+            (int)EXPLORE_DEFAULT_SECONDS);
+    fprintf(stderr, "  --explore-limit MS  con --explore, validazione oltre MS millisecondi considerata pericolosa (predefinito %d)\n",
+            (int)(EXPLORE_DEFAULT_LIMIT_SECONDS * 1000));
+    fprintf(stderr, "  --explore-out DIR   con --explore, scrive in DIR i payload trovati (caso-N.json)\n");
+    fprintf(stderr, "  --profile           stampa su stderr i tempi di ogni fase della validazione\n");
+    fprintf(stderr, "  --profile-schemas   come --profile, con un intervallo per ogni sotto-schema ($ref)\n");
+    fprintf(stderr, "  --profile-trace F   come --profile, e scrive in F la trace in formato Chrome trace_event\n");
 }
 
+// Opzioni comuni alle modalità a riga di comando e servizio.
+typedef struct {
+    int memo;
+    payload_limits limits;
+    unsigned io_depth;
+    file_batch_backend io_backend;
+    size_t spec_budget;
+    result_cache *cache; // cache degli esiti, NULL se disattivata
+    profile *profile;    // tempi delle fasi (--profile), NULL se disattivato
+    const char *profile_trace;
+    const char *emit_c;    // --emit-c: file C da generare
+    const char *emit_name; // nome della funzione generata
+    work_pool *pool;       // thread per gli array grandi (--parallel), NULL se disattivati
+    size_t parallel_items;
+    content_encoding encoding; // codifica dei body (--encoding)
+    size_t max_inflated;       // limite dei byte decompressi, 0 = nessuno
+    int prune_spec;            // pota la specifica al caricamento (--prune-spec)
+    int lazy_spec;             // indicizza la specifica e ne materializza solo le parti usate (--lazy-spec)
+    unsigned explore_seconds;  // --explore: durata della ricerca, 0 = predefinita
+    unsigned explore_limit_ms; // --explore: soglia dei casi pericolosi, 0 = predefinita
+    const char *explore_out;   // --explore: directory dei payload trovati, NULL = nessuna
+    mem_account *memory;       // memoria per richiesta (--memory-stats, --max-request-memory), NULL se disattivata
+    int memory_stats;
+    int adaptive_order;        // ordine delle proprietà dai rifiuti osservati (--adaptive-order)
+    req_budget *budget;        // tempo e passi per richiesta (--max-request-ms/-steps), NULL se nessuno
+    const char *ring;          // --ring: segmento in memoria condivisa da cui ricevere le richieste
+    size_t ring_slots;         // --ring-slots, 0 = predefinito
+    size_t ring_slot_size;     // --ring-slot-size, 0 = predefinito
+    const char *ring_send;     // --ring-send: segmento a cui inviare i body come produttore
+} cli_options;
+
 // Restituisce un puntatore al primo carattere non spazio/tab/newline della stringa.
 static const char* ltrim(const char *s) {
     while (*s==' '||*s=='\t'||*s=='\r'||*s=='\n') ++s;
@@ -32,118 +134,1539 @@ static char* lowercase_dup(const char *s) {
     return dup;
 }
 
-// Punto di ingresso del validatore: carica i file, gestisce JSON/YAML e
-// avvia la validazione restituendo 0 se il payload è conforme allo schema.
-int main(int argc, char **argv) {
-    if (argc < 5 || argc > 6) { print_usage(argv[0]); return 2; }
-
-    jsval_mode mode = JSVAL_MODE_STRICT;
-    if (argc == 6) {
-        if (strcmp(argv[5], "strict-rule") == 0) {
-            mode = JSVAL_MODE_STRICT;
-        } else if (strcmp(argv[5], "lexical-rule") == 0) {
-            mode = JSVAL_MODE_LEXICAL;
-        } else {
-            fprintf(stderr, "Errore: modalità sconosciuta '%s'.\n", argv[5]);
-            print_usage(argv[0]);
-            return 2;
-        }
+// Interpreta il nome della modalità di validazione; false se sconosciuta.
+static int parse_mode(const char *arg, jsval_mode *out) {
+    if (strcmp(arg, "strict-rule") == 0) {
+        *out = JSVAL_MODE_STRICT;
+        return 1;
     }
+    if (strcmp(arg, "lexical-rule") == 0) {
+        *out = JSVAL_MODE_LEXICAL;
+        return 1;
+    }
+    return 0;
+}
 
-    size_t json_len=0, oas_len=0;
-    char *json_body = read_entire_file(argv[1], &json_len);
-    if (!json_body) return 1;
-    char *oas_spec  = read_entire_file(argv[2], &oas_len);
-    if (!oas_spec) { free(json_body); return 1; }
+// Copia allocata di un messaggio di errore.
+static char* message_dup(const char *prefix, const char *detail) {
+    size_t n = strlen(prefix) + (detail ? strlen(detail) + 2 : 0) + 1;
+    char *s = (char*)malloc(n);
+    if (!s) return NULL;
+    snprintf(s, n, detail ? "%s: %s" : "%s", prefix, detail);
+    return s;
+}
 
-    const char *http_method_arg = argv[3];
-    const char *endpoint_arg = argv[4];
+// Codice di uscita e motivo (in `reason`, da liberare con free) per un body
+// JSON respinto dal parser; prende possesso di `parse_error`.
+static int parse_failure(payload_status st, char *parse_error, char **reason) {
+    if (st == PAYLOAD_LIMIT_EXCEEDED) {
+        *reason = parse_error ? parse_error : message_dup("(sconosciuto)", NULL);
+        return 1;
+    }
+    free(parse_error);
+    if (st == PAYLOAD_NO_MEMORY) {
+        *reason = message_dup("memoria insufficiente per il body.", NULL);
+        return 8;
+    }
+    if (st == PAYLOAD_BUDGET_EXCEEDED) {
+        *reason = message_dup("validazione interrotta, budget della richiesta esaurito.", NULL);
+        return 9;
+    }
+    *reason = message_dup("JSON body non valido.", NULL);
+    return 4;
+}
 
-    const char *body_trim = ltrim(json_body);
-    cJSON *inst = NULL;
+// Interpreta il body (JSON o YAML) letto in `text`, di cui prende possesso.
+// Il JSON viene interpretato seguendo `schema`, così i limiti dello schema e
+// quelli globali interrompono il parsing dei payload che non potranno mai
+// essere validi. Il body YAML viene convertito nello stesso tape. In caso di
+// errore scrive in `code` il codice di uscita, in `reason` il motivo (da
+// liberare con free) e restituisce 0.
+static int parse_body(char *text, size_t len, cJSON *schema, const jsval_ctx *ctx,
+                      const payload_limits *limits, payload_tape *out, int *code, char **reason) {
+    *reason = NULL;
+    const char *body_trim = ltrim(text);
     if (body_trim[0] == '{' || body_trim[0] == '[') {
-        inst = cJSON_ParseWithLength(json_body, (int)json_len);
-        if (!inst) {
-            fprintf(stderr, "Errore: JSON body non valido.\n");
-            free(json_body); free(oas_spec);
-            return 4;
+        char *parse_error = NULL;
+        profile_begin(ctx->profile, "parsing body (JSON guidato dallo schema)", NULL);
+        payload_status st = payload_parse(text, len, schema, ctx, limits, out, &parse_error);
+        profile_end(ctx->profile);
+        if (st == PAYLOAD_OK) {
+            // le stringhe del tape sono sezioni di text
+            return 1;
         }
+        *code = parse_failure(st, parse_error, reason);
     } else {
         char *yaml_error = NULL;
-        inst = miniyaml_parse(json_body, &yaml_error);
+        profile_begin(ctx->profile, "parsing body (YAML)", NULL);
+        mem_account_phase(ctx->memory, "parsing body (YAML)");
+        cJSON *inst = miniyaml_parse(text, &yaml_error);
+        profile_end(ctx->profile);
+        int converted = 0;
+        if (inst) {
+            profile_begin(ctx->profile, "conversione in tape", NULL);
+            mem_account_phase(ctx->memory, "conversione in tape");
+            converted = payload_tape_from_cjson(out, inst, ctx->symbols);
+            profile_end(ctx->profile);
+        }
         if (!inst) {
-            fprintf(stderr, "Errore: YAML body non valido%s%s\n",
-                    yaml_error ? ": " : "",
-                    yaml_error ? yaml_error : "");
+            *reason = message_dup("YAML body non valido", yaml_error);
+            *code = 4;
+        } else if (!converted) {
+            *reason = message_dup("memoria insufficiente per il body.", NULL);
+            *code = 8;
+        } else {
+            payload_free(inst);
             free(yaml_error);
-            free(json_body); free(oas_spec);
-            return 4;
+            mem_free(text);
+            return 1;
         }
+        payload_free(inst);
         free(yaml_error);
     }
-    const char *oas_trim = ltrim(oas_spec);
+    mem_free(text);
+    return 0;
+}
+
+// Contesto di validazione di una richiesta con le opzioni del comando.
+static jsval_ctx request_ctx(const oas_spec *spec, jsval_mode mode, const cli_options *opts) {
+    jsval_ctx ctx = jsval_ctx_make(spec->root, mode);
+    ctx.index = spec->index;
+    ctx.max_depth = opts->limits.max_depth;
+    ctx.symbols = spec->symbols;
+    ctx.profile = opts->profile;
+    ctx.pool = opts->pool;
+    ctx.parallel_min_items = opts->parallel_items;
+    ctx.memory = opts->memory;
+    ctx.adaptive_order = opts->adaptive_order != 0;
+    ctx.budget = opts->budget;
+    return ctx;
+}
+
+// Con il limite di memoria della richiesta superato il body viene respinto,
+// qualunque errore abbia prodotto l'allocazione mancata (memoria esaurita,
+// lettura o decompressione non riuscite). Restituisce il codice da usare.
+static int memory_verdict(const cli_options *opts, int code, char **reason) {
+    if (!mem_account_exceeded(opts->memory)) return code;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "Memoria della richiesta oltre il limite di %zu byte", mem_account_limit(opts->memory));
+    free(*reason);
+    *reason = message_dup(msg, NULL);
+    return 1;
+}
+
+// Con il budget della richiesta esaurito la validazione è stata interrotta e
+// non c'è un verdetto sul body, qualunque esito abbiano prodotto i passi
+// interrotti (una regex fermata non corrisponde). Restituisce il codice da
+// usare: 9 se il budget è esaurito.
+static int budget_verdict(const cli_options *opts, int code, char **reason) {
+    if (!req_budget_exceeded(opts->budget)) return code;
+    char what[64];
+    req_budget_describe(opts->budget, what, sizeof(what));
+    free(*reason);
+    *reason = message_dup("validazione interrotta, budget della richiesta esaurito", what);
+    return 9;
+}
+
+// Valida il tape di un body già interpretato e lo libera. Restituisce 0 se
+// valido, 1 se non valido; in `reason` il motivo (da liberare con free).
+static int validate_parsed(payload_tape *tape, cJSON *schema, jsval_ctx *ctx, const cli_options *opts,
+                           char **reason) {
+    if (opts->memo) ctx->memo = jsval_memo_create();
+    profile_begin(opts->profile, "validazione", NULL);
+    jsval_result res = js_validate_tape(tape, schema, ctx);
+    profile_end(opts->profile);
+    jsval_memo_free(ctx->memo);
+    ctx->memo = NULL;
+    int code = res.ok ? 0 : 1;
+    if (!res.ok) *reason = message_dup(res.error_msg ? res.error_msg : "(sconosciuto)", NULL);
+    jsval_result_free(&res);
+    payload_tape_free(tape);
+    return code;
+}
+
+// Valida il body `text` (di cui prende possesso) rispetto a `schema`. Con la
+// cache degli esiti attiva, un body già visto con la stessa versione della
+// specifica e la stessa operazione riceve il verdetto memorizzato senza
+// essere interpretato. Restituisce 0 se valido, 1 se non valido, altrimenti
+// un codice di errore; in `reason` il motivo (da liberare con free).
+static int check_body(const oas_spec *spec, cJSON *schema, const char *method, const char *endpoint,
+                      jsval_mode mode, char *text, size_t len, const cli_options *opts, char **reason) {
+    *reason = NULL;
+    result_cache_key key;
+    if (opts->cache) {
+        profile_begin(opts->profile, "cache degli esiti", NULL);
+        key = result_cache_key_of(opts->cache, spec->uid, method, endpoint, (int)mode, text, len);
+        int verdict = 0;
+        int hit = result_cache_get(opts->cache, &key, &verdict, reason);
+        profile_end(opts->profile);
+        if (hit) {
+            mem_free(text);
+            return verdict;
+        }
+    }
+
+    jsval_ctx ctx = request_ctx(spec, mode, opts);
+    int code = 0;
+    payload_tape tape;
+    if (!parse_body(text, len, schema, &ctx, &opts->limits, &tape, &code, reason)) {
+        // i limiti violati durante il parsing sono un verdetto come gli altri
+        if (opts->cache && code == 1) result_cache_put(opts->cache, &key, 1, *reason);
+        return code;
+    }
+
+    code = validate_parsed(&tape, schema, &ctx, opts, reason);
+    // l'esito di una validazione interrotta dipende dal tempo, non dal body
+    if (opts->cache && !req_budget_exceeded(opts->budget)) result_cache_put(opts->cache, &key, code, *reason);
+    return code;
+}
+
+// Potatura richiesta con --prune-spec: a partire dalla sola operazione
+// `method` (minuscolo) su `endpoint`, oppure da tutte se sono NULL.
+static oas_prune_opts prune_opts(const cli_options *opts, const char *method, const char *endpoint) {
+    oas_prune_opts p = {opts->prune_spec != 0, method, endpoint};
+    return p;
+}
+
+// Riporta su stderr la memoria della specifica prima e dopo la potatura. La
+// stima senza potatura non conta gli schemi eliminati che sarebbero stati
+// compilati.
+static void report_prune(const oas_spec *spec) {
+    if (!spec->prune.enabled) return;
+    size_t removed = spec->dom_bytes_full - spec->dom_bytes_pruned;
+    fprintf(stderr, "Specifica potata: DOM da %.1f KiB a %.1f KiB (%zu nodi rimossi); memoria %.1f KiB, "
+            "senza potatura almeno %.1f KiB.\n",
+            spec->dom_bytes_full / 1024.0, spec->dom_bytes_pruned / 1024.0, spec->pruned_nodes,
+            spec->memory_bytes / 1024.0, (spec->memory_bytes + removed) / 1024.0);
+}
+
+// Caricamento completo della specifica per la validazione di un singolo
+// body: lettura, parsing (JSON o YAML), verifica della versione e
+// compilazione, con una fase del profilo per ciascun passo. In caso di
+// errore stampa il motivo e restituisce NULL con il codice di uscita in `*code`.
+static oas_spec *load_spec_full(const char *path, const char *method, const char *endpoint,
+                                const cli_options *opts, int *code) {
+    profile *prof = opts->profile;
+    size_t oas_len = 0;
+    profile_begin(prof, "lettura specifica", NULL);
+    char *oas_spec_text = read_entire_file(path, &oas_len);
+    profile_end(prof);
+    if (!oas_spec_text) { *code = 1; return NULL; }
+
+    const char *oas_trim = ltrim(oas_spec_text);
     cJSON *oas = NULL;
     if (oas_trim[0] == '{' || oas_trim[0] == '[') {
-        oas = cJSON_ParseWithLength(oas_spec, (int)oas_len);
+        profile_begin(prof, "parsing specifica (cJSON)", NULL);
+        oas = cJSON_ParseWithLength(oas_spec_text, oas_len);
+        profile_end(prof);
         if (!oas) {
             fprintf(stderr, "Errore: OpenAPI JSON non valido.\n");
-            cJSON_Delete(inst); free(json_body); free(oas_spec);
-            return 5;
+            free(oas_spec_text);
+            *code = 5;
+            return NULL;
         }
     } else {
         char *yaml_error = NULL;
-        oas = miniyaml_parse(oas_spec, &yaml_error);
+        profile_begin(prof, "parsing specifica (YAML)", NULL);
+        oas = miniyaml_parse(oas_spec_text, &yaml_error);
+        profile_end(prof);
         if (!oas) {
             fprintf(stderr, "Errore: OpenAPI YAML non valido%s%s\n",
                     yaml_error ? ": " : "",
                     yaml_error ? yaml_error : "");
             free(yaml_error);
-            cJSON_Delete(inst); free(json_body); free(oas_spec);
-            return 5;
+            free(oas_spec_text);
+            *code = 5;
+            return NULL;
         }
         free(yaml_error);
     }
+    free(oas_spec_text);
 
     // check openapi 3.x minimale
     cJSON *openapi = cJSON_GetObjectItemCaseSensitive(oas, "openapi");
     if (!cJSON_IsString(openapi) || strncmp(openapi->valuestring, "3.", 2)!=0) {
         fprintf(stderr, "Errore: 'openapi' non è 3.x.\n");
-        cJSON_Delete(inst); cJSON_Delete(oas);
-        free(json_body); free(oas_spec);
-        return 6;
+        cJSON_Delete(oas);
+        *code = 6;
+        return NULL;
+    }
+
+    // compila la specifica (regex precompilate, unità per components/schemas)
+    oas_prune_opts prune = prune_opts(opts, method, endpoint);
+    profile_begin(prof, "compilazione specifica", NULL);
+    oas_spec *spec = oas_spec_build(oas, NULL, &prune);
+    profile_end(prof);
+    if (!spec) {
+        fprintf(stderr, "Errore: memoria insufficiente durante la compilazione della specifica.\n");
+        *code = 8;
+        return NULL;
+    }
+    report_prune(spec);
+    return spec;
+}
+
+// Caricamento su richiesta (--lazy-spec): il file viene mappato e indicizzato
+// senza costruire il DOM, poi vengono materializzati solo "openapi",
+// l'operazione `method` (minuscolo) su `endpoint` e i target dei $ref del
+// suo requestBody. Restituisce NULL con `*code` a 0 se il documento non è un
+// oggetto JSON (ad esempio YAML) e va caricato per intero; negli altri errori
+// stampa il motivo e scrive in `*code` il codice di uscita.
+static oas_spec *load_spec_lazy(const char *path, const char *method, const char *endpoint,
+                                const cli_options *opts, int *code) {
+    profile *prof = opts->profile;
+    oas_lazy *lz = NULL;
+    *code = 0;
+    profile_begin(prof, "indicizzazione specifica", NULL);
+    oas_lazy_status st = oas_lazy_open(path, &lz);
+    profile_end(prof);
+    if (st == OAS_LAZY_NOT_JSON) return NULL;
+    if (st == OAS_LAZY_OK) {
+        profile_begin(prof, "materializzazione specifica", NULL);
+        st = oas_lazy_require_operation(lz, method, endpoint);
+        profile_end(prof);
+    }
+    if (st != OAS_LAZY_OK) {
+        fprintf(stderr, "Errore: OpenAPI non valido: %s.\n", oas_lazy_status_message(st));
+        oas_lazy_free(lz);
+        *code = st == OAS_LAZY_IO ? 1 : st == OAS_LAZY_NO_MEMORY ? 8 : 5;
+        return NULL;
+    }
+    cJSON *openapi = cJSON_GetObjectItemCaseSensitive(oas_lazy_root(lz), "openapi");
+    if (!cJSON_IsString(openapi) || strncmp(openapi->valuestring, "3.", 2) != 0) {
+        fprintf(stderr, "Errore: 'openapi' non è 3.x.\n");
+        oas_lazy_free(lz);
+        *code = 6;
+        return NULL;
+    }
+
+    oas_prune_opts prune = prune_opts(opts, method, endpoint);
+    profile_begin(prof, "compilazione specifica", NULL);
+    oas_spec *spec = oas_spec_build(oas_lazy_detach(lz), NULL, &prune);
+    profile_end(prof);
+    if (!spec) {
+        fprintf(stderr, "Errore: memoria insufficiente durante la compilazione della specifica.\n");
+        oas_lazy_free(lz);
+        *code = 8;
+        return NULL;
+    }
+    report_prune(spec);
+    fprintf(stderr, "Specifica su richiesta: indice di %zu contenitori (%.1f KiB) su %.1f KiB di JSON; "
+            "memoria %.1f KiB.\n", oas_lazy_containers(lz), oas_lazy_index_bytes(lz) / 1024.0,
+            oas_lazy_source_bytes(lz) / 1024.0, spec->memory_bytes / 1024.0);
+    oas_lazy_free(lz);
+    return spec;
+}
+
+// Stampa l'esito di una richiesta e libera `reason`; restituisce `code`.
+static int report_verdict(int code, char *reason, const char *ok_suffix) {
+    if (code == 0) {
+        printf("OK%s", ok_suffix);
+    } else if (code == 1) {
+        printf("NON VALIDO - Motivo: %s\n", reason ? reason : "(sconosciuto)");
+    } else {
+        fprintf(stderr, "Errore: %s\n", reason ? reason : "memoria insufficiente per il body.");
+    }
+    free(reason);
+    return code;
+}
+
+// Blocco letto dagli stream del body.
+#define BODY_CHUNK 65536
+
+// Sorgente dei byte del body per check_stream: lo stream così com'è oppure,
+// con --encoding, decompresso a blocchi durante la lettura.
+typedef struct {
+    FILE *in;
+    inflate_stream *inflate; // NULL per i body non compressi
+    profile *profile;
+    const char *phase;       // fase del profilo della decompressione
+} body_source;
+
+static size_t file_read(void *arg, void *buf, size_t cap) {
+    return fread(buf, 1, cap, (FILE*)arg);
+}
+
+static size_t source_read(body_source *src, char *buf, size_t cap) {
+    if (!src->inflate) return fread(buf, 1, cap, src->in);
+    profile_begin(src->profile, src->phase, NULL);
+    size_t n = inflate_stream_read(src->inflate, buf, cap);
+    profile_end(src->profile);
+    return n;
+}
+
+// Codice di uscita e motivo per un errore di decompressione; 0 se non ce ne
+// sono.
+static int inflate_failure(inflate_status st, const char *error, const cli_options *opts, char **reason) {
+    if (st == INFLATE_OK) return 0;
+    if (st == INFLATE_TOO_LARGE) {
+        *reason = (char*)malloc(64);
+        if (!*reason) return 8;
+        snprintf(*reason, 64, "Body decompresso oltre il limite di %zu byte", opts->max_inflated);
+        return 1;
+    }
+    if (st == INFLATE_NO_MEMORY) {
+        *reason = message_dup("memoria insufficiente per il body.", NULL);
+        return 8;
+    }
+    *reason = message_dup("body compresso non valido", error);
+    return 4;
+}
+
+// Codice di uscita per un errore della sorgente (lettura o decompressione)
+// emerso alla fine dei dati, 0 se la sorgente è terminata regolarmente.
+static int source_failure(const body_source *src, const cli_options *opts, char **reason) {
+    if (ferror(src->in)) {
+        *reason = message_dup("lettura del body non riuscita.", NULL);
+        return 3;
+    }
+    if (!src->inflate) return 0;
+    return inflate_failure(inflate_stream_status(src->inflate), inflate_stream_error(src->inflate), opts, reason);
+}
+
+// Valida il body letto da `src`. Il JSON passa al parser incrementale a
+// blocchi man mano che arriva, senza conservare il body: un limite superato
+// o un errore di sintassi interrompono la lettura. Il YAML (e ogni body se la
+// cache degli esiti, che ne usa i byte, è attiva) viene raccolto e passato a
+// check_body. Codici di uscita e `reason` come check_body.
+static int check_source(const oas_spec *spec, cJSON *schema, const char *method, const char *endpoint,
+                        jsval_mode mode, body_source *src, const cli_options *opts, char **reason) {
+    size_t cap = BODY_CHUNK, len = 0, lead = 0;
+    char *buf = (char*)mem_malloc(cap + 1);
+    if (!buf) return 8;
+
+    // i primi byte diversi da spazi decidono tra JSON e YAML come in parse_body
+    profile_begin(opts->profile, "lettura body", NULL);
+    size_t n;
+    while ((n = source_read(src, buf + len, cap - len)) > 0) {
+        len += n;
+        while (lead < len && (buf[lead] == ' ' || buf[lead] == '\t' || buf[lead] == '\r' || buf[lead] == '\n')) ++lead;
+        if (lead < len || (opts->limits.max_bytes && len > opts->limits.max_bytes)) break;
+        if (len == cap) {
+            char *nb = (char*)mem_realloc(buf, cap * 2 + 1);
+            if (!nb) {
+                profile_end(opts->profile);
+                mem_free(buf);
+                return 8;
+            }
+            buf = nb;
+            cap *= 2;
+        }
+    }
+    profile_end(opts->profile);
+    int json = lead < len && (buf[lead] == '{' || buf[lead] == '[');
+
+    if (!json || opts->cache) {
+        profile_begin(opts->profile, "lettura body", NULL);
+        while (!(opts->limits.max_bytes && len > opts->limits.max_bytes)) {
+            if (len == cap) {
+                char *nb = (char*)mem_realloc(buf, cap * 2 + 1);
+                if (!nb) break;
+                buf = nb;
+                cap *= 2;
+            }
+            n = source_read(src, buf + len, cap - len);
+            if (n == 0) break;
+            len += n;
+        }
+        profile_end(opts->profile);
+        if (opts->limits.max_bytes && len > opts->limits.max_bytes) {
+            mem_free(buf);
+            *reason = (char*)mem_malloc(64);
+            if (!*reason) return 8;
+            snprintf(*reason, 64, "Payload oltre il limite di %zu byte", opts->limits.max_bytes);
+            return 1;
+        }
+        int code = len < cap ? source_failure(src, opts, reason) : 0;
+        if (code != 0 || len == cap) {
+            mem_free(buf);
+            if (code == 0) *reason = message_dup("memoria insufficiente per il body.", NULL);
+            return code ? code : 8;
+        }
+        buf[len] = '\0';
+        return check_body(spec, schema, method, endpoint, mode, buf, len, opts, reason);
+    }
+
+    jsval_ctx ctx = request_ctx(spec, mode, opts);
+    payload_push *pp = payload_push_create(schema, &ctx, &opts->limits);
+    if (!pp) {
+        mem_free(buf);
+        return 8;
+    }
+    profile_begin(opts->profile, "lettura e parsing body (JSON incrementale)", NULL);
+    payload_status st = payload_push_feed(pp, buf, len);
+    while (st == PAYLOAD_OK && (n = source_read(src, buf, BODY_CHUNK)) > 0) {
+        st = payload_push_feed(pp, buf, n);
+    }
+    mem_free(buf);
+    // un errore di lettura o di decompressione spiega anche il body troncato
+    int source_code = st == PAYLOAD_OK ? source_failure(src, opts, reason) : 0;
+    payload_tape tape;
+    char *parse_error = NULL;
+    st = payload_push_finish(pp, &tape, &parse_error);
+    payload_push_free(pp);
+    profile_end(opts->profile);
+    if (source_code != 0) {
+        if (st == PAYLOAD_OK) payload_tape_free(&tape);
+        mem_free(parse_error);
+        return source_code;
+    }
+    if (st != PAYLOAD_OK) return parse_failure(st, parse_error, reason);
+    return validate_parsed(&tape, schema, &ctx, opts, reason);
+}
+
+// Valida il body letto da uno stream senza dimensione nota (pipe, socket,
+// "-" per lo standard input) o compresso (--encoding), senza caricarlo prima
+// in memoria: vedi check_source. Codici di uscita e `reason` come check_body.
+static int check_stream(const oas_spec *spec, cJSON *schema, const char *method, const char *endpoint,
+                        jsval_mode mode, FILE *in, const cli_options *opts, char **reason) {
+    *reason = NULL;
+    body_source src = {in, NULL, opts->profile, NULL};
+    if (opts->encoding != CONTENT_IDENTITY) {
+        src.inflate = inflate_stream_create(opts->encoding, opts->max_inflated, file_read, in);
+        if (!src.inflate) return 8;
+        src.phase = opts->encoding == CONTENT_GZIP ? "decompressione body (gzip)" : "decompressione body (deflate)";
     }
+    int code = check_source(spec, schema, method, endpoint, mode, &src, opts, reason);
+    inflate_stream_free(src.inflate);
+    return code;
+}
 
-    char *method_lower = lowercase_dup(http_method_arg);
+// Individua lo schema del requestBody per metodo/endpoint nella versione
+// `spec`, carica il body da `body_path` e lo valida. Restituisce il codice
+// di uscita del programma.
+static int run_request(const oas_spec *spec, const char *body_path, const char *http_method,
+                       const char *endpoint, jsval_mode mode, const cli_options *opts,
+                       const char *ok_suffix) {
+    char *method_lower = lowercase_dup(http_method);
     if (!method_lower) {
         fprintf(stderr, "Errore: memoria insufficiente per elaborare il metodo HTTP.\n");
-        cJSON_Delete(inst); cJSON_Delete(oas);
-        free(json_body); free(oas_spec);
         return 8;
     }
 
-    cJSON *schema = oas_request_body_schema(oas, method_lower, endpoint_arg);
+    profile_begin(opts->profile, "ricerca schema dell'operazione", NULL);
+    cJSON *schema = oas_request_body_schema(spec->root, method_lower, endpoint);
+    profile_end(opts->profile);
+    if (!schema) {
+        free(method_lower);
+        fprintf(stderr, "Errore: impossibile trovare requestBody application/json->schema per %s %s.\n", http_method, endpoint);
+        return 7;
+    }
+
+    char *reason = NULL;
+    int code;
+    if (opts->encoding != CONTENT_IDENTITY || is_stream_path(body_path)) {
+        FILE *in = open_input(body_path);
+        if (!in) {
+            free(method_lower);
+            return 1;
+        }
+        mem_account_phase(opts->memory, "lettura body");
+        code = check_stream(spec, schema, method_lower, endpoint, mode, in, opts, &reason);
+        close_input(in);
+        free(method_lower);
+        code = memory_verdict(opts, budget_verdict(opts, code, &reason), &reason);
+        return report_verdict(code, reason, ok_suffix);
+    }
+
+    size_t body_len = 0;
+    int too_large = 0;
+    profile_begin(opts->profile, "lettura body", NULL);
+    mem_account_phase(opts->memory, "lettura body");
+    char *body = read_file_limited(body_path, opts->limits.max_bytes, &body_len, &too_large);
+    profile_end(opts->profile);
+    if (!body) {
+        free(method_lower);
+        if (mem_account_exceeded(opts->memory)) {
+            code = memory_verdict(opts, 1, &reason);
+            return report_verdict(code, reason, ok_suffix);
+        }
+        if (too_large) {
+            printf("NON VALIDO - Motivo: Payload oltre il limite di %zu byte\n", opts->limits.max_bytes);
+        }
+        return 1;
+    }
+
+    code = check_body(spec, schema, method_lower, endpoint, mode, body, body_len, opts, &reason);
+    free(method_lower);
+    code = memory_verdict(opts, budget_verdict(opts, code, &reason), &reason);
+    return report_verdict(code, reason, ok_suffix);
+}
+
+// Come run_request, con la memoria della richiesta contata in opts->memory
+// (azzerato all'inizio) e stampata su stderr con --memory-stats.
+static int validate_request(const oas_spec *spec, const char *body_path, const char *http_method,
+                            const char *endpoint, jsval_mode mode, const cli_options *opts,
+                            const char *ok_suffix) {
+    req_budget_start(opts->budget);
+    if (!opts->memory) return run_request(spec, body_path, http_method, endpoint, mode, opts, ok_suffix);
+    mem_account_reset(opts->memory);
+    mem_account *prev = mem_account_enter(opts->memory);
+    int code = run_request(spec, body_path, http_method, endpoint, mode, opts, ok_suffix);
+    mem_account_phase(opts->memory, NULL);
+    mem_account_enter(prev);
+    if (opts->memory_stats) {
+        fflush(stdout);
+        mem_account_print(opts->memory, stderr);
+    }
+    return code;
+}
+
+// Riepilogo della cache degli esiti.
+static void print_cache_stats(FILE *f, result_cache *cache) {
+    result_cache_stats st;
+    result_cache_get_stats(cache, &st);
+    uint64_t total = st.hits + st.misses;
+    fprintf(f, "CACHE hit %llu, miss %llu (%.1f%% hit), esiti %zu/%zu, sfrattati %llu, invalidazioni %llu\n",
+            (unsigned long long)st.hits, (unsigned long long)st.misses,
+            total ? 100.0 * (double)st.hits / (double)total : 0.0,
+            st.entries, st.capacity, (unsigned long long)st.evictions,
+            (unsigned long long)st.invalidations);
+}
+
+// Scrive `s` come stringa JSON.
+static void print_json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (const unsigned char *p = (const unsigned char*)s; *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', f);
+            fputc(*p, f);
+        } else if (*p == '\n') {
+            fputs("\\n", f);
+        } else if (*p == '\t') {
+            fputs("\\t", f);
+        } else if (*p < 0x20) {
+            fprintf(f, "\\u%04x", *p);
+        } else {
+            fputc(*p, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Riga NDJSON con l'esito della validazione di un file e, se `memory` non è
+// NULL, la memoria della richiesta.
+static void print_batch_result(const char *path, const char *result, int code, const char *reason,
+                               const mem_account *memory) {
+    fputs("{\"file\":", stdout);
+    print_json_string(stdout, path);
+    fputs(",\"result\":", stdout);
+    print_json_string(stdout, result);
+    if (code > 1) printf(",\"code\":%d", code);
+    if (reason) {
+        fputs(",\"reason\":", stdout);
+        print_json_string(stdout, reason);
+    }
+    if (memory) {
+        mem_stats ms = mem_account_stats(memory);
+        printf(",\"memory\":{\"allocations\":%zu,\"allocated\":%zu,\"peak\":%zu}", ms.allocations, ms.allocated,
+               ms.peak);
+    }
+    fputs("}\n", stdout);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Modalità directory: valida con la stessa operazione tutti i file indicati
+// da `pattern` (directory visitata ricorsivamente oppure glob) e scrive su
+// stdout una riga NDJSON per file, nell'ordine in cui le letture terminano.
+// Le letture procedono in anticipo (io_uring o pool di thread) mentre il
+// file corrente viene validato. Restituisce 0 se tutti i file sono validi.
+static int run_batch(const char *pattern, const char *spec_path, const char *http_method,
+                     const char *endpoint, jsval_mode mode, const cli_options *opts) {
+    file_list files;
+    char *err = NULL;
+    if (!file_list_collect(pattern, &files, &err)) {
+        fprintf(stderr, "Errore: %s\n", err ? err : "memoria insufficiente");
+        free(err);
+        return 1;
+    }
+
+    char *method_lower = lowercase_dup(http_method);
+    int load_code = 0;
+    oas_spec *spec = opts->lazy_spec && method_lower
+                         ? load_spec_lazy(spec_path, method_lower, endpoint, opts, &load_code) : NULL;
+    if (!spec && load_code) {
+        free(method_lower);
+        file_list_free(&files);
+        return load_code;
+    }
+    if (!spec) {
+        oas_prune_opts prune = prune_opts(opts, method_lower, endpoint);
+        spec = oas_spec_load_file(spec_path, NULL, &prune, &err);
+        if (!spec) {
+            fprintf(stderr, "Errore: OpenAPI non valido: %s\n", err ? err : "(sconosciuto)");
+            free(err);
+            free(method_lower);
+            file_list_free(&files);
+            return 5;
+        }
+        report_prune(spec);
+    }
+    cJSON *schema = method_lower ? oas_request_body_schema(spec->root, method_lower, endpoint) : NULL;
+    if (!schema) {
+        fprintf(stderr, "Errore: impossibile trovare requestBody application/json->schema per %s %s.\n", http_method, endpoint);
+        free(method_lower);
+        oas_spec_free(spec);
+        file_list_free(&files);
+        return 7;
+    }
+
+    file_batch_options bopts;
+    memset(&bopts, 0, sizeof(bopts));
+    bopts.backend = opts->io_backend;
+    bopts.depth = opts->io_depth;
+    bopts.max_bytes = opts->limits.max_bytes;
+    file_batch *batch = file_batch_open((const char *const *)files.paths, files.count, &bopts);
+    if (!batch) {
+        fprintf(stderr, "Errore: lettura parallela dei file non disponibile%s.\n",
+                opts->io_backend == FILE_BATCH_URING ? " (io_uring)" : "");
+        free(method_lower);
+        oas_spec_free(spec);
+        file_list_free(&files);
+        return 8;
+    }
+
+    double t0 = now_seconds();
+    size_t n_ok = 0, n_invalid = 0, n_error = 0;
+    file_batch_item item;
+    while (file_batch_next(batch, &item)) {
+        if (item.too_large) {
+            char reason[64];
+            snprintf(reason, sizeof(reason), "Payload oltre il limite di %zu byte", opts->limits.max_bytes);
+            print_batch_result(item.path, "NON VALIDO", 1, reason, NULL);
+            ++n_invalid;
+            continue;
+        }
+        if (!item.data) {
+            print_batch_result(item.path, "ERRORE", 3, strerror(item.error), NULL);
+            ++n_error;
+            continue;
+        }
+        char *reason = NULL;
+        int code = 0;
+        // il body è stato letto dai thread di I/O, fuori dalla contabilità
+        mem_account_reset(opts->memory);
+        req_budget_start(opts->budget);
+        mem_account *prev = mem_account_enter(opts->memory);
+        if (opts->encoding != CONTENT_IDENTITY) {
+            mem_account_phase(opts->memory, "decompressione");
+            char *plain = NULL;
+            const char *inflate_error = NULL;
+            inflate_status ist = inflate_buffer(opts->encoding, item.data, item.len, opts->max_inflated,
+                                                &plain, &item.len, &inflate_error);
+            free(item.data);
+            item.data = plain;
+            code = inflate_failure(ist, inflate_error, opts, &reason);
+        }
+        if (code == 0)
+            code = check_body(spec, schema, method_lower, endpoint, mode, item.data, item.len, opts, &reason);
+        mem_account_phase(opts->memory, NULL);
+        mem_account_enter(prev);
+        code = memory_verdict(opts, budget_verdict(opts, code, &reason), &reason);
+        const mem_account *stats = opts->memory_stats ? opts->memory : NULL;
+        if (code == 0) {
+            print_batch_result(item.path, "OK", 0, NULL, stats);
+            ++n_ok;
+        } else {
+            print_batch_result(item.path, code == 1 ? "NON VALIDO" : "ERRORE", code, reason ? reason : "(sconosciuto)",
+                               stats);
+            if (code == 1) ++n_invalid; else ++n_error;
+        }
+        free(reason);
+    }
+    fflush(stdout);
+    double elapsed = now_seconds() - t0;
+    fprintf(stderr, "File: %zu in %.3f s (%s, %u letture in anticipo): OK %zu, non validi %zu, errori %zu.\n",
+            files.count, elapsed, file_batch_backend_name(batch), file_batch_depth(batch),
+            n_ok, n_invalid, n_error);
+    if (opts->cache) print_cache_stats(stderr, opts->cache);
+
+    file_batch_close(batch);
+    free(method_lower);
+    oas_spec_free(spec);
+    file_list_free(&files);
+    return (n_invalid || n_error) ? 1 : 0;
+}
+
+// Modalità servizio: legge da stdin una richiesta per riga nel formato
+// "<metodo> <endpoint> <file-body> [strict-rule|lexical-rule]" e risponde su
+// stdout. Il comando "reload" ricarica la specifica in background; le
+// validazioni in corso terminano sulla versione precedente.
+static int run_serve(const char *prog, const char *spec_path, int watch, const cli_options *opts) {
+    char *err = NULL;
+    oas_prune_opts prune = prune_opts(opts, NULL, NULL);
+    oas_spec *spec = oas_spec_load_file(spec_path, NULL, &prune, &err);
+    if (!spec) {
+        fprintf(stderr, "Errore: OpenAPI non valido: %s\n", err ? err : "(sconosciuto)");
+        free(err);
+        return 5;
+    }
+    report_prune(spec);
+    oas_spec_slot *slot = oas_spec_slot_create(spec, 1);
+    if (!slot) {
+        oas_spec_free(spec);
+        fprintf(stderr, "Errore: memoria insufficiente.\n");
+        return 8;
+    }
+    spec_reloader *reloader = spec_reloader_start(slot, spec_path, watch != 0);
+    if (!reloader) {
+        fprintf(stderr, "Avviso: ricaricamento in background non disponibile.\n");
+    }
+
+    uint64_t cache_uid = 0;
+    char line[8192];
+    while (fgets(line, sizeof(line), stdin)) {
+        size_t n = strlen(line);
+        while (n > 0 && (line[n-1] == '\n' || line[n-1] == '\r')) line[--n] = '\0';
+        const char *cmd = ltrim(line);
+        if (*cmd == '\0') continue;
+        if (strcmp(cmd, "quit") == 0) break;
+        if (strcmp(cmd, "reload") == 0) {
+            spec_reloader_request(reloader);
+            printf("RELOAD\n");
+            fflush(stdout);
+            continue;
+        }
+        if (strcmp(cmd, "stats") == 0) {
+            if (opts->cache) print_cache_stats(stdout, opts->cache);
+            else printf("CACHE disattivata\n");
+            fflush(stdout);
+            continue;
+        }
+
+        char *fields[4] = {NULL, NULL, NULL, NULL};
+        int nf = 0;
+        for (char *tok = strtok(line, " \t"); tok && nf < 4; tok = strtok(NULL, " \t")) {
+            fields[nf++] = tok;
+        }
+        jsval_mode mode = JSVAL_MODE_STRICT;
+        if (nf < 3 || (nf == 4 && !parse_mode(fields[3], &mode))) {
+            printf("ERRORE - Richiesta non valida\n");
+            print_usage(prog);
+            fflush(stdout);
+            continue;
+        }
+
+        const oas_spec *current = oas_spec_read_lock(slot, 0);
+        // gli esiti della versione precedente non verrebbero più cercati
+        if (opts->cache && current->uid != cache_uid) {
+            if (cache_uid != 0) result_cache_clear(opts->cache);
+            cache_uid = current->uid;
+        }
+        int code = validate_request(current, fields[2], fields[0], fields[1], mode, opts, "\n");
+        oas_spec_read_unlock(slot, 0);
+        if (code > 1) printf("ERRORE - Codice %d\n", code);
+        fflush(stdout);
+    }
+
+    spec_reloader_stop(reloader);
+    oas_spec_slot_free(slot);
+    return 0;
+}
+
+static void print_registry_stats(spec_registry *reg) {
+    spec_registry_stats st;
+    spec_registry_get_stats(reg, &st);
+    uint64_t total = st.hits + st.misses;
+    printf("STATS hit %llu, miss %llu (%.1f%% hit), ricaricate %llu, condivise %llu, sfrattate %llu, "
+           "residenti %zu/%zu, memoria %zu KB",
+           (unsigned long long)st.hits, (unsigned long long)st.misses,
+           total ? 100.0 * (double)st.hits / (double)total : 0.0,
+           (unsigned long long)st.reloads, (unsigned long long)st.shared,
+           (unsigned long long)st.evictions, st.resident, st.registered, st.resident_bytes / 1024);
+    if (st.budget_bytes) printf(" su %zu KB", st.budget_bytes / 1024);
+    printf("\n");
+}
+
+// Crea il registro delle specifiche elencate in `list_path`. NULL, con il
+// codice di uscita in `code`, se la memoria non basta o l'elenco non è valido.
+static spec_registry *open_registry(const char *list_path, const cli_options *opts, int *code) {
+    spec_registry *reg = spec_registry_create(opts->spec_budget, opts->prune_spec != 0);
+    if (!reg) {
+        fprintf(stderr, "Errore: memoria insufficiente.\n");
+        *code = 8;
+        return NULL;
+    }
+    char *err = NULL;
+    long count = spec_registry_add_list(reg, list_path, &err);
+    if (count < 0) {
+        fprintf(stderr, "Errore: %s\n", err ? err : "(sconosciuto)");
+        free(err);
+        spec_registry_free(reg);
+        *code = 5;
+        return NULL;
+    }
+    fprintf(stderr, "Registro: %ld specifiche.\n", count);
+    return reg;
+}
+
+// Modalità servizio con più specifiche: come --serve, ma ogni riga indica
+// anche l'id della specifica ("<id> <metodo> <endpoint> <file-body>
+// [strict-rule|lexical-rule]"). Le specifiche elencate in `list_path` sono
+// caricate al primo uso e tenute in memoria entro il budget; il comando
+// "stats" stampa i contatori del registro.
+static int run_registry(const char *prog, const char *list_path, const cli_options *opts) {
+    int load_code = 0;
+    spec_registry *reg = open_registry(list_path, opts, &load_code);
+    if (!reg) return load_code;
+    char *err = NULL;
+
+    char line[8192];
+    while (fgets(line, sizeof(line), stdin)) {
+        size_t n = strlen(line);
+        while (n > 0 && (line[n-1] == '\n' || line[n-1] == '\r')) line[--n] = '\0';
+        const char *cmd = ltrim(line);
+        if (*cmd == '\0') continue;
+        if (strcmp(cmd, "quit") == 0) break;
+        if (strcmp(cmd, "stats") == 0) {
+            print_registry_stats(reg);
+            if (opts->cache) print_cache_stats(stdout, opts->cache);
+            fflush(stdout);
+            continue;
+        }
+
+        char *fields[5] = {NULL, NULL, NULL, NULL, NULL};
+        int nf = 0;
+        for (char *tok = strtok(line, " \t"); tok && nf < 5; tok = strtok(NULL, " \t")) {
+            fields[nf++] = tok;
+        }
+        jsval_mode mode = JSVAL_MODE_STRICT;
+        if (nf < 4 || (nf == 5 && !parse_mode(fields[4], &mode))) {
+            printf("ERRORE - Richiesta non valida\n");
+            print_usage(prog);
+            fflush(stdout);
+            continue;
+        }
+
+        const oas_spec *spec = spec_registry_acquire(reg, fields[0], &err);
+        if (!spec) {
+            printf("ERRORE - %s\n", err ? err : "specifica non disponibile");
+            free(err);
+            fflush(stdout);
+            continue;
+        }
+        int code = validate_request(spec, fields[3], fields[1], fields[2], mode, opts, "\n");
+        spec_registry_release(reg, spec);
+        if (code > 1) printf("ERRORE - Codice %d\n", code);
+        fflush(stdout);
+    }
+
+    spec_registry_free(reg);
+    return 0;
+}
+
+// Modalità anello: come --registry, ma le richieste arrivano dai processi
+// produttori tramite l'anello in memoria condivisa opts->ring (vedi
+// shm_ring.h) e gli esiti tornano nello stesso anello. All'arresto stampa i
+// contatori del registro.
+static int run_ring(const char *list_path, const cli_options *opts) {
+    int code = 0;
+    spec_registry *reg = open_registry(list_path, opts, &code);
+    if (!reg) return code;
+
+    ring_server_options ropts;
+    memset(&ropts, 0, sizeof(ropts));
+    ropts.name = opts->ring;
+    ropts.slots = opts->ring_slots;
+    ropts.slot_size = opts->ring_slot_size;
+    ropts.limits = opts->limits;
+    ropts.memo = opts->memo != 0;
+    ropts.cache = opts->cache;
+    ropts.pool = opts->pool;
+    ropts.parallel_items = opts->parallel_items;
+    ropts.memory = opts->memory;
+    ropts.adaptive_order = opts->adaptive_order != 0;
+    ropts.budget = opts->budget;
+    code = ring_server_run(reg, &ropts);
+    if (code == 0) print_registry_stats(reg);
+    spec_registry_free(reg);
+    return code;
+}
+
+// Stato di --ring-send: esiti ricevuti dall'anello.
+typedef struct {
+    const char *const *paths;
+    int single;   // un solo body: esito stampato come nella validazione diretta
+    int code;     // con un solo body, il suo codice
+    size_t n_ok, n_invalid, n_error;
+} ring_send_state;
+
+static void on_ring_result(void *arg, size_t index, int code, const char *reason) {
+    ring_send_state *st = (ring_send_state*)arg;
+    if (st->single) {
+        st->code = report_verdict(code, code ? message_dup(reason, NULL) : NULL, "");
+        return;
+    }
+    if (code == 0) {
+        print_batch_result(st->paths[index], "OK", 0, NULL, NULL);
+        ++st->n_ok;
+    } else {
+        print_batch_result(st->paths[index], code == 1 ? "NON VALIDO" : "ERRORE", code, reason, NULL);
+        if (code == 1) ++st->n_invalid; else ++st->n_error;
+    }
+}
+
+// Modalità produttore: invia il body `request` (o, con `dir_pattern`, i
+// file della directory o del glob) al validatore avviato con --ring sul
+// segmento `name`, per l'operazione `http_method` `endpoint` della
+// specifica `spec_id` del suo registro. Con un solo body l'esito e il codice
+// di uscita sono quelli della validazione diretta; con --dir scrive una
+// riga NDJSON per file, nell'ordine in cui arrivano gli esiti, e su stderr
+// il riepilogo con le richieste al secondo.
+static int run_ring_send(const char *name, const char *dir_pattern, const char *request, const char *spec_id,
+                         const char *http_method, const char *endpoint, jsval_mode mode) {
+    file_list files;
+    memset(&files, 0, sizeof(files));
+    const char *single[1] = {request};
+    char *err = NULL;
+    if (dir_pattern && !file_list_collect(dir_pattern, &files, &err)) {
+        fprintf(stderr, "Errore: %s\n", err ? err : "memoria insufficiente");
+        free(err);
+        return 1;
+    }
+    ring_send_state st;
+    memset(&st, 0, sizeof(st));
+    st.paths = dir_pattern ? (const char *const *)files.paths : single;
+    st.single = !dir_pattern;
+    st.code = 3;
+    size_t count = dir_pattern ? files.count : 1;
+
+    ring_send_request req = {spec_id, http_method, endpoint, (unsigned)mode};
+    double t0 = now_seconds();
+    int sent = ring_send_files(name, &req, st.paths, count, on_ring_result, &st, &err);
+    double elapsed = now_seconds() - t0;
+    fflush(stdout);
+    if (!sent) {
+        fprintf(stderr, "Errore: %s.\n", err ? err : "memoria insufficiente");
+        free(err);
+    }
+    if (dir_pattern) {
+        size_t done = st.n_ok + st.n_invalid + st.n_error;
+        fprintf(stderr, "Anello: %zu file in %.3f s (%.0f richieste/s): OK %zu, non validi %zu, errori %zu.\n",
+                done, elapsed, elapsed > 0 ? (double)done / elapsed : 0.0, st.n_ok, st.n_invalid, st.n_error);
+        file_list_free(&files);
+        if (!sent) return 3;
+        return (st.n_invalid || st.n_error) ? 1 : 0;
+    }
+    return sent ? st.code : 3;
+}
+
+// Modalità proxy: valida i body delle richieste HTTP in arrivo e inoltra
+// quelle valide all'upstream. Come in modalità servizio la specifica può
+// essere ricaricata in background (--watch).
+static int run_proxy(const char *spec_path, int watch, const char *listen_addr, const char *upstream,
+                     jsval_mode mode, const cli_options *opts) {
+    char *err = NULL;
+    oas_prune_opts prune = prune_opts(opts, NULL, NULL);
+    oas_spec *spec = oas_spec_load_file(spec_path, NULL, &prune, &err);
+    if (!spec) {
+        fprintf(stderr, "Errore: OpenAPI non valido: %s\n", err ? err : "(sconosciuto)");
+        free(err);
+        return 5;
+    }
+    report_prune(spec);
+    oas_spec_slot *slot = oas_spec_slot_create(spec, 1);
+    if (!slot) {
+        oas_spec_free(spec);
+        fprintf(stderr, "Errore: memoria insufficiente.\n");
+        return 8;
+    }
+    spec_reloader *reloader = watch ? spec_reloader_start(slot, spec_path, true) : NULL;
+    if (watch && !reloader) {
+        fprintf(stderr, "Avviso: ricaricamento in background non disponibile.\n");
+    }
+
+    proxy_options popts;
+    memset(&popts, 0, sizeof(popts));
+    popts.listen = listen_addr;
+    popts.upstream = upstream;
+    popts.limits = opts->limits;
+    popts.mode = mode;
+    popts.memo = opts->memo != 0;
+    popts.cache = opts->cache;
+    popts.pool = opts->pool;
+    popts.parallel_items = opts->parallel_items;
+    popts.max_inflated = opts->max_inflated;
+    popts.memory = opts->memory;
+    popts.adaptive_order = opts->adaptive_order != 0;
+    popts.budget = opts->budget;
+    int code = proxy_run(slot, &popts);
+
+    spec_reloader_stop(reloader);
+    oas_spec_slot_free(slot);
+    return code;
+}
+
+// Nome predefinito della funzione generata: oas_validate_<metodo>_<endpoint>
+// con i caratteri non alfanumerici sostituiti da '_'.
+static char *default_function_name(const char *http_method, const char *endpoint) {
+    size_t len = strlen("oas_validate_") + strlen(http_method) + 1 + strlen(endpoint) + 1;
+    char *name = (char*)malloc(len);
+    if (!name) return NULL;
+    snprintf(name, len, "oas_validate_%s_%s", http_method, endpoint);
+    for (char *p = name + strlen("oas_validate_"); *p; ++p) {
+        *p = isalnum((unsigned char)*p) ? (char)tolower((unsigned char)*p) : '_';
+    }
+    return name;
+}
+
+// Modalità --emit-c: scrive in `out_path` il validatore C specializzato per
+// lo schema del requestBody dell'operazione indicata.
+static int run_emit(const char *out_path, const char *function_name, const char *spec_path,
+                    const char *http_method, const char *endpoint) {
+    char *err = NULL;
+    oas_spec *spec = oas_spec_load_file(spec_path, NULL, NULL, &err);
+    if (!spec) {
+        fprintf(stderr, "Errore: OpenAPI non valido: %s\n", err ? err : "(sconosciuto)");
+        free(err);
+        return 5;
+    }
+    char *method_lower = lowercase_dup(http_method);
+    cJSON *schema = method_lower ? oas_request_body_schema(spec->root, method_lower, endpoint) : NULL;
+    free(method_lower);
+    if (!schema) {
+        fprintf(stderr, "Errore: impossibile trovare requestBody application/json->schema per %s %s.\n", http_method, endpoint);
+        oas_spec_free(spec);
+        return 7;
+    }
+    char *name = function_name ? NULL : default_function_name(http_method, endpoint);
+    size_t title_len = strlen(http_method) + strlen(endpoint) + strlen(spec_path) + 8;
+    char *title = (char*)malloc(title_len);
+    if ((!function_name && !name) || !title) {
+        fprintf(stderr, "Errore: memoria insufficiente.\n");
+        free(name);
+        free(title);
+        oas_spec_free(spec);
+        return 8;
+    }
+    snprintf(title, title_len, "%s %s (%s)", http_method, endpoint, spec_path);
+
+    int code = 0;
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "Errore: impossibile scrivere '%s'.\n", out_path);
+        code = 3;
+    } else {
+        int ok = js_codegen_emit(out, schema, spec->root, function_name ? function_name : name, title, &err);
+        ok = (fclose(out) == 0) && ok;
+        if (!ok) {
+            fprintf(stderr, "Errore: generazione non riuscita: %s\n", err ? err : "scrittura del file non riuscita");
+            free(err);
+            remove(out_path);
+            code = 3;
+        } else {
+            fprintf(stderr, "Generato %s: jsval_result %s(payload_tape *tape, const jsval_ctx *ctx);\n", out_path,
+                    function_name ? function_name : name);
+        }
+    }
+    free(name);
+    free(title);
+    oas_spec_free(spec);
+    return code;
+}
+
+// Anteprima di un payload su una riga: al più `max` byte, caratteri di
+// controllo sostituiti da '.'.
+static void print_preview(FILE *f, const char *s, size_t len, size_t max) {
+    for (size_t i = 0; i < len && i < max; ++i) {
+        unsigned char c = (unsigned char)s[i];
+        fputc(c < 0x20 || c == 0x7f ? '.' : c, f);
+    }
+    if (len > max) fprintf(f, "... (%zu byte)", len);
+}
+
+// Scrive i payload del rapporto in `dir` come caso-N.json (N = posizione
+// nella classifica). Restituisce false se una scrittura non riesce.
+static int write_explore_cases(const char *dir, const explore_report *r) {
+    for (size_t i = 0; i < r->count; ++i) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/caso-%zu.json", dir, i + 1);
+        FILE *f = fopen(path, "wb");
+        int ok = f && fwrite(r->cases[i].payload, 1, r->cases[i].payload_len, f) == r->cases[i].payload_len;
+        if (f) ok = (fclose(f) == 0) && ok;
+        if (!ok) {
+            fprintf(stderr, "Errore: impossibile scrivere '%s'.\n", path);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Modalità --explore: cerca i payload più lenti da validare per lo schema
+// del requestBody dell'operazione e ne stampa la classifica con la parte
+// dello schema responsabile. Restituisce 1 se almeno un caso raggiunge il
+// limite di durata (specifica da rifiutare), 0 altrimenti.
+static int run_explore(const char *spec_path, const char *http_method, const char *endpoint,
+                       jsval_mode mode, const cli_options *opts) {
+    char *method_lower = lowercase_dup(http_method);
+    if (!method_lower) {
+        fprintf(stderr, "Errore: memoria insufficiente per elaborare il metodo HTTP.\n");
+        return 8;
+    }
+    int code = 0;
+    oas_spec *spec = opts->lazy_spec ? load_spec_lazy(spec_path, method_lower, endpoint, opts, &code) : NULL;
+    if (!spec && code == 0) spec = load_spec_full(spec_path, method_lower, endpoint, opts, &code);
+    if (!spec) {
+        free(method_lower);
+        return code;
+    }
+    cJSON *schema = oas_request_body_schema(spec->root, method_lower, endpoint);
     free(method_lower);
     if (!schema) {
-        fprintf(stderr, "Errore: impossibile trovare requestBody application/json->schema per %s %s.\n", http_method_arg, endpoint_arg);
-        cJSON_Delete(inst); cJSON_Delete(oas);
-        free(json_body); free(oas_spec);
+        fprintf(stderr, "Errore: impossibile trovare requestBody application/json->schema per %s %s.\n", http_method, endpoint);
+        oas_spec_free(spec);
         return 7;
     }
 
-    // valida
-    jsval_ctx ctx = jsval_ctx_make(oas, mode); // per futuro: $ref/components e modalità
-    jsval_result res = js_validate(inst, schema, &ctx);
+    explore_options eo;
+    memset(&eo, 0, sizeof(eo));
+    eo.limits = opts->limits;
+    if (eo.limits.max_bytes == 0) eo.limits.max_bytes = EXPLORE_DEFAULT_MAX_BYTES;
+    eo.memo = opts->memo != 0;
+    eo.seconds = opts->explore_seconds ? (double)opts->explore_seconds : EXPLORE_DEFAULT_SECONDS;
+    eo.limit_seconds = opts->explore_limit_ms ? opts->explore_limit_ms / 1000.0 : EXPLORE_DEFAULT_LIMIT_SECONDS;
+    eo.seed = (unsigned)time(NULL);
+    jsval_ctx ctx = request_ctx(spec, mode, opts);
 
-    if (res.ok) {
-        printf("OK");
+    explore_report report;
+    if (!explore_latency(schema, &ctx, &eo, &report)) {
+        fprintf(stderr, "Errore: memoria insufficiente durante l'esplorazione.\n");
+        oas_spec_free(spec);
+        return 8;
+    }
+    printf("Esplorazione di %s %s: %zu punti dello schema, %zu payload validati in %.1f s "
+           "(limite %.0f ms, payload fino a %zu byte).\n", http_method, endpoint, report.count,
+           report.probes, report.elapsed, eo.limit_seconds * 1000, eo.limits.max_bytes);
+    printf("%4s %10s %10s %8s %10s  %-26s %s\n", "#", "ms", "byte", "ns/B", "picco KiB", "tipo", "schema");
+    size_t dangerous = 0;
+    for (size_t i = 0; i < report.count; ++i) {
+        const explore_case *c = &report.cases[i];
+        int bad = c->seconds >= eo.limit_seconds;
+        dangerous += bad;
+        printf("%4zu %10.3f %10zu %8.1f %10.1f  %-26s %s%s\n", i + 1, c->seconds * 1000, c->payload_len,
+               c->payload_len ? c->seconds * 1e9 / (double)c->payload_len : 0.0, c->memory / 1024.0,
+               explore_kind_name(c->kind), c->location, bad ? "  PERICOLOSO" : "");
+        printf("     %s, payload %s: ", c->detail ? c->detail : "", c->valid ? "valido" : "non valido");
+        print_preview(stdout, c->payload, c->payload_len, 72);
+        fputc('\n', stdout);
+    }
+    if (dangerous) {
+        printf("PERICOLOSO - %zu %s oltre %.0f ms.\n", dangerous, dangerous == 1 ? "caso" : "casi",
+               eo.limit_seconds * 1000);
     } else {
-        printf("NON VALIDO - Motivo: %s\n", res.error_msg ? res.error_msg : "(sconosciuto)");
+        printf("OK - nessun caso oltre %.0f ms.\n", eo.limit_seconds * 1000);
     }
+    code = dangerous ? 1 : 0;
+    if (opts->explore_out && !write_explore_cases(opts->explore_out, &report)) code = 3;
+    explore_report_free(&report);
+    oas_spec_free(spec);
+    return code;
+}
 
-    jsval_result_free(&res);
-    cJSON_Delete(inst);
-    cJSON_Delete(oas);
-    free(json_body);
-    free(oas_spec);
-    return res.ok ? 0 : 1;
+// Esegue la modalità scelta sulla riga di comando e restituisce il codice di
+// uscita del programma.
+static int run_mode(const char *prog, const cli_options *opts, const char *registry_list,
+                    const char *dir_pattern, const char *serve_spec, const char *proxy_spec,
+                    const char *explore_spec,
+                    const char *listen_addr, const char *upstream, int watch,
+                    const char **pos, int npos) {
+    if (opts->emit_name && !opts->emit_c) {
+        print_usage(prog);
+        return 2;
+    }
+    if (opts->emit_c) {
+        if (npos != 3 || registry_list || dir_pattern || serve_spec || proxy_spec || explore_spec || watch ||
+            opts->profile) {
+            print_usage(prog);
+            return 2;
+        }
+        return run_emit(opts->emit_c, opts->emit_name, pos[0], pos[1], pos[2]);
+    }
+    if ((opts->explore_seconds || opts->explore_limit_ms || opts->explore_out) && !explore_spec) {
+        print_usage(prog);
+        return 2;
+    }
+    if (explore_spec) {
+        jsval_mode explore_mode = JSVAL_MODE_STRICT;
+        if (npos < 2 || npos > 3 || (npos == 3 && !parse_mode(pos[2], &explore_mode)) || registry_list ||
+            dir_pattern || serve_spec || proxy_spec || watch || opts->profile || opts->cache) {
+            print_usage(prog);
+            return 2;
+        }
+        return run_explore(explore_spec, pos[0], pos[1], explore_mode, opts);
+    }
+    if (opts->profile && (registry_list || dir_pattern || serve_spec || proxy_spec)) {
+        fprintf(stderr, "Errore: --profile è disponibile solo per la validazione di un singolo body.\n");
+        return 2;
+    }
+    if (opts->lazy_spec && (registry_list || serve_spec || proxy_spec)) {
+        fprintf(stderr, "Errore: --lazy-spec è disponibile solo per un singolo body, con --dir o con --explore.\n");
+        return 2;
+    }
+    if ((opts->ring && !registry_list) || ((opts->ring_slots || opts->ring_slot_size) && !opts->ring)) {
+        print_usage(prog);
+        return 2;
+    }
+    if (opts->ring_send) {
+        // le opzioni di validazione valgono per il validatore, non per il produttore
+        jsval_mode send_mode = JSVAL_MODE_STRICT;
+        int first = dir_pattern ? 0 : 1;
+        if (registry_list || serve_spec || proxy_spec || watch || npos < first + 3 || npos > first + 4 ||
+            (npos == first + 4 && !parse_mode(pos[first + 3], &send_mode))) {
+            print_usage(prog);
+            return 2;
+        }
+        return run_ring_send(opts->ring_send, dir_pattern, dir_pattern ? NULL : pos[0], pos[first],
+                             pos[first + 1], pos[first + 2], send_mode);
+    }
+    if (registry_list) {
+        if (npos != 0 || serve_spec || proxy_spec || dir_pattern || watch) {
+            print_usage(prog);
+            return 2;
+        }
+        return opts->ring ? run_ring(registry_list, opts) : run_registry(prog, registry_list, opts);
+    }
+    if (dir_pattern) {
+        jsval_mode dir_mode = JSVAL_MODE_STRICT;
+        if (serve_spec || proxy_spec || watch || npos < 3 || npos > 4 ||
+            (npos == 4 && !parse_mode(pos[3], &dir_mode))) {
+            print_usage(prog);
+            return 2;
+        }
+        return run_batch(dir_pattern, pos[0], pos[1], pos[2], dir_mode, opts);
+    }
+    if (serve_spec) {
+        if (npos != 0 || proxy_spec) { print_usage(prog); return 2; }
+        return run_serve(prog, serve_spec, watch, opts);
+    }
+    if (proxy_spec) {
+        jsval_mode proxy_mode = JSVAL_MODE_STRICT;
+        if (!listen_addr || !upstream || npos > 1 || (npos == 1 && !parse_mode(pos[0], &proxy_mode))) {
+            print_usage(prog);
+            return 2;
+        }
+        return run_proxy(proxy_spec, watch, listen_addr, upstream, proxy_mode, opts);
+    }
+    if (listen_addr || upstream) { print_usage(prog); return 2; }
+
+    if (npos < 4 || watch) { print_usage(prog); return 2; }
+
+    jsval_mode mode = JSVAL_MODE_STRICT;
+    if (npos == 5 && !parse_mode(pos[4], &mode)) {
+        fprintf(stderr, "Errore: modalità sconosciuta '%s'.\n", pos[4]);
+        print_usage(prog);
+        return 2;
+    }
+
+    char *method_lower = lowercase_dup(pos[2]);
+    if (!method_lower) {
+        fprintf(stderr, "Errore: memoria insufficiente per elaborare il metodo HTTP.\n");
+        return 8;
+    }
+    int load_code = 0;
+    oas_spec *spec = opts->lazy_spec ? load_spec_lazy(pos[1], method_lower, pos[3], opts, &load_code) : NULL;
+    if (!spec && load_code == 0) spec = load_spec_full(pos[1], method_lower, pos[3], opts, &load_code);
+    free(method_lower);
+    if (!spec) return load_code;
+
+    // carica il body guidato dallo schema e valida
+    int code = validate_request(spec, pos[0], pos[2], pos[3], mode, opts, "");
+
+    // i nomi dei $ref nel profilo appartengono alla specifica
+    if (opts->profile) {
+        fflush(stdout);
+        profile_print(opts->profile, stderr);
+        if (opts->profile_trace && !profile_write_trace(opts->profile, opts->profile_trace)) {
+            fprintf(stderr, "Avviso: impossibile scrivere la trace in '%s'.\n", opts->profile_trace);
+        }
+    }
+    oas_spec_free(spec);
+    return code;
+}
+
+// Punto di ingresso del validatore: carica i file, gestisce JSON/YAML e
+// avvia la validazione restituendo 0 se il payload è conforme allo schema.
+int main(int argc, char **argv) {
+    cli_options opts = {0};
+    opts.limits = payload_limits_default();
+    opts.parallel_items = JSVAL_DEFAULT_PARALLEL_ITEMS;
+    opts.max_inflated = INFLATE_DEFAULT_MAX_OUTPUT;
+    const char *serve_spec = NULL;
+    const char *proxy_spec = NULL;
+    const char *dir_pattern = NULL;
+    const char *registry_list = NULL;
+    const char *explore_spec = NULL;
+    size_t cache_size = 0;
+    unsigned parallel = 0;
+    size_t max_request_memory = 0;
+    unsigned long long max_request_ms = 0, max_request_steps = 0;
+    const char *listen_addr = NULL;
+    const char *upstream = NULL;
+    int watch = 0;
+    int profiling = 0; // 1 = fasi, 2 = anche sotto-schemi
+    const char *pos[5];
+    int npos = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char *a = argv[i];
+        if (strcmp(a, "--serve") == 0 && i + 1 < argc) {
+            serve_spec = argv[++i];
+        } else if (strcmp(a, "--proxy") == 0 && i + 1 < argc) {
+            proxy_spec = argv[++i];
+        } else if (strcmp(a, "--registry") == 0 && i + 1 < argc) {
+            registry_list = argv[++i];
+        } else if (strcmp(a, "--ring") == 0 && i + 1 < argc) {
+            opts.ring = argv[++i];
+        } else if (strcmp(a, "--ring-send") == 0 && i + 1 < argc) {
+            opts.ring_send = argv[++i];
+        } else if (strcmp(a, "--explore") == 0 && i + 1 < argc) {
+            explore_spec = argv[++i];
+        } else if (strcmp(a, "--explore-out") == 0 && i + 1 < argc) {
+            opts.explore_out = argv[++i];
+        } else if (strcmp(a, "--dir") == 0 && i + 1 < argc) {
+            dir_pattern = argv[++i];
+        } else if (strcmp(a, "--io") == 0 && i + 1 < argc) {
+            const char *io = argv[++i];
+            if (strcmp(io, "uring") == 0) opts.io_backend = FILE_BATCH_URING;
+            else if (strcmp(io, "pread") == 0) opts.io_backend = FILE_BATCH_THREADS;
+            else {
+                fprintf(stderr, "Errore: valore non valido per '--io'.\n");
+                return 2;
+            }
+        } else if (strcmp(a, "--listen") == 0 && i + 1 < argc) {
+            listen_addr = argv[++i];
+        } else if (strcmp(a, "--upstream") == 0 && i + 1 < argc) {
+            upstream = argv[++i];
+        } else if (strcmp(a, "--watch") == 0) {
+            watch = 1;
+        } else if (strcmp(a, "--emit-c") == 0 && i + 1 < argc) {
+            opts.emit_c = argv[++i];
+        } else if (strcmp(a, "--emit-name") == 0 && i + 1 < argc) {
+            opts.emit_name = argv[++i];
+        } else if (strcmp(a, "--encoding") == 0 && i + 1 < argc) {
+            const char *enc = argv[++i];
+            if (!content_encoding_parse(enc, strlen(enc), &opts.encoding)) {
+                fprintf(stderr, "Errore: valore non valido per '--encoding'.\n");
+                return 2;
+            }
+        } else if (strcmp(a, "--prune-spec") == 0) {
+            opts.prune_spec = 1;
+        } else if (strcmp(a, "--lazy-spec") == 0) {
+            opts.lazy_spec = 1;
+        } else if (strcmp(a, "--memory-stats") == 0) {
+            opts.memory_stats = 1;
+        } else if (strcmp(a, "--memo") == 0) {
+            opts.memo = 1;
+        } else if (strcmp(a, "--adaptive-order") == 0) {
+            opts.adaptive_order = 1;
+        } else if (strcmp(a, "--profile") == 0) {
+            profiling = 1;
+        } else if (strcmp(a, "--profile-schemas") == 0) {
+            profiling = 2;
+        } else if (strcmp(a, "--profile-trace") == 0 && i + 1 < argc) {
+            if (!profiling) profiling = 1;
+            opts.profile_trace = argv[++i];
+        } else if (strcmp(a, "--max-bytes") == 0 || strcmp(a, "--max-depth") == 0 ||
+                   strcmp(a, "--max-elements") == 0 || strcmp(a, "--io-depth") == 0 ||
+                   strcmp(a, "--spec-budget") == 0 || strcmp(a, "--result-cache") == 0 ||
+                   strcmp(a, "--parallel") == 0 || strcmp(a, "--parallel-items") == 0 ||
+                   strcmp(a, "--max-inflated") == 0 || strcmp(a, "--explore-seconds") == 0 ||
+                   strcmp(a, "--explore-limit") == 0 || strcmp(a, "--max-request-memory") == 0 ||
+                   strcmp(a, "--max-request-ms") == 0 || strcmp(a, "--max-request-steps") == 0 ||
+                   strcmp(a, "--ring-slots") == 0 || strcmp(a, "--ring-slot-size") == 0) {
+            char *end = NULL;
+            unsigned long long v = (i + 1 < argc) ? strtoull(argv[i + 1], &end, 10) : 0;
+            if (i + 1 >= argc || !end || *end != '\0' || argv[i + 1][0] == '-') {
+                fprintf(stderr, "Errore: valore non valido per '%s'.\n", a);
+                return 2;
+            }
+            ++i;
+            if (strcmp(a, "--max-bytes") == 0) opts.limits.max_bytes = (size_t)v;
+            else if (strcmp(a, "--max-depth") == 0) opts.limits.max_depth = (size_t)v;
+            else if (strcmp(a, "--result-cache") == 0) cache_size = (size_t)v;
+            else if (strcmp(a, "--parallel") == 0) parallel = v > 256 ? 256u : (unsigned)v;
+            else if (strcmp(a, "--parallel-items") == 0) opts.parallel_items = (size_t)v;
+            else if (strcmp(a, "--max-inflated") == 0) opts.max_inflated = (size_t)v;
+            else if (strcmp(a, "--spec-budget") == 0) opts.spec_budget = (size_t)v * 1024 * 1024;
+            else if (strcmp(a, "--max-request-memory") == 0) max_request_memory = (size_t)v;
+            else if (strcmp(a, "--max-request-ms") == 0) max_request_ms = v;
+            else if (strcmp(a, "--max-request-steps") == 0) max_request_steps = v;
+            else if (strcmp(a, "--ring-slots") == 0) opts.ring_slots = v > SHM_RING_MAX_SLOTS ? SHM_RING_MAX_SLOTS : (size_t)v;
+            else if (strcmp(a, "--ring-slot-size") == 0) opts.ring_slot_size = (size_t)v;
+            else if (strcmp(a, "--explore-seconds") == 0) opts.explore_seconds = v > 86400 ? 86400u : (unsigned)v;
+            else if (strcmp(a, "--explore-limit") == 0) opts.explore_limit_ms = v > 3600000 ? 3600000u : (unsigned)v;
+            else if (strcmp(a, "--io-depth") == 0) opts.io_depth = v > 4096 ? 4096u : (unsigned)v;
+            else opts.limits.max_elements = (size_t)v;
+        } else if (strncmp(a, "--", 2) == 0) {
+            fprintf(stderr, "Errore: opzione sconosciuta '%s'.\n", a);
+            print_usage(argv[0]);
+            return 2;
+        } else if (npos < 5) {
+            pos[npos++] = a;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (cache_size > 0) {
+        opts.cache = result_cache_create(cache_size, 0);
+        if (!opts.cache) {
+            fprintf(stderr, "Errore: memoria insufficiente per la cache degli esiti.\n");
+            return 8;
+        }
+    }
+    if (profiling) {
+        opts.profile = profile_create(profiling == 2);
+        if (!opts.profile) {
+            fprintf(stderr, "Errore: memoria insufficiente per il profilo.\n");
+            result_cache_free(opts.cache);
+            return 8;
+        }
+    }
+    if (parallel > 0) {
+        opts.pool = work_pool_create(parallel);
+        if (!opts.pool) {
+            fprintf(stderr, "Errore: impossibile avviare i thread per --parallel.\n");
+            profile_free(opts.profile);
+            result_cache_free(opts.cache);
+            return 8;
+        }
+    }
+    if (opts.memory_stats || max_request_memory) {
+        opts.memory = mem_account_create(max_request_memory);
+        if (!opts.memory) {
+            fprintf(stderr, "Errore: memoria insufficiente.\n");
+            work_pool_free(opts.pool);
+            profile_free(opts.profile);
+            result_cache_free(opts.cache);
+            return 8;
+        }
+        // anche i nodi cJSON (body YAML) sono a carico della richiesta
+        cJSON_Hooks hooks = {mem_malloc, mem_free};
+        cJSON_InitHooks(&hooks);
+    }
+    if (max_request_ms || max_request_steps) {
+        opts.budget = req_budget_create(max_request_ms / 1000.0, max_request_steps);
+        if (!opts.budget) {
+            fprintf(stderr, "Errore: memoria insufficiente.\n");
+            mem_account_free(opts.memory);
+            work_pool_free(opts.pool);
+            profile_free(opts.profile);
+            result_cache_free(opts.cache);
+            return 8;
+        }
+    }
+    int code = run_mode(argv[0], &opts, registry_list, dir_pattern, serve_spec, proxy_spec, explore_spec,
+                        listen_addr, upstream, watch, pos, npos);
+    req_budget_free(opts.budget);
+    mem_account_free(opts.memory);
+    work_pool_free(opts.pool);
+    profile_free(opts.profile);
+    result_cache_free(opts.cache);
+    return code;
 }
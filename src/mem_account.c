@@ -0,0 +1,308 @@
+#include "mem_account.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#define MEM_BLOCK_SIZE(p) _msize(p)
+#define MEM_THREAD_LOCAL __declspec(thread)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define MEM_BLOCK_SIZE(p) malloc_size(p)
+#define MEM_THREAD_LOCAL _Thread_local
+#else
+#include <malloc.h>
+#define MEM_BLOCK_SIZE(p) malloc_usable_size(p)
+#define MEM_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct mem_phase
+{
+  const char *name;
+  mem_stats stats;
+} mem_phase;
+
+struct mem_account
+{
+  size_t limit;
+  atomic_size_t allocated;
+  atomic_size_t allocations;
+  // con segno: un blocco allocato prima della richiesta e liberato durante
+  // la porta temporaneamente sotto zero
+  atomic_llong live;
+  atomic_llong peak;
+  atomic_llong phase_peak;
+  atomic_bool exceeded;
+  mem_phase phases[MEM_ACCOUNT_MAX_PHASES];
+  size_t phase_count;
+  mem_phase *open;        // fase in corso, NULL se nessuna
+  size_t open_allocated;  // contatori all'apertura della fase
+  size_t open_allocations;
+};
+
+static MEM_THREAD_LOCAL mem_account *current_account;
+
+mem_account *mem_account_create(size_t limit)
+{
+  mem_account *a = (mem_account *)calloc(1, sizeof(mem_account));
+  if (!a)
+    return NULL;
+  a->limit = limit;
+  mem_account_reset(a);
+  return a;
+}
+
+void mem_account_free(mem_account *a)
+{
+  if (a && current_account == a)
+    current_account = NULL;
+  free(a);
+}
+
+size_t mem_account_limit(const mem_account *a)
+{
+  return a ? a->limit : 0;
+}
+
+void mem_account_reset(mem_account *a)
+{
+  if (!a)
+    return;
+  atomic_store(&a->allocated, 0);
+  atomic_store(&a->allocations, 0);
+  atomic_store(&a->live, 0);
+  atomic_store(&a->peak, 0);
+  atomic_store(&a->phase_peak, 0);
+  atomic_store(&a->exceeded, false);
+  a->phase_count = 0;
+  a->open = NULL;
+}
+
+mem_account *mem_account_enter(mem_account *a)
+{
+  mem_account *prev = current_account;
+  current_account = a;
+  return prev;
+}
+
+mem_account *mem_account_current(void)
+{
+  return current_account;
+}
+
+static void raise_to(atomic_llong *v, long long x)
+{
+  long long cur = atomic_load_explicit(v, memory_order_relaxed);
+  while (cur < x && !atomic_compare_exchange_weak_explicit(v, &cur, x, memory_order_relaxed, memory_order_relaxed))
+  {
+  }
+}
+
+static size_t clamp(long long v)
+{
+  return v > 0 ? (size_t)v : 0;
+}
+
+// Prenota `size` byte prima dell'allocazione: false (e account superato) se
+// i byte vivi andrebbero oltre il limite.
+static bool reserve(mem_account *a, size_t size)
+{
+  long long live = atomic_fetch_add_explicit(&a->live, (long long)size, memory_order_relaxed) + (long long)size;
+  if (a->limit && (size > a->limit || live > (long long)a->limit))
+  {
+    atomic_fetch_sub_explicit(&a->live, (long long)size, memory_order_relaxed);
+    atomic_store(&a->exceeded, true);
+    return false;
+  }
+  return true;
+}
+
+// Registra un blocco di `block` byte allocato al posto dei `reserved`
+// prenotati e di `released` byte liberati (realloc).
+static void settle(mem_account *a, size_t reserved, size_t block, size_t released)
+{
+  long long delta = (long long)block - (long long)reserved - (long long)released;
+  long long live = atomic_fetch_add_explicit(&a->live, delta, memory_order_relaxed) + delta;
+  atomic_fetch_add_explicit(&a->allocated, block, memory_order_relaxed);
+  atomic_fetch_add_explicit(&a->allocations, 1, memory_order_relaxed);
+  raise_to(&a->peak, live);
+  raise_to(&a->phase_peak, live);
+}
+
+static void unreserve(mem_account *a, size_t size)
+{
+  atomic_fetch_sub_explicit(&a->live, (long long)size, memory_order_relaxed);
+}
+
+void *mem_malloc(size_t size)
+{
+  mem_account *a = current_account;
+  if (!a)
+    return malloc(size);
+  if (!reserve(a, size))
+    return NULL;
+  void *p = malloc(size);
+  if (!p)
+  {
+    unreserve(a, size);
+    return NULL;
+  }
+  settle(a, size, MEM_BLOCK_SIZE(p), 0);
+  return p;
+}
+
+void *mem_calloc(size_t count, size_t size)
+{
+  if (size && count > SIZE_MAX / size)
+    return NULL;
+  void *p = mem_malloc(count * size);
+  if (p)
+    memset(p, 0, count * size);
+  return p;
+}
+
+void *mem_realloc(void *p, size_t size)
+{
+  mem_account *a = current_account;
+  if (!a)
+    return realloc(p, size);
+  if (!p)
+    return mem_malloc(size);
+  size_t old = MEM_BLOCK_SIZE(p);
+  // il blocco precedente resta vivo fino al termine della realloc
+  if (!reserve(a, size))
+    return NULL;
+  void *np = realloc(p, size);
+  if (!np)
+  {
+    unreserve(a, size);
+    return NULL;
+  }
+  settle(a, size, MEM_BLOCK_SIZE(np), old);
+  return np;
+}
+
+void mem_free(void *p)
+{
+  mem_account *a = current_account;
+  if (a && p)
+    atomic_fetch_sub_explicit(&a->live, (long long)MEM_BLOCK_SIZE(p), memory_order_relaxed);
+  free(p);
+}
+
+char *mem_strdup(const char *s)
+{
+  size_t len = strlen(s) + 1;
+  char *out = (char *)mem_malloc(len);
+  if (out)
+    memcpy(out, s, len);
+  return out;
+}
+
+static void close_phase(mem_account *a)
+{
+  mem_phase *ph = a->open;
+  if (!ph)
+    return;
+  size_t allocated = atomic_load(&a->allocated) - a->open_allocated;
+  size_t allocations = atomic_load(&a->allocations) - a->open_allocations;
+  size_t peak = clamp(atomic_load(&a->phase_peak));
+  ph->stats.allocated += allocated;
+  ph->stats.allocations += allocations;
+  if (peak > ph->stats.peak)
+    ph->stats.peak = peak;
+  ph->stats.live = clamp(atomic_load(&a->live));
+  a->open = NULL;
+}
+
+void mem_account_phase(mem_account *a, const char *name)
+{
+  if (!a)
+    return;
+  close_phase(a);
+  if (!name)
+    return;
+  mem_phase *ph = NULL;
+  for (size_t i = 0; i < a->phase_count && !ph; ++i)
+  {
+    if (strcmp(a->phases[i].name, name) == 0)
+      ph = &a->phases[i];
+  }
+  if (!ph)
+  {
+    if (a->phase_count == MEM_ACCOUNT_MAX_PHASES)
+      ph = &a->phases[a->phase_count - 1];
+    else
+    {
+      ph = &a->phases[a->phase_count++];
+      memset(ph, 0, sizeof(*ph));
+      ph->name = name;
+    }
+  }
+  a->open = ph;
+  a->open_allocated = atomic_load(&a->allocated);
+  a->open_allocations = atomic_load(&a->allocations);
+  atomic_store(&a->phase_peak, atomic_load(&a->live));
+}
+
+mem_stats mem_account_stats(const mem_account *a)
+{
+  mem_stats s = {0, 0, 0, 0};
+  if (!a)
+    return s;
+  mem_account *m = (mem_account *)a;
+  s.allocated = atomic_load(&m->allocated);
+  s.allocations = atomic_load(&m->allocations);
+  s.peak = clamp(atomic_load(&m->peak));
+  s.live = clamp(atomic_load(&m->live));
+  return s;
+}
+
+bool mem_account_exceeded(const mem_account *a)
+{
+  return a && atomic_load(&((mem_account *)a)->exceeded);
+}
+
+size_t mem_account_phase_count(const mem_account *a)
+{
+  return a ? a->phase_count : 0;
+}
+
+const char *mem_account_phase_stats(const mem_account *a, size_t i, mem_stats *out)
+{
+  if (!a || i >= a->phase_count)
+    return NULL;
+  *out = a->phases[i].stats;
+  // la fase in corso riporta i valori fino a questo momento
+  if (a->open == &a->phases[i])
+  {
+    mem_account *m = (mem_account *)a;
+    out->allocated += atomic_load(&m->allocated) - a->open_allocated;
+    out->allocations += atomic_load(&m->allocations) - a->open_allocations;
+    size_t peak = clamp(atomic_load(&m->phase_peak));
+    if (peak > out->peak)
+      out->peak = peak;
+    out->live = clamp(atomic_load(&m->live));
+  }
+  return a->phases[i].name;
+}
+
+void mem_account_print(const mem_account *a, FILE *f)
+{
+  if (!a)
+    return;
+  fprintf(f, "%-44s %12s %12s %12s %12s\n", "MEMORIA (KiB)", "allocazioni", "allocati", "picco", "vivi");
+  for (size_t i = 0; i < a->phase_count; ++i)
+  {
+    mem_stats s;
+    const char *name = mem_account_phase_stats(a, i, &s);
+    fprintf(f, "%-44s %12zu %12.1f %12.1f %12.1f\n", name, s.allocations, s.allocated / 1024.0, s.peak / 1024.0,
+            s.live / 1024.0);
+  }
+  mem_stats t = mem_account_stats(a);
+  fprintf(f, "%-44s %12zu %12.1f %12.1f %12.1f\n", "richiesta", t.allocations, t.allocated / 1024.0,
+          t.peak / 1024.0, t.live / 1024.0);
+  if (mem_account_exceeded(a))
+    fprintf(f, "(limite di %zu byte superato)\n", a->limit);
+}
@@ -1,7 +1,53 @@
 #include "oas_extract.h"
+#include "ptrmap.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
+// Stato della potatura (oas_prune): i nodi da conservare con la loro marca e
+// gli schemi di cui seguire ancora i $ref.
+typedef struct
+{
+  ptrmap marks;
+  cJSON **work;
+  size_t work_count, work_cap;
+  bool ok;
+} prune_state;
+
+// Marche dei nodi: PRUNE_PATH conserva il nodo come contenitore di altri
+// nodi marcati (i figli non marcati vengono eliminati), PRUNE_KEEP conserva
+// il sottoalbero di uno schema raggiunto.
+#define PRUNE_PATH 1
+#define PRUNE_KEEP 2
+
+static void prune_mark(prune_state *ps, cJSON *node, uintptr_t mark)
+{
+  if (!ps || !node || !ps->ok)
+    return;
+  if ((uintptr_t)ptrmap_get(&ps->marks, node) >= mark)
+    return;
+  if (!ptrmap_put(&ps->marks, node, (void *)mark))
+  {
+    ps->ok = false;
+    return;
+  }
+  if (mark != PRUNE_KEEP)
+    return;
+  if (ps->work_count == ps->work_cap)
+  {
+    size_t ncap = ps->work_cap ? ps->work_cap * 2 : 64;
+    cJSON **nw = (cJSON **)realloc(ps->work, ncap * sizeof(cJSON *));
+    if (!nw)
+    {
+      ps->ok = false;
+      return;
+    }
+    ps->work = nw;
+    ps->work_cap = ncap;
+  }
+  ps->work[ps->work_count++] = node;
+}
+
 // Cerca il primo schema JSON all'interno della sezione "content" di un requestBody.
 // Restituisce il nodo schema o NULL se assente/non valido.
 static cJSON *first_schema_in_content(cJSON *content)
@@ -34,7 +80,9 @@ static void json_pointer_unescape(char *token)
   *dst = '\0';
 }
 
-static cJSON *resolve_ref(cJSON *oas_root, const char *ref)
+// Risolve un $ref interno (#/...) come jsval_resolve_ref. Con `ps` i nodi
+// attraversati vengono marcati come contenitori da conservare.
+static cJSON *resolve_ref(cJSON *oas_root, const char *ref, prune_state *ps)
 {
   if (!cJSON_IsObject(oas_root) || !ref)
     return NULL;
@@ -58,13 +106,19 @@ static cJSON *resolve_ref(cJSON *oas_root, const char *ref)
 
     json_pointer_unescape(token);
 
-    if (!cJSON_IsObject(current))
+    prune_mark(ps, current, PRUNE_PATH);
+    cJSON *next = NULL;
+    if (cJSON_IsArray(current))
     {
-      free(buffer);
-      return NULL;
+      char *end = NULL;
+      long idx = strtol(token, &end, 10);
+      if (*token && *end == '\0' && idx >= 0)
+        next = cJSON_GetArrayItem(current, (int)idx);
+    }
+    else if (cJSON_IsObject(current))
+    {
+      next = cJSON_GetObjectItemCaseSensitive(current, token);
     }
-
-    cJSON *next = cJSON_GetObjectItemCaseSensitive(current, token);
     if (!next)
     {
       free(buffer);
@@ -124,44 +178,260 @@ cJSON *oas_first_request_body_schema(cJSON *oas_root)
   return NULL;
 }
 
-cJSON *oas_request_body_schema(cJSON *oas_root, const char *http_method, const char *endpoint_path)
+bool oas_path_matches_template(const char *tmpl, const char *path)
 {
-  if (!cJSON_IsObject(oas_root) || !http_method || !endpoint_path)
-    return NULL;
-
-  cJSON *paths = cJSON_GetObjectItemCaseSensitive(oas_root, "paths");
-  if (!cJSON_IsObject(paths))
-    return NULL;
-
-  cJSON *path_item = cJSON_GetObjectItemCaseSensitive(paths, endpoint_path);
-  if (!cJSON_IsObject(path_item))
-    return NULL;
+  while (*tmpl && *path)
+  {
+    if (*tmpl == '{')
+    {
+      const char *close = strchr(tmpl, '}');
+      if (!close || *path == '/')
+        return false;
+      tmpl = close + 1;
+      while (*path && *path != '/' && *path != *tmpl)
+        ++path;
+      continue;
+    }
+    if (*tmpl != *path)
+      return false;
+    ++tmpl;
+    ++path;
+  }
+  return *tmpl == '\0' && *path == '\0';
+}
 
-  cJSON *operation = cJSON_GetObjectItemCaseSensitive(path_item, http_method);
-  if (!cJSON_IsObject(operation))
-    return NULL;
+// Path item per `endpoint_path`: prima la chiave esatta, poi il primo
+// template compatibile.
+static cJSON *find_path_item(cJSON *paths, const char *endpoint_path)
+{
+  cJSON *item = cJSON_GetObjectItemCaseSensitive(paths, endpoint_path);
+  if (cJSON_IsObject(item))
+    return item;
+  cJSON_ArrayForEach(item, paths)
+  {
+    if (item->string && strchr(item->string, '{') && cJSON_IsObject(item) &&
+        oas_path_matches_template(item->string, endpoint_path))
+      return item;
+  }
+  return NULL;
+}
 
+// Schema del requestBody application/json di `operation`, diretto o
+// tramite $ref; con `ps` i nodi attraversati vengono marcati come
+// contenitori da conservare.
+static cJSON *operation_body_schema(cJSON *oas_root, cJSON *operation, prune_state *ps)
+{
   cJSON *request_body = cJSON_GetObjectItemCaseSensitive(operation, "requestBody");
   if (!cJSON_IsObject(request_body))
     return NULL;
+  prune_mark(ps, operation, PRUNE_PATH);
 
   cJSON *content = cJSON_GetObjectItemCaseSensitive(request_body, "content");
   if (cJSON_IsObject(content))
   {
+    prune_mark(ps, request_body, PRUNE_PATH);
+    prune_mark(ps, content, PRUNE_PATH);
+    prune_mark(ps, cJSON_GetObjectItemCaseSensitive(content, "application/json"), PRUNE_PATH);
     return first_schema_in_content(content);
   }
 
   cJSON *ref = cJSON_GetObjectItemCaseSensitive(request_body, "$ref");
   if (cJSON_IsString(ref))
   {
-    cJSON *resolved = resolve_ref(oas_root, ref->valuestring);
+    prune_mark(ps, request_body, PRUNE_PATH);
+    prune_mark(ps, ref, PRUNE_PATH);
+    cJSON *resolved = resolve_ref(oas_root, ref->valuestring, ps);
     if (cJSON_IsObject(resolved))
     {
       cJSON *resolved_content = cJSON_GetObjectItemCaseSensitive(resolved, "content");
       if (cJSON_IsObject(resolved_content))
+      {
+        prune_mark(ps, resolved, PRUNE_PATH);
+        prune_mark(ps, resolved_content, PRUNE_PATH);
+        prune_mark(ps, cJSON_GetObjectItemCaseSensitive(resolved_content, "application/json"), PRUNE_PATH);
         return first_schema_in_content(resolved_content);
+      }
     }
   }
-
   return NULL;
 }
+
+cJSON *oas_request_body_schema(cJSON *oas_root, const char *http_method, const char *endpoint_path)
+{
+  if (!cJSON_IsObject(oas_root) || !http_method || !endpoint_path)
+    return NULL;
+
+  cJSON *paths = cJSON_GetObjectItemCaseSensitive(oas_root, "paths");
+  if (!cJSON_IsObject(paths))
+    return NULL;
+
+  cJSON *path_item = find_path_item(paths, endpoint_path);
+  if (!path_item)
+    return NULL;
+
+  cJSON *operation = cJSON_GetObjectItemCaseSensitive(path_item, http_method);
+  if (!cJSON_IsObject(operation))
+    return NULL;
+
+  return operation_body_schema(oas_root, operation, NULL);
+}
+
+// Parole chiave degli schemi che il validatore non legge e che non
+// contengono sotto-schemi da validare.
+static bool is_annotation(const char *key)
+{
+  static const char *const names[] = {"description", "title",      "example",  "examples",  "externalDocs",
+                                      "xml",         "deprecated", "$comment", "default",   "readOnly",
+                                      "writeOnly",   "discriminator"};
+  if (strncmp(key, "x-", 2) == 0)
+    return true;
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    if (strcmp(key, names[i]) == 0)
+      return true;
+  return false;
+}
+
+static size_t count_nodes(const cJSON *node)
+{
+  size_t n = 1;
+  for (const cJSON *c = node->child; c; c = c->next)
+    n += count_nodes(c);
+  return n;
+}
+
+// Elimina `child` da `parent` e ne restituisce i nodi.
+static size_t drop_child(cJSON *parent, cJSON *child)
+{
+  size_t n = count_nodes(child);
+  cJSON_Delete(cJSON_DetachItemViaPointer(parent, child));
+  return n;
+}
+
+// Segue i $ref presenti nel sottoalbero di uno schema conservato.
+static void follow_refs(prune_state *ps, cJSON *root, const cJSON *node)
+{
+  for (cJSON *c = node->child; c && ps->ok; c = c->next)
+  {
+    if (cJSON_IsString(c) && c->string && strcmp(c->string, "$ref") == 0)
+      prune_mark(ps, resolve_ref(root, c->valuestring, ps), PRUNE_KEEP);
+    else if (c->child)
+      follow_refs(ps, root, c);
+  }
+}
+
+static size_t strip_schema(prune_state *ps, cJSON *schema);
+
+// Applica strip_schema a ogni sotto-schema di un oggetto o array.
+static size_t strip_each(prune_state *ps, cJSON *container)
+{
+  size_t n = 0;
+  if (cJSON_IsObject(container) || cJSON_IsArray(container))
+    for (cJSON *c = container->child; c; c = c->next)
+      n += strip_schema(ps, c);
+  return n;
+}
+
+// Toglie le annotazioni da uno schema conservato e dai suoi sotto-schemi.
+// I nodi marcati (target di $ref, anche dentro un'annotazione) restano.
+static size_t strip_schema(prune_state *ps, cJSON *schema)
+{
+  if (!cJSON_IsObject(schema))
+    return 0;
+  size_t n = 0;
+  cJSON *c = schema->child;
+  while (c)
+  {
+    cJSON *next = c->next;
+    const char *k = c->string ? c->string : "";
+    if (is_annotation(k) && !ptrmap_get(&ps->marks, c))
+      n += drop_child(schema, c);
+    else if (strcmp(k, "properties") == 0 || strcmp(k, "patternProperties") == 0 ||
+             strcmp(k, "allOf") == 0 || strcmp(k, "anyOf") == 0 || strcmp(k, "oneOf") == 0 ||
+             strcmp(k, "prefixItems") == 0 || strcmp(k, "$defs") == 0 || strcmp(k, "definitions") == 0)
+      n += strip_each(ps, c);
+    else if (strcmp(k, "items") == 0)
+      n += cJSON_IsArray(c) ? strip_each(ps, c) : strip_schema(ps, c);
+    else if (strcmp(k, "additionalProperties") == 0 || strcmp(k, "not") == 0 ||
+             strcmp(k, "additionalItems") == 0 || strcmp(k, "contains") == 0 ||
+             strcmp(k, "propertyNames") == 0)
+      n += strip_schema(ps, c);
+    c = next;
+  }
+  return n;
+}
+
+// Elimina i figli non marcati di un contenitore conservato.
+static size_t sweep(prune_state *ps, cJSON *node)
+{
+  size_t n = 0;
+  cJSON *c = node->child;
+  while (c)
+  {
+    cJSON *next = c->next;
+    uintptr_t mark = (uintptr_t)ptrmap_get(&ps->marks, c);
+    if (mark == PRUNE_KEEP)
+      n += strip_schema(ps, c);
+    else if (mark == PRUNE_PATH)
+      n += sweep(ps, c);
+    else
+      n += drop_child(node, c);
+    c = next;
+  }
+  return n;
+}
+
+bool oas_prune(cJSON *oas_root, const char *http_method, const char *endpoint_path, size_t *removed)
+{
+  if (removed)
+    *removed = 0;
+  if (!cJSON_IsObject(oas_root))
+    return true;
+  prune_state ps = {0};
+  ps.ok = ptrmap_init(&ps.marks, 1024);
+  prune_mark(&ps, oas_root, PRUNE_PATH);
+  prune_mark(&ps, cJSON_GetObjectItemCaseSensitive(oas_root, "openapi"), PRUNE_PATH);
+  cJSON *paths = cJSON_GetObjectItemCaseSensitive(oas_root, "paths");
+  if (cJSON_IsObject(paths))
+  {
+    prune_mark(&ps, paths, PRUNE_PATH);
+    cJSON *path_item = NULL;
+    cJSON_ArrayForEach(path_item, paths)
+    {
+      prune_mark(&ps, path_item, PRUNE_PATH);
+    }
+    if (http_method && endpoint_path)
+    {
+      cJSON *item = find_path_item(paths, endpoint_path);
+      cJSON *operation = item ? cJSON_GetObjectItemCaseSensitive(item, http_method) : NULL;
+      if (cJSON_IsObject(operation))
+        prune_mark(&ps, operation_body_schema(oas_root, operation, &ps), PRUNE_KEEP);
+    }
+    else
+    {
+      cJSON_ArrayForEach(path_item, paths)
+      {
+        cJSON *operation = NULL;
+        cJSON_ArrayForEach(operation, path_item)
+        {
+          if (cJSON_IsObject(operation))
+            prune_mark(&ps, operation_body_schema(oas_root, operation, &ps), PRUNE_KEEP);
+        }
+      }
+    }
+  }
+
+  // chiusura dei $ref: ogni schema conservato può aggiungerne altri
+  for (size_t i = 0; ps.ok && i < ps.work_count; ++i)
+    follow_refs(&ps, oas_root, ps.work[i]);
+
+  bool ok = ps.ok;
+  if (ok)
+  {
+    size_t n = sweep(&ps, oas_root);
+    if (removed)
+      *removed = n;
+  }
+  ptrmap_free(&ps.marks);
+  free(ps.work);
+  return ok;
+}
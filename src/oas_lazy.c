@@ -0,0 +1,724 @@
+#if defined(__linux__)
+#define _DEFAULT_SOURCE
+#endif
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "oas_lazy.h"
+#include "fileutil.h"
+#include "oas_extract.h"
+#include "ptrmap.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Indice assente (nessun figlio o fratello); gli offset sono a 32 bit.
+#define LAZY_NONE UINT32_MAX
+
+// Contenitore indicizzato: da `start` (parentesi di apertura) a `end`
+// (dopo quella di chiusura), primo contenitore figlio e contenitore
+// fratello successivo. I valori scalari non sono indicizzati: si trovano
+// scorrendo il testo del genitore e saltando i contenitori figli.
+typedef struct
+{
+  uint32_t start, end;
+  uint32_t first_child, next;
+} lazy_node;
+
+struct oas_lazy
+{
+  const char *text;
+  size_t len;
+  bool mapped; // altrimenti `text` è un buffer da liberare
+  lazy_node *nodes; // nodes[0] è la radice
+  size_t node_count;
+  cJSON *root;
+  ptrmap skeletons; // nodo scheletro del DOM -> indice del contenitore + 1
+  oas_lazy_status error;
+};
+
+// Membro di un contenitore: la chiave (senza virgolette, ancora codificata,
+// solo per gli oggetti) e l'estensione del valore.
+typedef struct
+{
+  size_t key, key_len;
+  size_t value, value_end;
+  uint32_t node; // contenitore del valore, LAZY_NONE per gli scalari
+} lazy_member;
+
+typedef struct
+{
+  size_t pos;
+  uint32_t child;
+} member_iter;
+
+typedef struct
+{
+  char **items;
+  size_t count, cap;
+} ref_list;
+
+const char *oas_lazy_status_message(oas_lazy_status st)
+{
+  switch (st)
+  {
+  case OAS_LAZY_OK:
+    return "nessun errore";
+  case OAS_LAZY_NOT_JSON:
+    return "il documento non è un oggetto JSON";
+  case OAS_LAZY_IO:
+    return "lettura del file non riuscita";
+  case OAS_LAZY_BAD_JSON:
+    return "JSON non valido";
+  case OAS_LAZY_TOO_LARGE:
+    return "documento oltre 4 GiB";
+  case OAS_LAZY_NO_MEMORY:
+    return "memoria insufficiente";
+  }
+  return "errore sconosciuto";
+}
+
+static void fail(oas_lazy *lz, oas_lazy_status st)
+{
+  if (lz->error == OAS_LAZY_OK)
+    lz->error = st;
+}
+
+static char *dup_range(const char *s, size_t len)
+{
+  char *out = (char *)malloc(len + 1);
+  if (!out)
+    return NULL;
+  memcpy(out, s, len);
+  out[len] = '\0';
+  return out;
+}
+
+static oas_lazy_status map_file(oas_lazy *lz, const char *path)
+{
+#if !defined(_WIN32)
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return OAS_LAZY_IO;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+  {
+    if ((unsigned long long)st.st_size >= LAZY_NONE)
+    {
+      close(fd);
+      return OAS_LAZY_TOO_LARGE;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED)
+    {
+      close(fd);
+      lz->text = (const char *)p;
+      lz->len = (size_t)st.st_size;
+      lz->mapped = true;
+      return OAS_LAZY_OK;
+    }
+  }
+  close(fd);
+#endif
+  // Pipe, file vuoti o mappatura non disponibile: lettura completa.
+  size_t len = 0;
+  char *buf = read_entire_file(path, &len);
+  if (!buf)
+    return OAS_LAZY_IO;
+  lz->text = buf;
+  lz->len = len;
+  return len >= LAZY_NONE ? OAS_LAZY_TOO_LARGE : OAS_LAZY_OK;
+}
+
+static size_t skip_ws(const char *t, size_t p, size_t len)
+{
+  while (p < len && (t[p] == ' ' || t[p] == '\t' || t[p] == '\r' || t[p] == '\n'))
+    ++p;
+  return p;
+}
+
+// `*p` è sulle virgolette di apertura; in caso di successo passa dopo quelle
+// di chiusura. Le virgolette precedute da un numero dispari di backslash
+// fanno parte della stringa.
+static bool skip_string(const char *t, size_t len, size_t *p)
+{
+  size_t i = *p + 1;
+  for (;;)
+  {
+    const char *q = (const char *)memchr(t + i, '"', len - i);
+    if (!q)
+      return false;
+    size_t k = (size_t)(q - t), bs = 0;
+    while (k - bs > *p + 1 && t[k - bs - 1] == '\\')
+      ++bs;
+    if (bs % 2 == 0)
+    {
+      *p = k + 1;
+      return true;
+    }
+    i = k + 1;
+  }
+}
+
+typedef struct
+{
+  uint32_t node, last_child;
+} scan_frame;
+
+// Una sola scansione del testo: registra estensione e collegamenti di ogni
+// contenitore. Verifica solo l'appaiamento delle parentesi e che il
+// documento sia un unico oggetto; il resto della sintassi viene verificato
+// da cJSON quando una parte viene materializzata.
+static oas_lazy_status build_index(oas_lazy *lz)
+{
+  const char *t = lz->text;
+  size_t len = lz->len;
+  size_t p = skip_ws(t, 0, len);
+  if (p >= len || t[p] != '{')
+    return OAS_LAZY_NOT_JSON;
+
+  size_t cap = len / 64 + 16, depth = 0, stack_cap = 64;
+  lz->nodes = (lazy_node *)malloc(cap * sizeof(lazy_node));
+  scan_frame *stack = (scan_frame *)malloc(stack_cap * sizeof(scan_frame));
+  if (!lz->nodes || !stack)
+  {
+    free(stack);
+    return OAS_LAZY_NO_MEMORY;
+  }
+
+  oas_lazy_status st = OAS_LAZY_OK;
+  while (p < len)
+  {
+    char c = t[p];
+    if (c == '"')
+    {
+      if (depth == 0 || !skip_string(t, len, &p))
+      {
+        st = OAS_LAZY_BAD_JSON;
+        break;
+      }
+      continue;
+    }
+    if (c == '{' || c == '[')
+    {
+      if (depth == 0 && lz->node_count > 0)
+      {
+        st = OAS_LAZY_BAD_JSON;
+        break;
+      }
+      if (lz->node_count == cap || depth == stack_cap)
+      {
+        size_t ncap = lz->node_count == cap ? cap * 2 : cap;
+        size_t nstack = depth == stack_cap ? stack_cap * 2 : stack_cap;
+        lazy_node *nn = (lazy_node *)realloc(lz->nodes, ncap * sizeof(lazy_node));
+        if (nn)
+          lz->nodes = nn;
+        scan_frame *ns = nn ? (scan_frame *)realloc(stack, nstack * sizeof(scan_frame)) : NULL;
+        if (!nn || !ns)
+        {
+          st = OAS_LAZY_NO_MEMORY;
+          break;
+        }
+        stack = ns;
+        cap = ncap;
+        stack_cap = nstack;
+      }
+      uint32_t n = (uint32_t)lz->node_count++;
+      lz->nodes[n] = (lazy_node){(uint32_t)p, 0, LAZY_NONE, LAZY_NONE};
+      if (depth > 0)
+      {
+        scan_frame *parent = &stack[depth - 1];
+        if (parent->last_child == LAZY_NONE)
+          lz->nodes[parent->node].first_child = n;
+        else
+          lz->nodes[parent->last_child].next = n;
+        parent->last_child = n;
+      }
+      stack[depth++] = (scan_frame){n, LAZY_NONE};
+    }
+    else if (c == '}' || c == ']')
+    {
+      if (depth == 0 || (t[lz->nodes[stack[depth - 1].node].start] == '{') != (c == '}'))
+      {
+        st = OAS_LAZY_BAD_JSON;
+        break;
+      }
+      lz->nodes[stack[--depth].node].end = (uint32_t)(p + 1);
+    }
+    else if (depth == 0 && c != ' ' && c != '\t' && c != '\r' && c != '\n')
+    {
+      st = OAS_LAZY_BAD_JSON;
+      break;
+    }
+    ++p;
+  }
+  if (st == OAS_LAZY_OK && depth != 0)
+    st = OAS_LAZY_BAD_JSON;
+  free(stack);
+  if (st == OAS_LAZY_OK && lz->node_count < cap)
+  {
+    lazy_node *shrunk = (lazy_node *)realloc(lz->nodes, lz->node_count * sizeof(lazy_node));
+    if (shrunk)
+      lz->nodes = shrunk;
+  }
+  return st;
+}
+
+oas_lazy_status oas_lazy_open(const char *path, oas_lazy **out)
+{
+  *out = NULL;
+  oas_lazy *lz = (oas_lazy *)calloc(1, sizeof(oas_lazy));
+  if (!lz)
+    return OAS_LAZY_NO_MEMORY;
+  oas_lazy_status st = map_file(lz, path);
+  if (st == OAS_LAZY_OK)
+    st = build_index(lz);
+  if (st == OAS_LAZY_OK)
+  {
+    lz->root = cJSON_CreateObject();
+    if (!lz->root || !ptrmap_init(&lz->skeletons, 64) || !ptrmap_put(&lz->skeletons, lz->root, (void *)(uintptr_t)1))
+      st = OAS_LAZY_NO_MEMORY;
+  }
+  if (st != OAS_LAZY_OK)
+  {
+    oas_lazy_free(lz);
+    return st;
+  }
+  *out = lz;
+  return OAS_LAZY_OK;
+}
+
+void oas_lazy_free(oas_lazy *lz)
+{
+  if (!lz)
+    return;
+#if !defined(_WIN32)
+  if (lz->mapped)
+    munmap((void *)lz->text, lz->len);
+  else
+#endif
+    free((char *)lz->text);
+  free(lz->nodes);
+  ptrmap_free(&lz->skeletons);
+  cJSON_Delete(lz->root);
+  free(lz);
+}
+
+static void members_begin(const oas_lazy *lz, uint32_t node, member_iter *it)
+{
+  it->pos = lz->nodes[node].start + 1;
+  it->child = lz->nodes[node].first_child;
+}
+
+// Membro successivo del contenitore: 1 con il membro in `*m`, 0 alla fine,
+// -1 se la struttura non è valida.
+static int members_next(const oas_lazy *lz, member_iter *it, bool object, lazy_member *m)
+{
+  const char *t = lz->text;
+  size_t len = lz->len;
+  size_t p = skip_ws(t, it->pos, len);
+  if (p >= len)
+    return -1;
+  if (t[p] == '}' || t[p] == ']')
+    return 0;
+  m->key = m->key_len = 0;
+  if (object)
+  {
+    size_t k = p;
+    if (t[p] != '"' || !skip_string(t, len, &p))
+      return -1;
+    m->key = k + 1;
+    m->key_len = p - k - 2;
+    p = skip_ws(t, p, len);
+    if (p >= len || t[p] != ':')
+      return -1;
+    p = skip_ws(t, p + 1, len);
+    if (p >= len)
+      return -1;
+  }
+  m->value = p;
+  m->node = LAZY_NONE;
+  if (t[p] == '{' || t[p] == '[')
+  {
+    if (it->child == LAZY_NONE || lz->nodes[it->child].start != p)
+      return -1;
+    m->node = it->child;
+    m->value_end = lz->nodes[it->child].end;
+    it->child = lz->nodes[it->child].next;
+  }
+  else if (t[p] == '"')
+  {
+    if (!skip_string(t, len, &p))
+      return -1;
+    m->value_end = p;
+  }
+  else
+  {
+    while (p < len && t[p] != ',' && t[p] != '}' && t[p] != ']' && t[p] != ' ' && t[p] != '\t' && t[p] != '\r' &&
+           t[p] != '\n')
+      ++p;
+    if (p == m->value)
+      return -1;
+    m->value_end = p;
+  }
+  p = skip_ws(t, m->value_end, len);
+  if (p < len && t[p] == ',')
+    ++p;
+  else if (p >= len || (t[p] != '}' && t[p] != ']'))
+    return -1;
+  it->pos = p;
+  return 1;
+}
+
+// Chiave decodificata del membro (da liberare con free); NULL se la memoria
+// non basta o la stringa non è valida.
+static char *member_key(const oas_lazy *lz, const lazy_member *m)
+{
+  const char *k = lz->text + m->key;
+  if (!memchr(k, '\\', m->key_len))
+    return dup_range(k, m->key_len);
+  cJSON *s = cJSON_ParseWithLength(k - 1, m->key_len + 2);
+  char *out = cJSON_IsString(s) ? dup_range(s->valuestring, strlen(s->valuestring)) : NULL;
+  cJSON_Delete(s);
+  return out;
+}
+
+static bool key_equals(const oas_lazy *lz, const lazy_member *m, const char *key)
+{
+  const char *k = lz->text + m->key;
+  if (!memchr(k, '\\', m->key_len))
+    return strlen(key) == m->key_len && memcmp(k, key, m->key_len) == 0;
+  char *decoded = member_key(lz, m);
+  bool eq = decoded && strcmp(decoded, key) == 0;
+  free(decoded);
+  return eq;
+}
+
+// Primo membro con chiave `key` dell'oggetto `node`, come
+// cJSON_GetObjectItemCaseSensitive: 1 trovato, 0 assente, -1 non valido.
+static int find_member(const oas_lazy *lz, uint32_t node, const char *key, lazy_member *m)
+{
+  if (lz->text[lz->nodes[node].start] != '{')
+    return 0;
+  member_iter it;
+  members_begin(lz, node, &it);
+  int r;
+  while ((r = members_next(lz, &it, true, m)) == 1)
+  {
+    if (key_equals(lz, m, key))
+      return 1;
+  }
+  return r;
+}
+
+// Interpreta per intero il valore del membro.
+static cJSON *parse_member(oas_lazy *lz, const lazy_member *m)
+{
+  const char *end = NULL;
+  cJSON *v = cJSON_ParseWithLengthOpts(lz->text + m->value, m->value_end - m->value, &end, false);
+  if (v && end != lz->text + m->value_end)
+  {
+    cJSON_Delete(v);
+    v = NULL;
+  }
+  if (!v)
+    fail(lz, OAS_LAZY_BAD_JSON);
+  return v;
+}
+
+static uint32_t skeleton_node(const oas_lazy *lz, const cJSON *item)
+{
+  uintptr_t v = (uintptr_t)ptrmap_get(&lz->skeletons, item);
+  return v ? (uint32_t)(v - 1) : LAZY_NONE;
+}
+
+// Dimentica gli scheletri del sottoalbero che sta per essere sostituito: i
+// loro indirizzi potranno essere riusati da altri nodi.
+static void forget_skeletons(oas_lazy *lz, const cJSON *item)
+{
+  if (skeleton_node(lz, item) == LAZY_NONE)
+    return;
+  ptrmap_put(&lz->skeletons, item, NULL);
+  for (const cJSON *c = item->child; c; c = c->next)
+    forget_skeletons(lz, c);
+}
+
+// Prosegue nel DOM già completo come jsval_resolve_ref.
+static cJSON *dom_lookup(cJSON *node, char **tokens, size_t count)
+{
+  for (size_t i = 0; i < count && node; ++i)
+  {
+    if (cJSON_IsArray(node))
+    {
+      char *end = NULL;
+      long idx = strtol(tokens[i], &end, 10);
+      node = (*tokens[i] && *end == '\0' && idx >= 0) ? cJSON_GetArrayItem(node, (int)idx) : NULL;
+    }
+    else
+    {
+      node = cJSON_IsObject(node) ? cJSON_GetObjectItemCaseSensitive(node, tokens[i]) : NULL;
+    }
+  }
+  return node;
+}
+
+// Materializza il valore indicato da `tokens` (già decodificati): gli
+// oggetti attraversati diventano scheletri, l'ultimo valore (o il primo
+// array o scalare incontrato) viene interpretato per intero. In `*fresh`
+// (se non NULL) il sottoalbero interpretato da questa chiamata, NULL se
+// tutto era già presente.
+static cJSON *materialize(oas_lazy *lz, char **tokens, size_t count, cJSON **fresh)
+{
+  if (fresh)
+    *fresh = NULL;
+  if (!lz->root || lz->error != OAS_LAZY_OK)
+    return NULL;
+  cJSON *node = lz->root;
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint32_t idx = skeleton_node(lz, node);
+    if (idx == LAZY_NONE)
+      return dom_lookup(node, tokens + i, count - i);
+    bool last = i + 1 == count;
+    cJSON *child = cJSON_GetObjectItemCaseSensitive(node, tokens[i]);
+    if (child && (!last || skeleton_node(lz, child) == LAZY_NONE))
+    {
+      node = child;
+      continue;
+    }
+
+    lazy_member m;
+    int found = find_member(lz, idx, tokens[i], &m);
+    if (found <= 0)
+    {
+      if (found < 0)
+        fail(lz, OAS_LAZY_BAD_JSON);
+      return NULL;
+    }
+    cJSON *value = NULL;
+    if (!last && m.node != LAZY_NONE && lz->text[m.value] == '{')
+    {
+      value = cJSON_CreateObject();
+      if (!value || !ptrmap_put(&lz->skeletons, value, (void *)(uintptr_t)(m.node + 1)))
+      {
+        cJSON_Delete(value);
+        fail(lz, OAS_LAZY_NO_MEMORY);
+        return NULL;
+      }
+    }
+    else
+    {
+      value = parse_member(lz, &m);
+      if (!value)
+        return NULL;
+      if (fresh)
+        *fresh = value;
+    }
+    // Uno scheletro richiesto per intero viene sostituito: i membri già
+    // materializzati sono compresi nel valore completo.
+    if (child)
+      forget_skeletons(lz, child);
+    if (child ? !cJSON_ReplaceItemInObjectCaseSensitive(node, tokens[i], value)
+              : !cJSON_AddItemToObject(node, tokens[i], value))
+    {
+      cJSON_Delete(value);
+      fail(lz, OAS_LAZY_NO_MEMORY);
+      return NULL;
+    }
+    node = value;
+  }
+  return node;
+}
+
+static void json_pointer_unescape(char *token)
+{
+  char *dst = token;
+  for (char *src = token; *src; ++src, ++dst)
+  {
+    if (*src == '~' && (src[1] == '0' || src[1] == '1'))
+      *dst = *++src == '0' ? '~' : '/';
+    else
+      *dst = *src;
+  }
+  *dst = '\0';
+}
+
+static cJSON *resolve_ref(oas_lazy *lz, const char *ref, cJSON **fresh)
+{
+  if (fresh)
+    *fresh = NULL;
+  if (!ref || strncmp(ref, "#/", 2) != 0)
+    return NULL;
+  char *buffer = dup_range(ref + 2, strlen(ref + 2));
+  size_t count = 1;
+  for (const char *s = ref + 2; *s; ++s)
+    count += *s == '/';
+  char **tokens = buffer ? (char **)malloc(count * sizeof(char *)) : NULL;
+  if (!tokens)
+  {
+    free(buffer);
+    fail(lz, OAS_LAZY_NO_MEMORY);
+    return NULL;
+  }
+  char *token = buffer;
+  for (size_t i = 0; i < count; ++i)
+  {
+    char *slash = strchr(token, '/');
+    if (slash)
+      *slash = '\0';
+    json_pointer_unescape(token);
+    tokens[i] = token;
+    token = slash ? slash + 1 : NULL;
+  }
+  cJSON *target = materialize(lz, tokens, count, fresh);
+  free(tokens);
+  free(buffer);
+  return target;
+}
+
+cJSON *oas_lazy_resolve(oas_lazy *lz, const char *ref)
+{
+  return resolve_ref(lz, ref, NULL);
+}
+
+// Aggiunge a `refs` una copia di ogni "$ref" del sottoalbero: le copie
+// restano valide anche se uno scheletro antenato viene sostituito.
+static bool collect_refs(ref_list *refs, const cJSON *node)
+{
+  for (const cJSON *c = node ? node->child : NULL; c; c = c->next)
+  {
+    if (c->string && cJSON_IsString(c) && strcmp(c->string, "$ref") == 0)
+    {
+      if (refs->count == refs->cap)
+      {
+        size_t ncap = refs->cap ? refs->cap * 2 : 16;
+        char **ni = (char **)realloc(refs->items, ncap * sizeof(char *));
+        if (!ni)
+          return false;
+        refs->items = ni;
+        refs->cap = ncap;
+      }
+      if (!(refs->items[refs->count] = dup_range(c->valuestring, strlen(c->valuestring))))
+        return false;
+      ++refs->count;
+    }
+    else if (c->child && !collect_refs(refs, c))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Chiave di `paths` scelta per `endpoint_path` come find_path_item: la
+// chiave esatta, altrimenti il primo template compatibile nell'ordine del
+// documento. NULL se nessuna corrisponde (o in caso di errore).
+static char *choose_path_key(oas_lazy *lz, uint32_t paths, const char *endpoint_path)
+{
+  lazy_member m;
+  int r = find_member(lz, paths, endpoint_path, &m);
+  if (r == 1 && m.node != LAZY_NONE && lz->text[m.value] == '{')
+    return dup_range(endpoint_path, strlen(endpoint_path));
+  member_iter it;
+  members_begin(lz, paths, &it);
+  while (r >= 0 && (r = members_next(lz, &it, true, &m)) == 1)
+  {
+    const char *raw = lz->text + m.key;
+    if (m.node == LAZY_NONE || lz->text[m.value] != '{' ||
+        (!memchr(raw, '{', m.key_len) && !memchr(raw, '\\', m.key_len)))
+      continue;
+    char *key = member_key(lz, &m);
+    if (!key)
+    {
+      fail(lz, OAS_LAZY_NO_MEMORY);
+      return NULL;
+    }
+    if (strchr(key, '{') && oas_path_matches_template(key, endpoint_path))
+      return key;
+    free(key);
+  }
+  if (r < 0)
+    fail(lz, OAS_LAZY_BAD_JSON);
+  return NULL;
+}
+
+oas_lazy_status oas_lazy_require_operation(oas_lazy *lz, const char *http_method, const char *endpoint_path)
+{
+  if (!lz->root)
+    return lz->error;
+  char *openapi[] = {"openapi"};
+  materialize(lz, openapi, 1, NULL);
+
+  lazy_member paths;
+  int r = find_member(lz, 0, "paths", &paths);
+  if (r < 0)
+    fail(lz, OAS_LAZY_BAD_JSON);
+  if (r != 1 || paths.node == LAZY_NONE || !http_method || !endpoint_path || lz->error != OAS_LAZY_OK)
+    return lz->error;
+  char *key = choose_path_key(lz, paths.node, endpoint_path);
+  if (!key)
+    return lz->error;
+
+  ref_list refs = {NULL, 0, 0};
+  char *tokens[] = {"paths", key, (char *)http_method};
+  cJSON *operation = materialize(lz, tokens, 3, NULL);
+  free(key);
+  if (cJSON_IsObject(operation) &&
+      !collect_refs(&refs, cJSON_GetObjectItemCaseSensitive(operation, "requestBody")))
+    fail(lz, OAS_LAZY_NO_MEMORY);
+  // Chiusura: ogni target interpretato per la prima volta porta i propri $ref.
+  while (refs.count > 0 && lz->error == OAS_LAZY_OK)
+  {
+    char *ref = refs.items[--refs.count];
+    cJSON *fresh = NULL;
+    resolve_ref(lz, ref, &fresh);
+    free(ref);
+    if (fresh && !collect_refs(&refs, fresh))
+      fail(lz, OAS_LAZY_NO_MEMORY);
+  }
+  while (refs.count > 0)
+    free(refs.items[--refs.count]);
+  free(refs.items);
+  return lz->error;
+}
+
+cJSON *oas_lazy_root(const oas_lazy *lz)
+{
+  return lz->root;
+}
+
+oas_lazy_status oas_lazy_error(const oas_lazy *lz)
+{
+  return lz->error;
+}
+
+cJSON *oas_lazy_detach(oas_lazy *lz)
+{
+  cJSON *root = lz->root;
+  lz->root = NULL;
+  ptrmap_clear(&lz->skeletons);
+  return root;
+}
+
+size_t oas_lazy_source_bytes(const oas_lazy *lz)
+{
+  return lz->len;
+}
+
+size_t oas_lazy_containers(const oas_lazy *lz)
+{
+  return lz->node_count;
+}
+
+size_t oas_lazy_index_bytes(const oas_lazy *lz)
+{
+  return lz->node_count * sizeof(lazy_node);
+}
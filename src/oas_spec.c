@@ -0,0 +1,406 @@
+#include "oas_spec.h"
+#include "fileutil.h"
+#include "miniyaml.h"
+#include "oas_extract.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+struct oas_component
+{
+  char *name;
+  uint64_t hash;
+  cJSON *schema; // oggetto proprietario dei figli condivisi con i DOM delle versioni
+  js_compiled *compiled;
+  atomic_size_t refs;
+};
+
+// Stringhe della tabella dei simboli non usate dalla versione precedente
+// tollerate oltre il doppio di quelle usate, prima di ripartire da un pool
+// nuovo.
+#define OAS_SYMBOL_SLACK 4096
+
+// Contatore degli identificativi delle versioni costruite.
+static atomic_uint_fast64_t next_spec_uid = 1;
+
+struct oas_spec_slot
+{
+  _Atomic(oas_spec *) current;
+  atomic_uint_fast64_t epoch;
+  atomic_uint_fast64_t *readers; // 0 = lettore inattivo, altrimenti epoca di ingresso
+  size_t reader_count;
+  mtx_t publish_lock;
+};
+
+static char *dup_str(const char *s)
+{
+  size_t len = strlen(s);
+  char *out = (char *)malloc(len + 1);
+  if (out)
+    memcpy(out, s, len + 1);
+  return out;
+}
+
+cJSON *oas_parse_text(const char *text, size_t len, char **error_msg)
+{
+  if (error_msg)
+    *error_msg = NULL;
+  if (!text)
+    return NULL;
+  const char *t = text;
+  while (*t == ' ' || *t == '\t' || *t == '\r' || *t == '\n')
+    ++t;
+  if (t[0] == '{' || t[0] == '[')
+  {
+    cJSON *root = cJSON_ParseWithLength(text, len);
+    if (!root && error_msg)
+      *error_msg = dup_str("JSON non valido");
+    return root;
+  }
+  return miniyaml_parse(text, error_msg);
+}
+
+static void component_release(oas_component *c)
+{
+  if (!c)
+    return;
+  if (atomic_fetch_sub(&c->refs, 1) != 1)
+    return;
+  js_compiled_free(c->compiled);
+  cJSON_Delete(c->schema);
+  free(c->name);
+  free(c);
+}
+
+// Crea una nuova unità spostando i figli di `item` in un oggetto proprietario.
+static oas_component *component_create(cJSON *item, uint64_t hash, js_compile_pool *pool)
+{
+  oas_component *c = (oas_component *)calloc(1, sizeof(oas_component));
+  if (!c)
+    return NULL;
+  c->name = dup_str(item->string);
+  c->schema = cJSON_CreateObject();
+  if (!c->name || !c->schema)
+  {
+    free(c->name);
+    cJSON_Delete(c->schema);
+    free(c);
+    return NULL;
+  }
+  c->hash = hash;
+  c->schema->child = item->child;
+  item->child = NULL;
+  atomic_init(&c->refs, 1);
+  c->compiled = js_compile_schema(c->schema, pool);
+  if (!c->compiled)
+  {
+    component_release(c);
+    return NULL;
+  }
+  return c;
+}
+
+// Cerca nella versione precedente un'unità con lo stesso nome e contenuto.
+// La posizione `pos` viene provata per prima: tra un ricaricamento e l'altro
+// l'ordine dei componenti di solito non cambia.
+static oas_component *find_reusable(const oas_spec *prev, const cJSON *item, uint64_t hash, size_t pos)
+{
+  if (!prev)
+    return NULL;
+  oas_component *found = NULL;
+  if (pos < prev->component_count && strcmp(prev->components[pos]->name, item->string) == 0)
+  {
+    found = prev->components[pos];
+  }
+  else
+  {
+    for (size_t i = 0; i < prev->component_count; ++i)
+    {
+      if (strcmp(prev->components[i]->name, item->string) == 0)
+      {
+        found = prev->components[i];
+        break;
+      }
+    }
+  }
+  // L'hash fa da filtro veloce; il confronto completo esclude le collisioni.
+  if (!found || found->hash != hash || !cJSON_Compare(found->schema, item, true))
+    return NULL;
+  return found;
+}
+
+static size_t dom_bytes(const cJSON *first);
+
+// Copia la scelta di potatura nella versione e pota il DOM.
+static bool prune_dom(oas_spec *spec, const oas_prune_opts *prune)
+{
+  spec->prune.enabled = true;
+  if (prune->method && prune->path)
+  {
+    char *method = dup_str(prune->method), *path = dup_str(prune->path);
+    spec->prune.method = method;
+    spec->prune.path = path;
+    if (!method || !path)
+      return false;
+  }
+  spec->dom_bytes_full = dom_bytes(spec->root);
+  if (!oas_prune(spec->root, spec->prune.method, spec->prune.path, &spec->pruned_nodes))
+    return false;
+  spec->dom_bytes_pruned = dom_bytes(spec->root);
+  return true;
+}
+
+oas_spec *oas_spec_build(cJSON *root, const oas_spec *prev, const oas_prune_opts *prune)
+{
+  if (!root)
+    return NULL;
+  oas_spec *spec = (oas_spec *)calloc(1, sizeof(oas_spec));
+  if (!spec)
+  {
+    cJSON_Delete(root);
+    return NULL;
+  }
+  spec->root = root;
+  spec->version = prev ? prev->version + 1 : 1;
+  spec->uid = atomic_fetch_add(&next_spec_uid, 1);
+  // La tabella dei simboli condivisa tra le versioni non rimuove stringhe:
+  // quando quelle usate solo da versioni passate (descrizioni, numeri di
+  // versione, nomi cambiati) sono più di quelle ancora in uso, la nuova
+  // versione riparte da un pool nuovo e ricompila tutte le unità; il pool
+  // precedente viene liberato con l'ultima versione che lo usa.
+  const oas_spec *reuse = prev;
+  if (prev && js_symtab_count(prev->symbols) > 2 * prev->live_symbols + OAS_SYMBOL_SLACK)
+    reuse = NULL;
+  spec->pool = reuse ? js_compile_pool_retain(reuse->pool) : js_compile_pool_create();
+  if (!spec->pool)
+    goto fail;
+  if (!prune && prev)
+    prune = &prev->prune;
+  if (prune && prune->enabled && !prune_dom(spec, prune))
+    goto fail;
+  // Nomi e valori ripetuti (type, description, nomi di proprietà) diventano
+  // un'unica copia nella tabella dei simboli condivisa tra le versioni.
+  spec->symbols = js_compile_pool_symbols(spec->pool);
+  spec->interned_bytes = js_symtab_intern_dom(spec->symbols, root, &spec->live_symbols);
+
+  cJSON *components = cJSON_GetObjectItemCaseSensitive(root, "components");
+  cJSON *schemas = cJSON_GetObjectItemCaseSensitive(components, "schemas");
+  size_t total = cJSON_IsObject(schemas) ? (size_t)cJSON_GetArraySize(schemas) : 0;
+
+  spec->index = js_schema_index_create(total * 8);
+  if (!spec->index)
+    goto fail;
+  if (total > 0)
+  {
+    spec->components = (oas_component **)calloc(total, sizeof(oas_component *));
+    if (!spec->components)
+      goto fail;
+  }
+
+  size_t pos = 0;
+  cJSON *item = NULL;
+  cJSON_ArrayForEach(item, schemas)
+  {
+    if (!cJSON_IsObject(item) || !item->string || (item->type & cJSON_IsReference))
+      continue;
+    uint64_t hash = js_hash_node(item);
+    oas_component *unit = find_reusable(reuse, item, hash, pos++);
+    if (unit)
+    {
+      atomic_fetch_add(&unit->refs, 1);
+      cJSON_Delete(item->child);
+      item->child = NULL;
+    }
+    else
+    {
+      unit = component_create(item, hash, spec->pool);
+      if (!unit)
+        goto fail;
+      ++spec->recompiled_count;
+    }
+    // Il nodo nel DOM diventa un riferimento al contenuto dell'unità.
+    item->child = unit->schema->child;
+    item->type |= cJSON_IsReference;
+    spec->components[spec->component_count++] = unit;
+
+    if (!js_schema_index_add(spec->index, unit->compiled) ||
+        !js_schema_index_alias(spec->index, item, unit->schema))
+      goto fail;
+  }
+
+  spec->inline_compiled = js_compile_schema(root, spec->pool);
+  if (!spec->inline_compiled || !js_schema_index_add(spec->index, spec->inline_compiled))
+    goto fail;
+  spec->memory_bytes = oas_spec_memory(spec);
+  return spec;
+
+fail:
+  oas_spec_free(spec);
+  return NULL;
+}
+
+oas_spec *oas_spec_load_text(const char *text, size_t len, const oas_spec *prev, const oas_prune_opts *prune,
+                             char **error_msg)
+{
+  cJSON *root = oas_parse_text(text, len, error_msg);
+  if (!root)
+    return NULL;
+
+  cJSON *openapi = cJSON_GetObjectItemCaseSensitive(root, "openapi");
+  if (!cJSON_IsString(openapi) || strncmp(openapi->valuestring, "3.", 2) != 0)
+  {
+    cJSON_Delete(root);
+    if (error_msg)
+      *error_msg = dup_str("'openapi' non è 3.x");
+    return NULL;
+  }
+
+  oas_spec *spec = oas_spec_build(root, prev, prune);
+  if (!spec && error_msg)
+    *error_msg = dup_str("memoria insufficiente durante la compilazione");
+  return spec;
+}
+
+oas_spec *oas_spec_load_file(const char *path, const oas_spec *prev, const oas_prune_opts *prune,
+                             char **error_msg)
+{
+  if (error_msg)
+    *error_msg = NULL;
+  size_t len = 0;
+  char *text = read_entire_file(path, &len);
+  if (!text)
+  {
+    if (error_msg)
+      *error_msg = dup_str("lettura del file non riuscita");
+    return NULL;
+  }
+  oas_spec *spec = oas_spec_load_text(text, len, prev, prune, error_msg);
+  free(text);
+  return spec;
+}
+
+// Costo medio dell'allocatore per ogni blocco (intestazione e arrotondamento).
+#define OAS_MALLOC_OVERHEAD 16
+
+// Byte del sottoalbero `first` e dei suoi fratelli. Le stringhe internate o
+// di riferimento appartengono alla tabella dei simboli; i sottoalberi
+// riferimento appartengono alle unità.
+static size_t dom_bytes(const cJSON *first)
+{
+  size_t bytes = 0;
+  for (const cJSON *item = first; item; item = item->next)
+  {
+    bytes += sizeof(cJSON) + OAS_MALLOC_OVERHEAD;
+    if (item->string && !(item->type & cJSON_StringIsConst))
+      bytes += strlen(item->string) + 1 + OAS_MALLOC_OVERHEAD;
+    if (item->type & cJSON_IsReference)
+      continue;
+    if (item->valuestring)
+      bytes += strlen(item->valuestring) + 1 + OAS_MALLOC_OVERHEAD;
+    bytes += dom_bytes(item->child);
+  }
+  return bytes;
+}
+
+size_t oas_spec_memory(const oas_spec *spec)
+{
+  if (!spec)
+    return 0;
+  size_t bytes = sizeof(oas_spec) + dom_bytes(spec->root);
+  bytes += spec->component_count * (sizeof(oas_component *) + sizeof(oas_component));
+  for (size_t i = 0; i < spec->component_count; ++i)
+  {
+    const oas_component *c = spec->components[i];
+    bytes += strlen(c->name) + 1 + sizeof(cJSON) + dom_bytes(c->schema->child);
+    bytes += js_compiled_bytes(c->compiled);
+  }
+  bytes += js_compiled_bytes(spec->inline_compiled);
+  bytes += js_schema_index_bytes(spec->index);
+  bytes += js_compile_pool_bytes(spec->pool);
+  return bytes;
+}
+
+void oas_spec_free(oas_spec *spec)
+{
+  if (!spec)
+    return;
+  // Prima il DOM: i nodi riferimento non liberano i figli delle unità.
+  cJSON_Delete(spec->root);
+  for (size_t i = 0; i < spec->component_count; ++i)
+    component_release(spec->components[i]);
+  free(spec->components);
+  js_compiled_free(spec->inline_compiled);
+  js_schema_index_free(spec->index);
+  js_compile_pool_release(spec->pool);
+  free((char *)spec->prune.method);
+  free((char *)spec->prune.path);
+  free(spec);
+}
+
+oas_spec_slot *oas_spec_slot_create(oas_spec *initial, size_t max_readers)
+{
+  if (max_readers == 0)
+    max_readers = 1;
+  oas_spec_slot *slot = (oas_spec_slot *)calloc(1, sizeof(oas_spec_slot));
+  if (!slot)
+    return NULL;
+  slot->readers = (atomic_uint_fast64_t *)calloc(max_readers, sizeof(atomic_uint_fast64_t));
+  if (!slot->readers || mtx_init(&slot->publish_lock, mtx_plain) != thrd_success)
+  {
+    free(slot->readers);
+    free(slot);
+    return NULL;
+  }
+  for (size_t i = 0; i < max_readers; ++i)
+    atomic_init(&slot->readers[i], 0);
+  slot->reader_count = max_readers;
+  atomic_init(&slot->epoch, 1);
+  atomic_init(&slot->current, initial);
+  return slot;
+}
+
+void oas_spec_slot_free(oas_spec_slot *slot)
+{
+  if (!slot)
+    return;
+  oas_spec_free(atomic_load(&slot->current));
+  mtx_destroy(&slot->publish_lock);
+  free(slot->readers);
+  free(slot);
+}
+
+const oas_spec *oas_spec_read_lock(oas_spec_slot *slot, size_t reader_id)
+{
+  // Annuncia l'epoca di ingresso prima di leggere il puntatore: lo scrittore
+  // che ha già scambiato la versione vedrà questo lettore e lo attenderà.
+  uint_fast64_t e = atomic_load(&slot->epoch);
+  atomic_store(&slot->readers[reader_id], e);
+  return atomic_load(&slot->current);
+}
+
+void oas_spec_read_unlock(oas_spec_slot *slot, size_t reader_id)
+{
+  atomic_store_explicit(&slot->readers[reader_id], 0, memory_order_release);
+}
+
+const oas_spec *oas_spec_slot_peek(oas_spec_slot *slot)
+{
+  return atomic_load(&slot->current);
+}
+
+void oas_spec_publish(oas_spec_slot *slot, oas_spec *next)
+{
+  mtx_lock(&slot->publish_lock);
+  oas_spec *old = atomic_exchange(&slot->current, next);
+  uint_fast64_t target = atomic_fetch_add(&slot->epoch, 1) + 1;
+  // Periodo di grazia: attende solo i lettori entrati prima dello scambio.
+  for (size_t i = 0; i < slot->reader_count; ++i)
+  {
+    uint_fast64_t r;
+    while ((r = atomic_load(&slot->readers[i])) != 0 && r < target)
+      thrd_yield();
+  }
+  mtx_unlock(&slot->publish_lock);
+  oas_spec_free(old);
+}
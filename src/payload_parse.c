@@ -0,0 +1,1550 @@
+#include "payload_parse.h"
+#include "mem_account.h"
+#include "json_number.h"
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Numero massimo di $ref consecutivi seguiti per individuare lo schema di
+// una posizione: oltre (o in presenza di cicli) la posizione non è vincolata.
+#define PAYLOAD_MAX_REF_HOPS 32
+
+// Contenitore aperto durante il parsing.
+typedef struct pframe
+{
+  size_t start; // voce TAPE_OBJECT/TAPE_ARRAY nel tape
+  bool is_object;
+  long long max_count; // maxItems/maxProperties, -1 se assente
+  long long count;
+  cJSON *items;       // schema degli elementi se il validatore vi discende
+  cJSON *props;       // "properties" se il validatore vi discende
+  unsigned char *seen; // proprietà dello schema già incontrate
+  size_t seen_len;
+  bool exclusive;      // i figli sono validati solo dallo schema assegnato qui
+} pframe;
+
+typedef struct pstate
+{
+  const char *p;
+  const char *end;
+  const char *start;
+  char *text; // stesso buffer di `start`, scrivibile: stringhe decodificate sul posto
+  payload_tape tape;
+  const jsval_ctx *ctx;
+  payload_limits limits;
+  size_t elements;
+  pframe *stack;
+  size_t depth;
+  size_t cap;
+  payload_status status;
+  char *error_msg;
+  req_budget_meter budget; // un passo per valore
+} pstate;
+
+payload_limits payload_limits_default(void)
+{
+  payload_limits l = {0, CJSON_NESTING_LIMIT, 0};
+  return l;
+}
+
+static void fail(pstate *st, payload_status status, const char *fmt, ...)
+{
+  if (st->status != PAYLOAD_OK)
+    return;
+  st->status = status;
+  char buf[256];
+  mem_account *acct = mem_account_current();
+  if (status == PAYLOAD_NO_MEMORY && mem_account_exceeded(acct))
+  {
+    // il limite di memoria della richiesta respinge il body come gli altri
+    st->status = PAYLOAD_LIMIT_EXCEEDED;
+    snprintf(buf, sizeof(buf), "Memoria della richiesta oltre il limite di %zu byte", mem_account_limit(acct));
+  }
+  else
+  {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+  }
+  // il messaggio non è a carico della richiesta, che può essere già al limite
+  mem_account *prev = mem_account_enter(NULL);
+  size_t len = strlen(buf);
+  st->error_msg = (char *)mem_malloc(len + 1);
+  if (st->error_msg)
+    memcpy(st->error_msg, buf, len + 1);
+  mem_account_enter(prev);
+}
+
+static void syntax_error(pstate *st)
+{
+  fail(st, PAYLOAD_SYNTAX_ERROR, "JSON non valido all'offset %zu", (size_t)(st->p - st->start));
+}
+
+static void skip_ws(pstate *st)
+{
+  while (st->p < st->end && (unsigned char)*st->p <= 32)
+    ++st->p;
+}
+
+// Segue la catena di $ref come farebbe il validatore.
+static cJSON *resolve_schema(const pstate *st, cJSON *schema)
+{
+  for (int hops = 0; cJSON_IsObject(schema) && hops < PAYLOAD_MAX_REF_HOPS; ++hops)
+  {
+    cJSON *ref = cJSON_GetObjectItemCaseSensitive(schema, "$ref");
+    if (!cJSON_IsString(ref))
+      return schema;
+    schema = jsval_resolve_ref(ref->valuestring, st->ctx);
+  }
+  return NULL;
+}
+
+static void limits_of(const pstate *st, cJSON *schema, js_size_limits *out)
+{
+  const js_compiled_node *cn = st->ctx ? js_schema_index_lookup(st->ctx->index, schema) : NULL;
+  if (cn)
+    *out = cn->limits;
+  else
+    js_size_limits_read(schema, out);
+}
+
+static const char *schema_type(cJSON *schema)
+{
+  cJSON *t = cJSON_GetObjectItemCaseSensitive(schema, "type");
+  return cJSON_IsString(t) ? t->valuestring : NULL;
+}
+
+// Parole chiave che il validatore legge su un nodo: uno schema (già risolto)
+// che non ne contiene nessuna non impone vincoli al valore.
+static const char *const constraining_keywords[] = {
+    "type", "enum", "pattern", "minLength", "maxLength", "minimum", "maximum",
+    "minItems", "maxItems", "minProperties", "maxProperties", "properties"};
+
+static bool schema_is_unconstrained(const cJSON *schema)
+{
+  if (!cJSON_IsObject(schema))
+    return true;
+  for (const cJSON *k = schema->child; k; k = k->next)
+  {
+    if (!k->string)
+      continue;
+    for (size_t i = 0; i < sizeof(constraining_keywords) / sizeof(constraining_keywords[0]); ++i)
+    {
+      if (strcmp(k->string, constraining_keywords[i]) == 0)
+        return false;
+    }
+  }
+  return true;
+}
+
+static bool emit(pstate *st, payload_tape_tag tag, uint64_t data)
+{
+  if (payload_tape_emit(&st->tape, tag, data))
+    return true;
+  fail(st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+  return false;
+}
+
+static bool emit_word(pstate *st, uint64_t word)
+{
+  if (payload_tape_emit_word(&st->tape, word))
+    return true;
+  fail(st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+  return false;
+}
+
+static bool count_element(pstate *st)
+{
+  if (!req_budget_tick(&st->budget))
+  {
+    char what[64];
+    req_budget_describe(st->budget.budget, what, sizeof(what));
+    fail(st, PAYLOAD_BUDGET_EXCEEDED, "Budget della richiesta esaurito: %s", what);
+    return false;
+  }
+  ++st->elements;
+  if (st->limits.max_elements && st->elements > st->limits.max_elements)
+  {
+    fail(st, PAYLOAD_LIMIT_EXCEEDED, "Payload con più di %zu elementi", st->limits.max_elements);
+    return false;
+  }
+  return true;
+}
+
+static int hex_value(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+static bool parse_hex4(const char *p, const char *end, unsigned *out)
+{
+  if (end - p < 4)
+    return false;
+  unsigned v = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    int h = hex_value(p[i]);
+    if (h < 0)
+      return false;
+    v = (v << 4) | (unsigned)h;
+  }
+  *out = v;
+  return true;
+}
+
+// Decodifica una stringa JSON (cursore sulle virgolette di apertura) sul
+// posto: il risultato non è mai più lungo del testo di partenza, quindi viene
+// scritto nello stesso buffer e terminato da NUL al posto delle virgolette di
+// chiusura. Emette la voce TAPE_STRING. Con `max_length` >= 0 interrompe
+// appena la lunghezza (come la misura strlen) supera il limite, senza
+// leggere il resto della stringa.
+static bool parse_string(pstate *st, long long max_length)
+{
+  size_t visible = 0; // byte prima dell'eventuale primo NUL
+  bool nul_seen = false;
+  ++st->p;
+  char *begin = st->text + (st->p - st->start);
+  char *w = begin;
+  while (st->p < st->end)
+  {
+    const char *run = st->p;
+    while (st->p < st->end && *st->p != '"' && *st->p != '\\')
+      ++st->p;
+    size_t n = (size_t)(st->p - run);
+    if (n)
+    {
+      if (!nul_seen)
+        visible += n;
+      if (max_length >= 0 && (long long)visible > max_length)
+        goto too_long;
+      if (w != run)
+        memmove(w, run, n);
+      w += n;
+    }
+    if (st->p >= st->end)
+      break;
+    if (*st->p == '"')
+    {
+      ++st->p;
+      *w = '\0';
+      return emit(st, TAPE_STRING, (uint64_t)(begin - st->text)) && emit_word(st, visible);
+    }
+
+    // sequenza di escape
+    if (st->end - st->p < 2)
+      break;
+    char esc = st->p[1];
+    char out[4];
+    size_t out_len = 1;
+    st->p += 2;
+    switch (esc)
+    {
+    case '"': out[0] = '"'; break;
+    case '\\': out[0] = '\\'; break;
+    case '/': out[0] = '/'; break;
+    case 'b': out[0] = '\b'; break;
+    case 'f': out[0] = '\f'; break;
+    case 'n': out[0] = '\n'; break;
+    case 'r': out[0] = '\r'; break;
+    case 't': out[0] = '\t'; break;
+    case 'u':
+    {
+      unsigned cp;
+      if (!parse_hex4(st->p, st->end, &cp))
+        goto syntax;
+      st->p += 4;
+      if (cp >= 0xDC00 && cp <= 0xDFFF)
+        goto syntax;
+      if (cp >= 0xD800 && cp <= 0xDBFF)
+      {
+        unsigned lo;
+        if (st->end - st->p < 6 || st->p[0] != '\\' || st->p[1] != 'u' ||
+            !parse_hex4(st->p + 2, st->end, &lo) || lo < 0xDC00 || lo > 0xDFFF)
+          goto syntax;
+        st->p += 6;
+        cp = 0x10000 + (((cp & 0x3FF) << 10) | (lo & 0x3FF));
+      }
+      if (cp < 0x80)
+      {
+        out[0] = (char)cp;
+      }
+      else if (cp < 0x800)
+      {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        out_len = 2;
+      }
+      else if (cp < 0x10000)
+      {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        out_len = 3;
+      }
+      else
+      {
+        out[0] = (char)(0xF0 | (cp >> 18));
+        out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (cp & 0x3F));
+        out_len = 4;
+      }
+      break;
+    }
+    default:
+      goto syntax;
+    }
+    if (out[0] == '\0')
+      nul_seen = true;
+    if (!nul_seen)
+      visible += out_len;
+    if (max_length >= 0 && (long long)visible > max_length)
+      goto too_long;
+    memcpy(w, out, out_len);
+    w += out_len;
+  }
+
+syntax:
+  syntax_error(st);
+  return false;
+too_long:
+  fail(st, PAYLOAD_LIMIT_EXCEEDED, "Stringa più lunga di maxLength");
+  return false;
+}
+
+// Offset da passare a emit_number quando il lessema non è già nel testo del
+// tape e va copiato nella sua area propria.
+#define NUMBER_COPY UINT64_MAX
+
+// Emette il numero [lex, lex + len), già delimitato da js_number_lexeme_len.
+// I letterali interi fino a 19 cifre vengono convertiti esattamente senza
+// strtod, e così i decimali con mantissa ed esponente piccoli; per gli altri
+// strtod viene chiamata subito solo se lo schema della posizione ne
+// confronta il valore (minimum/maximum/enum), altrimenti se ne conserva il
+// lessema (a `raw_off` nel testo del tape) e il validatore li decodifica
+// alla prima richiesta (payload_tape_number).
+static bool emit_number(pstate *st, const char *lex, size_t len, cJSON *schema, uint64_t raw_off)
+{
+  const char *q = lex;
+  const char *end = lex + len;
+  bool neg = *q == '-';
+  if (neg)
+    ++q;
+  uint64_t u = 0;
+  const char *d = q;
+  while (d < end && *d >= '0' && *d <= '9' && d - q < 19)
+    u = u * 10 + (uint64_t)(*d++ - '0');
+
+  double v;
+  if (d == end && u <= (uint64_t)INT64_MAX && !(neg && u == 0))
+    return emit(st, TAPE_INT, 0) && emit_word(st, neg ? (uint64_t)-(int64_t)u : u);
+  if (d == end)
+  {
+    // intero oltre int64 (o -0): la conversione da uint64 è già arrotondata
+    v = neg ? -(double)u : (double)u;
+  }
+  else if (!js_number_decode_fast(lex, len, &v))
+  {
+    if (!schema || !(cJSON_GetObjectItemCaseSensitive(schema, "minimum") ||
+                     cJSON_GetObjectItemCaseSensitive(schema, "maximum") ||
+                     cJSON_GetObjectItemCaseSensitive(schema, "enum")))
+    {
+      if (raw_off == NUMBER_COPY)
+      {
+        raw_off = st->tape.text_len;
+        if (!payload_tape_append_text(&st->tape, lex, len))
+        {
+          fail(st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+          return false;
+        }
+      }
+      return emit(st, TAPE_RAWNUM, raw_off) && emit_word(st, len);
+    }
+    v = js_number_decode(lex, len);
+  }
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return emit(st, TAPE_DOUBLE, 0) && emit_word(st, bits);
+}
+
+// Interpreta un numero con la stessa tolleranza di cJSON.
+static bool parse_number(pstate *st, cJSON *schema)
+{
+  size_t len = js_number_lexeme_len(st->p, st->end);
+  if (len == 0)
+  {
+    syntax_error(st);
+    return false;
+  }
+  bool good = emit_number(st, st->p, len, schema, (uint64_t)(st->p - st->start));
+  st->p += len;
+  return good;
+}
+
+static bool match_literal(pstate *st, const char *lit)
+{
+  size_t n = strlen(lit);
+  if ((size_t)(st->end - st->p) < n || memcmp(st->p, lit, n) != 0)
+    return false;
+  st->p += n;
+  return true;
+}
+
+// Apre un contenitore per `schema` già risolto emettendone la voce iniziale.
+static bool push_frame(pstate *st, bool is_object, cJSON *schema, bool exclusive)
+{
+  if (st->limits.max_depth && st->depth + 1 > st->limits.max_depth)
+  {
+    fail(st, PAYLOAD_LIMIT_EXCEEDED, "Nidificazione oltre il limite di %zu livelli", st->limits.max_depth);
+    return false;
+  }
+  if (st->depth == st->cap)
+  {
+    size_t new_cap = st->cap ? st->cap * 2 : 16;
+    pframe *ns = (pframe *)mem_realloc(st->stack, new_cap * sizeof(pframe));
+    if (!ns)
+    {
+      fail(st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+      return false;
+    }
+    st->stack = ns;
+    st->cap = new_cap;
+  }
+  if (!emit(st, is_object ? TAPE_OBJECT : TAPE_ARRAY, 0))
+    return false;
+  pframe *f = &st->stack[st->depth++];
+  memset(f, 0, sizeof(*f));
+  f->start = st->tape.count - 1;
+  f->is_object = is_object;
+  f->max_count = -1;
+  if (!schema)
+    return true;
+
+  js_size_limits lim;
+  limits_of(st, schema, &lim);
+  const char *t = schema_type(schema);
+  if (f->is_object)
+  {
+    f->max_count = lim.max_properties;
+    cJSON *props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+    bool descend = t ? strcmp(t, "object") == 0 : true;
+    // con patternProperties una chiave può essere validata da altri schemi
+    f->exclusive = exclusive && (!descend || !cJSON_GetObjectItemCaseSensitive(schema, "patternProperties"));
+    if (descend && cJSON_IsObject(props))
+    {
+      f->props = props;
+      f->seen_len = (size_t)cJSON_GetArraySize(props);
+      if (f->seen_len)
+      {
+        f->seen = (unsigned char *)mem_calloc(f->seen_len, 1);
+        if (!f->seen)
+        {
+          fail(st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+          return false;
+        }
+      }
+    }
+  }
+  else
+  {
+    f->max_count = lim.max_items;
+    f->exclusive = exclusive;
+    cJSON *items = cJSON_GetObjectItemCaseSensitive(schema, "items");
+    if (t && strcmp(t, "array") == 0 && cJSON_IsObject(items))
+      f->items = items;
+  }
+  return true;
+}
+
+static void free_frame(pframe *f)
+{
+  mem_free(f->seen);
+}
+
+// Chiude il contenitore in cima: la voce TAPE_END conta i figli e la voce
+// iniziale riceve l'indice della chiusura.
+static bool close_frame(pstate *st)
+{
+  pframe *f = &st->stack[st->depth - 1];
+  size_t end = st->tape.count;
+  bool good = emit(st, TAPE_END, (uint64_t)f->count);
+  if (good)
+    st->tape.entries[f->start] |= (uint64_t)end & TAPE_PAYLOAD_MASK;
+  free_frame(f);
+  --st->depth;
+  return good;
+}
+
+// Conta un nuovo figlio del contenitore in cima e ne verifica il limite.
+static bool next_child(pstate *st)
+{
+  pframe *f = &st->stack[st->depth - 1];
+  ++f->count;
+  if (f->max_count >= 0 && f->count > f->max_count)
+  {
+    if (f->is_object)
+      fail(st, PAYLOAD_LIMIT_EXCEEDED, "Oggetto con più proprietà di maxProperties");
+    else
+      fail(st, PAYLOAD_LIMIT_EXCEEDED, "Array con più elementi di maxItems");
+    return false;
+  }
+  return true;
+}
+
+// Conta il membro la cui chiave è alla voce `k` e restituisce lo schema del
+// valore che segue. Lo schema vale solo per la prima occorrenza della
+// chiave, l'unica che il validatore controlla tramite "properties".
+// `*skip_out` indica che il validatore non esaminerà il valore.
+static bool member_schema(pstate *st, size_t k, cJSON **schema_out, bool *skip_out)
+{
+  *schema_out = NULL;
+  *skip_out = false;
+  const char *key = payload_tape_string(&st->tape, k);
+  // il simbolo viene cercato solo se qualche schema può usarlo
+  js_symbol sym = 0;
+  if (st->tape.symbols)
+  {
+    sym = js_symtab_lookup(st->tape.symbols, key, payload_tape_string_len(&st->tape, k));
+    st->tape.entries[k + 1] |= (uint64_t)sym << TAPE_LEN_BITS;
+  }
+  pframe *f = &st->stack[st->depth - 1];
+  if (!next_child(st))
+    return false;
+
+  bool described = false;
+  if (f->props)
+  {
+    size_t i = 0;
+    cJSON *p = NULL;
+    for (p = f->props->child; p; p = p->next, ++i)
+    {
+      js_symbol ps = st->tape.symbols ? js_symbol_of_key(p) : 0;
+      if (ps ? ps == sym : (p->string && strcmp(p->string, key) == 0))
+        break;
+    }
+    if (p && i < f->seen_len && !f->seen[i])
+    {
+      f->seen[i] = 1;
+      if (cJSON_IsObject(p))
+      {
+        described = true;
+        *schema_out = resolve_schema(st, p);
+      }
+    }
+  }
+  // un $ref non risolvibile resta da validare (il validatore lo segnalerà)
+  if (f->exclusive)
+    *skip_out = !described || (*schema_out && schema_is_unconstrained(*schema_out));
+  return true;
+}
+
+// Legge "chiave": e restituisce lo schema del valore che segue (vedi
+// member_schema).
+static bool parse_member_key(pstate *st, cJSON **schema_out, bool *skip_out)
+{
+  skip_ws(st);
+  if (st->p >= st->end || *st->p != '"')
+  {
+    syntax_error(st);
+    return false;
+  }
+  if (!parse_string(st, -1))
+    return false;
+  size_t k = st->tape.count - 2;
+  skip_ws(st);
+  if (st->p >= st->end || *st->p != ':')
+  {
+    syntax_error(st);
+    return false;
+  }
+  ++st->p;
+  return member_schema(st, k, schema_out, skip_out);
+}
+
+// Schema e visibilità del prossimo elemento dell'array in cima allo stack.
+static cJSON *next_item_schema(pstate *st, bool *skip_out)
+{
+  pframe *f = &st->stack[st->depth - 1];
+  cJSON *schema = f->items ? resolve_schema(st, f->items) : NULL;
+  *skip_out = f->exclusive && (!f->items || (schema && schema_is_unconstrained(schema)));
+  return schema;
+}
+
+// Verifica una stringa (cursore sulle virgolette) senza decodificarla, con
+// le stesse regole di parse_string.
+static bool skip_string(pstate *st)
+{
+  ++st->p;
+  while (st->p < st->end)
+  {
+    char c = *st->p;
+    if (c == '"')
+    {
+      ++st->p;
+      return true;
+    }
+    if (c != '\\')
+    {
+      ++st->p;
+      continue;
+    }
+    if (st->end - st->p < 2)
+      break;
+    char esc = st->p[1];
+    st->p += 2;
+    if (esc == 'u')
+    {
+      unsigned cp;
+      if (!parse_hex4(st->p, st->end, &cp) || (cp >= 0xDC00 && cp <= 0xDFFF))
+        break;
+      st->p += 4;
+      if (cp >= 0xD800 && cp <= 0xDBFF)
+      {
+        unsigned lo;
+        if (st->end - st->p < 6 || st->p[0] != '\\' || st->p[1] != 'u' ||
+            !parse_hex4(st->p + 2, st->end, &lo) || lo < 0xDC00 || lo > 0xDFFF)
+          break;
+        st->p += 6;
+      }
+    }
+    else if (!strchr("\"\\/bfnrt", esc) || esc == '\0')
+    {
+      break;
+    }
+  }
+  syntax_error(st);
+  return false;
+}
+
+static bool skip_member_key(pstate *st)
+{
+  skip_ws(st);
+  if (st->p >= st->end || *st->p != '"' || !skip_string(st))
+  {
+    syntax_error(st);
+    return false;
+  }
+  skip_ws(st);
+  if (st->p >= st->end || *st->p != ':')
+  {
+    syntax_error(st);
+    return false;
+  }
+  ++st->p;
+  return true;
+}
+
+// Controlla sintassi, annidamento e numero di elementi del valore al cursore
+// senza allocare nodi: serve per i sottoalberi che il validatore non
+// esaminerà. I contenitori aperti sono tenuti come sequenza di '{' / '['.
+static bool skip_value(pstate *st)
+{
+  char local[64];
+  char *open = local;
+  size_t cap = sizeof(local);
+  size_t n = 0;
+  bool good = false;
+  for (;;)
+  {
+    skip_ws(st);
+    if (st->p >= st->end)
+    {
+      syntax_error(st);
+      goto out;
+    }
+    if (!count_element(st))
+      goto out;
+    char c = *st->p;
+    if (c == '{' || c == '[')
+    {
+      if (st->limits.max_depth && st->depth + n + 1 > st->limits.max_depth)
+      {
+        fail(st, PAYLOAD_LIMIT_EXCEEDED, "Nidificazione oltre il limite di %zu livelli", st->limits.max_depth);
+        goto out;
+      }
+      if (n == cap)
+      {
+        char *grown = (char *)mem_malloc(cap * 2);
+        if (!grown)
+        {
+          fail(st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+          goto out;
+        }
+        memcpy(grown, open, n);
+        if (open != local)
+          mem_free(open);
+        open = grown;
+        cap *= 2;
+      }
+      open[n++] = c;
+      ++st->p;
+      skip_ws(st);
+      if (st->p < st->end && *st->p == (c == '{' ? '}' : ']'))
+      {
+        ++st->p;
+        --n;
+      }
+      else
+      {
+        if (c == '{' && !skip_member_key(st))
+          goto out;
+        continue;
+      }
+    }
+    else if (c == '"')
+    {
+      if (!skip_string(st))
+        goto out;
+    }
+    else if (c == '-' || (c >= '0' && c <= '9'))
+    {
+      size_t len = js_number_lexeme_len(st->p, st->end);
+      if (len == 0)
+      {
+        syntax_error(st);
+        goto out;
+      }
+      st->p += len;
+    }
+    else if (!match_literal(st, "null") && !match_literal(st, "true") && !match_literal(st, "false"))
+    {
+      syntax_error(st);
+      goto out;
+    }
+
+    // dopo un valore completo
+    for (;;)
+    {
+      if (n == 0)
+      {
+        good = true;
+        goto out;
+      }
+      skip_ws(st);
+      if (st->p >= st->end)
+      {
+        syntax_error(st);
+        goto out;
+      }
+      if (*st->p == ',')
+      {
+        ++st->p;
+        if (open[n - 1] == '{' && !skip_member_key(st))
+          goto out;
+        break;
+      }
+      if (*st->p == (open[n - 1] == '{' ? '}' : ']'))
+      {
+        ++st->p;
+        --n;
+        continue;
+      }
+      syntax_error(st);
+      goto out;
+    }
+  }
+out:
+  if (open != local)
+    mem_free(open);
+  return good;
+}
+
+static payload_status parse_text(char *text, size_t len, cJSON *schema, const jsval_ctx *ctx,
+                                 const payload_limits *limits, payload_tape *out, char **error_msg)
+{
+  pstate st;
+  memset(&st, 0, sizeof(st));
+  st.start = text;
+  st.text = text;
+  st.p = text;
+  st.end = text + len;
+  st.ctx = ctx;
+  st.limits = limits ? *limits : payload_limits_default();
+  st.budget = req_budget_meter_of(ctx ? ctx->budget : NULL);
+  payload_tape_init(&st.tape);
+  st.tape.text = text;
+  st.tape.text_len = len;
+  st.tape.symbols = ctx ? ctx->symbols : NULL;
+  payload_tape_init(out);
+  if (error_msg)
+    *error_msg = NULL;
+
+  if (st.limits.max_bytes && len > st.limits.max_bytes)
+  {
+    fail(&st, PAYLOAD_LIMIT_EXCEEDED, "Payload oltre il limite di %zu byte", st.limits.max_bytes);
+    goto done;
+  }
+  if (len >= 3 && memcmp(st.p, "\xEF\xBB\xBF", 3) == 0)
+    st.p += 3;
+
+  cJSON *cur_schema = resolve_schema(&st, schema);
+  bool cur_skip = false;
+  for (;;)
+  {
+    // Valore all'inizio del cursore, vincolato da `cur_schema`. I valori che
+    // il validatore non esaminerà (`cur_skip`) vengono solo verificati e
+    // occupano una voce TAPE_SKIPPED, che mantiene chiave e conteggi per
+    // required, min/maxProperties e min/maxItems.
+    if (cur_skip)
+    {
+      if (!skip_value(&st) || !emit(&st, TAPE_SKIPPED, 0))
+        goto done;
+      goto after_value;
+    }
+    skip_ws(&st);
+    if (st.p >= st.end)
+    {
+      syntax_error(&st);
+      goto done;
+    }
+    if (!count_element(&st))
+      goto done;
+
+    char c = *st.p;
+    if (c == '{' || c == '[')
+    {
+      bool exclusive = cur_schema && (st.depth == 0 || st.stack[st.depth - 1].exclusive);
+      if (!push_frame(&st, c == '{', cur_schema, exclusive))
+        goto done;
+      ++st.p;
+      skip_ws(&st);
+      if (st.p < st.end && *st.p == (c == '{' ? '}' : ']'))
+      {
+        ++st.p;
+        if (!close_frame(&st))
+          goto done;
+      }
+      else if (c == '{')
+      {
+        if (!parse_member_key(&st, &cur_schema, &cur_skip))
+          goto done;
+        continue;
+      }
+      else
+      {
+        if (!next_child(&st))
+          goto done;
+        cur_schema = next_item_schema(&st, &cur_skip);
+        continue;
+      }
+    }
+    else
+    {
+      bool good;
+      if (c == '"')
+      {
+        long long max_length = -1;
+        if (cur_schema)
+        {
+          js_size_limits lim;
+          limits_of(&st, cur_schema, &lim);
+          max_length = lim.max_length;
+        }
+        good = parse_string(&st, max_length);
+      }
+      else if (c == '-' || (c >= '0' && c <= '9'))
+      {
+        good = parse_number(&st, cur_schema);
+      }
+      else if (match_literal(&st, "null"))
+      {
+        good = emit(&st, TAPE_NULL, 0);
+      }
+      else if (match_literal(&st, "true"))
+      {
+        good = emit(&st, TAPE_TRUE, 0);
+      }
+      else if (match_literal(&st, "false"))
+      {
+        good = emit(&st, TAPE_FALSE, 0);
+      }
+      else
+      {
+        syntax_error(&st);
+        good = false;
+      }
+      if (!good)
+        goto done;
+    }
+
+  after_value:
+    // Dopo un valore completo: separatori e chiusure dei contenitori.
+    for (;;)
+    {
+      if (st.depth == 0)
+        goto done;
+      pframe *f = &st.stack[st.depth - 1];
+      skip_ws(&st);
+      if (st.p >= st.end)
+      {
+        syntax_error(&st);
+        goto done;
+      }
+      if (*st.p == ',')
+      {
+        ++st.p;
+        if (f->is_object)
+        {
+          if (!parse_member_key(&st, &cur_schema, &cur_skip))
+            goto done;
+        }
+        else
+        {
+          if (!next_child(&st))
+            goto done;
+          cur_schema = next_item_schema(&st, &cur_skip);
+        }
+        break;
+      }
+      if (*st.p == (f->is_object ? '}' : ']'))
+      {
+        ++st.p;
+        if (!close_frame(&st))
+          goto done;
+        continue;
+      }
+      syntax_error(&st);
+      goto done;
+    }
+  }
+
+done:
+  while (st.depth > 0)
+    free_frame(&st.stack[--st.depth]);
+  mem_free(st.stack);
+  if (st.status != PAYLOAD_OK)
+  {
+    // il testo resta al chiamante
+    st.tape.text = NULL;
+    payload_tape_free(&st.tape);
+    if (error_msg)
+      *error_msg = st.error_msg;
+    else
+      mem_free(st.error_msg);
+    return st.status;
+  }
+  *out = st.tape;
+  return PAYLOAD_OK;
+}
+
+payload_status payload_parse(char *text, size_t len, cJSON *schema, const jsval_ctx *ctx,
+                             const payload_limits *limits, payload_tape *out, char **error_msg)
+{
+  mem_account *acct = ctx ? ctx->memory : NULL;
+  if (!acct)
+    return parse_text(text, len, schema, ctx, limits, out, error_msg);
+  mem_account *prev = mem_account_enter(acct);
+  mem_account_phase(acct, "parsing body");
+  payload_status status = parse_text(text, len, schema, ctx, limits, out, error_msg);
+  mem_account_enter(prev);
+  return status;
+}
+
+// ---------------------------------------------------------------------------
+// Parser incrementale: gli stessi passi di payload_parse guidati da un automa
+// che riprende a ogni blocco. Il token in corso (stringa, numero, letterale)
+// è l'unico stato oltre allo stack dei contenitori; le stringhe vengono
+// decodificate direttamente nell'area di testo del tape.
+
+typedef enum
+{
+  PUSH_VALUE,          // un valore
+  PUSH_VALUE_OR_CLOSE, // dopo '[': un valore oppure ']'
+  PUSH_KEY_OR_CLOSE,   // dopo '{': una chiave oppure '}'
+  PUSH_KEY,            // dopo ',' in un oggetto
+  PUSH_COLON,          // dopo una chiave
+  PUSH_AFTER,          // dopo un valore: ',' oppure la chiusura
+  PUSH_DONE            // valore radice completo: il resto viene ignorato
+} push_expect;
+
+typedef enum
+{
+  TOKEN_NONE,
+  TOKEN_STRING,
+  TOKEN_NUMBER,
+  TOKEN_LITERAL
+} push_token;
+
+struct payload_push
+{
+  pstate st; // tape, contenitori, limiti ed esito (i cursori non sono usati)
+  size_t offset; // byte ricevuti prima del blocco corrente
+  size_t bom;    // byte del BOM UTF-8 già riconosciuti
+  push_expect expect;
+  cJSON *cur_schema;
+  bool cur_skip;
+  // valore che il validatore non esaminerà: solo verificato, come skip_value
+  bool skipping;
+  char *skip_open; // contenitori aperti nel valore saltato ('{' / '[')
+  size_t skip_count;
+  size_t skip_cap;
+  // token in corso
+  push_token token;
+  bool key;            // la stringa è una chiave
+  bool store;          // la stringa va nel tape
+  long long max_length;
+  uint64_t str_off;    // inizio della stringa nel testo del tape
+  size_t visible;      // come in parse_string
+  bool nul_seen;
+  char esc[12];        // sequenza di escape in corso (al più una coppia \uXXXX)
+  size_t esc_len;
+  size_t key_entry;    // voce della chiave in attesa di ':'
+  char *num;           // lessema numerico in corso
+  size_t num_len;
+  size_t num_cap;
+  const char *literal;
+  size_t literal_pos;
+};
+
+static void push_syntax_error(payload_push *pp, size_t at)
+{
+  fail(&pp->st, PAYLOAD_SYNTAX_ERROR, "JSON non valido all'offset %zu", at);
+}
+
+payload_push *payload_push_create(cJSON *schema, const jsval_ctx *ctx, const payload_limits *limits)
+{
+  payload_push *pp = (payload_push *)mem_calloc(1, sizeof(payload_push));
+  if (!pp)
+    return NULL;
+  pp->st.ctx = ctx;
+  pp->st.limits = limits ? *limits : payload_limits_default();
+  pp->st.budget = req_budget_meter_of(ctx ? ctx->budget : NULL);
+  payload_tape_init(&pp->st.tape);
+  pp->st.tape.symbols = ctx ? ctx->symbols : NULL;
+  pp->cur_schema = resolve_schema(&pp->st, schema);
+  pp->expect = PUSH_VALUE;
+  return pp;
+}
+
+void payload_push_free(payload_push *pp)
+{
+  if (!pp)
+    return;
+  while (pp->st.depth > 0)
+    free_frame(&pp->st.stack[--pp->st.depth]);
+  mem_free(pp->st.stack);
+  payload_tape_free(&pp->st.tape);
+  mem_free(pp->st.error_msg);
+  mem_free(pp->skip_open);
+  mem_free(pp->num);
+  mem_free(pp);
+}
+
+// Il contenitore in cima (saltato o nel tape) è un oggetto.
+static bool push_in_object(const payload_push *pp)
+{
+  if (pp->skipping && pp->skip_count > 0)
+    return pp->skip_open[pp->skip_count - 1] == '{';
+  return pp->st.stack[pp->st.depth - 1].is_object;
+}
+
+// Un valore è terminato: chiude il valore saltato o la radice.
+static bool push_value_done(payload_push *pp)
+{
+  if (pp->skipping && pp->skip_count == 0)
+  {
+    pp->skipping = false;
+    if (!emit(&pp->st, TAPE_SKIPPED, 0))
+      return false;
+  }
+  pp->expect = !pp->skipping && pp->st.depth == 0 ? PUSH_DONE : PUSH_AFTER;
+  return true;
+}
+
+// Chiude il contenitore in cima con `c` (già verificato).
+static bool push_close(payload_push *pp)
+{
+  if (pp->skipping)
+    --pp->skip_count;
+  else if (!close_frame(&pp->st))
+    return false;
+  return push_value_done(pp);
+}
+
+// Prepara il prossimo elemento dell'array in cima.
+static bool push_next_item(payload_push *pp)
+{
+  if (!pp->skipping)
+  {
+    if (!next_child(&pp->st))
+      return false;
+    pp->cur_schema = next_item_schema(&pp->st, &pp->cur_skip);
+  }
+  pp->expect = PUSH_VALUE;
+  return true;
+}
+
+static void push_start_string(payload_push *pp, bool key)
+{
+  pp->token = TOKEN_STRING;
+  pp->key = key;
+  pp->store = !pp->skipping;
+  pp->max_length = -1;
+  if (pp->store && !key && pp->cur_schema)
+  {
+    js_size_limits lim;
+    limits_of(&pp->st, pp->cur_schema, &lim);
+    pp->max_length = lim.max_length;
+  }
+  pp->str_off = pp->st.tape.text_len;
+  pp->visible = 0;
+  pp->nul_seen = false;
+  pp->esc_len = 0;
+}
+
+// Aggiunge byte decodificati alla stringa in corso.
+static bool push_string_bytes(payload_push *pp, const char *s, size_t n, bool escaped_nul)
+{
+  if (escaped_nul)
+    pp->nul_seen = true;
+  if (!pp->nul_seen)
+    pp->visible += n;
+  if (pp->max_length >= 0 && (long long)pp->visible > pp->max_length)
+  {
+    fail(&pp->st, PAYLOAD_LIMIT_EXCEEDED, "Stringa più lunga di maxLength");
+    return false;
+  }
+  if (pp->store && !payload_tape_append_text(&pp->st.tape, s, n))
+  {
+    fail(&pp->st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+    return false;
+  }
+  return true;
+}
+
+// Sequenza di escape completa in pp->esc: 1 se decodificata in `out`, 0 se
+// servono altri byte, -1 se non valida.
+static int push_escape(payload_push *pp, char *out, size_t *out_len)
+{
+  const char *e = pp->esc;
+  size_t n = pp->esc_len;
+  if (n < 2)
+    return 0;
+  *out_len = 1;
+  switch (e[1])
+  {
+  case '"': out[0] = '"'; return 1;
+  case '\\': out[0] = '\\'; return 1;
+  case '/': out[0] = '/'; return 1;
+  case 'b': out[0] = '\b'; return 1;
+  case 'f': out[0] = '\f'; return 1;
+  case 'n': out[0] = '\n'; return 1;
+  case 'r': out[0] = '\r'; return 1;
+  case 't': out[0] = '\t'; return 1;
+  case 'u':
+    break;
+  default:
+    return -1;
+  }
+  unsigned cp;
+  if (n < 6)
+    return 0;
+  if (!parse_hex4(e + 2, e + 6, &cp) || (cp >= 0xDC00 && cp <= 0xDFFF))
+    return -1;
+  if (cp >= 0xD800 && cp <= 0xDBFF)
+  {
+    if ((n > 6 && e[6] != '\\') || (n > 7 && e[7] != 'u'))
+      return -1;
+    if (n < 12)
+      return 0;
+    unsigned lo;
+    if (!parse_hex4(e + 8, e + 12, &lo) || lo < 0xDC00 || lo > 0xDFFF)
+      return -1;
+    cp = 0x10000 + (((cp & 0x3FF) << 10) | (lo & 0x3FF));
+  }
+  if (cp < 0x80)
+  {
+    out[0] = (char)cp;
+  }
+  else if (cp < 0x800)
+  {
+    out[0] = (char)(0xC0 | (cp >> 6));
+    out[1] = (char)(0x80 | (cp & 0x3F));
+    *out_len = 2;
+  }
+  else if (cp < 0x10000)
+  {
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    *out_len = 3;
+  }
+  else
+  {
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    *out_len = 4;
+  }
+  return 1;
+}
+
+// La stringa in corso è terminata (virgolette di chiusura consumate).
+static bool push_end_string(payload_push *pp)
+{
+  pp->token = TOKEN_NONE;
+  if (pp->store)
+  {
+    if (!payload_tape_append_text(&pp->st.tape, "", 1))
+    {
+      fail(&pp->st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+      return false;
+    }
+    if (!emit(&pp->st, TAPE_STRING, pp->str_off) || !emit_word(&pp->st, pp->visible))
+      return false;
+  }
+  if (pp->key)
+  {
+    pp->key_entry = pp->st.tape.count - 2;
+    pp->expect = PUSH_COLON;
+    return true;
+  }
+  return push_value_done(pp);
+}
+
+// Consuma i byte della stringa in corso (il blocco inizia all'offset `base`
+// con `data`); restituisce il cursore successivo.
+static const char *push_string(payload_push *pp, const char *p, const char *end, const char *data, size_t base)
+{
+  while (p < end)
+  {
+    if (pp->esc_len > 0)
+    {
+      pp->esc[pp->esc_len++] = *p++;
+      char out[4];
+      size_t out_len;
+      int r = push_escape(pp, out, &out_len);
+      if (r < 0)
+      {
+        push_syntax_error(pp, base + (size_t)(p - data) - 1);
+        return end;
+      }
+      if (r == 0)
+        continue;
+      pp->esc_len = 0;
+      if (!push_string_bytes(pp, out, out_len, out[0] == '\0'))
+        return end;
+      continue;
+    }
+    const char *run = p;
+    while (p < end && *p != '"' && *p != '\\')
+      ++p;
+    if (p > run && !push_string_bytes(pp, run, (size_t)(p - run), false))
+      return end;
+    if (p == end)
+      break;
+    if (*p++ == '"')
+    {
+      push_end_string(pp);
+      return p;
+    }
+    pp->esc[0] = '\\';
+    pp->esc_len = 1;
+  }
+  return p;
+}
+
+static bool is_number_char(char c)
+{
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static bool push_number_bytes(payload_push *pp, const char *s, size_t n)
+{
+  if (pp->num_len + n > pp->num_cap)
+  {
+    size_t new_cap = pp->num_cap ? pp->num_cap : 32;
+    while (pp->num_len + n > new_cap)
+      new_cap *= 2;
+    char *nn = (char *)mem_realloc(pp->num, new_cap);
+    if (!nn)
+    {
+      fail(&pp->st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+      return false;
+    }
+    pp->num = nn;
+    pp->num_cap = new_cap;
+  }
+  memcpy(pp->num + pp->num_len, s, n);
+  pp->num_len += n;
+  return true;
+}
+
+// Il numero in corso è delimitato (dal byte successivo o dalla fine).
+static bool push_end_number(payload_push *pp, size_t at)
+{
+  pp->token = TOKEN_NONE;
+  size_t len = js_number_lexeme_len(pp->num, pp->num + pp->num_len);
+  bool root = !pp->skipping && pp->st.depth == 0;
+  // dopo il lessema seguirebbero byte che nessun contenitore accetta; dopo
+  // la radice vengono ignorati come in payload_parse
+  if (len == 0 || (len < pp->num_len && !root))
+  {
+    push_syntax_error(pp, at - pp->num_len + len);
+    return false;
+  }
+  if (!pp->skipping && !emit_number(&pp->st, pp->num, len, pp->cur_schema, NUMBER_COPY))
+    return false;
+  return push_value_done(pp);
+}
+
+// Inizia un valore con il byte `c` (non spazio).
+static bool push_start_value(payload_push *pp, char c, size_t at)
+{
+  pstate *st = &pp->st;
+  if (!pp->skipping && pp->cur_skip)
+  {
+    pp->skipping = true;
+    pp->skip_count = 0;
+  }
+  if (!count_element(st))
+    return false;
+  if (c == '{' || c == '[')
+  {
+    if (pp->skipping)
+    {
+      if (st->limits.max_depth && st->depth + pp->skip_count + 1 > st->limits.max_depth)
+      {
+        fail(st, PAYLOAD_LIMIT_EXCEEDED, "Nidificazione oltre il limite di %zu livelli", st->limits.max_depth);
+        return false;
+      }
+      if (pp->skip_count == pp->skip_cap)
+      {
+        size_t new_cap = pp->skip_cap ? pp->skip_cap * 2 : 64;
+        char *ns = (char *)mem_realloc(pp->skip_open, new_cap);
+        if (!ns)
+        {
+          fail(st, PAYLOAD_NO_MEMORY, "Memoria insufficiente");
+          return false;
+        }
+        pp->skip_open = ns;
+        pp->skip_cap = new_cap;
+      }
+      pp->skip_open[pp->skip_count++] = c;
+    }
+    else
+    {
+      bool exclusive = pp->cur_schema && (st->depth == 0 || st->stack[st->depth - 1].exclusive);
+      if (!push_frame(st, c == '{', pp->cur_schema, exclusive))
+        return false;
+    }
+    pp->expect = c == '{' ? PUSH_KEY_OR_CLOSE : PUSH_VALUE_OR_CLOSE;
+    return true;
+  }
+  if (c == '"')
+  {
+    push_start_string(pp, false);
+    return true;
+  }
+  if (c == '-' || (c >= '0' && c <= '9'))
+  {
+    pp->token = TOKEN_NUMBER;
+    pp->num_len = 0;
+    return push_number_bytes(pp, &c, 1);
+  }
+  pp->literal = c == 't' ? "true" : c == 'f' ? "false" : c == 'n' ? "null" : NULL;
+  if (!pp->literal)
+  {
+    push_syntax_error(pp, at);
+    return false;
+  }
+  pp->token = TOKEN_LITERAL;
+  pp->literal_pos = 1;
+  return true;
+}
+
+static payload_status push_feed(payload_push *pp, const char *data, size_t len)
+{
+  pstate *st = &pp->st;
+  if (st->status != PAYLOAD_OK)
+    return st->status;
+  const char *p = data;
+  const char *end = data + len;
+  size_t base = pp->offset;
+  pp->offset += len;
+  if (st->limits.max_bytes && pp->offset > st->limits.max_bytes)
+  {
+    fail(st, PAYLOAD_LIMIT_EXCEEDED, "Payload oltre il limite di %zu byte", st->limits.max_bytes);
+    return st->status;
+  }
+  // BOM UTF-8 iniziale, eventualmente diviso tra più blocchi
+  while (base + (size_t)(p - data) < 3 && p < end && pp->bom == base + (size_t)(p - data) &&
+         (unsigned char)*p == (unsigned char)"\xEF\xBB\xBF"[pp->bom])
+  {
+    ++pp->bom;
+    ++p;
+  }
+  if (pp->bom > 0 && pp->bom < 3 && p < end)
+  {
+    push_syntax_error(pp, 0);
+    return st->status;
+  }
+
+  while (p < end && st->status == PAYLOAD_OK && pp->expect != PUSH_DONE)
+  {
+    size_t at = base + (size_t)(p - data);
+    switch (pp->token)
+    {
+    case TOKEN_STRING:
+      p = push_string(pp, p, end, data, base);
+      continue;
+    case TOKEN_NUMBER:
+    {
+      const char *run = p;
+      while (p < end && is_number_char(*p))
+        ++p;
+      if (!push_number_bytes(pp, run, (size_t)(p - run)))
+        continue;
+      if (p < end)
+        push_end_number(pp, base + (size_t)(p - data));
+      continue;
+    }
+    case TOKEN_LITERAL:
+      if (*p != pp->literal[pp->literal_pos])
+      {
+        push_syntax_error(pp, at);
+        continue;
+      }
+      ++p;
+      if (pp->literal[++pp->literal_pos] == '\0')
+      {
+        pp->token = TOKEN_NONE;
+        if (!pp->skipping)
+        {
+          payload_tape_tag tag = pp->literal[0] == 't' ? TAPE_TRUE : pp->literal[0] == 'f' ? TAPE_FALSE : TAPE_NULL;
+          if (!emit(st, tag, 0))
+            continue;
+        }
+        push_value_done(pp);
+      }
+      continue;
+    case TOKEN_NONE:
+      break;
+    }
+
+    char c = *p;
+    if ((unsigned char)c <= 32)
+    {
+      ++p;
+      continue;
+    }
+    ++p;
+    switch (pp->expect)
+    {
+    case PUSH_VALUE_OR_CLOSE:
+      if (c == ']')
+      {
+        push_close(pp);
+        break;
+      }
+      if (!push_next_item(pp))
+        break;
+      push_start_value(pp, c, at);
+      break;
+    case PUSH_VALUE:
+      push_start_value(pp, c, at);
+      break;
+    case PUSH_KEY_OR_CLOSE:
+      if (c == '}')
+      {
+        push_close(pp);
+        break;
+      }
+      if (c != '"')
+        push_syntax_error(pp, at);
+      else
+        push_start_string(pp, true);
+      break;
+    case PUSH_KEY:
+      if (c != '"')
+        push_syntax_error(pp, at);
+      else
+        push_start_string(pp, true);
+      break;
+    case PUSH_COLON:
+      if (c != ':')
+        push_syntax_error(pp, at);
+      else if (pp->skipping || member_schema(st, pp->key_entry, &pp->cur_schema, &pp->cur_skip))
+        pp->expect = PUSH_VALUE;
+      break;
+    case PUSH_AFTER:
+      if (c == ',')
+      {
+        if (push_in_object(pp))
+          pp->expect = PUSH_KEY;
+        else
+          push_next_item(pp);
+      }
+      else if (c == (push_in_object(pp) ? '}' : ']'))
+      {
+        push_close(pp);
+      }
+      else
+      {
+        push_syntax_error(pp, at);
+      }
+      break;
+    case PUSH_DONE:
+      break;
+    }
+  }
+  return st->status;
+}
+
+payload_status payload_push_feed(payload_push *pp, const char *data, size_t len)
+{
+  mem_account *acct = pp->st.ctx ? pp->st.ctx->memory : NULL;
+  mem_account *prev = acct ? mem_account_enter(acct) : NULL;
+  payload_status status = push_feed(pp, data, len);
+  if (acct)
+    mem_account_enter(prev);
+  return status;
+}
+
+static payload_status push_finish(payload_push *pp, payload_tape *out, char **error_msg)
+{
+  pstate *st = &pp->st;
+  payload_tape_init(out);
+  if (error_msg)
+    *error_msg = NULL;
+  if (st->status == PAYLOAD_OK && pp->token == TOKEN_NUMBER)
+    push_end_number(pp, pp->offset);
+  // payload_parse conta il primo elemento di un array appena aperto
+  // (maxItems) prima di leggerlo
+  if (st->status == PAYLOAD_OK && pp->expect == PUSH_VALUE_OR_CLOSE)
+    push_next_item(pp);
+  if (st->status == PAYLOAD_OK && pp->expect != PUSH_DONE)
+    push_syntax_error(pp, pp->offset);
+  if (st->status != PAYLOAD_OK)
+  {
+    if (error_msg)
+    {
+      *error_msg = st->error_msg;
+      st->error_msg = NULL;
+    }
+    return st->status;
+  }
+  *out = st->tape;
+  payload_tape_init(&st->tape);
+  return PAYLOAD_OK;
+}
+
+payload_status payload_push_finish(payload_push *pp, payload_tape *out, char **error_msg)
+{
+  mem_account *acct = pp->st.ctx ? pp->st.ctx->memory : NULL;
+  mem_account *prev = acct ? mem_account_enter(acct) : NULL;
+  payload_status status = push_finish(pp, out, error_msg);
+  if (acct)
+    mem_account_enter(prev);
+  return status;
+}
@@ -0,0 +1,341 @@
+#include "payload_tape.h"
+#include "mem_account.h"
+#include "json_number.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+void payload_tape_init(payload_tape *t)
+{
+  memset(t, 0, sizeof(*t));
+}
+
+// Libera le voci e il testo a cui puntano.
+void payload_tape_free(payload_tape *t)
+{
+  if (!t)
+    return;
+  mem_free(t->entries);
+  mem_free(t->text);
+  payload_tape_init(t);
+}
+
+bool payload_tape_emit_word(payload_tape *t, uint64_t word)
+{
+  if (t->count == t->cap)
+  {
+    size_t new_cap = t->cap ? t->cap * 2 : 64;
+    uint64_t *ne = (uint64_t *)mem_realloc(t->entries, new_cap * sizeof(uint64_t));
+    if (!ne)
+      return false;
+    t->entries = ne;
+    t->cap = new_cap;
+  }
+  t->entries[t->count++] = word;
+  return true;
+}
+
+bool payload_tape_emit(payload_tape *t, payload_tape_tag tag, uint64_t data)
+{
+  return payload_tape_emit_word(t, ((uint64_t)tag << 56) | (data & TAPE_PAYLOAD_MASK));
+}
+
+double payload_tape_number(payload_tape *t, size_t i)
+{
+  double d;
+  switch (payload_tape_tag_at(t, i))
+  {
+  case TAPE_INT:
+    return (double)(int64_t)t->entries[i + 1];
+  case TAPE_DOUBLE:
+    memcpy(&d, &t->entries[i + 1], sizeof(d));
+    return d;
+  case TAPE_RAWNUM:
+    d = js_number_decode(payload_tape_string(t, i), (size_t)t->entries[i + 1]);
+    t->entries[i] = (uint64_t)TAPE_DOUBLE << 56;
+    memcpy(&t->entries[i + 1], &d, sizeof(d));
+    return d;
+  default:
+    return 0.0;
+  }
+}
+
+bool payload_tape_is_integer(payload_tape *t, size_t i)
+{
+  if (payload_tape_tag_at(t, i) == TAPE_INT)
+    return true;
+  return js_number_is_integral(payload_tape_number(t, i));
+}
+
+size_t payload_tape_find(const payload_tape *t, size_t obj, const char *name, js_symbol sym)
+{
+  size_t end = (size_t)payload_tape_data(t, obj);
+  if (sym)
+  {
+    for (size_t k = obj + 1; k < end; k = payload_tape_next(t, k + 2))
+    {
+      if (payload_tape_key_symbol(t, k) == sym)
+        return k + 2;
+    }
+    return TAPE_NONE;
+  }
+  for (size_t k = obj + 1; k < end; k = payload_tape_next(t, k + 2))
+  {
+    if (strcmp(payload_tape_string(t, k), name) == 0)
+      return k + 2;
+  }
+  return TAPE_NONE;
+}
+
+// Confronto senza distinzione tra maiuscole e minuscole, come cJSON.
+static bool equal_ci(const char *a, const char *b)
+{
+  for (; tolower((unsigned char)*a) == tolower((unsigned char)*b); ++a, ++b)
+  {
+    if (*a == '\0')
+      return true;
+  }
+  return false;
+}
+
+bool payload_tape_has_ci(const payload_tape *t, size_t obj, const char *name)
+{
+  size_t end = (size_t)payload_tape_data(t, obj);
+  for (size_t k = obj + 1; k < end; k = payload_tape_next(t, k + 2))
+  {
+    if (equal_ci(payload_tape_string(t, k), name))
+      return true;
+  }
+  return false;
+}
+
+bool payload_tape_append_text(payload_tape *t, const char *s, size_t n)
+{
+  if (t->text_len + n + 1 > t->text_cap)
+  {
+    size_t new_cap = t->text_cap ? t->text_cap : 256;
+    while (t->text_len + n + 1 > new_cap)
+      new_cap *= 2;
+    char *nt = (char *)mem_realloc(t->text, new_cap);
+    if (!nt)
+      return false;
+    t->text = nt;
+    t->text_cap = new_cap;
+  }
+  memcpy(t->text + t->text_len, s, n);
+  t->text_len += n;
+  return true;
+}
+
+// Copia `s` nell'area di testo del tape e ne restituisce l'offset.
+static bool text_put(payload_tape *t, const char *s, uint64_t *off, size_t *len_out)
+{
+  size_t len = strlen(s);
+  *off = t->text_len;
+  *len_out = len;
+  return payload_tape_append_text(t, s, len + 1);
+}
+
+static bool emit_string(payload_tape *t, const char *s, bool is_key)
+{
+  uint64_t off;
+  size_t len;
+  if (!text_put(t, s ? s : "", &off, &len))
+    return false;
+  uint64_t sym = is_key ? js_symtab_lookup(t->symbols, t->text + off, len) : 0;
+  return payload_tape_emit(t, TAPE_STRING, off) && payload_tape_emit_word(t, len | (sym << TAPE_LEN_BITS));
+}
+
+// Contenitore cJSON in corso di conversione.
+typedef struct conv_frame
+{
+  const cJSON *next;
+  size_t start;
+  size_t count;
+  bool is_object;
+} conv_frame;
+
+// Emette `v`; se è un contenitore lo apre aggiungendo un frame.
+static bool emit_cjson_value(payload_tape *t, const cJSON *v, conv_frame **stack, size_t *depth, size_t *cap)
+{
+  if (cJSON_IsObject(v) || cJSON_IsArray(v))
+  {
+    if (*depth == *cap)
+    {
+      size_t new_cap = *cap ? *cap * 2 : 16;
+      conv_frame *ns = (conv_frame *)mem_realloc(*stack, new_cap * sizeof(conv_frame));
+      if (!ns)
+        return false;
+      *stack = ns;
+      *cap = new_cap;
+    }
+    conv_frame *f = &(*stack)[(*depth)++];
+    f->next = v->child;
+    f->start = t->count;
+    f->count = 0;
+    f->is_object = cJSON_IsObject(v);
+    return payload_tape_emit(t, f->is_object ? TAPE_OBJECT : TAPE_ARRAY, 0);
+  }
+  if (cJSON_IsString(v))
+    return emit_string(t, v->valuestring, false);
+  if (cJSON_IsNumber(v))
+  {
+    uint64_t bits;
+    memcpy(&bits, &v->valuedouble, sizeof(bits));
+    return payload_tape_emit(t, TAPE_DOUBLE, 0) && payload_tape_emit_word(t, bits);
+  }
+  if (cJSON_IsTrue(v))
+    return payload_tape_emit(t, TAPE_TRUE, 0);
+  if (cJSON_IsFalse(v))
+    return payload_tape_emit(t, TAPE_FALSE, 0);
+  if (cJSON_IsRaw(v))
+    return payload_tape_emit(t, TAPE_SKIPPED, 0);
+  return payload_tape_emit(t, TAPE_NULL, 0);
+}
+
+bool payload_tape_from_cjson(payload_tape *out, const cJSON *root, const js_symtab *symbols)
+{
+  payload_tape_init(out);
+  out->symbols = symbols;
+  conv_frame *stack = NULL;
+  size_t depth = 0, cap = 0;
+  bool good = root && emit_cjson_value(out, root, &stack, &depth, &cap);
+  while (good && depth > 0)
+  {
+    conv_frame *f = &stack[depth - 1];
+    if (!f->next)
+    {
+      size_t start = f->start;
+      size_t count = f->count;
+      --depth;
+      out->entries[start] |= (uint64_t)out->count & TAPE_PAYLOAD_MASK;
+      good = payload_tape_emit(out, TAPE_END, count);
+      continue;
+    }
+    const cJSON *child = f->next;
+    f->next = child->next;
+    ++f->count;
+    if (f->is_object && !emit_string(out, child->string, true))
+      good = false;
+    else
+      good = emit_cjson_value(out, child, &stack, &depth, &cap);
+  }
+  mem_free(stack);
+  if (!good)
+    payload_tape_free(out);
+  return good;
+}
+
+cJSON *payload_tape_to_cjson(payload_tape *t)
+{
+  cJSON *root = NULL;
+  cJSON **open = NULL;
+  size_t depth = 0, cap = 0;
+  const char *key = NULL;
+  size_t i = 0;
+  while (i < t->count)
+  {
+    payload_tape_tag tag = payload_tape_tag_at(t, i);
+    if (tag == TAPE_END)
+    {
+      --depth;
+      ++i;
+      continue;
+    }
+    cJSON *top = depth ? open[depth - 1] : NULL;
+    if (top && cJSON_IsObject(top) && !key)
+    {
+      key = payload_tape_string(t, i);
+      i += 2;
+      continue;
+    }
+
+    cJSON *item = NULL;
+    switch (tag)
+    {
+    case TAPE_OBJECT: item = cJSON_CreateObject(); break;
+    case TAPE_ARRAY: item = cJSON_CreateArray(); break;
+    case TAPE_STRING: item = cJSON_CreateString(payload_tape_string(t, i)); break;
+    case TAPE_INT:
+    case TAPE_DOUBLE:
+    case TAPE_RAWNUM: item = cJSON_CreateNumber(payload_tape_number(t, i)); break;
+    case TAPE_TRUE: item = cJSON_CreateTrue(); break;
+    case TAPE_FALSE: item = cJSON_CreateFalse(); break;
+    case TAPE_SKIPPED:
+      item = cJSON_CreateNull();
+      if (item)
+        item->type = cJSON_Raw;
+      break;
+    default: item = cJSON_CreateNull(); break;
+    }
+    if (!item)
+      goto fail;
+    if (key)
+    {
+      size_t len = strlen(key);
+      item->string = (char *)cJSON_malloc(len + 1);
+      if (!item->string)
+      {
+        cJSON_Delete(item);
+        goto fail;
+      }
+      memcpy(item->string, key, len + 1);
+      key = NULL;
+    }
+    if (top)
+      cJSON_AddItemToArray(top, item);
+    else
+      root = item;
+
+    if (tag == TAPE_OBJECT || tag == TAPE_ARRAY)
+    {
+      if (depth == cap)
+      {
+        size_t new_cap = cap ? cap * 2 : 16;
+        cJSON **no = (cJSON **)mem_realloc(open, new_cap * sizeof(cJSON *));
+        if (!no)
+          goto fail;
+        open = no;
+        cap = new_cap;
+      }
+      open[depth++] = item;
+      ++i;
+    }
+    else
+    {
+      i = payload_tape_next(t, i);
+    }
+  }
+  mem_free(open);
+  return root;
+
+fail:
+  mem_free(open);
+  payload_free(root);
+  return NULL;
+}
+
+void payload_free(cJSON *item)
+{
+  while (item)
+  {
+    // i figli vengono agganciati subito dopo il nodo nella catena dei
+    // fratelli: la visita resta piatta qualunque sia la profondità
+    if (!(item->type & cJSON_IsReference) && item->child)
+    {
+      cJSON *last = item->child;
+      while (last->next)
+        last = last->next;
+      last->next = item->next;
+      item->next = item->child;
+      item->child = NULL;
+    }
+    cJSON *next = item->next;
+    if (!(item->type & cJSON_IsReference) && item->valuestring)
+      cJSON_free(item->valuestring);
+    if (!(item->type & cJSON_StringIsConst) && item->string)
+      cJSON_free(item->string);
+    cJSON_free(item);
+    item = next;
+  }
+}
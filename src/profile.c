@@ -0,0 +1,304 @@
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "profile.h"
+#include "ptrmap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Intervalli conservati singolarmente per la trace; oltre il limite restano
+// solo gli aggregati (un payload con molti elementi e $ref ne apre milioni).
+#define PROFILE_MAX_EVENTS 200000
+// Sotto-schemi elencati nella tabella.
+#define PROFILE_TOP_SCHEMAS 20
+
+typedef struct prof_open
+{
+  const char *name;
+  const char *detail;
+  uint64_t start;
+  uint64_t child; // durata degli intervalli annidati già chiusi
+  size_t agg;     // indice in aggs + 1, 0 se non registrato
+} prof_open;
+
+typedef struct prof_event
+{
+  const char *name;
+  const char *detail;
+  uint64_t start;
+  uint64_t dur;
+  uint32_t depth;
+} prof_event;
+
+typedef struct prof_agg
+{
+  const char *name;
+  const char *detail;
+  uint32_t depth; // del primo intervallo con questo nome
+  uint64_t calls;
+  uint64_t total;
+  uint64_t self;
+} prof_agg;
+
+struct profile
+{
+  bool schemas;
+  uint64_t origin;
+  prof_open *open;
+  size_t open_count;
+  size_t open_cap;
+  size_t ignored; // intervalli aperti dopo un errore di memoria
+  prof_event *events;
+  size_t event_count;
+  size_t event_cap;
+  uint64_t dropped;
+  prof_agg *aggs;
+  size_t agg_count;
+  size_t agg_cap;
+  ptrmap by_key; // detail (o name) -> indice in aggs + 1
+  bool incomplete;
+};
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+#ifdef _MSC_VER
+  timespec_get(&ts, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static bool grow(void **buf, size_t *cap, size_t need, size_t elem)
+{
+  if (need <= *cap)
+    return true;
+  size_t ncap = *cap ? *cap * 2 : 32;
+  while (ncap < need)
+    ncap *= 2;
+  void *nb = realloc(*buf, ncap * elem);
+  if (!nb)
+    return false;
+  *buf = nb;
+  *cap = ncap;
+  return true;
+}
+
+profile *profile_create(bool schemas)
+{
+  profile *p = (profile *)calloc(1, sizeof(profile));
+  if (!p)
+    return NULL;
+  if (!ptrmap_init(&p->by_key, 64))
+  {
+    free(p);
+    return NULL;
+  }
+  p->schemas = schemas;
+  p->origin = now_ns();
+  return p;
+}
+
+void profile_free(profile *p)
+{
+  if (!p)
+    return;
+  ptrmap_free(&p->by_key);
+  free(p->open);
+  free(p->events);
+  free(p->aggs);
+  free(p);
+}
+
+bool profile_schemas(const profile *p)
+{
+  return p && p->schemas;
+}
+
+// Indice + 1 dell'aggregato con la chiave di (name, detail), creato alla
+// prima apertura così la tabella elenca le fasi in ordine di inizio; 0 se la
+// memoria non basta.
+static size_t agg_index(profile *p, const char *name, const char *detail, uint32_t depth)
+{
+  const void *key = detail ? (const void *)detail : (const void *)name;
+  size_t idx = (size_t)(uintptr_t)ptrmap_get(&p->by_key, key);
+  if (idx != 0)
+    return idx;
+  if (!grow((void **)&p->aggs, &p->agg_cap, p->agg_count + 1, sizeof(prof_agg)) ||
+      !ptrmap_put(&p->by_key, key, (void *)(uintptr_t)(p->agg_count + 1)))
+  {
+    p->incomplete = true;
+    return 0;
+  }
+  prof_agg *a = &p->aggs[p->agg_count++];
+  memset(a, 0, sizeof(*a));
+  a->name = name;
+  a->detail = detail;
+  a->depth = depth;
+  return p->agg_count;
+}
+
+void profile_begin(profile *p, const char *name, const char *detail)
+{
+  if (!p)
+    return;
+  if (p->ignored || !grow((void **)&p->open, &p->open_cap, p->open_count + 1, sizeof(prof_open)))
+  {
+    p->incomplete = true;
+    ++p->ignored;
+    return;
+  }
+  size_t agg = agg_index(p, name, detail, (uint32_t)p->open_count);
+  prof_open *o = &p->open[p->open_count++];
+  o->name = name;
+  o->detail = detail;
+  o->child = 0;
+  o->agg = agg;
+  o->start = now_ns();
+}
+
+void profile_end(profile *p)
+{
+  if (!p)
+    return;
+  if (p->ignored)
+  {
+    --p->ignored;
+    return;
+  }
+  if (p->open_count == 0)
+    return;
+  uint64_t t = now_ns();
+  prof_open *o = &p->open[--p->open_count];
+  uint64_t dur = t - o->start;
+  uint32_t depth = (uint32_t)p->open_count;
+  if (depth > 0)
+    p->open[depth - 1].child += dur;
+  if (o->agg)
+  {
+    prof_agg *a = &p->aggs[o->agg - 1];
+    ++a->calls;
+    a->total += dur;
+    a->self += dur > o->child ? dur - o->child : 0;
+  }
+  if (p->event_count >= PROFILE_MAX_EVENTS ||
+      !grow((void **)&p->events, &p->event_cap, p->event_count + 1, sizeof(prof_event)))
+  {
+    ++p->dropped;
+    return;
+  }
+  prof_event *e = &p->events[p->event_count++];
+  e->name = o->name;
+  e->detail = o->detail;
+  e->start = o->start - p->origin;
+  e->dur = dur;
+  e->depth = depth;
+}
+
+static bool is_schema_span(const prof_agg *a)
+{
+  return strcmp(a->name, PROFILE_SCHEMA_SPAN) == 0;
+}
+
+static int cmp_self_desc(const void *x, const void *y)
+{
+  const prof_agg *a = (const prof_agg *)x, *b = (const prof_agg *)y;
+  return (a->self < b->self) - (a->self > b->self);
+}
+
+static void print_row(FILE *f, unsigned indent, const char *label, const prof_agg *a, uint64_t total)
+{
+  fprintf(f, "%*s%-*.*s %10.3f %10.3f %9llu %6.1f%%\n", (int)indent, "", (int)(44 - indent),
+          (int)(44 - indent), label, (double)a->total / 1e6, (double)a->self / 1e6,
+          (unsigned long long)a->calls, total ? 100.0 * (double)a->total / (double)total : 0.0);
+}
+
+void profile_print(const profile *p, FILE *f)
+{
+  if (!p)
+    return;
+  uint64_t total = 0;
+  size_t schema_count = 0;
+  for (size_t i = 0; i < p->agg_count; ++i)
+  {
+    if (p->aggs[i].depth == 0)
+      total += p->aggs[i].total;
+    if (is_schema_span(&p->aggs[i]))
+      ++schema_count;
+  }
+  fprintf(f, "%-44s %10s %10s %9s %7s\n", "PROFILO (ms)", "totale", "proprio", "chiamate", "%");
+  for (size_t i = 0; i < p->agg_count; ++i)
+  {
+    const prof_agg *a = &p->aggs[i];
+    if (!is_schema_span(a))
+      print_row(f, 2 * a->depth, a->detail ? a->detail : a->name, a, total);
+  }
+  fprintf(f, "%-44s %10.3f\n", "totale", (double)total / 1e6);
+
+  if (schema_count > 0)
+  {
+    prof_agg *sorted = (prof_agg *)malloc(schema_count * sizeof(prof_agg));
+    if (sorted)
+    {
+      size_t n = 0;
+      for (size_t i = 0; i < p->agg_count; ++i)
+      {
+        if (is_schema_span(&p->aggs[i]))
+          sorted[n++] = p->aggs[i];
+      }
+      qsort(sorted, n, sizeof(prof_agg), cmp_self_desc);
+      fprintf(f, "%-44s %10s %10s %9s %7s\n", "SOTTO-SCHEMI ($ref, per tempo proprio)", "totale", "proprio",
+              "chiamate", "%");
+      for (size_t i = 0; i < n && i < PROFILE_TOP_SCHEMAS; ++i)
+        print_row(f, 2, sorted[i].detail, &sorted[i], total);
+      if (n > PROFILE_TOP_SCHEMAS)
+        fprintf(f, "  ... altri %zu sotto-schemi\n", n - PROFILE_TOP_SCHEMAS);
+      free(sorted);
+    }
+  }
+  if (p->dropped)
+    fprintf(f, "(%llu intervalli oltre il limite di %d non sono nella trace)\n", (unsigned long long)p->dropped,
+            PROFILE_MAX_EVENTS);
+  if (p->incomplete)
+    fprintf(f, "(profilo incompleto: memoria insufficiente)\n");
+}
+
+static void write_json_string(FILE *f, const char *s)
+{
+  fputc('"', f);
+  for (const unsigned char *c = (const unsigned char *)s; *c; ++c)
+  {
+    if (*c == '"' || *c == '\\')
+      fprintf(f, "\\%c", *c);
+    else if (*c < 0x20)
+      fprintf(f, "\\u%04x", *c);
+    else
+      fputc(*c, f);
+  }
+  fputc('"', f);
+}
+
+bool profile_write_trace(const profile *p, const char *path)
+{
+  if (!p)
+    return false;
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+  for (size_t i = 0; i < p->event_count; ++i)
+  {
+    const prof_event *e = &p->events[i];
+    bool schema = strcmp(e->name, PROFILE_SCHEMA_SPAN) == 0;
+    fputs(i ? ",\n{\"name\":" : "\n{\"name\":", f);
+    write_json_string(f, schema && e->detail ? e->detail : e->name);
+    fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"depth\":%u}}",
+            schema ? "schema" : "fase", (double)e->start / 1e3, (double)e->dur / 1e3, e->depth);
+  }
+  fprintf(f, "\n],\"otherData\":{\"dropped\":%llu}}\n", (unsigned long long)p->dropped);
+  bool ok = !ferror(f);
+  return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,1597 @@
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "proxy.h"
+#include "miniyaml.h"
+#include "oas_extract.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Dimensione massima di intestazioni di richiesta e risposta.
+#define PROXY_MAX_HEAD 16384
+#define PROXY_READ_CHUNK 65536
+#define PROXY_MAX_EVENTS 64
+// Oltre questa quantità di dati in attesa verso il client non si leggono
+// altri dati né dal client né dall'upstream (contropressione).
+#define PROXY_MAX_PENDING_OUT (1u << 20)
+// Scadenze delle connessioni client (millisecondi): intestazioni di una
+// richiesta dall'apertura o dal primo byte, attesa tra due letture del
+// body, inattività tra richieste keep-alive e client che non legge la
+// risposta. Il controllo avviene ogni PROXY_SWEEP_MS.
+#define PROXY_HEADER_TIMEOUT_MS 10000.0
+#define PROXY_BODY_TIMEOUT_MS 30000.0
+#define PROXY_IDLE_TIMEOUT_MS 60000.0
+#define PROXY_SWEEP_MS 1000
+
+typedef struct pbuf
+{
+  char *data;
+  size_t len;
+  size_t cap;
+} pbuf;
+
+static bool pbuf_append(pbuf *b, const char *p, size_t n)
+{
+  if (b->len + n > b->cap)
+  {
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n)
+      cap *= 2;
+    char *nd = (char *)realloc(b->data, cap);
+    if (!nd)
+      return false;
+    b->data = nd;
+    b->cap = cap;
+  }
+  memcpy(b->data + b->len, p, n);
+  b->len += n;
+  return true;
+}
+
+static void pbuf_consume(pbuf *b, size_t n)
+{
+  if (n >= b->len)
+  {
+    b->len = 0;
+    return;
+  }
+  memmove(b->data, b->data + n, b->len - n);
+  b->len -= n;
+}
+
+static void pbuf_free(pbuf *b)
+{
+  free(b->data);
+  memset(b, 0, sizeof(*b));
+}
+
+// Stato del riconoscimento della fine di una risposta dell'upstream, che
+// viene inoltrata al client man mano che arriva.
+typedef enum
+{
+  RESP_HEAD,
+  RESP_LENGTH,
+  RESP_CHUNK_SIZE,
+  RESP_CHUNK_DATA,
+  RESP_CHUNK_CRLF,
+  RESP_TRAILER,
+  RESP_UNTIL_CLOSE,
+  RESP_DONE
+} resp_state;
+
+typedef struct resp_track
+{
+  resp_state state;
+  bool head_request; // risposta a HEAD: nessun body
+  bool close;        // l'upstream chiuderà la connessione
+  int status;
+  unsigned long long remaining;
+  size_t relayed; // byte già inoltrati al client
+  size_t line_len;
+  char line[PROXY_MAX_HEAD]; // intestazioni o riga corrente dei chunk
+} resp_track;
+
+typedef enum
+{
+  CONN_READ,     // in attesa (o in lettura) di una richiesta
+  CONN_UPSTREAM, // richiesta inoltrata, risposta in arrivo
+  CONN_CLOSING   // chiude dopo aver inviato i dati in attesa
+} conn_state;
+
+typedef struct proxy_conn proxy_conn;
+
+// Estremo registrato in epoll: il client o la connessione verso l'upstream.
+typedef struct proxy_end
+{
+  proxy_conn *conn;
+  bool upstream;
+} proxy_end;
+
+struct proxy_conn
+{
+  int fd;
+  int up_fd;
+  bool up_connecting;
+  conn_state state;
+  pbuf in;
+  pbuf out;
+  pbuf up_out;
+  bool keep_alive;
+  bool sent_continue;
+  bool eof; // il client ha chiuso il proprio lato
+  bool served;  // almeno una risposta consegnata
+  bool in_body; // intestazioni complete, body in arrivo
+  double t_wait; // inizio dell'attesa della richiesta corrente
+  double t_io;   // ultimo byte ricevuto dal client o inviato al client
+  proxy_end client_end;
+  proxy_end up_end;
+  resp_track resp;
+  // tempi della richiesta corrente (millisecondi, orologio monotono)
+  char label[96]; // metodo e path per il log
+  double t_complete;
+  double t_forward;
+  double t_up_done;
+  double validate_ms;
+  size_t validate_peak; // byte, con opts->memory
+  bool log_pending;
+  bool closed;
+  proxy_conn *next_closed;
+  proxy_conn *prev; // elenco delle connessioni aperte, per le scadenze
+  proxy_conn *next;
+};
+
+typedef struct proxy_server
+{
+  int epfd;
+  int listen_fd;
+  struct addrinfo *upstream;
+  oas_spec_slot *slot;
+  const proxy_options *opts;
+  proxy_conn *closed; // da liberare al termine del lotto di eventi
+  size_t requests;
+  double overhead_sum;
+  double overhead_max;
+  uint64_t cache_uid; // versione a cui si riferiscono gli esiti in cache
+  size_t max_bytes;   // body più grande accettato (--max-bytes o PROXY_DEFAULT_MAX_BYTES)
+  proxy_conn *conns;  // connessioni client aperte
+  int spare_fd;       // descrittore di riserva per i rifiuti con EMFILE/ENFILE
+  bool accept_paused; // socket di ascolto tolto da epoll: descrittori esauriti
+  size_t timeouts;    // connessioni chiuse per scadenza
+  size_t refused;     // connessioni chiuse subito per mancanza di descrittori
+} proxy_server;
+
+static volatile sig_atomic_t proxy_stop;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  proxy_stop = 1;
+}
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static bool set_nonblocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Divide "host:porta" (o solo "porta") e risolve l'indirizzo.
+static struct addrinfo *resolve(const char *spec, bool passive)
+{
+  char host[256] = "";
+  const char *port = spec;
+  const char *colon = strrchr(spec, ':');
+  if (colon)
+  {
+    size_t n = (size_t)(colon - spec);
+    if (n >= sizeof(host))
+      return NULL;
+    memcpy(host, spec, n);
+    host[n] = '\0';
+    port = colon + 1;
+  }
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+  struct addrinfo *res = NULL;
+  if (getaddrinfo(host[0] ? host : NULL, port, &hints, &res) != 0)
+    return NULL;
+  return res;
+}
+
+// Fine delle intestazioni di una richiesta nei primi `len` byte di `data`:
+// puntatore alla riga vuota "\r\n\r\n", NULL se non è ancora arrivata.
+// Un LF senza CR o un CR senza LF impostano `*bare` (e restituiscono
+// NULL): le righe vanno chiuse da CRLF, perché un upstream che accetta
+// altri terminatori leggerebbe intestazioni diverse da quelle controllate,
+// e senza risposta immediata la richiesta resterebbe in attesa del limite
+// PROXY_MAX_HEAD.
+static const char *request_head_end(const char *data, size_t len, bool *bare)
+{
+  *bare = false;
+  for (size_t i = 0; i < len; ++i)
+  {
+    if (data[i] == '\n')
+    {
+      if (i == 0 || data[i - 1] != '\r')
+      {
+        *bare = true;
+        return NULL;
+      }
+      if (i >= 3 && data[i - 2] == '\n')
+        return data + i - 3;
+    }
+    else if (data[i] == '\r' && i + 1 < len && data[i + 1] != '\n')
+    {
+      *bare = true;
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+static bool parse_length(const char *v, size_t vlen, unsigned long long *out)
+{
+  if (vlen == 0 || vlen > 19)
+    return false;
+  unsigned long long n = 0;
+  for (size_t i = 0; i < vlen; ++i)
+  {
+    if (v[i] < '0' || v[i] > '9')
+      return false;
+    n = n * 10 + (unsigned long long)(v[i] - '0');
+  }
+  *out = n;
+  return true;
+}
+
+// Prossima intestazione `name` nel blocco `head` dopo la riga che termina in
+// `*pos` (NULL all'inizio: dopo la prima riga); NULL se non ce ne sono altre.
+static const char *header_next(const char *head, size_t len, const char *name, const char **pos, size_t *vlen)
+{
+  size_t nlen = strlen(name);
+  const char *end = head + len;
+  const char *p = *pos ? *pos : memchr(head, '\n', len);
+  while (p && p + 1 < end)
+  {
+    const char *line = p + 1;
+    const char *eol = memchr(line, '\n', (size_t)(end - line));
+    if (!eol)
+      break;
+    p = eol;
+    if ((size_t)(eol - line) > nlen && line[nlen] == ':' && strncasecmp(line, name, nlen) == 0)
+    {
+      const char *v = line + nlen + 1;
+      while (v < eol && (*v == ' ' || *v == '\t'))
+        ++v;
+      const char *ve = eol;
+      while (ve > v && (ve[-1] == '\r' || ve[-1] == ' ' || ve[-1] == '\t'))
+        --ve;
+      *vlen = (size_t)(ve - v);
+      *pos = eol;
+      return v;
+    }
+  }
+  return NULL;
+}
+
+// Valore della prima intestazione `name` nel blocco `head`; NULL se assente.
+static const char *header_value(const char *head, size_t len, const char *name, size_t *vlen)
+{
+  const char *pos = NULL;
+  return header_next(head, len, name, &pos, vlen);
+}
+
+// Righe di intestazione della richiesta ben formate: un nome senza spazi
+// seguito da ':' e nessuna riga di continuazione (obs-fold). Altrimenti
+// proxy e upstream potrebbero leggere intestazioni diverse, e quindi
+// confini diversi del messaggio (RFC 9112, 5.1 e 5.2).
+static bool head_fields_valid(const char *head, size_t len)
+{
+  const char *end = head + len;
+  const char *p = memchr(head, '\n', len);
+  while (p && p + 1 < end)
+  {
+    const char *line = p + 1;
+    const char *eol = memchr(line, '\n', (size_t)(end - line));
+    if (!eol)
+      break;
+    size_t n = (size_t)(eol - line);
+    if (n && line[n - 1] == '\r')
+      --n;
+    if (n == 0)
+      break; // riga vuota: fine delle intestazioni
+    size_t i = 0;
+    while (i < n && line[i] != ':' && line[i] != ' ' && line[i] != '\t')
+      ++i;
+    if (i == 0 || i == n || line[i] != ':')
+      return false;
+    p = eol;
+  }
+  return true;
+}
+
+// Lunghezza del body dichiarata dalle intestazioni Content-Length (0 se
+// assenti). false se un valore non è un numero, come una lista separata da
+// virgole, o se più intestazioni indicano valori diversi: l'upstream
+// potrebbe usarne un altro e trattare come body di questa richiesta byte
+// che il proxy considera la successiva.
+static bool request_length(const char *head, size_t len, unsigned long long *out)
+{
+  *out = 0;
+  bool seen = false;
+  const char *pos = NULL;
+  size_t vlen;
+  const char *v;
+  while ((v = header_next(head, len, "Content-Length", &pos, &vlen)))
+  {
+    unsigned long long n;
+    if (!parse_length(v, vlen, &n) || (seen && n != *out))
+      return false;
+    *out = n;
+    seen = true;
+  }
+  return true;
+}
+
+// true se la lista separata da virgole `v` contiene `token`.
+static bool has_token(const char *v, size_t vlen, const char *token)
+{
+  size_t tlen = strlen(token);
+  size_t i = 0;
+  while (i < vlen)
+  {
+    while (i < vlen && (v[i] == ' ' || v[i] == '\t' || v[i] == ','))
+      ++i;
+    size_t start = i;
+    while (i < vlen && v[i] != ',')
+      ++i;
+    size_t e = i;
+    while (e > start && (v[e - 1] == ' ' || v[e - 1] == '\t'))
+      --e;
+    if (e - start == tlen && strncasecmp(v + start, token, tlen) == 0)
+      return true;
+  }
+  return false;
+}
+
+static int hex_digit(char ch)
+{
+  if (ch >= '0' && ch <= '9')
+    return ch - '0';
+  ch = (char)tolower((unsigned char)ch);
+  return ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+}
+
+// Path con cui cercare l'operazione nella specifica a partire dal target
+// della riga di richiesta, anche in forma assoluta ("http://host/path"):
+// senza query né frammento, con i caratteri %XX decodificati, senza
+// barre ripetute, segmenti "." e ".." e barra finale. Così "/%61udit",
+// "//audit" o "/audit/" vengono validati come "/audit", la risorsa su cui
+// l'upstream li instraderà. Restituisce 0 oppure il codice HTTP con cui
+// rifiutare la richiesta: 400 per un target non valido o con "%2F" e
+// "%00", il cui instradamento dipende dall'upstream, 414 se troppo lungo.
+static int normalize_target(const char *target, size_t len, char *out, size_t size)
+{
+  if (len >= 7 && (strncasecmp(target, "http://", 7) == 0 || (len >= 8 && strncasecmp(target, "https://", 8) == 0)))
+  {
+    size_t skip = target[4] == ':' ? 7 : 8;
+    target += skip;
+    len -= skip;
+    while (len && *target != '/' && *target != '?' && *target != '#')
+    {
+      ++target;
+      --len;
+    }
+  }
+  else if (len == 1 && target[0] == '*')
+  {
+    snprintf(out, size, "*");
+    return 0;
+  }
+  else if (len == 0 || target[0] != '/')
+  {
+    return 400;
+  }
+  for (size_t i = 0; i < len; ++i)
+  {
+    if (target[i] == '?' || target[i] == '#')
+    {
+      len = i;
+      break;
+    }
+  }
+  if (len >= size)
+    return 414;
+
+  // un segmento alla volta: `o` è la lunghezza del path già scritto
+  size_t o = 0;
+  size_t i = 0;
+  while (i < len)
+  {
+    while (i < len && target[i] == '/')
+      ++i;
+    size_t seg = o;
+    out[o++] = '/';
+    while (i < len && target[i] != '/')
+    {
+      char ch = target[i++];
+      if (ch == '%')
+      {
+        int hi = i + 1 < len ? hex_digit(target[i]) : -1;
+        int lo = hi >= 0 ? hex_digit(target[i + 1]) : -1;
+        if (lo < 0)
+          return 400;
+        ch = (char)(hi * 16 + lo);
+        if (ch == '/' || ch == '\0')
+          return 400;
+        i += 2;
+      }
+      out[o++] = ch;
+    }
+    size_t n = o - seg - 1;
+    if (n == 0 || (n == 1 && out[seg + 1] == '.'))
+    {
+      o = seg;
+    }
+    else if (n == 2 && out[seg + 1] == '.' && out[seg + 2] == '.')
+    {
+      o = seg;
+      while (o > 0 && out[o - 1] != '/')
+        --o;
+      if (o > 0)
+        --o;
+    }
+  }
+  if (o == 0)
+    out[o++] = '/';
+  out[o] = '\0';
+  return 0;
+}
+
+static void resp_reset(resp_track *t, bool head_request)
+{
+  t->state = RESP_HEAD;
+  t->head_request = head_request;
+  t->close = false;
+  t->status = 0;
+  t->remaining = 0;
+  t->relayed = 0;
+  t->line_len = 0;
+}
+
+// Interpreta le intestazioni complete della risposta e sceglie come
+// riconoscerne la fine.
+static bool resp_head_done(resp_track *t)
+{
+  const char *h = t->line;
+  size_t len = t->line_len;
+  if (len < 12 || strncmp(h, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)h[9]))
+    return false;
+  t->status = atoi(h + 9);
+  bool http10 = h[7] == '0';
+  t->line_len = 0;
+  if (t->status >= 100 && t->status < 200 && t->status != 101)
+    return true; // risposta intermedia: segue quella definitiva
+
+  size_t vlen;
+  const char *v = header_value(h, len, "Connection", &vlen);
+  t->close = v ? has_token(v, vlen, "close") : http10;
+  if (http10 && v && has_token(v, vlen, "keep-alive"))
+    t->close = false;
+  if (t->head_request || t->status == 204 || t->status == 304)
+  {
+    t->state = RESP_DONE;
+    return true;
+  }
+  v = header_value(h, len, "Transfer-Encoding", &vlen);
+  if (v && has_token(v, vlen, "chunked"))
+  {
+    t->state = RESP_CHUNK_SIZE;
+    return true;
+  }
+  v = header_value(h, len, "Content-Length", &vlen);
+  if (v)
+  {
+    if (!parse_length(v, vlen, &t->remaining))
+      return false;
+    t->state = t->remaining ? RESP_LENGTH : RESP_DONE;
+    return true;
+  }
+  t->state = RESP_UNTIL_CLOSE;
+  t->close = true;
+  return true;
+}
+
+// Gestisce una riga completa in `t->line`.
+static bool resp_line(resp_track *t)
+{
+  const char *l = t->line;
+  size_t n = t->line_len;
+  switch (t->state)
+  {
+  case RESP_HEAD:
+    if (n == 2 && l[0] == '\r')
+    {
+      t->line_len = 0; // righe vuote prima della risposta
+      return true;
+    }
+    if ((n >= 4 && memcmp(l + n - 4, "\r\n\r\n", 4) == 0) || (n >= 2 && memcmp(l + n - 2, "\n\n", 2) == 0))
+      return resp_head_done(t);
+    return true;
+  case RESP_CHUNK_SIZE:
+  {
+    unsigned long long size = 0;
+    size_t i = 0;
+    for (; i < n && isxdigit((unsigned char)l[i]); ++i)
+    {
+      if (size >> 60)
+        return false;
+      size = size * 16 + (unsigned long long)(isdigit((unsigned char)l[i]) ? l[i] - '0'
+                                                                          : (tolower((unsigned char)l[i]) - 'a' + 10));
+    }
+    if (i == 0)
+      return false;
+    t->remaining = size;
+    t->state = size ? RESP_CHUNK_DATA : RESP_TRAILER;
+    break;
+  }
+  case RESP_CHUNK_CRLF:
+    if (!(n == 2 && l[0] == '\r') && !(n == 1))
+      return false;
+    t->state = RESP_CHUNK_SIZE;
+    break;
+  case RESP_TRAILER:
+    if ((n == 2 && l[0] == '\r') || n == 1)
+      t->state = RESP_DONE;
+    break;
+  default:
+    break;
+  }
+  t->line_len = 0;
+  return true;
+}
+
+// Avanza il riconoscimento con `n` byte ricevuti; false se la risposta non
+// è HTTP/1.1 ben formata.
+static bool resp_feed(resp_track *t, const char *p, size_t n)
+{
+  size_t i = 0;
+  while (i < n && t->state != RESP_DONE)
+  {
+    if (t->state == RESP_LENGTH || t->state == RESP_CHUNK_DATA)
+    {
+      size_t take = n - i;
+      if ((unsigned long long)take > t->remaining)
+        take = (size_t)t->remaining;
+      i += take;
+      t->remaining -= take;
+      if (t->remaining == 0)
+        t->state = t->state == RESP_LENGTH ? RESP_DONE : RESP_CHUNK_CRLF;
+      continue;
+    }
+    if (t->state == RESP_UNTIL_CLOSE)
+      return true;
+    char c = p[i++];
+    if (t->line_len >= sizeof(t->line))
+      return false;
+    t->line[t->line_len++] = c;
+    if (c == '\n' && !resp_line(t))
+      return false;
+  }
+  return i == n;
+}
+
+// Byte del client tenuti nel buffer di ingresso: intestazioni e body di
+// una richiesta accettabile. Una richiesta più grande riceve 431 o 413
+// prima di arrivare al limite, quindi oltre si smette di leggere finché
+// la richiesta in testa non è stata elaborata.
+static size_t input_limit(const proxy_server *srv)
+{
+  return PROXY_MAX_HEAD + srv->max_bytes;
+}
+
+static void update_events(proxy_server *srv, proxy_conn *c)
+{
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.data.ptr = &c->client_end;
+  if (c->state == CONN_READ && !c->eof && c->out.len < PROXY_MAX_PENDING_OUT && c->in.len < input_limit(srv))
+    ev.events |= EPOLLIN;
+  if (c->out.len)
+    ev.events |= EPOLLOUT;
+  epoll_ctl(srv->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+  if (c->up_fd >= 0)
+  {
+    memset(&ev, 0, sizeof(ev));
+    ev.data.ptr = &c->up_end;
+    ev.events = c->out.len < PROXY_MAX_PENDING_OUT ? EPOLLIN : 0;
+    if (c->up_connecting || c->up_out.len)
+      ev.events |= EPOLLOUT;
+    epoll_ctl(srv->epfd, EPOLL_CTL_MOD, c->up_fd, &ev);
+  }
+}
+
+static void close_upstream(proxy_server *srv, proxy_conn *c)
+{
+  if (c->up_fd < 0)
+    return;
+  epoll_ctl(srv->epfd, EPOLL_CTL_DEL, c->up_fd, NULL);
+  close(c->up_fd);
+  c->up_fd = -1;
+  c->up_connecting = false;
+  c->up_out.len = 0;
+}
+
+// Riprende ad accettare connessioni dopo che i descrittori erano esauriti.
+static void resume_accept(proxy_server *srv)
+{
+  if (!srv->accept_paused)
+    return;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (epoll_ctl(srv->epfd, EPOLL_CTL_MOD, srv->listen_fd, &ev) == 0)
+    srv->accept_paused = false;
+}
+
+static void close_conn(proxy_server *srv, proxy_conn *c)
+{
+  close_upstream(srv, c);
+  epoll_ctl(srv->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+  close(c->fd);
+  if (c->prev)
+    c->prev->next = c->next;
+  else
+    srv->conns = c->next;
+  if (c->next)
+    c->next->prev = c->prev;
+  resume_accept(srv);
+  pbuf_free(&c->in);
+  pbuf_free(&c->out);
+  pbuf_free(&c->up_out);
+  c->closed = true;
+  c->next_closed = srv->closed;
+  srv->closed = c;
+}
+
+// Accoda una risposta generata dal proxy (errori e richieste non valide).
+static bool respond_local(proxy_conn *c, int status, const char *reason, const char *body)
+{
+  char head[256];
+  size_t blen = strlen(body);
+  int n = snprintf(head, sizeof(head),
+                   "HTTP/1.1 %d %s\r\nContent-Type: text/plain; charset=utf-8\r\n"
+                   "Content-Length: %zu\r\nConnection: %s\r\n\r\n",
+                   status, reason, blen, c->keep_alive ? "keep-alive" : "close");
+  if (!pbuf_append(&c->out, head, (size_t)n) || !pbuf_append(&c->out, body, blen))
+    return false;
+  c->resp.status = status;
+  c->log_pending = true;
+  if (!c->keep_alive)
+    c->state = CONN_CLOSING;
+  return true;
+}
+
+// Scrive il log della richiesta appena completata verso il client.
+static void log_request(proxy_server *srv, proxy_conn *c)
+{
+  double total = now_ms() - c->t_complete;
+  double upstream = c->t_forward > 0 ? c->t_up_done - c->t_forward : 0;
+  double overhead = total - upstream;
+  fprintf(stderr, "PROXY %s -> %d validazione %.3f ms", c->label, c->resp.status, c->validate_ms);
+  if (srv->opts->memory)
+    fprintf(stderr, " (picco %.1f KiB)", c->validate_peak / 1024.0);
+  fprintf(stderr, ", upstream %.3f ms, overhead %.3f ms\n", upstream, overhead);
+  ++srv->requests;
+  srv->overhead_sum += overhead;
+  if (overhead > srv->overhead_max)
+    srv->overhead_max = overhead;
+  c->log_pending = false;
+}
+
+// Motivo della risposta 503 per una validazione interrotta dal budget.
+static char *budget_reason(const req_budget *budget)
+{
+  char what[64], msg[128];
+  req_budget_describe(budget, what, sizeof(what));
+  snprintf(msg, sizeof(msg), "Validazione interrotta: budget della richiesta esaurito (%s)\n", what);
+  return strdup(msg);
+}
+
+// Valida il body della richiesta, decompresso prima se `enc` lo richiede.
+// Restituisce NULL se valido (o se è vuoto e l'operazione non ha uno schema
+// per il body), altrimenti il motivo da liberare con free(); `*status`
+// riceve il codice HTTP da usare. Un body senza schema con cui validarlo
+// viene respinto: inoltrarlo renderebbe il proxy aggirabile con un path o
+// un metodo che la specifica non descrive.
+static char *validate_body(proxy_server *srv, const char *method, const char *path, const char *body,
+                           size_t len, content_encoding enc, int *status)
+{
+  char method_lower[16];
+  size_t i = 0;
+  for (; method[i] && i + 1 < sizeof(method_lower); ++i)
+    method_lower[i] = (char)tolower((unsigned char)method[i]);
+  method_lower[i] = '\0';
+
+  const oas_spec *spec = oas_spec_read_lock(srv->slot, 0);
+  char *reason = NULL;
+  result_cache *cache = srv->opts->cache;
+  result_cache_key key;
+  bool store = false;
+  char *plain = NULL; // body decompresso
+  *status = 400;
+  cJSON *schema = oas_request_body_schema(spec->root, method_lower, path);
+  if (!schema)
+  {
+    if (len > 0)
+    {
+      size_t n = strlen(method) + strlen(path) + 96;
+      reason = (char *)malloc(n);
+      if (reason)
+        snprintf(reason, n, "NON VALIDO - Motivo: Nessuno schema per il body di %s %s nella specifica\n", method,
+                 path);
+    }
+    goto out;
+  }
+
+  if (enc != CONTENT_IDENTITY)
+  {
+    // la cache usa i byte decompressi: lo stesso body con codifiche diverse
+    // riceve lo stesso verdetto
+    const char *inflate_error = NULL;
+    inflate_status ist = inflate_buffer(enc, body, len, srv->opts->max_inflated, &plain, &len, &inflate_error);
+    if (ist == INFLATE_NO_MEMORY)
+    {
+      *status = 503;
+      reason = strdup("Memoria insufficiente per il body\n");
+      goto out;
+    }
+    if (ist != INFLATE_OK)
+    {
+      size_t n = strlen(inflate_error) + 64;
+      reason = (char *)malloc(n);
+      if (reason && ist == INFLATE_TOO_LARGE)
+        snprintf(reason, n, "NON VALIDO - Motivo: Body decompresso oltre il limite di %zu byte\n",
+                 srv->opts->max_inflated);
+      else if (reason)
+        snprintf(reason, n, "Body %s non valido: %s\n", content_encoding_name(enc), inflate_error);
+      goto out;
+    }
+    body = plain;
+  }
+
+  if (cache)
+  {
+    if (spec->uid != srv->cache_uid)
+    {
+      // nuova versione pubblicata: gli esiti precedenti non valgono più
+      if (srv->cache_uid != 0)
+        result_cache_clear(cache);
+      srv->cache_uid = spec->uid;
+    }
+    key = result_cache_key_of(cache, spec->uid, method_lower, path, (int)srv->opts->mode, body, len);
+    int verdict = 0;
+    if (result_cache_get(cache, &key, &verdict, &reason))
+      goto out;
+    store = true;
+  }
+
+  jsval_ctx ctx = jsval_ctx_make(spec->root, srv->opts->mode);
+  ctx.index = spec->index;
+  ctx.max_depth = srv->opts->limits.max_depth;
+  ctx.symbols = spec->symbols;
+  ctx.pool = srv->opts->pool;
+  ctx.parallel_min_items = srv->opts->parallel_items;
+  ctx.memory = srv->opts->memory;
+  ctx.adaptive_order = srv->opts->adaptive_order;
+  ctx.budget = srv->opts->budget;
+
+  // il parser decodifica le stringhe sul posto: il body originale resta
+  // intatto per l'inoltro (quello decompresso è già una copia)
+  char *copy = plain;
+  plain = NULL;
+  if (!copy)
+  {
+    copy = (char *)mem_malloc(len + 1);
+    if (!copy)
+    {
+      *status = 503;
+      reason = strdup("Memoria insufficiente");
+      goto out;
+    }
+    memcpy(copy, body, len);
+    copy[len] = '\0';
+  }
+
+  payload_tape tape;
+  const char *p = copy;
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+    ++p;
+  if (*p == '{' || *p == '[')
+  {
+    char *parse_error = NULL;
+    payload_status ps = payload_parse(copy, len, schema, &ctx, &srv->opts->limits, &tape, &parse_error);
+    if (ps != PAYLOAD_OK)
+    {
+      if (ps == PAYLOAD_LIMIT_EXCEEDED)
+      {
+        size_t n = strlen(parse_error ? parse_error : "") + 32;
+        reason = (char *)malloc(n);
+        if (reason)
+          snprintf(reason, n, "NON VALIDO - Motivo: %s\n", parse_error ? parse_error : "(sconosciuto)");
+      }
+      else if (ps == PAYLOAD_NO_MEMORY)
+      {
+        *status = 503;
+        reason = strdup("Memoria insufficiente per il body\n");
+      }
+      else if (ps == PAYLOAD_BUDGET_EXCEEDED)
+      {
+        *status = 503;
+        reason = budget_reason(ctx.budget);
+      }
+      else
+      {
+        reason = strdup("JSON body non valido\n");
+      }
+      free(parse_error);
+      free(copy);
+      goto out;
+    }
+  }
+  else
+  {
+    char *yaml_error = NULL;
+    cJSON *inst = miniyaml_parse(copy, &yaml_error);
+    free(yaml_error);
+    free(copy);
+    if (!inst || !payload_tape_from_cjson(&tape, inst, ctx.symbols))
+    {
+      reason = strdup(inst ? "Memoria insufficiente per il body\n" : "YAML body non valido\n");
+      if (inst)
+        *status = 503;
+      payload_free(inst);
+      goto out;
+    }
+    payload_free(inst);
+  }
+
+  if (srv->opts->memo)
+    ctx.memo = jsval_memo_create();
+  jsval_result res = js_validate_tape(&tape, schema, &ctx);
+  jsval_memo_free(ctx.memo);
+  payload_tape_free(&tape);
+  if (req_budget_exceeded(ctx.budget))
+  {
+    // validazione interrotta: nessun verdetto sul body
+    *status = 503;
+    reason = budget_reason(ctx.budget);
+  }
+  else if (!res.ok)
+  {
+    const char *msg = res.error_msg ? res.error_msg : "(sconosciuto)";
+    size_t n = strlen(msg) + 32;
+    reason = (char *)malloc(n);
+    if (reason)
+      snprintf(reason, n, "NON VALIDO - Motivo: %s\n", msg);
+  }
+  jsval_result_free(&res);
+
+out:
+  free(plain);
+  // gli errori di memoria (503) non sono un verdetto sul body
+  if (store && *status == 400)
+    result_cache_put(cache, &key, reason ? 400 : 0, reason);
+  oas_spec_read_unlock(srv->slot, 0);
+  if (*status != 400 && !reason)
+    *status = 400;
+  return reason;
+}
+
+// Apre (se necessario) la connessione verso l'upstream.
+static bool ensure_upstream(proxy_server *srv, proxy_conn *c)
+{
+  if (c->up_fd >= 0)
+    return true;
+  for (struct addrinfo *ai = srv->upstream; ai; ai = ai->ai_next)
+  {
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0)
+      continue;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (!set_nonblocking(fd))
+    {
+      close(fd);
+      continue;
+    }
+    int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+    if (rc != 0 && errno != EINPROGRESS)
+    {
+      close(fd);
+      continue;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = &c->up_end;
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+      close(fd);
+      return false;
+    }
+    c->up_fd = fd;
+    c->up_connecting = rc != 0;
+    return true;
+  }
+  return false;
+}
+
+// L'upstream non ha fornito una risposta completa.
+static void upstream_failed(proxy_server *srv, proxy_conn *c)
+{
+  close_upstream(srv, c);
+  c->t_up_done = now_ms();
+  if (c->resp.relayed == 0)
+  {
+    // niente è ancora arrivato al client: può ricevere un 502
+    respond_local(c, 502, "Bad Gateway", "Upstream non raggiungibile\n");
+    if (c->state == CONN_UPSTREAM)
+      c->state = CONN_READ;
+  }
+  else
+  {
+    c->keep_alive = false;
+    c->state = CONN_CLOSING;
+    c->log_pending = true;
+  }
+}
+
+// Elabora le richieste complete presenti nel buffer di ingresso.
+static void process_requests(proxy_server *srv, proxy_conn *c)
+{
+  // una richiesta alla volta: la successiva attende che la risposta sia
+  // stata consegnata, così i tempi registrati restano separati
+  while (c->state == CONN_READ && c->in.len && !c->log_pending)
+  {
+    const char *data = c->in.data;
+    bool bare = false;
+    const char *head_end = request_head_end(data, c->in.len < PROXY_MAX_HEAD ? c->in.len : PROXY_MAX_HEAD, &bare);
+    c->t_complete = now_ms();
+    c->t_forward = 0;
+    c->validate_ms = 0;
+    c->validate_peak = 0;
+    snprintf(c->label, sizeof(c->label), "(richiesta non valida)");
+    c->in_body = false;
+    if (bare)
+    {
+      c->keep_alive = false;
+      respond_local(c, 400, "Bad Request", "Righe della richiesta non terminate da CRLF\n");
+      return;
+    }
+    if (!head_end)
+    {
+      if (c->in.len >= PROXY_MAX_HEAD)
+      {
+        c->keep_alive = false;
+        respond_local(c, 431, "Request Header Fields Too Large", "Intestazioni troppo grandi\n");
+      }
+      return;
+    }
+    size_t head_len = (size_t)(head_end - data) + 4;
+
+    // riga di richiesta: metodo, target e versione
+    const char *sp1 = memchr(data, ' ', head_len);
+    const char *sp2 = sp1 ? memchr(sp1 + 1, ' ', (size_t)(data + head_len - sp1 - 1)) : NULL;
+    const char *eol = memchr(data, '\r', head_len);
+    if (!sp1 || !sp2 || sp2 > eol || (size_t)(sp1 - data) >= 16 || eol - sp2 < 9 ||
+        strncmp(sp2 + 1, "HTTP/1.", 7) != 0)
+    {
+      c->keep_alive = false;
+      respond_local(c, 400, "Bad Request", "Richiesta HTTP non valida\n");
+      return;
+    }
+    char method[16];
+    memcpy(method, data, (size_t)(sp1 - data));
+    method[sp1 - data] = '\0';
+    bool http10 = sp2[8] == '0';
+
+    if (!head_fields_valid(data, head_len))
+    {
+      c->keep_alive = false;
+      respond_local(c, 400, "Bad Request", "Intestazione HTTP non valida\n");
+      return;
+    }
+    size_t vlen;
+    const char *v = header_value(data, head_len, "Connection", &vlen);
+    c->keep_alive = v ? !has_token(v, vlen, "close") : !http10;
+    if (http10 && v && has_token(v, vlen, "keep-alive"))
+      c->keep_alive = true;
+
+    if (header_value(data, head_len, "Transfer-Encoding", &vlen))
+    {
+      c->keep_alive = false;
+      respond_local(c, 411, "Length Required", "Transfer-Encoding non supportato: usare Content-Length\n");
+      return;
+    }
+    content_encoding enc = CONTENT_IDENTITY;
+    v = header_value(data, head_len, "Content-Encoding", &vlen);
+    if (v && !content_encoding_parse(v, vlen, &enc))
+    {
+      c->keep_alive = false;
+      respond_local(c, 415, "Unsupported Media Type", "Content-Encoding non supportato: usare gzip o deflate\n");
+      return;
+    }
+    unsigned long long clen = 0;
+    if (!request_length(data, head_len, &clen))
+    {
+      c->keep_alive = false;
+      respond_local(c, 400, "Bad Request", "Content-Length non valido\n");
+      return;
+    }
+    if (clen > srv->max_bytes)
+    {
+      char body[128];
+      snprintf(body, sizeof(body), "NON VALIDO - Motivo: Payload oltre il limite di %zu byte\n", srv->max_bytes);
+      c->keep_alive = false;
+      respond_local(c, 413, "Payload Too Large", body);
+      return;
+    }
+    if (c->in.len - head_len < clen)
+    {
+      v = header_value(data, head_len, "Expect", &vlen);
+      if (v && has_token(v, vlen, "100-continue") && !c->sent_continue)
+      {
+        pbuf_append(&c->out, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+        c->sent_continue = true;
+      }
+      c->in_body = true;
+      return;
+    }
+    c->sent_continue = false;
+
+    char path[2048];
+    int target_status = normalize_target(sp1 + 1, (size_t)(sp2 - sp1 - 1), path, sizeof(path));
+    if (target_status != 0)
+    {
+      c->keep_alive = false;
+      if (target_status == 414)
+        respond_local(c, 414, "URI Too Long", "Path troppo lungo\n");
+      else
+        respond_local(c, 400, "Bad Request", "Target della richiesta non valido\n");
+      return;
+    }
+    snprintf(c->label, sizeof(c->label), "%.15s %.79s", method, path);
+
+    size_t req_len = head_len + (size_t)clen;
+    c->t_complete = now_ms();
+    c->t_forward = 0;
+    c->t_up_done = 0;
+    int status = 400;
+    mem_account *memory = srv->opts->memory;
+    mem_account_reset(memory);
+    req_budget_start(srv->opts->budget);
+    mem_account *prev = mem_account_enter(memory);
+    char *reason = validate_body(srv, method, path, data + head_len, (size_t)clen, enc, &status);
+    mem_account_enter(prev);
+    c->validate_ms = now_ms() - c->t_complete;
+    c->validate_peak = mem_account_stats(memory).peak;
+    if (mem_account_exceeded(memory) && status != 400)
+    {
+      // memoria esaurita per il limite della richiesta: è un verdetto sul body
+      free(reason);
+      status = 400;
+      char msg[128];
+      snprintf(msg, sizeof(msg), "NON VALIDO - Motivo: Memoria della richiesta oltre il limite di %zu byte\n",
+               mem_account_limit(memory));
+      reason = strdup(msg);
+    }
+    resp_reset(&c->resp, strcmp(method, "HEAD") == 0);
+    if (reason)
+    {
+      pbuf_consume(&c->in, req_len);
+      respond_local(c, status, status == 400 ? "Bad Request" : "Service Unavailable", reason);
+      free(reason);
+      continue;
+    }
+
+    // richiesta valida: inoltro invariato
+    if (!ensure_upstream(srv, c))
+    {
+      pbuf_consume(&c->in, req_len);
+      upstream_failed(srv, c);
+      continue;
+    }
+    if (!pbuf_append(&c->up_out, c->in.data, req_len))
+    {
+      c->keep_alive = false;
+      pbuf_consume(&c->in, req_len);
+      respond_local(c, 503, "Service Unavailable", "Memoria insufficiente\n");
+      return;
+    }
+    pbuf_consume(&c->in, req_len);
+    c->t_forward = now_ms();
+    c->state = CONN_UPSTREAM;
+  }
+}
+
+// Invia i dati in attesa verso il client; false se la connessione va chiusa.
+static bool flush_client(proxy_server *srv, proxy_conn *c)
+{
+  while (c->out.len)
+  {
+    ssize_t n = send(c->fd, c->out.data, c->out.len, MSG_NOSIGNAL);
+    if (n < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return true;
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    pbuf_consume(&c->out, (size_t)n);
+    c->t_io = now_ms();
+  }
+  // risposta interamente consegnata: il tempo totale è ora noto
+  if (c->log_pending && c->state != CONN_UPSTREAM)
+  {
+    log_request(srv, c);
+    c->served = true;
+    c->t_wait = c->t_io = now_ms();
+  }
+  return c->state != CONN_CLOSING;
+}
+
+static void on_client(proxy_server *srv, proxy_conn *c, uint32_t events)
+{
+  if (events & EPOLLIN)
+  {
+    char buf[PROXY_READ_CHUNK];
+    for (;;)
+    {
+      ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+      if (n > 0)
+      {
+        c->t_io = now_ms();
+        if (c->in.len == 0 && c->served && c->state == CONN_READ && !c->log_pending)
+          c->t_wait = c->t_io; // prima richiesta dopo una pausa keep-alive
+        if (!pbuf_append(&c->in, buf, (size_t)n))
+        {
+          close_conn(srv, c);
+          return;
+        }
+        if ((size_t)n < sizeof(buf) || c->in.len >= input_limit(srv))
+          break;
+        continue;
+      }
+      if (n == 0)
+      {
+        // le richieste già ricevute ricevono comunque risposta
+        c->eof = true;
+        break;
+      }
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      close_conn(srv, c);
+      return;
+    }
+    process_requests(srv, c);
+  }
+  else if (events & (EPOLLERR | EPOLLHUP))
+  {
+    close_conn(srv, c);
+    return;
+  }
+  if (!flush_client(srv, c))
+  {
+    close_conn(srv, c);
+    return;
+  }
+  if (c->state == CONN_READ)
+    process_requests(srv, c);
+  if (!flush_client(srv, c) || (c->eof && c->state == CONN_READ && !c->out.len))
+  {
+    close_conn(srv, c);
+    return;
+  }
+  update_events(srv, c);
+}
+
+static void on_upstream(proxy_server *srv, proxy_conn *c, uint32_t events)
+{
+  if (c->up_fd < 0)
+    return; // evento di una connessione verso l'upstream già chiusa
+  if (c->up_connecting && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+  {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(c->up_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+    {
+      upstream_failed(srv, c);
+      goto done;
+    }
+    struct sockaddr_storage peer;
+    socklen_t plen = sizeof(peer);
+    if (getpeername(c->up_fd, (struct sockaddr *)&peer, &plen) != 0)
+      goto done; // evento di un socket precedente: connessione ancora in corso
+    c->up_connecting = false;
+  }
+  while (!c->up_connecting && c->up_out.len)
+  {
+    ssize_t n = send(c->up_fd, c->up_out.data, c->up_out.len, MSG_NOSIGNAL);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        upstream_failed(srv, c);
+      break;
+    }
+    pbuf_consume(&c->up_out, (size_t)n);
+  }
+  if (c->up_fd >= 0 && (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !c->up_connecting)
+  {
+    char buf[PROXY_READ_CHUNK];
+    for (;;)
+    {
+      ssize_t n = recv(c->up_fd, buf, sizeof(buf), 0);
+      if (n > 0)
+      {
+        if (c->state != CONN_UPSTREAM)
+        {
+          // dati non richiesti su una connessione inattiva
+          close_upstream(srv, c);
+          break;
+        }
+        bool good = resp_feed(&c->resp, buf, (size_t)n);
+        if (!pbuf_append(&c->out, buf, (size_t)n))
+          good = false;
+        else
+          c->resp.relayed += (size_t)n;
+        if (!good)
+        {
+          upstream_failed(srv, c);
+          break;
+        }
+        if (c->resp.state == RESP_DONE)
+        {
+          c->t_up_done = now_ms();
+          c->log_pending = true;
+          if (c->resp.close)
+            close_upstream(srv, c);
+          c->state = c->keep_alive && !c->resp.close ? CONN_READ : CONN_CLOSING;
+          break;
+        }
+        continue;
+      }
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      // connessione chiusa dall'upstream o errore
+      if (c->state == CONN_UPSTREAM && c->resp.state == RESP_UNTIL_CLOSE && n == 0)
+      {
+        c->t_up_done = now_ms();
+        c->log_pending = true;
+        close_upstream(srv, c);
+        c->keep_alive = false;
+        c->state = CONN_CLOSING;
+      }
+      else if (c->state == CONN_UPSTREAM)
+      {
+        upstream_failed(srv, c);
+      }
+      else
+      {
+        close_upstream(srv, c);
+      }
+      break;
+    }
+  }
+
+done:
+  if (!flush_client(srv, c))
+  {
+    close_conn(srv, c);
+    return;
+  }
+  if (c->state == CONN_READ)
+  {
+    process_requests(srv, c);
+    if (!flush_client(srv, c) || (c->eof && c->state == CONN_READ && !c->out.len))
+    {
+      close_conn(srv, c);
+      return;
+    }
+  }
+  update_events(srv, c);
+}
+
+// Descrittori esauriti: la connessione resta in coda e il socket di
+// ascolto verrebbe segnalato a ogni epoll_wait senza che nessuno la
+// accetti. Con il descrittore di riserva la si accetta e si chiude subito,
+// così il client riceve la chiusura invece di restare in attesa; se non è
+// disponibile, il socket di ascolto esce da epoll finché non si chiude una
+// connessione o passa il prossimo controllo delle scadenze.
+static bool refuse_pending(proxy_server *srv)
+{
+  if (srv->spare_fd >= 0)
+  {
+    close(srv->spare_fd);
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    if (fd >= 0)
+    {
+      close(fd);
+      ++srv->refused;
+    }
+    srv->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0 && srv->spare_fd >= 0)
+      return true;
+  }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.data.ptr = NULL;
+  if (epoll_ctl(srv->epfd, EPOLL_CTL_MOD, srv->listen_fd, &ev) == 0)
+    srv->accept_paused = true;
+  return false;
+}
+
+static void on_accept(proxy_server *srv)
+{
+  for (;;)
+  {
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+      {
+        if (refuse_pending(srv))
+          continue;
+      }
+      return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    proxy_conn *c = (proxy_conn *)calloc(1, sizeof(proxy_conn));
+    if (!c || !set_nonblocking(fd))
+    {
+      free(c);
+      close(fd);
+      continue;
+    }
+    c->fd = fd;
+    c->up_fd = -1;
+    c->state = CONN_READ;
+    c->t_wait = c->t_io = now_ms();
+    c->client_end.conn = c;
+    c->up_end.conn = c;
+    c->up_end.upstream = true;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &c->client_end;
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+      free(c);
+      close(fd);
+      continue;
+    }
+    c->next = srv->conns;
+    if (srv->conns)
+      srv->conns->prev = c;
+    srv->conns = c;
+  }
+}
+
+// Istante (millisecondi) in cui la connessione scade; 0 se non ha una
+// scadenza, cioè mentre attende l'upstream senza dati per il client.
+static double conn_deadline(const proxy_conn *c)
+{
+  if (c->out.len)
+    return c->t_io + PROXY_IDLE_TIMEOUT_MS;
+  if (c->state != CONN_READ)
+    return 0;
+  if (c->in.len == 0)
+    return c->t_wait + (c->served ? PROXY_IDLE_TIMEOUT_MS : PROXY_HEADER_TIMEOUT_MS);
+  if (c->in_body)
+    return c->t_io + PROXY_BODY_TIMEOUT_MS;
+  return c->t_wait + PROXY_HEADER_TIMEOUT_MS;
+}
+
+// Chiude le connessioni scadute; una richiesta iniziata e non completata
+// riceve prima 408 se il client può ancora leggerlo.
+static void sweep_conns(proxy_server *srv)
+{
+  double now = now_ms();
+  proxy_conn *next;
+  for (proxy_conn *c = srv->conns; c; c = next)
+  {
+    next = c->next;
+    double deadline = conn_deadline(c);
+    if (deadline == 0 || now < deadline)
+      continue;
+    if (c->state == CONN_READ && c->in.len && !c->out.len)
+    {
+      c->keep_alive = false;
+      respond_local(c, 408, "Request Timeout", "Richiesta non completata in tempo\n");
+      c->log_pending = false; // non è una richiesta elaborata: resta fuori dai tempi
+      flush_client(srv, c);
+    }
+    ++srv->timeouts;
+    close_conn(srv, c);
+  }
+  resume_accept(srv);
+}
+
+static int open_listener(const char *spec)
+{
+  struct addrinfo *res = resolve(spec, true);
+  if (!res)
+    return -1;
+  int fd = -1;
+  for (struct addrinfo *ai = res; ai; ai = ai->ai_next)
+  {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0)
+      continue;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 128) == 0 && set_nonblocking(fd))
+      break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+int proxy_run(oas_spec_slot *slot, const proxy_options *opts)
+{
+  proxy_server srv;
+  memset(&srv, 0, sizeof(srv));
+  srv.slot = slot;
+  srv.opts = opts;
+  srv.max_bytes = opts->limits.max_bytes ? opts->limits.max_bytes : PROXY_DEFAULT_MAX_BYTES;
+  srv.upstream = resolve(opts->upstream, false);
+  if (!srv.upstream)
+  {
+    fprintf(stderr, "Errore: upstream '%s' non risolvibile.\n", opts->upstream);
+    return 2;
+  }
+  srv.listen_fd = open_listener(opts->listen);
+  if (srv.listen_fd < 0)
+  {
+    fprintf(stderr, "Errore: impossibile ascoltare su '%s'.\n", opts->listen);
+    freeaddrinfo(srv.upstream);
+    return 2;
+  }
+  srv.epfd = epoll_create1(0);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (srv.epfd < 0 || epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.listen_fd, &ev) != 0)
+  {
+    fprintf(stderr, "Errore: epoll non disponibile.\n");
+    if (srv.epfd >= 0)
+      close(srv.epfd);
+    close(srv.listen_fd);
+    freeaddrinfo(srv.upstream);
+    return 2;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  srv.spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  fprintf(stderr, "Proxy in ascolto su %s, upstream %s.\n", opts->listen, opts->upstream);
+  struct epoll_event events[PROXY_MAX_EVENTS];
+  double next_sweep = now_ms() + PROXY_SWEEP_MS;
+  while (!proxy_stop)
+  {
+    int n = epoll_wait(srv.epfd, events, PROXY_MAX_EVENTS, PROXY_SWEEP_MS);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+      proxy_end *end = (proxy_end *)events[i].data.ptr;
+      if (!end)
+      {
+        on_accept(&srv);
+        continue;
+      }
+      if (end->conn->closed)
+        continue;
+      if (end->upstream)
+        on_upstream(&srv, end->conn, events[i].events);
+      else
+        on_client(&srv, end->conn, events[i].events);
+    }
+    if (now_ms() >= next_sweep)
+    {
+      sweep_conns(&srv);
+      next_sweep = now_ms() + PROXY_SWEEP_MS;
+    }
+    // le connessioni chiuse in questo lotto vengono liberate solo ora:
+    // altri eventi dello stesso lotto potevano ancora riferirle
+    while (srv.closed)
+    {
+      proxy_conn *c = srv.closed;
+      srv.closed = c->next_closed;
+      free(c);
+    }
+  }
+
+  if (srv.opts->cache)
+  {
+    result_cache_stats st;
+    result_cache_get_stats(srv.opts->cache, &st);
+    uint64_t total = st.hits + st.misses;
+    fprintf(stderr, "Proxy: cache degli esiti %llu hit su %llu (%.1f%%), %zu esiti memorizzati.\n",
+            (unsigned long long)st.hits, (unsigned long long)total,
+            total ? 100.0 * (double)st.hits / (double)total : 0.0, st.entries);
+  }
+  if (srv.requests)
+    fprintf(stderr, "Proxy: %zu richieste, overhead medio %.3f ms, massimo %.3f ms.\n", srv.requests,
+            srv.overhead_sum / (double)srv.requests, srv.overhead_max);
+  if (srv.timeouts || srv.refused)
+    fprintf(stderr, "Proxy: %zu connessioni scadute, %zu chiuse per descrittori esauriti.\n", srv.timeouts,
+            srv.refused);
+  if (srv.spare_fd >= 0)
+    close(srv.spare_fd);
+  close(srv.epfd);
+  close(srv.listen_fd);
+  freeaddrinfo(srv.upstream);
+  return 0;
+}
+
+#else
+
+int proxy_run(oas_spec_slot *slot, const proxy_options *opts)
+{
+  (void)slot;
+  (void)opts;
+  fprintf(stderr, "Errore: la modalità proxy richiede Linux (epoll).\n");
+  return 2;
+}
+
+#endif
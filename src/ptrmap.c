@@ -0,0 +1,100 @@
+#include "ptrmap.h"
+#include "mem_account.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Mescola i bit dell'indirizzo: i puntatori restituiti da malloc sono
+// allineati e avrebbero i bit bassi sempre a zero.
+static size_t ptr_hash(const void *p)
+{
+  uint64_t x = (uint64_t)(uintptr_t)p;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return (size_t)x;
+}
+
+bool ptrmap_init(ptrmap *m, size_t hint)
+{
+  size_t cap = 16;
+  while (cap < hint * 2)
+    cap <<= 1;
+  m->entries = (ptrmap_entry *)mem_calloc(cap, sizeof(ptrmap_entry));
+  m->cap = m->entries ? cap : 0;
+  m->count = 0;
+  return m->entries != NULL;
+}
+
+void ptrmap_free(ptrmap *m)
+{
+  if (!m)
+    return;
+  mem_free(m->entries);
+  m->entries = NULL;
+  m->cap = 0;
+  m->count = 0;
+}
+
+void ptrmap_clear(ptrmap *m)
+{
+  if (m && m->entries)
+  {
+    memset(m->entries, 0, m->cap * sizeof(ptrmap_entry));
+    m->count = 0;
+  }
+}
+
+// Raddoppia la capacità reinserendo tutte le voci presenti.
+static bool ptrmap_grow(ptrmap *m)
+{
+  size_t new_cap = m->cap ? m->cap * 2 : 16;
+  ptrmap_entry *ne = (ptrmap_entry *)mem_calloc(new_cap, sizeof(ptrmap_entry));
+  if (!ne)
+    return false;
+  for (size_t i = 0; i < m->cap; ++i)
+  {
+    if (!m->entries[i].key)
+      continue;
+    size_t j = ptr_hash(m->entries[i].key) & (new_cap - 1);
+    while (ne[j].key)
+      j = (j + 1) & (new_cap - 1);
+    ne[j] = m->entries[i];
+  }
+  mem_free(m->entries);
+  m->entries = ne;
+  m->cap = new_cap;
+  return true;
+}
+
+bool ptrmap_put(ptrmap *m, const void *key, void *value)
+{
+  if (!key)
+    return false;
+  if ((m->count + 1) * 4 > m->cap * 3 && !ptrmap_grow(m))
+    return false;
+  size_t i = ptr_hash(key) & (m->cap - 1);
+  while (m->entries[i].key && m->entries[i].key != key)
+    i = (i + 1) & (m->cap - 1);
+  if (!m->entries[i].key)
+  {
+    m->entries[i].key = key;
+    ++m->count;
+  }
+  m->entries[i].value = value;
+  return true;
+}
+
+void *ptrmap_get(const ptrmap *m, const void *key)
+{
+  if (!m || !m->entries || !key)
+    return NULL;
+  size_t i = ptr_hash(key) & (m->cap - 1);
+  while (m->entries[i].key)
+  {
+    if (m->entries[i].key == key)
+      return m->entries[i].value;
+    i = (i + 1) & (m->cap - 1);
+  }
+  return NULL;
+}
@@ -1,6 +1,7 @@
 #ifdef _MSC_VER
 
 #include "regex_compat.h"
+#include "req_budget.h"
 
 #include <ctype.h>
 #include <limits.h>
@@ -404,6 +405,11 @@ static quantifier parse_quantifier(const char **pattern)
 
 static bool match_pattern_segment(const char *pattern, const char *text, const char *text_start, const char **match_end, bool *error);
 
+// Budget della richiesta attivo nel thread (req_budget_enter): ogni passo del
+// backtracking ne consuma uno, e un budget esaurito interrompe la ricerca
+// come un errore.
+static __declspec(thread) req_budget_meter match_budget;
+
 static bool match_atom(const atom *a, const char *text, const char *text_start, const char **next, bool *error)
 {
   switch (a->type)
@@ -552,6 +558,12 @@ static bool match_sequence_internal(const char *pattern, const char *text, const
   const char *p = pattern;
   const char *t = text;
 
+  if (!req_budget_tick(&match_budget))
+  {
+    *error = true;
+    return false;
+  }
+
   if (*p == '\0')
   {
     if (pattern_end)
@@ -650,7 +662,7 @@ static bool match_sequence_internal(const char *pattern, const char *text, const
 
 regex_compat_result regex_compat_match(const char *pattern, const char *text)
 {
-  regex_compat_result result = {true, false};
+  regex_compat_result result = {true, false, false};
   if (!pattern || !text)
   {
     result.valid = false;
@@ -660,6 +672,7 @@ regex_compat_result regex_compat_match(const char *pattern, const char *text)
   const char *text_start = text;
   const char *pos = text;
   bool error = false;
+  match_budget = req_budget_meter_of(req_budget_current());
 
   do
   {
@@ -671,7 +684,10 @@ regex_compat_result regex_compat_match(const char *pattern, const char *text)
     }
     if (error)
     {
-      result.valid = false;
+      if (req_budget_exceeded(match_budget.budget))
+        result.interrupted = true;
+      else
+        result.valid = false;
       return result;
     }
     if (*pos == '\0')
@@ -0,0 +1,105 @@
+#include "req_budget.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(_MSC_VER)
+#define BUDGET_THREAD_LOCAL __declspec(thread)
+#else
+#define BUDGET_THREAD_LOCAL _Thread_local
+#endif
+
+struct req_budget
+{
+  double seconds;
+  unsigned long long max_steps;
+  double deadline; // 0 = nessuna scadenza
+  atomic_ullong used;
+  atomic_bool exceeded;
+};
+
+static BUDGET_THREAD_LOCAL req_budget *current_budget;
+
+static double now_seconds(void)
+{
+  struct timespec ts;
+#ifdef _MSC_VER
+  timespec_get(&ts, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+req_budget *req_budget_create(double seconds, unsigned long long steps)
+{
+  req_budget *b = (req_budget *)calloc(1, sizeof(req_budget));
+  if (!b)
+    return NULL;
+  b->seconds = seconds > 0 ? seconds : 0;
+  b->max_steps = steps;
+  atomic_init(&b->used, 0);
+  atomic_init(&b->exceeded, false);
+  return b;
+}
+
+void req_budget_free(req_budget *b)
+{
+  if (b && current_budget == b)
+    current_budget = NULL;
+  free(b);
+}
+
+void req_budget_start(req_budget *b)
+{
+  if (!b)
+    return;
+  b->deadline = b->seconds > 0 ? now_seconds() + b->seconds : 0;
+  atomic_store(&b->used, 0);
+  atomic_store(&b->exceeded, false);
+}
+
+req_budget *req_budget_enter(req_budget *b)
+{
+  req_budget *prev = current_budget;
+  current_budget = b;
+  return prev;
+}
+
+req_budget *req_budget_current(void)
+{
+  return current_budget;
+}
+
+bool req_budget_charge(req_budget *b, unsigned long long steps)
+{
+  if (!b)
+    return true;
+  if (atomic_load_explicit(&b->exceeded, memory_order_relaxed))
+    return false;
+  unsigned long long used = atomic_fetch_add_explicit(&b->used, steps, memory_order_relaxed) + steps;
+  if ((b->max_steps && used > b->max_steps) || (b->deadline > 0 && now_seconds() > b->deadline))
+  {
+    atomic_store_explicit(&b->exceeded, true, memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool req_budget_exceeded(const req_budget *b)
+{
+  return b && atomic_load_explicit(&((req_budget *)b)->exceeded, memory_order_relaxed);
+}
+
+unsigned long long req_budget_used(const req_budget *b)
+{
+  return b ? atomic_load_explicit(&((req_budget *)b)->used, memory_order_relaxed) : 0;
+}
+
+void req_budget_describe(const req_budget *b, char *buf, size_t size)
+{
+  if (b && b->max_steps && req_budget_used(b) > b->max_steps)
+    snprintf(buf, size, "oltre %llu passi", b->max_steps);
+  else
+    snprintf(buf, size, "durata oltre %.0f ms", b ? b->seconds * 1000 : 0.0);
+}
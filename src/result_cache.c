@@ -0,0 +1,390 @@
+#include "result_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#define RC_DEFAULT_SHARDS 16
+#define RC_MAX_SHARDS 256
+
+typedef struct rc_entry
+{
+  result_cache_key key;
+  int verdict;
+  char *reason;
+  struct rc_entry *chain; // bucket della tabella hash
+  struct rc_entry *prev;  // lista LRU dello shard: in testa il più recente
+  struct rc_entry *next;
+} rc_entry;
+
+// Shard con il proprio lock; il riempimento finale evita che shard vicini
+// condividano la stessa linea di cache.
+typedef struct rc_shard
+{
+  mtx_t lock;
+  rc_entry **buckets;
+  size_t bucket_mask;
+  size_t count;
+  size_t cap;
+  rc_entry *head;
+  rc_entry *tail;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t insertions;
+  uint64_t evictions;
+  char pad[64];
+} rc_shard;
+
+struct result_cache
+{
+  rc_shard *shards;
+  unsigned shard_count;
+  size_t capacity;
+  uint64_t seed[2];
+  uint64_t invalidations;
+  mtx_t clear_lock;
+};
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+// Finalizzatore di MurmurHash3.
+static inline uint64_t fmix64(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Stato dell'hash: due corsie indipendenti da 64 bit, ognuna su tutte le
+// parole di 8 byte, combinate alla fine in una chiave da 128 bit.
+typedef struct rc_hasher
+{
+  uint64_t a;
+  uint64_t b;
+  uint64_t total;
+} rc_hasher;
+
+static inline void hasher_word(rc_hasher *h, uint64_t w)
+{
+  h->a = rotl64((h->a ^ w) * 0x87c37b91114253d5ULL, 31);
+  h->b = rotl64((h->b + w) * 0x4cf5ad432745937fULL, 27) ^ h->a;
+}
+
+static void hasher_bytes(rc_hasher *h, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  h->total += len;
+  while (len >= 8)
+  {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    hasher_word(h, w);
+    p += 8;
+    len -= 8;
+  }
+  // coda: i byte rimanenti e la loro quantità, così "a" e "a\0" differiscono
+  uint64_t w = (uint64_t)len << 56;
+  for (size_t i = 0; i < len; ++i)
+    w |= (uint64_t)p[i] << (8 * i);
+  hasher_word(h, w);
+}
+
+static void hasher_str(rc_hasher *h, const char *s)
+{
+  hasher_bytes(h, s ? s : "", s ? strlen(s) : 0);
+}
+
+result_cache_key result_cache_key_of(const result_cache *c, uint64_t spec_uid, const char *method,
+                                     const char *endpoint, int mode, const void *body, size_t len)
+{
+  rc_hasher h = {c->seed[0], c->seed[1], 0};
+  hasher_word(&h, spec_uid);
+  hasher_word(&h, (uint64_t)(unsigned)mode);
+  hasher_str(&h, method);
+  hasher_str(&h, endpoint);
+  hasher_bytes(&h, body, len);
+  result_cache_key k;
+  uint64_t a = h.a ^ h.total;
+  uint64_t b = h.b;
+  a += b;
+  b += a;
+  k.lo = fmix64(a);
+  k.hi = fmix64(b);
+  return k;
+}
+
+// Seme casuale: /dev/urandom se disponibile, altrimenti ora e indirizzi.
+static void random_seed(uint64_t seed[2], const void *salt)
+{
+  FILE *f = fopen("/dev/urandom", "rb");
+  if (f)
+  {
+    size_t n = fread(seed, sizeof(uint64_t), 2, f);
+    fclose(f);
+    if (n == 2)
+      return;
+  }
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  seed[0] = fmix64((uint64_t)ts.tv_nsec ^ ((uint64_t)ts.tv_sec << 32));
+  seed[1] = fmix64((uint64_t)(uintptr_t)salt ^ seed[0]);
+}
+
+static void shard_destroy(rc_shard *s)
+{
+  rc_entry *e = s->head;
+  while (e)
+  {
+    rc_entry *next = e->next;
+    free(e->reason);
+    free(e);
+    e = next;
+  }
+  free(s->buckets);
+  mtx_destroy(&s->lock);
+}
+
+result_cache *result_cache_create(size_t capacity, unsigned shards)
+{
+  if (capacity == 0)
+    return NULL;
+  if (shards == 0)
+    shards = RC_DEFAULT_SHARDS;
+  if (shards > RC_MAX_SHARDS)
+    shards = RC_MAX_SHARDS;
+  if (shards > capacity)
+    shards = (unsigned)capacity;
+  result_cache *c = (result_cache *)calloc(1, sizeof(result_cache));
+  if (!c)
+    return NULL;
+  c->shards = (rc_shard *)calloc(shards, sizeof(rc_shard));
+  if (!c->shards || mtx_init(&c->clear_lock, mtx_plain) != thrd_success)
+  {
+    free(c->shards);
+    free(c);
+    return NULL;
+  }
+  c->capacity = capacity;
+  size_t per_shard = (capacity + shards - 1) / shards;
+  for (unsigned i = 0; i < shards; ++i)
+  {
+    rc_shard *s = &c->shards[i];
+    size_t nb = 16;
+    while (nb < per_shard)
+      nb <<= 1;
+    s->cap = per_shard;
+    s->bucket_mask = nb - 1;
+    s->buckets = (rc_entry **)calloc(nb, sizeof(rc_entry *));
+    if (!s->buckets || mtx_init(&s->lock, mtx_plain) != thrd_success)
+    {
+      free(s->buckets);
+      c->shard_count = i;
+      result_cache_free(c);
+      return NULL;
+    }
+  }
+  c->shard_count = shards;
+  random_seed(c->seed, c);
+  return c;
+}
+
+void result_cache_free(result_cache *c)
+{
+  if (!c)
+    return;
+  for (unsigned i = 0; i < c->shard_count; ++i)
+    shard_destroy(&c->shards[i]);
+  free(c->shards);
+  mtx_destroy(&c->clear_lock);
+  free(c);
+}
+
+static inline rc_shard *shard_of(result_cache *c, const result_cache_key *key)
+{
+  return &c->shards[(key->hi >> 32) % c->shard_count];
+}
+
+static inline rc_entry **bucket_of(rc_shard *s, const result_cache_key *key)
+{
+  return &s->buckets[key->lo & s->bucket_mask];
+}
+
+static void lru_unlink(rc_shard *s, rc_entry *e)
+{
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    s->head = e->next;
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    s->tail = e->prev;
+}
+
+static void lru_push_front(rc_shard *s, rc_entry *e)
+{
+  e->prev = NULL;
+  e->next = s->head;
+  if (s->head)
+    s->head->prev = e;
+  s->head = e;
+  if (!s->tail)
+    s->tail = e;
+}
+
+static rc_entry *shard_find(rc_shard *s, const result_cache_key *key)
+{
+  for (rc_entry *e = *bucket_of(s, key); e; e = e->chain)
+    if (e->key.lo == key->lo && e->key.hi == key->hi)
+      return e;
+  return NULL;
+}
+
+static void shard_remove(rc_shard *s, rc_entry *e)
+{
+  rc_entry **pp = bucket_of(s, &e->key);
+  while (*pp != e)
+    pp = &(*pp)->chain;
+  *pp = e->chain;
+  lru_unlink(s, e);
+  --s->count;
+}
+
+static char *dup_str(const char *s)
+{
+  if (!s)
+    return NULL;
+  size_t len = strlen(s);
+  char *out = (char *)malloc(len + 1);
+  if (out)
+    memcpy(out, s, len + 1);
+  return out;
+}
+
+bool result_cache_get(result_cache *c, const result_cache_key *key, int *verdict, char **reason)
+{
+  if (reason)
+    *reason = NULL;
+  rc_shard *s = shard_of(c, key);
+  mtx_lock(&s->lock);
+  rc_entry *e = shard_find(s, key);
+  if (!e)
+  {
+    ++s->misses;
+    mtx_unlock(&s->lock);
+    return false;
+  }
+  // copiare il motivo sotto lock: l'esito può essere sfrattato subito dopo
+  char *copy = reason && e->reason ? dup_str(e->reason) : NULL;
+  if (reason && e->reason && !copy)
+  {
+    ++s->misses;
+    mtx_unlock(&s->lock);
+    return false;
+  }
+  ++s->hits;
+  *verdict = e->verdict;
+  if (s->head != e)
+  {
+    lru_unlink(s, e);
+    lru_push_front(s, e);
+  }
+  mtx_unlock(&s->lock);
+  if (reason)
+    *reason = copy;
+  return true;
+}
+
+void result_cache_put(result_cache *c, const result_cache_key *key, int verdict, const char *reason)
+{
+  rc_shard *s = shard_of(c, key);
+  char *copy = dup_str(reason);
+  if (reason && !copy)
+    return;
+  rc_entry *victim = NULL;
+  mtx_lock(&s->lock);
+  rc_entry *e = shard_find(s, key);
+  if (e)
+  {
+    // un altro thread ha già inserito lo stesso esito
+    mtx_unlock(&s->lock);
+    free(copy);
+    return;
+  }
+  if (s->count >= s->cap && s->tail)
+  {
+    victim = s->tail;
+    shard_remove(s, victim);
+    ++s->evictions;
+  }
+  e = victim ? victim : (rc_entry *)malloc(sizeof(rc_entry));
+  if (!e)
+  {
+    mtx_unlock(&s->lock);
+    free(copy);
+    return;
+  }
+  char *old_reason = victim ? victim->reason : NULL;
+  e->key = *key;
+  e->verdict = verdict;
+  e->reason = copy;
+  rc_entry **b = bucket_of(s, key);
+  e->chain = *b;
+  *b = e;
+  lru_push_front(s, e);
+  ++s->count;
+  ++s->insertions;
+  mtx_unlock(&s->lock);
+  free(old_reason);
+}
+
+void result_cache_clear(result_cache *c)
+{
+  mtx_lock(&c->clear_lock);
+  ++c->invalidations;
+  mtx_unlock(&c->clear_lock);
+  for (unsigned i = 0; i < c->shard_count; ++i)
+  {
+    rc_shard *s = &c->shards[i];
+    mtx_lock(&s->lock);
+    rc_entry *e = s->head;
+    s->head = s->tail = NULL;
+    s->count = 0;
+    memset(s->buckets, 0, (s->bucket_mask + 1) * sizeof(rc_entry *));
+    mtx_unlock(&s->lock);
+    while (e)
+    {
+      rc_entry *next = e->next;
+      free(e->reason);
+      free(e);
+      e = next;
+    }
+  }
+}
+
+void result_cache_get_stats(result_cache *c, result_cache_stats *out)
+{
+  memset(out, 0, sizeof(*out));
+  for (unsigned i = 0; i < c->shard_count; ++i)
+  {
+    rc_shard *s = &c->shards[i];
+    mtx_lock(&s->lock);
+    out->hits += s->hits;
+    out->misses += s->misses;
+    out->insertions += s->insertions;
+    out->evictions += s->evictions;
+    out->entries += s->count;
+    mtx_unlock(&s->lock);
+  }
+  mtx_lock(&c->clear_lock);
+  out->invalidations = c->invalidations;
+  mtx_unlock(&c->clear_lock);
+  out->capacity = c->capacity;
+}
@@ -0,0 +1,122 @@
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ring_client.h"
+#include "shm_ring.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *error_dup(const char *msg)
+{
+  char *s = (char *)malloc(strlen(msg) + 1);
+  if (s)
+    strcpy(s, msg);
+  return s;
+}
+
+// Legge il file `path` nello slot `body` da `cap` byte. 0 se il body è
+// stato letto, altrimenti il codice dell'esito con il motivo in `reason`.
+static int read_into_slot(const char *path, char *body, size_t cap, size_t *len, char *reason, size_t size)
+{
+  bool std_in = strcmp(path, "-") == 0;
+  FILE *f = std_in ? stdin : fopen(path, "rb");
+  if (!f)
+  {
+    snprintf(reason, size, "%s", strerror(errno));
+    return 3;
+  }
+  size_t n = 0;
+  while (n < cap)
+  {
+    size_t got = fread(body + n, 1, cap - n, f);
+    if (got == 0)
+      break;
+    n += got;
+  }
+  int code = 0;
+  if (ferror(f))
+  {
+    snprintf(reason, size, "%s", strerror(errno ? errno : EIO));
+    code = 3;
+  }
+  else if (n == cap && fgetc(f) != EOF)
+  {
+    snprintf(reason, size, "Body oltre la dimensione dello slot (%zu byte)", cap);
+    code = 2;
+  }
+  if (!std_in)
+    fclose(f);
+  *len = n;
+  return code;
+}
+
+bool ring_send_files(const char *name, const ring_send_request *req, const char *const *files, size_t count,
+                     ring_send_fn done, void *arg, char **error_msg)
+{
+  *error_msg = NULL;
+  if (strlen(req->spec_id) >= SHM_RING_ID_MAX || strlen(req->method) >= SHM_RING_METHOD_MAX ||
+      strlen(req->path) >= SHM_RING_PATH_MAX)
+  {
+    *error_msg = error_dup("id della specifica, metodo o path troppo lunghi per lo slot");
+    return false;
+  }
+  shm_ring *ring = shm_ring_attach(name, error_msg);
+  if (!ring)
+  {
+    if (!*error_msg)
+      *error_msg = error_dup("il trasporto in memoria condivisa richiede Linux (futex)");
+    return false;
+  }
+
+  size_t cap = shm_ring_slot_size(ring);
+  size_t next = 0;
+  size_t in_flight = 0;
+  char reason[SHM_RING_REASON_MAX];
+  bool ok = true;
+  while (next < count || in_flight)
+  {
+    if (next < count)
+    {
+      // con richieste in corso non si aspetta uno slot: prima si raccoglie
+      char *body = NULL;
+      long slot = shm_ring_reserve(ring, &body, in_flight ? 0 : RING_SEND_TIMEOUT_MS);
+      if (slot >= 0)
+      {
+        size_t len = 0;
+        int code = read_into_slot(files[next], body, cap, &len, reason, sizeof(reason));
+        if (code != 0)
+        {
+          shm_ring_release(ring, (uint32_t)slot);
+          done(arg, next++, code, reason);
+          continue;
+        }
+        shm_ring_submit(ring, slot, req->spec_id, req->method, req->path, req->mode, len, next);
+        ++next;
+        ++in_flight;
+        continue;
+      }
+      if (!in_flight)
+      {
+        *error_msg = error_dup("nessuno slot libero: validatore terminato o non risponde");
+        ok = false;
+        break;
+      }
+    }
+    shm_ring_completion c;
+    if (!shm_ring_wait(ring, &c, RING_SEND_TIMEOUT_MS))
+    {
+      *error_msg = error_dup("nessun esito: validatore terminato o non risponde");
+      ok = false;
+      break;
+    }
+    if (c.tag < count)
+      done(arg, (size_t)c.tag, c.code, c.reason);
+    shm_ring_release(ring, c.slot);
+    --in_flight;
+  }
+  shm_ring_detach(ring);
+  return ok;
+}
@@ -0,0 +1,289 @@
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ring_server.h"
+#include "miniyaml.h"
+#include "oas_extract.h"
+#include "shm_ring.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <signal.h>
+#include <time.h>
+
+// Attesa massima di una richiesta prima di ricontrollare i segnali.
+#define RING_POLL_MS 200
+// Intervallo tra due recuperi degli slot dei produttori terminati.
+#define RING_RECLAIM_MS 200
+
+static volatile sig_atomic_t ring_stop;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  ring_stop = 1;
+}
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+typedef struct ring_totals
+{
+  size_t requests;
+  size_t counts[3]; // validi, non validi, errori
+  double validate_sum;
+  double validate_max;
+  size_t reclaimed; // slot recuperati da produttori terminati
+} ring_totals;
+
+// Codice e motivo di un body JSON respinto dal parser, come in modalità
+// riga di comando.
+static int parse_failure(payload_status st, const char *parse_error, char *reason, size_t size)
+{
+  switch (st)
+  {
+  case PAYLOAD_LIMIT_EXCEEDED:
+    snprintf(reason, size, "%s", parse_error ? parse_error : "(sconosciuto)");
+    return 1;
+  case PAYLOAD_NO_MEMORY:
+    snprintf(reason, size, "memoria insufficiente per il body.");
+    return 8;
+  case PAYLOAD_BUDGET_EXCEEDED:
+    return 9;
+  default:
+    snprintf(reason, size, "JSON body non valido.");
+    return 4;
+  }
+}
+
+// Valida il body della richiesta `req` con la specifica `spec`. Il JSON
+// viene interpretato direttamente nello slot: il tape ne usa le stringhe
+// decodificate sul posto e non lo libera.
+static int check_slot(const ring_server_options *opts, const oas_spec *spec, const char *method,
+                      const shm_ring_request *req, char *reason, size_t size)
+{
+  cJSON *schema = oas_request_body_schema(spec->root, method, req->path);
+  if (!schema)
+  {
+    snprintf(reason, size, "impossibile trovare requestBody application/json->schema per %s %s", req->method,
+             req->path);
+    return 7;
+  }
+  jsval_mode mode = req->mode == JSVAL_MODE_LEXICAL ? JSVAL_MODE_LEXICAL : JSVAL_MODE_STRICT;
+
+  result_cache *cache = opts->cache;
+  result_cache_key key;
+  if (cache)
+  {
+    // la chiave precede il parsing, che riscrive le stringhe nello slot
+    key = result_cache_key_of(cache, spec->uid, method, req->path, (int)mode, req->body, req->len);
+    int verdict = 0;
+    char *cached = NULL;
+    if (result_cache_get(cache, &key, &verdict, &cached))
+    {
+      snprintf(reason, size, "%s", cached ? cached : "");
+      free(cached);
+      return verdict;
+    }
+  }
+
+  jsval_ctx ctx = jsval_ctx_make(spec->root, mode);
+  ctx.index = spec->index;
+  ctx.max_depth = opts->limits.max_depth;
+  ctx.symbols = spec->symbols;
+  ctx.pool = opts->pool;
+  ctx.parallel_min_items = opts->parallel_items;
+  ctx.memory = opts->memory;
+  ctx.adaptive_order = opts->adaptive_order;
+  ctx.budget = opts->budget;
+
+  int code = 0;
+  payload_tape tape;
+  bool borrowed = false;
+  const char *p = req->body;
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+    ++p;
+  if (*p == '{' || *p == '[')
+  {
+    char *parse_error = NULL;
+    payload_status ps = payload_parse(req->body, req->len, schema, &ctx, &opts->limits, &tape, &parse_error);
+    if (ps != PAYLOAD_OK)
+      code = parse_failure(ps, parse_error, reason, size);
+    free(parse_error);
+    borrowed = true;
+  }
+  else
+  {
+    char *yaml_error = NULL;
+    cJSON *inst = miniyaml_parse(req->body, &yaml_error);
+    if (!inst)
+    {
+      snprintf(reason, size, "YAML body non valido: %s", yaml_error ? yaml_error : "(sconosciuto)");
+      code = 4;
+    }
+    else if (!payload_tape_from_cjson(&tape, inst, ctx.symbols))
+    {
+      snprintf(reason, size, "memoria insufficiente per il body.");
+      code = 8;
+    }
+    payload_free(inst);
+    free(yaml_error);
+  }
+
+  if (code == 0)
+  {
+    if (opts->memo)
+      ctx.memo = jsval_memo_create();
+    jsval_result res = js_validate_tape(&tape, schema, &ctx);
+    jsval_memo_free(ctx.memo);
+    if (borrowed)
+      tape.text = NULL; // lo slot resta del produttore
+    payload_tape_free(&tape);
+    if (!res.ok)
+    {
+      snprintf(reason, size, "%s", res.error_msg ? res.error_msg : "(sconosciuto)");
+      code = 1;
+    }
+    jsval_result_free(&res);
+  }
+
+  if (req_budget_exceeded(opts->budget))
+  {
+    // validazione interrotta: nessun verdetto sul body
+    char what[64];
+    req_budget_describe(opts->budget, what, sizeof(what));
+    snprintf(reason, size, "validazione interrotta, budget della richiesta esaurito: %s", what);
+    return 9;
+  }
+  if (mem_account_exceeded(opts->memory))
+  {
+    snprintf(reason, size, "Memoria della richiesta oltre il limite di %zu byte", mem_account_limit(opts->memory));
+    return 1;
+  }
+  if (cache && code <= 1)
+    result_cache_put(cache, &key, code, code ? reason : NULL);
+  return code;
+}
+
+// Esito della richiesta `req`: codice di uscita del programma e motivo in
+// `reason` ("" se valida).
+static int validate_slot(spec_registry *reg, const ring_server_options *opts, const shm_ring_request *req,
+                         char *reason, size_t size)
+{
+  reason[0] = '\0';
+  if (req->truncated)
+  {
+    snprintf(reason, size, "Body oltre la dimensione dello slot (%zu byte)", req->len);
+    return 2;
+  }
+  if (opts->limits.max_bytes && req->len > opts->limits.max_bytes)
+  {
+    snprintf(reason, size, "Payload oltre il limite di %zu byte", opts->limits.max_bytes);
+    return 1;
+  }
+  char method_lower[SHM_RING_METHOD_MAX];
+  size_t i = 0;
+  for (; req->method[i] && i + 1 < sizeof(method_lower); ++i)
+    method_lower[i] = (char)tolower((unsigned char)req->method[i]);
+  method_lower[i] = '\0';
+
+  char *err = NULL;
+  const oas_spec *spec = spec_registry_acquire(reg, req->spec_id, &err);
+  if (!spec)
+  {
+    snprintf(reason, size, "%s", err ? err : "specifica non disponibile");
+    free(err);
+    return 5;
+  }
+  mem_account_reset(opts->memory);
+  req_budget_start(opts->budget);
+  mem_account *prev = mem_account_enter(opts->memory);
+  int code = check_slot(opts, spec, method_lower, req, reason, size);
+  mem_account_enter(prev);
+  spec_registry_release(reg, spec);
+  return code;
+}
+
+int ring_server_run(spec_registry *reg, const ring_server_options *opts)
+{
+  char *err = NULL;
+  size_t slots = opts->slots ? opts->slots : SHM_RING_DEFAULT_SLOTS;
+  shm_ring *ring = shm_ring_create(opts->name, slots, opts->slot_size, &err);
+  if (!ring)
+  {
+    fprintf(stderr, "Errore: %s.\n", err ? err : "memoria insufficiente");
+    free(err);
+    return 3;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  fprintf(stderr, "Anello %s: %zu byte di body per slot.\n", opts->name, shm_ring_slot_size(ring));
+  ring_totals totals;
+  memset(&totals, 0, sizeof(totals));
+  char reason[SHM_RING_REASON_MAX];
+  shm_ring_request req;
+  double last_reclaim = now_ms();
+  while (!ring_stop)
+  {
+    if (now_ms() - last_reclaim >= RING_RECLAIM_MS)
+    {
+      totals.reclaimed += shm_ring_reclaim(ring);
+      last_reclaim = now_ms();
+    }
+    if (!shm_ring_next(ring, &req, RING_POLL_MS))
+      continue;
+    double t0 = now_ms();
+    int code = validate_slot(reg, opts, &req, reason, sizeof(reason));
+    double elapsed = now_ms() - t0;
+    shm_ring_complete(ring, &req, code, reason);
+    ++totals.requests;
+    ++totals.counts[code > 1 ? 2 : code];
+    totals.validate_sum += elapsed;
+    if (elapsed > totals.validate_max)
+      totals.validate_max = elapsed;
+  }
+
+  shm_ring_destroy(ring);
+  if (opts->cache)
+  {
+    result_cache_stats st;
+    result_cache_get_stats(opts->cache, &st);
+    uint64_t total = st.hits + st.misses;
+    fprintf(stderr, "Anello: cache degli esiti %llu hit su %llu (%.1f%%), %zu esiti memorizzati.\n",
+            (unsigned long long)st.hits, (unsigned long long)total,
+            total ? 100.0 * (double)st.hits / (double)total : 0.0, st.entries);
+  }
+  if (totals.requests)
+    fprintf(stderr, "Anello: %zu richieste (OK %zu, non validi %zu, errori %zu), validazione media %.3f ms, "
+            "massima %.3f ms.\n", totals.requests, totals.counts[0], totals.counts[1], totals.counts[2],
+            totals.validate_sum / (double)totals.requests, totals.validate_max);
+  if (totals.reclaimed)
+    fprintf(stderr, "Anello: %zu slot recuperati da produttori terminati.\n", totals.reclaimed);
+  return 0;
+}
+
+#else
+
+int ring_server_run(spec_registry *reg, const ring_server_options *opts)
+{
+  (void)reg;
+  (void)opts;
+  fprintf(stderr, "Errore: il trasporto in memoria condivisa richiede Linux (futex).\n");
+  return 2;
+}
+
+#endif
@@ -0,0 +1,1148 @@
+#include "schema_codegen.h"
+#include "jsonschema.h"
+#include "ptrmap.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Testo generato, accumulato in memoria: prototipi, funzioni ausiliarie e
+// funzioni degli schemi vengono scritti nell'ordine richiesto dal C solo
+// alla fine.
+typedef struct cg_buf
+{
+  char *data;
+  size_t len;
+  size_t cap;
+  bool oom;
+} cg_buf;
+
+static void buf_free(cg_buf *b)
+{
+  free(b->data);
+  memset(b, 0, sizeof(*b));
+}
+
+static bool buf_reserve(cg_buf *b, size_t extra)
+{
+  if (b->oom)
+    return false;
+  if (b->len + extra + 1 <= b->cap)
+    return true;
+  size_t ncap = b->cap ? b->cap * 2 : 4096;
+  while (ncap < b->len + extra + 1)
+    ncap *= 2;
+  char *nd = (char *)realloc(b->data, ncap);
+  if (!nd)
+  {
+    b->oom = true;
+    return false;
+  }
+  b->data = nd;
+  b->cap = ncap;
+  return true;
+}
+
+static void buf_put(cg_buf *b, const char *s, size_t len)
+{
+  if (!buf_reserve(b, len))
+    return;
+  memcpy(b->data + b->len, s, len);
+  b->len += len;
+  b->data[b->len] = '\0';
+}
+
+static void buf_puts(cg_buf *b, const char *s)
+{
+  buf_put(b, s, strlen(s));
+}
+
+static void buf_printf(cg_buf *b, const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0 || !buf_reserve(b, (size_t)n))
+    return;
+  va_start(ap, fmt);
+  vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  b->len += (size_t)n;
+}
+
+// Letterale stringa C: i byte fuori dall'ASCII stampabile diventano escape
+// ottali a tre cifre, così non si fondono con i caratteri successivi.
+static void buf_cstr(cg_buf *b, const char *s)
+{
+  buf_put(b, "\"", 1);
+  for (const unsigned char *p = (const unsigned char *)s; *p; ++p)
+  {
+    if (*p == '"' || *p == '\\' || *p == '?')
+    {
+      char esc[2] = {'\\', (char)*p};
+      buf_put(b, esc, 2);
+    }
+    else if (*p < 0x20 || *p > 0x7e)
+      buf_printf(b, "\\%03o", *p);
+    else
+      buf_put(b, (const char *)p, 1);
+  }
+  buf_put(b, "\"", 1);
+}
+
+// Letterale double esatto (esadecimale); JSON non ha NaN, cJSON può
+// produrre infiniti per esponenti fuori intervallo.
+static void buf_double(cg_buf *b, double d)
+{
+  if (isinf(d))
+    buf_puts(b, d > 0 ? "HUGE_VAL" : "-HUGE_VAL");
+  else
+    buf_printf(b, "%a", d);
+}
+
+// Messaggio formattato come gli errori del validatore (troncato a 511 byte).
+static char *message_of(const char *fmt, const char *arg)
+{
+  char tmp[512];
+  snprintf(tmp, sizeof(tmp), fmt, arg);
+  size_t len = strlen(tmp);
+  char *out = (char *)malloc(len + 1);
+  if (out)
+    memcpy(out, tmp, len + 1);
+  return out;
+}
+
+// Funzione generata per un sotto-schema: qualunque istanza valida (schema
+// non oggetto), nodo con vincoli oppure $ref non risolvibile o ciclico.
+typedef enum
+{
+  CG_ANY,
+  CG_NODE,
+  CG_FAIL
+} cg_kind;
+
+typedef struct cg_target
+{
+  cg_kind kind;
+  const cJSON *node;
+  char *message; // CG_FAIL
+} cg_target;
+
+typedef struct codegen
+{
+  jsval_ctx ctx; // per la risoluzione dei $ref
+  cg_target *targets;
+  size_t target_count;
+  size_t target_cap;
+  ptrmap by_schema; // schema (prima dei $ref) -> indice del target + 1
+  const char **regexes;
+  size_t regex_count;
+  size_t regex_cap;
+  size_t helper_count;
+  bool any_used;  // v_0 è chiamata da qualche funzione
+  size_t matcher_count;
+  cg_buf matcher_init; // costruzione degli automi delle chiavi in aot_init
+  cg_buf helpers; // funzioni k_N
+  cg_buf nodes;   // funzioni v_N
+  bool oom;
+} codegen;
+
+static size_t add_target(codegen *g, cg_kind kind, const cJSON *node, char *message)
+{
+  if (g->target_count == g->target_cap)
+  {
+    size_t ncap = g->target_cap ? g->target_cap * 2 : 64;
+    cg_target *nt = (cg_target *)realloc(g->targets, ncap * sizeof(cg_target));
+    if (!nt)
+    {
+      g->oom = true;
+      free(message);
+      return 0;
+    }
+    g->targets = nt;
+    g->target_cap = ncap;
+  }
+  g->targets[g->target_count] = (cg_target){kind, node, message};
+  return g->target_count++;
+}
+
+static void remember(codegen *g, const cJSON *schema, size_t id)
+{
+  if (!ptrmap_put(&g->by_schema, schema, (void *)(uintptr_t)(id + 1)))
+    g->oom = true;
+}
+
+// Funzione che valida un'istanza contro `schema`, creata alla prima
+// richiesta. I $ref vengono seguiti come in vframe_start; il target 0
+// accetta qualunque istanza.
+static size_t target_for(codegen *g, const cJSON *schema)
+{
+  if (!cJSON_IsObject(schema))
+  {
+    g->any_used = true;
+    return 0;
+  }
+  size_t id = (size_t)(uintptr_t)ptrmap_get(&g->by_schema, schema);
+  if (id)
+    return id - 1;
+
+  const cJSON *node = schema;
+  cJSON *ref = cJSON_GetObjectItemCaseSensitive(node, "$ref");
+  unsigned hops = 0;
+  while (cJSON_IsString(ref))
+  {
+    if (++hops > JSVAL_MAX_REF_HOPS)
+    {
+      id = add_target(g, CG_FAIL, NULL, message_of("Catena di $ref troppo lunga o ciclica: '%s'.", ref->valuestring));
+      remember(g, schema, id);
+      return id;
+    }
+    cJSON *resolved = jsval_resolve_ref(ref->valuestring, &g->ctx);
+    if (!resolved)
+    {
+      id = add_target(g, CG_FAIL, NULL, message_of("Impossibile risolvere $ref '%s'.", ref->valuestring));
+      remember(g, schema, id);
+      return id;
+    }
+    node = resolved;
+    ref = cJSON_GetObjectItemCaseSensitive(node, "$ref");
+  }
+  if (node != schema)
+  {
+    id = target_for(g, node);
+    remember(g, schema, id);
+    return id;
+  }
+  id = add_target(g, CG_NODE, node, NULL);
+  remember(g, schema, id);
+  return id;
+}
+
+// Indice del pattern nella tabella delle regex del file generato.
+static size_t regex_index(codegen *g, const char *pattern)
+{
+  for (size_t i = 0; i < g->regex_count; ++i)
+  {
+    if (strcmp(g->regexes[i], pattern) == 0)
+      return i;
+  }
+  if (g->regex_count == g->regex_cap)
+  {
+    size_t ncap = g->regex_cap ? g->regex_cap * 2 : 16;
+    const char **nr = (const char **)realloc((void *)g->regexes, ncap * sizeof(char *));
+    if (!nr)
+    {
+      g->oom = true;
+      return 0;
+    }
+    g->regexes = nr;
+    g->regex_cap = ncap;
+  }
+  g->regexes[g->regex_count] = pattern;
+  return g->regex_count++;
+}
+
+static bool regex_valid(const char *pattern)
+{
+  js_regex re;
+  js_regex_compile(&re, pattern);
+  bool valid = re.valid;
+  js_regex_free(&re);
+  return valid;
+}
+
+// Posizione in cui i nomi (tutti lunghi `len`) hanno più caratteri diversi.
+static size_t best_position(const char *const *names, const size_t *idx, size_t count, size_t len)
+{
+  size_t best = 0, best_distinct = 0;
+  for (size_t p = 0; p < len; ++p)
+  {
+    bool seen[256] = {false};
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      unsigned char ch = (unsigned char)names[idx[i]][p];
+      if (!seen[ch])
+      {
+        seen[ch] = true;
+        ++distinct;
+      }
+    }
+    if (distinct > best_distinct)
+    {
+      best_distinct = distinct;
+      best = p;
+    }
+    if (distinct == count)
+      break;
+  }
+  return best;
+}
+
+static void emit_compare(cg_buf *b, const char *indent, const char *name, size_t len, size_t index)
+{
+  buf_printf(b, "%sif (memcmp(s, ", indent);
+  buf_cstr(b, name);
+  buf_printf(b, ", %zu) == 0)\n%s  return %zu;\n", len, indent, index);
+}
+
+static int cmp_size(const void *x, const void *y)
+{
+  size_t a = *(const size_t *)x, b = *(const size_t *)y;
+  return (a > b) - (a < b);
+}
+
+// Genera `static long k_N(const char *s, size_t n)` che restituisce l'indice
+// di `s` (lungo `n`) tra i nomi distinti `names`, -1 se assente: switch sulla
+// lunghezza, poi sul carattere che meglio distingue i nomi della stessa
+// lunghezza, infine memcmp.
+static size_t emit_name_switch(codegen *g, const char *const *names, size_t count)
+{
+  size_t id = g->helper_count++;
+  cg_buf *b = &g->helpers;
+  size_t *lens = (size_t *)malloc((count ? count : 1) * sizeof(size_t));
+  size_t *idx = (size_t *)malloc((count ? count : 1) * sizeof(size_t));
+  size_t *order = (size_t *)malloc((count ? count : 1) * 2 * sizeof(size_t));
+  if (!lens || !idx || !order)
+  {
+    g->oom = true;
+    free(lens);
+    free(idx);
+    free(order);
+    return id;
+  }
+  // coppie (lunghezza, indice) ordinate per lunghezza
+  for (size_t i = 0; i < count; ++i)
+  {
+    lens[i] = strlen(names[i]);
+    order[2 * i] = lens[i];
+    order[2 * i + 1] = i;
+  }
+  qsort(order, count, 2 * sizeof(size_t), cmp_size);
+
+  buf_printf(b, "static long k_%zu(const char *s, size_t n)\n{\n", id);
+  if (count == 1 && lens[0] == 0)
+    buf_puts(b, "  (void)s;\n");
+  buf_puts(b, "  switch (n)\n  {\n");
+  for (size_t i = 0; i < count;)
+  {
+    size_t len = order[2 * i];
+    size_t group = 0;
+    while (i + group < count && order[2 * (i + group)] == len)
+    {
+      idx[group] = order[2 * (i + group) + 1];
+      ++group;
+    }
+    buf_printf(b, "  case %zu:\n", len);
+    if (len == 0)
+      buf_printf(b, "    return %zu;\n", idx[0]);
+    else if (group == 1)
+    {
+      emit_compare(b, "    ", names[idx[0]], len, idx[0]);
+      buf_puts(b, "    return -1;\n");
+    }
+    else
+    {
+      size_t p = best_position(names, idx, group, len);
+      buf_printf(b, "    switch ((unsigned char)s[%zu])\n    {\n", p);
+      bool *done = (bool *)calloc(group, sizeof(bool));
+      if (!done)
+        g->oom = true;
+      for (size_t a = 0; done && a < group; ++a)
+      {
+        if (done[a])
+          continue;
+        unsigned char ch = (unsigned char)names[idx[a]][p];
+        buf_printf(b, "    case %u:\n", ch);
+        for (size_t c = a; c < group; ++c)
+        {
+          if (!done[c] && (unsigned char)names[idx[c]][p] == ch)
+          {
+            done[c] = true;
+            emit_compare(b, "      ", names[idx[c]], len, idx[c]);
+          }
+        }
+        buf_puts(b, "      return -1;\n");
+      }
+      free(done);
+      buf_puts(b, "    default:\n      return -1;\n    }\n");
+    }
+    i += group;
+  }
+  buf_puts(b, "  default:\n    return -1;\n  }\n}\n\n");
+  free(lens);
+  free(idx);
+  free(order);
+  return id;
+}
+
+// Aggiunge `name` ai nomi distinti e ne restituisce l'indice.
+static size_t intern_name(const char **names, size_t *count, const char *name)
+{
+  for (size_t i = 0; i < *count; ++i)
+  {
+    if (strcmp(names[i], name) == 0)
+      return i;
+  }
+  names[*count] = name;
+  return (*count)++;
+}
+
+// Tipi di istanza ammessi dal vincolo "type" (tutti se assente o non
+// standard): permettono di omettere i controlli che non possono applicarsi.
+enum
+{
+  K_STRING = 1,
+  K_NUMBER = 2,
+  K_BOOL = 4,
+  K_NULL = 8,
+  K_OBJECT = 16,
+  K_ARRAY = 32,
+  K_ALL = 63
+};
+
+static unsigned kinds_of(const char *t)
+{
+  if (!t)
+    return K_ALL;
+  if (strcmp(t, "object") == 0)
+    return K_OBJECT;
+  if (strcmp(t, "array") == 0)
+    return K_ARRAY;
+  if (strcmp(t, "string") == 0)
+    return K_STRING;
+  if (strcmp(t, "number") == 0 || strcmp(t, "integer") == 0)
+    return K_NUMBER;
+  if (strcmp(t, "boolean") == 0)
+    return K_BOOL;
+  if (strcmp(t, "null") == 0)
+    return K_NULL;
+  return K_ALL;
+}
+
+// Condizione di fallimento del vincolo "type", NULL se non verificato.
+static const char *type_failure(const char *t)
+{
+  switch (kinds_of(t))
+  {
+  case K_OBJECT:
+    return "tag != TAPE_OBJECT";
+  case K_ARRAY:
+    return "tag != TAPE_ARRAY";
+  case K_STRING:
+    return "tag != TAPE_STRING";
+  case K_NUMBER:
+    return strcmp(t, "integer") == 0
+               ? "!payload_tape_is_number(c->tape, inst) || !payload_tape_is_integer(c->tape, inst)"
+               : "!payload_tape_is_number(c->tape, inst)";
+  case K_BOOL:
+    return "tag != TAPE_TRUE && tag != TAPE_FALSE";
+  case K_NULL:
+    return "tag != TAPE_NULL";
+  default:
+    return NULL;
+  }
+}
+
+// Nomi oltre i quali le proprietà vengono cercate una per una invece che con
+// un indice della prima occorrenza sullo stack della funzione generata.
+#define CG_MAX_FOUND 256
+
+// Corpo di una funzione v_N in costruzione.
+typedef struct cg_node
+{
+  codegen *g;
+  cg_buf body;
+} cg_node;
+
+// Errore con messaggio noto alla generazione.
+static void emit_fail(cg_buf *b, const char *indent, const char *message)
+{
+  buf_printf(b, "%sreturn aot_fail(c, \"%%s\", ", indent);
+  buf_cstr(b, message);
+  buf_puts(b, ");\n");
+}
+
+static void emit_check(cg_node *e, const char *cond, const char *message)
+{
+  buf_printf(&e->body, "  if (%s)\n", cond);
+  emit_fail(&e->body, "    ", message);
+}
+
+static void emit_enum(cg_node *e, const cJSON *enm, unsigned kinds)
+{
+  codegen *g = e->g;
+  size_t count = (size_t)cJSON_GetArraySize(enm);
+  const char **names = (const char **)malloc((count ? count : 1) * sizeof(char *));
+  if (!names)
+  {
+    g->oom = true;
+    return;
+  }
+  size_t name_count = 0;
+  bool has_number = false, has_true = false, has_false = false;
+  const cJSON *it = NULL;
+  cJSON_ArrayForEach(it, enm)
+  {
+    if (cJSON_IsString(it))
+      intern_name(names, &name_count, it->valuestring);
+    else if (cJSON_IsNumber(it))
+      has_number = true;
+    else if (cJSON_IsTrue(it))
+      has_true = true;
+    else if (cJSON_IsFalse(it))
+      has_false = true;
+  }
+  cg_buf *b = &e->body;
+  bool any = false;
+  buf_puts(b, "  if (!(");
+  if (b->oom)
+  {
+    free(names);
+    return;
+  }
+  if (name_count && (kinds & K_STRING))
+  {
+    size_t k = emit_name_switch(g, names, name_count);
+    buf_printf(b, "(tag == TAPE_STRING && k_%zu(payload_tape_string(c->tape, inst), "
+                  "payload_tape_string_len(c->tape, inst)) >= 0)",
+               k);
+    any = true;
+  }
+  if (has_number && (kinds & K_NUMBER))
+  {
+    buf_puts(b, any ? " ||\n        (" : "(");
+    buf_puts(b, "payload_tape_is_number(c->tape, inst) && (");
+    bool first = true;
+    cJSON_ArrayForEach(it, enm)
+    {
+      if (!cJSON_IsNumber(it))
+        continue;
+      buf_puts(b, first ? "payload_tape_number(c->tape, inst) == " : " || payload_tape_number(c->tape, inst) == ");
+      buf_double(b, it->valuedouble);
+      first = false;
+    }
+    buf_puts(b, "))");
+    any = true;
+  }
+  if (has_true && (kinds & K_BOOL))
+  {
+    buf_puts(b, any ? " || tag == TAPE_TRUE" : "tag == TAPE_TRUE");
+    any = true;
+  }
+  if (has_false && (kinds & K_BOOL))
+  {
+    buf_puts(b, any ? " || tag == TAPE_FALSE" : "tag == TAPE_FALSE");
+    any = true;
+  }
+  if (any)
+  {
+    buf_puts(b, "))\n");
+    emit_fail(b, "    ", "Valore non incluso in 'enum'.");
+  }
+  else
+  {
+    // nessun valore dell'enum può corrispondere a un'istanza di questo tipo
+    b->len -= strlen("  if (!(");
+    b->data[b->len] = '\0';
+    emit_fail(b, "  ", "Valore non incluso in 'enum'.");
+  }
+  free(names);
+}
+
+// Vincoli sul valore del nodo, nell'ordine di vframe_start.
+static void emit_value_checks(cg_node *e, const cJSON *schema, const char *t)
+{
+  codegen *g = e->g;
+  unsigned kinds = kinds_of(t);
+  char cond[256];
+
+  const char *type_fail = type_failure(t);
+  if (type_fail)
+  {
+    char msg[512];
+    snprintf(msg, sizeof(msg), "Tipo non valido: atteso '%s'.", t);
+    emit_check(e, type_fail, msg);
+  }
+
+  // le condizioni sul tipo dell'istanza sono superflue se "type" lo fissa
+  const char *if_string = kinds == K_STRING ? "" : "tag == TAPE_STRING && ";
+  const char *if_number = kinds == K_NUMBER ? "" : "payload_tape_is_number(c->tape, inst) && ";
+
+  js_size_limits lim;
+  js_size_limits_read(schema, &lim);
+  if (kinds & K_STRING)
+  {
+    if (lim.min_length >= 0)
+    {
+      snprintf(cond, sizeof(cond), "%s(long long)payload_tape_string_len(c->tape, inst) < %lldLL", if_string,
+               lim.min_length);
+      emit_check(e, cond, "Stringa più corta di minLength");
+    }
+    if (lim.max_length >= 0)
+    {
+      snprintf(cond, sizeof(cond), "%s(long long)payload_tape_string_len(c->tape, inst) > %lldLL", if_string,
+               lim.max_length);
+      emit_check(e, cond, "Stringa più lunga di maxLength");
+    }
+  }
+
+  if (kinds & K_NUMBER)
+  {
+    const char *keys[2] = {"minimum", "maximum"};
+    for (int i = 0; i < 2; ++i)
+    {
+      cJSON *bound = cJSON_GetObjectItemCaseSensitive(schema, keys[i]);
+      if (!cJSON_IsNumber(bound))
+        continue;
+      buf_printf(&e->body, "  if (%spayload_tape_number(c->tape, inst) %s ", if_number, i ? ">" : "<");
+      buf_double(&e->body, bound->valuedouble);
+      buf_puts(&e->body, ")\n");
+      emit_fail(&e->body, "    ", i ? "Numero > maximum" : "Numero < minimum");
+    }
+  }
+
+  struct
+  {
+    unsigned kind;
+    const char *tag;
+    long long value;
+    const char *op;
+    const char *message;
+  } sizes[4] = {
+      {K_ARRAY, "TAPE_ARRAY", lim.min_items, "<", "Array con meno elementi di minItems"},
+      {K_ARRAY, "TAPE_ARRAY", lim.max_items, ">", "Array con più elementi di maxItems"},
+      {K_OBJECT, "TAPE_OBJECT", lim.min_properties, "<", "Oggetto con meno proprietà di minProperties"},
+      {K_OBJECT, "TAPE_OBJECT", lim.max_properties, ">", "Oggetto con più proprietà di maxProperties"},
+  };
+  for (int i = 0; i < 4; ++i)
+  {
+    if (sizes[i].value < 0 || !(kinds & sizes[i].kind))
+      continue;
+    char guard[32] = "";
+    if (kinds != sizes[i].kind)
+      snprintf(guard, sizeof(guard), "tag == %s && ", sizes[i].tag);
+    snprintf(cond, sizeof(cond), "%s(long long)payload_tape_size(c->tape, inst) %s %lldLL", guard, sizes[i].op,
+             sizes[i].value);
+    emit_check(e, cond, sizes[i].message);
+  }
+
+  cJSON *enm = cJSON_GetObjectItemCaseSensitive(schema, "enum");
+  if (cJSON_IsArray(enm))
+    emit_enum(e, enm, kinds);
+
+  cJSON *pattern = cJSON_GetObjectItemCaseSensitive(schema, "pattern");
+  if (cJSON_IsString(pattern) && (kinds & K_STRING))
+  {
+    if (!regex_valid(pattern->valuestring))
+    {
+      if (kinds == K_STRING)
+        emit_fail(&e->body, "  ", "Pattern non valido nello schema.");
+      else
+        emit_check(e, "tag == TAPE_STRING", "Pattern non valido nello schema.");
+    }
+    else
+    {
+      snprintf(cond, sizeof(cond), "%s!js_regex_match(&aot_re[%zu], payload_tape_string(c->tape, inst))", if_string,
+               regex_index(g, pattern->valuestring));
+      emit_check(e, cond, "Stringa non conforme al pattern.");
+    }
+  }
+}
+
+static void emit_descend(cg_buf *b, const char *indent, size_t target, const char *child)
+{
+  buf_printf(b, "%sif (!v_%zu(c, %s, level + 1))\n%s  return false;\n", indent, target, child, indent);
+}
+
+// Con patternProperties usa, se costruibile, lo stesso automa delle chiavi
+// del validatore (una passata per chiave invece di una regex per pattern):
+// l'automa viene costruito in aot_init e, se la costruzione fallisce a
+// runtime, resta il confronto con le singole regex che segue.
+static void emit_key_matcher(codegen *g, cg_buf *b, const cJSON *pattern_props, size_t pattern_count,
+                             const char **names, size_t name_count)
+{
+  const char **patterns = (const char **)malloc(pattern_count * sizeof(char *));
+  if (!patterns)
+  {
+    g->oom = true;
+    return;
+  }
+  size_t n = 0;
+  for (const cJSON *pp = pattern_props->child; pp; pp = pp->next)
+  {
+    if (pp->string)
+      patterns[n++] = pp->string;
+  }
+  js_key_matcher *probe = js_key_matcher_build(patterns, n, names, name_count);
+  if (!probe)
+  {
+    free((void *)patterns);
+    return;
+  }
+  js_key_matcher_free(probe);
+
+  size_t id = g->matcher_count++;
+  cg_buf *init = &g->matcher_init;
+  buf_puts(init, "  {\n    static const char *const patterns[] = {");
+  for (size_t i = 0; i < n; ++i)
+  {
+    buf_puts(init, i ? ", " : "");
+    buf_cstr(init, patterns[i]);
+  }
+  buf_puts(init, "};\n");
+  if (name_count)
+  {
+    buf_puts(init, "    static const char *const names[] = {");
+    for (size_t i = 0; i < name_count; ++i)
+    {
+      buf_puts(init, i ? ", " : "");
+      buf_cstr(init, names[i]);
+    }
+    buf_puts(init, "};\n");
+  }
+  buf_printf(init, "    aot_keys[%zu] = js_key_matcher_build(patterns, %zu, %s, %zu);\n  }\n", id, n,
+             name_count ? "names" : "NULL", name_count);
+
+  buf_printf(b, "    if (aot_keys[%zu])\n    {\n      js_key_match km;\n", id);
+  buf_printf(b, "      js_key_matcher_run(aot_keys[%zu], key, &km);\n", id);
+  buf_puts(b, "      if (c->lexical && km.literal < 0 && km.pattern_count == 0)\n"
+              "        return aot_fail(c, \"Chiave non prevista: '%s'\", key);\n");
+  size_t index = 0;
+  bool any = false;
+  for (const cJSON *pp = pattern_props->child; pp; pp = pp->next)
+  {
+    if (!pp->string)
+      continue;
+    bool descend = cJSON_IsObject(pp) || cJSON_IsArray(pp);
+    if (descend || cJSON_IsFalse(pp))
+    {
+      if (!any)
+        buf_puts(b, "      for (size_t j = 0; j < km.pattern_count; ++j)\n      {\n        switch (km.patterns[j])\n        {\n");
+      any = true;
+      buf_printf(b, "        case %zu:\n", index);
+      if (descend)
+      {
+        emit_descend(b, "          ", target_for(g, pp), "k + 2");
+        buf_puts(b, "          break;\n");
+      }
+      else
+        buf_puts(b, "          return aot_fail(c, \"Chiave '%s' non ammessa da patternProperties.\", key);\n");
+    }
+    ++index;
+  }
+  if (any)
+    buf_puts(b, "        }\n      }\n");
+  buf_puts(b, "      continue;\n    }\n");
+  free((void *)patterns);
+}
+
+// Proprietà, patternProperties e regola lexical, come vframe_props e
+// vframe_patterns: prima i figli di "properties" nell'ordine dello schema,
+// poi le chiavi dell'istanza nel loro ordine.
+static void emit_object(cg_node *e, const cJSON *schema, const cJSON *props, bool typed)
+{
+  codegen *g = e->g;
+  cg_buf *b = &e->body;
+  if (!typed)
+    emit_check(e, "tag != TAPE_OBJECT", "Atteso object.");
+
+  cJSON *req = cJSON_GetObjectItemCaseSensitive(schema, "required");
+  if (cJSON_IsArray(req))
+  {
+    bool any = false;
+    const cJSON *r = NULL;
+    cJSON_ArrayForEach(r, req)
+    {
+      if (!cJSON_IsString(r))
+        continue;
+      if (!any)
+        buf_puts(b, "  if (!c->lexical)\n  {\n");
+      any = true;
+      char msg[512];
+      snprintf(msg, sizeof(msg), "Campo richiesto mancante: '%s'", r->valuestring);
+      buf_puts(b, "    if (!payload_tape_has_ci(c->tape, inst, ");
+      buf_cstr(b, r->valuestring);
+      buf_puts(b, "))\n");
+      emit_fail(b, "      ", msg);
+    }
+    if (any)
+      buf_puts(b, "  }\n");
+  }
+
+  // nomi distinti di "properties" (tutti, per la regola lexical)
+  size_t prop_total = cJSON_IsObject(props) ? (size_t)cJSON_GetArraySize(props) : 0;
+  const char **names = (const char **)malloc((prop_total ? prop_total : 1) * sizeof(char *));
+  if (!names)
+  {
+    g->oom = true;
+    return;
+  }
+  size_t name_count = 0, object_props = 0;
+  for (const cJSON *p = prop_total ? props->child : NULL; p; p = p->next)
+  {
+    if (!p->string)
+      continue;
+    intern_name(names, &name_count, p->string);
+    if (cJSON_IsObject(p))
+      ++object_props;
+  }
+  size_t keys = name_count ? emit_name_switch(g, names, name_count) : 0;
+
+  const cJSON *pattern_props = cJSON_GetObjectItemCaseSensitive(schema, "patternProperties");
+  size_t pattern_count = 0;
+  for (const cJSON *pp = cJSON_IsObject(pattern_props) ? pattern_props->child : NULL; pp; pp = pp->next)
+  {
+    if (pp->string)
+      ++pattern_count;
+  }
+  // le chiavi vengono scorse comunque per la regola lexical
+  buf_puts(b, "  size_t end = (size_t)payload_tape_data(c->tape, inst);\n");
+
+  if (object_props && name_count > CG_MAX_FOUND)
+  {
+    // troppi nomi per un indice sullo stack: una ricerca per proprietà
+    for (const cJSON *p = props->child; p; p = p->next)
+    {
+      if (!p->string || !cJSON_IsObject(p))
+        continue;
+      size_t target = target_for(g, p);
+      buf_puts(b, "  {\n    size_t child = payload_tape_find(c->tape, inst, ");
+      buf_cstr(b, p->string);
+      buf_printf(b, ", 0);\n    if (child != TAPE_NONE && !v_%zu(c, child, level + 1))\n      return false;\n  }\n",
+                 target);
+    }
+  }
+  else if (object_props)
+  {
+    // una sola passata sulle chiavi trova la prima occorrenza di ogni nome
+    buf_printf(b, "  size_t found[%zu];\n", name_count);
+    buf_printf(b, "  for (size_t i = 0; i < %zu; ++i)\n    found[i] = TAPE_NONE;\n", name_count);
+    buf_puts(b, "  for (size_t k = inst + 1; k < end; k = payload_tape_next(c->tape, k + 2))\n  {\n");
+    buf_printf(b, "    long i = k_%zu(payload_tape_string(c->tape, k), payload_tape_string_len(c->tape, k));\n",
+               keys);
+    buf_puts(b, "    if (i >= 0 && found[i] == TAPE_NONE)\n      found[i] = k + 2;\n  }\n");
+    for (const cJSON *p = props->child; p; p = p->next)
+    {
+      if (!p->string || !cJSON_IsObject(p))
+        continue;
+      size_t ni = intern_name(names, &name_count, p->string);
+      size_t target = target_for(g, p);
+      buf_printf(b, "  if (found[%zu] != TAPE_NONE && !v_%zu(c, found[%zu], level + 1))\n    return false;\n", ni,
+                 target, ni);
+    }
+  }
+
+  // patternProperties (se presenti) e regola lexical su ogni chiave
+  if (!pattern_count && !name_count)
+  {
+    buf_puts(b, "  if (c->lexical && end > inst + 1)\n"
+                "    return aot_fail(c, \"Chiave non prevista: '%s'\", payload_tape_string(c->tape, inst + 1));\n");
+    free(names);
+    return;
+  }
+  // un pattern non valido interrompe la validazione alla prima chiave che
+  // lo raggiunge: i pattern successivi e la regola lexical non servono
+  size_t valid_prefix = 0, effective = 0;
+  const char *invalid = NULL;
+  for (const cJSON *pp = pattern_count ? pattern_props->child : NULL; pp; pp = pp->next)
+  {
+    if (!pp->string)
+      continue;
+    if (!regex_valid(pp->string))
+    {
+      invalid = pp->string;
+      break;
+    }
+    ++valid_prefix;
+    if (cJSON_IsObject(pp) || cJSON_IsArray(pp) || cJSON_IsFalse(pp))
+      ++effective;
+  }
+  bool lexical_check = !invalid;
+  bool need_matched = valid_prefix && lexical_check;
+  const char *indent = pattern_count ? "    " : "      ";
+  char *invalid_msg = invalid ? message_of("Pattern non valido nello schema: '%s'.", invalid) : NULL;
+  if (invalid && !invalid_msg)
+    g->oom = true;
+  if (!effective && invalid)
+  {
+    buf_puts(b, "  if (end > inst + 1)\n");
+    emit_fail(b, "    ", invalid_msg ? invalid_msg : "");
+    free(invalid_msg);
+    free(names);
+    return;
+  }
+  if (pattern_count)
+    buf_puts(b, "  for (size_t k = inst + 1; k < end; k = payload_tape_next(c->tape, k + 2))\n  {\n");
+  else
+    buf_puts(b, "  if (c->lexical)\n  {\n    for (size_t k = inst + 1; k < end; k = payload_tape_next(c->tape, k + 2))\n    {\n");
+  buf_printf(b, "%sconst char *key = payload_tape_string(c->tape, k);\n", indent);
+  if (pattern_count && !invalid)
+    emit_key_matcher(g, b, pattern_props, pattern_count, names, name_count);
+  if (need_matched)
+    buf_printf(b, "%sbool matched = false;\n", indent);
+  size_t emitted = 0;
+  for (const cJSON *pp = pattern_count ? pattern_props->child : NULL; pp && emitted < valid_prefix; pp = pp->next)
+  {
+    if (!pp->string)
+      continue;
+    ++emitted;
+    bool descend = cJSON_IsObject(pp) || cJSON_IsArray(pp);
+    if (!descend && !cJSON_IsFalse(pp) && !need_matched)
+      continue; // corrispondenza senza effetti
+    buf_printf(b, "%sif (js_regex_match(&aot_re[%zu], key))\n%s{\n", indent, regex_index(g, pp->string), indent);
+    if (need_matched)
+      buf_printf(b, "%s  matched = true;\n", indent);
+    char inner[16];
+    snprintf(inner, sizeof(inner), "%s  ", indent);
+    if (descend)
+      emit_descend(b, inner, target_for(g, pp), "k + 2");
+    else if (cJSON_IsFalse(pp))
+      buf_printf(b, "%sreturn aot_fail(c, \"Chiave '%%s' non ammessa da patternProperties.\", key);\n", inner);
+    buf_printf(b, "%s}\n", indent);
+  }
+  if (invalid)
+  {
+    emit_fail(b, indent, invalid_msg ? invalid_msg : "");
+    free(invalid_msg);
+  }
+  else
+  {
+    char in_props[128] = "";
+    if (name_count)
+      snprintf(in_props, sizeof(in_props), " && k_%zu(key, payload_tape_string_len(c->tape, k)) < 0", keys);
+    if (pattern_count)
+      buf_printf(b, "%sif (c->lexical%s%s)\n", indent, need_matched ? " && !matched" : "", in_props);
+    else
+      buf_printf(b, "%sif (%s)\n", indent, in_props + 4);
+    buf_printf(b, "%s  return aot_fail(c, \"Chiave non prevista: '%%s'\", key);\n", indent);
+  }
+  if (pattern_count)
+    buf_puts(b, "  }\n");
+  else
+    buf_puts(b, "    }\n  }\n");
+  free(names);
+}
+
+static void emit_node(codegen *g, size_t id)
+{
+  cg_target tg = g->targets[id];
+  cg_buf *out = &g->nodes;
+  buf_printf(out, "static bool v_%zu(aot_ctx *c, size_t inst, size_t level)\n{\n", id);
+  buf_puts(out, "  if (c->max_depth && level > c->max_depth)\n    return aot_too_deep(c);\n");
+  if (tg.kind == CG_ANY)
+  {
+    buf_puts(out, "  (void)inst;\n  return true;\n}\n\n");
+    return;
+  }
+  if (tg.kind == CG_FAIL)
+  {
+    buf_puts(out, "  (void)inst;\n");
+    emit_fail(out, "  ", tg.message);
+    buf_puts(out, "}\n\n");
+    return;
+  }
+
+  cg_node e = {g, {NULL, 0, 0, false}};
+  const cJSON *schema = tg.node;
+  cJSON *type = cJSON_GetObjectItemCaseSensitive(schema, "type");
+  const char *t = cJSON_IsString(type) ? type->valuestring : NULL;
+  emit_value_checks(&e, schema, t);
+
+  if (t && strcmp(t, "array") == 0)
+  {
+    cJSON *items = cJSON_GetObjectItemCaseSensitive(schema, "items");
+    if (items)
+    {
+      buf_puts(&e.body, "  size_t end = (size_t)payload_tape_data(c->tape, inst);\n");
+      buf_puts(&e.body, "  for (size_t el = inst + 1; el < end; el = payload_tape_next(c->tape, el))\n  {\n");
+      emit_descend(&e.body, "    ", target_for(g, items), "el");
+      buf_puts(&e.body, "  }\n");
+    }
+  }
+  else
+  {
+    bool typed = t && strcmp(t, "object") == 0;
+    cJSON *props = NULL;
+    if (typed || !t)
+      props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+    if (typed || cJSON_IsObject(props))
+      emit_object(&e, schema, props, typed);
+  }
+
+  // il tag dell'istanza viene letto solo se qualche controllo lo usa
+  bool uses_tag = e.body.data && (strstr(e.body.data, "tag ==") || strstr(e.body.data, "tag !="));
+  if (uses_tag)
+    buf_puts(out, "  payload_tape_tag tag = payload_tape_tag_at(c->tape, inst);\n");
+  if (!uses_tag && (!e.body.data || !strstr(e.body.data, "inst")))
+    buf_puts(out, "  (void)inst;\n");
+  if (e.body.len)
+    buf_put(out, e.body.data, e.body.len);
+  buf_puts(out, "  return true;\n}\n\n");
+  if (e.body.oom)
+    g->oom = true;
+  buf_free(&e.body);
+}
+
+static bool valid_identifier(const char *s)
+{
+  if (!s || !(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z')))
+    return false;
+  for (; *s; ++s)
+  {
+    if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') || (*s >= '0' && *s <= '9')))
+      return false;
+  }
+  return true;
+}
+
+static void set_error(char **error, const char *msg)
+{
+  if (error)
+    *error = message_of("%s", msg);
+}
+
+// Parte fissa del file generato: contesto e segnalazione degli errori con
+// lo stesso formato di js_validate_tape.
+static const char *const includes = "#include \"jsonschema.h\"\n"
+                                   "#include <math.h>\n"
+                                   "#include <stdarg.h>\n"
+                                   "#include <stdio.h>\n"
+                                   "#include <stdlib.h>\n"
+                                   "#include <string.h>\n";
+
+static const char *const preamble =
+    "\n"
+    "typedef struct aot_ctx\n"
+    "{\n"
+    "  payload_tape *tape;\n"
+    "  size_t max_depth;\n"
+    "  bool lexical;\n"
+    "  jsval_result res;\n"
+    "} aot_ctx;\n"
+    "\n"
+    "static bool aot_fail(aot_ctx *c, const char *fmt, ...)\n"
+    "{\n"
+    "  char buf[512];\n"
+    "  va_list ap;\n"
+    "  va_start(ap, fmt);\n"
+    "  vsnprintf(buf, sizeof(buf), fmt, ap);\n"
+    "  va_end(ap);\n"
+    "  c->res.ok = false;\n"
+    "  c->res.error_msg = (char *)mem_malloc(strlen(buf) + 1);\n"
+    "  if (c->res.error_msg)\n"
+    "    strcpy(c->res.error_msg, buf);\n"
+    "  return false;\n"
+    "}\n"
+    "\n"
+    "static bool aot_too_deep(aot_ctx *c)\n"
+    "{\n"
+    "  return aot_fail(c, \"Profondità di validazione oltre il limite di %zu livelli\", c->max_depth);\n"
+    "}\n"
+    "\n";
+
+bool js_codegen_emit(FILE *out, const cJSON *schema, cJSON *oas_root, const char *name, const char *title,
+                     char **error)
+{
+  if (error)
+    *error = NULL;
+  if (!valid_identifier(name))
+  {
+    set_error(error, "il nome della funzione generata non è un identificatore C valido");
+    return false;
+  }
+  codegen g;
+  memset(&g, 0, sizeof(g));
+  g.ctx = jsval_ctx_make(oas_root, JSVAL_MODE_STRICT);
+  if (!ptrmap_init(&g.by_schema, 64))
+  {
+    set_error(error, "memoria insufficiente");
+    return false;
+  }
+  add_target(&g, CG_ANY, NULL, NULL);
+  size_t root = target_for(&g, schema);
+  for (size_t i = 1; i < g.target_count && !g.oom; ++i)
+    emit_node(&g, i);
+  if (g.any_used)
+    emit_node(&g, 0);
+
+  bool ok = !g.oom && !g.helpers.oom && !g.nodes.oom && !g.matcher_init.oom;
+  if (ok)
+  {
+    cg_buf head = {NULL, 0, 0, false};
+    buf_puts(&head, "// Validatore generato da oas_validator --emit-c");
+    if (title)
+    {
+      buf_puts(&head, " per ");
+      buf_puts(&head, title);
+    }
+    buf_puts(&head, ".\n// Non modificare: rigenerare dalla specifica. Stessi esiti di js_validate_tape.\n");
+    buf_puts(&head, includes);
+    if (g.regex_count)
+      buf_puts(&head, "#include <threads.h>\n");
+    buf_puts(&head, preamble);
+    if (g.regex_count)
+    {
+      buf_printf(&head, "// Pattern e automi delle chiavi costruiti al primo uso e mantenuti per tutta\n"
+                        "// la vita del processo.\n"
+                        "static js_regex aot_re[%zu];\n",
+                 g.regex_count);
+      if (g.matcher_count)
+        buf_printf(&head, "static js_key_matcher *aot_keys[%zu];\n", g.matcher_count);
+      buf_puts(&head, "static once_flag aot_once = ONCE_FLAG_INIT;\n\nstatic void aot_init(void)\n{\n");
+      for (size_t i = 0; i < g.regex_count; ++i)
+      {
+        buf_printf(&head, "  js_regex_compile(&aot_re[%zu], ", i);
+        buf_cstr(&head, g.regexes[i]);
+        buf_puts(&head, ");\n");
+      }
+      if (g.matcher_count)
+        buf_put(&head, g.matcher_init.data, g.matcher_init.len);
+      buf_puts(&head, "}\n\n");
+    }
+    for (size_t i = g.any_used ? 0 : 1; i < g.target_count; ++i)
+      buf_printf(&head, "static bool v_%zu(aot_ctx *c, size_t inst, size_t level);\n", i);
+    buf_puts(&head, "\n");
+
+    cg_buf tail = {NULL, 0, 0, false};
+    buf_printf(&tail, "jsval_result %s(payload_tape *tape, const jsval_ctx *ctx)\n{\n", name);
+    buf_puts(&tail, "  aot_ctx c = {tape, ctx ? ctx->max_depth : JSVAL_DEFAULT_MAX_DEPTH,\n"
+                    "               ctx && ctx->mode == JSVAL_MODE_LEXICAL, {true, NULL, {0, 0, 0, 0}}};\n"
+                    "  if (!tape || tape->count == 0)\n"
+                    "  {\n"
+                    "    aot_fail(&c, \"Payload vuoto.\");\n"
+                    "    return c.res;\n"
+                    "  }\n");
+    if (g.regex_count)
+      buf_puts(&tail, "  call_once(&aot_once, aot_init);\n");
+    buf_printf(&tail, "  v_%zu(&c, 0, 0);\n  return c.res;\n}\n", root);
+
+    ok = !head.oom && !tail.oom;
+    if (ok)
+    {
+      ok = fwrite(head.data, 1, head.len, out) == head.len &&
+           (!g.helpers.len || fwrite(g.helpers.data, 1, g.helpers.len, out) == g.helpers.len) &&
+           fwrite(g.nodes.data, 1, g.nodes.len, out) == g.nodes.len && fwrite(tail.data, 1, tail.len, out) == tail.len;
+      if (!ok)
+        set_error(error, "scrittura del file generato non riuscita");
+    }
+    else
+      set_error(error, "memoria insufficiente");
+    buf_free(&head);
+    buf_free(&tail);
+  }
+  else
+    set_error(error, "memoria insufficiente");
+
+  for (size_t i = 0; i < g.target_count; ++i)
+    free(g.targets[i].message);
+  free(g.targets);
+  free((void *)g.regexes);
+  ptrmap_free(&g.by_schema);
+  buf_free(&g.helpers);
+  buf_free(&g.nodes);
+  buf_free(&g.matcher_init);
+  return ok;
+}
@@ -0,0 +1,1059 @@
+#include "schema_compile.h"
+#include "ptrmap.h"
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#ifdef _MSC_VER
+#include "regex_compat.h"
+#endif
+
+void js_regex_compile(js_regex *out, const char *pattern)
+{
+  memset(out, 0, sizeof(*out));
+  if (!pattern)
+    return;
+#ifndef _MSC_VER
+  out->valid = regcomp(&out->re, pattern, REG_EXTENDED | REG_NOSUB) == 0;
+#else
+  size_t len = strlen(pattern);
+  out->pattern = (char *)malloc(len + 1);
+  if (!out->pattern)
+    return;
+  memcpy(out->pattern, pattern, len + 1);
+  // regex_compat segnala i pattern non validi solo durante il match.
+  out->valid = regex_compat_match(pattern, "").valid;
+#endif
+}
+
+bool js_regex_match(const js_regex *re, const char *text)
+{
+  if (!re || !re->valid || !text)
+    return false;
+#ifndef _MSC_VER
+  return regexec(&re->re, text, 0, NULL, 0) == 0;
+#else
+  return regex_compat_match(re->pattern, text).matched;
+#endif
+}
+
+void js_regex_free(js_regex *re)
+{
+  if (!re)
+    return;
+#ifndef _MSC_VER
+  if (re->valid)
+    regfree(&re->re);
+#else
+  free(re->pattern);
+  re->pattern = NULL;
+#endif
+  re->valid = false;
+}
+
+// Numero di bucket del pool: le specifiche reali contengono al più qualche
+// migliaio di pattern/enum distinti.
+#define JS_POOL_BUCKETS 1024
+
+typedef enum
+{
+  POOL_REGEX,
+  POOL_ENUM,
+  POOL_KEYS
+} pool_kind;
+
+typedef struct pool_entry
+{
+  struct pool_entry *next;
+  uint64_t hash;
+  pool_kind kind;
+  size_t refs;
+  char *pattern; // POOL_REGEX
+  js_regex re;
+  js_enum_table table; // POOL_ENUM
+  // POOL_KEYS: pattern e poi nomi nell'ordine dello schema; `keys` è NULL
+  // se l'automa non è costruibile, così il tentativo non viene ripetuto
+  char **names;
+  size_t pattern_count;
+  size_t name_count;
+  js_key_matcher *keys;
+} pool_entry;
+
+struct js_compile_pool
+{
+  pool_entry *buckets[JS_POOL_BUCKETS];
+  size_t size;
+  size_t refs;
+  js_symtab *symbols;
+  mtx_t lock;
+};
+
+// Alias di un oggetto schema verso il nodo compilato canonico.
+typedef struct js_alias
+{
+  const cJSON *schema;
+  size_t canonical;
+} js_alias;
+
+struct js_schema_index
+{
+  ptrmap map;
+};
+
+struct js_compiled
+{
+  js_compiled_node *nodes;
+  size_t count;
+  size_t cap;
+  js_alias *aliases;
+  size_t alias_count;
+  size_t alias_cap;
+  pool_entry **entries; // voci del pool acquisite, da rilasciare
+  size_t entry_count;
+  size_t entry_cap;
+  js_compile_pool *pool;
+};
+
+static char *dup_str(const char *s)
+{
+  size_t len = strlen(s);
+  char *out = (char *)malloc(len + 1);
+  if (out)
+    memcpy(out, s, len + 1);
+  return out;
+}
+
+static int cmp_str_ptr(const void *a, const void *b)
+{
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+bool js_enum_table_contains(const js_enum_table *t, const char *s)
+{
+  if (!t || !s || t->count == 0)
+    return false;
+  return bsearch(&s, t->values, t->count, sizeof(char *), cmp_str_ptr) != NULL;
+}
+
+js_compile_pool *js_compile_pool_create(void)
+{
+  js_compile_pool *pool = (js_compile_pool *)calloc(1, sizeof(js_compile_pool));
+  if (!pool)
+    return NULL;
+  pool->symbols = js_symtab_create();
+  if (!pool->symbols || mtx_init(&pool->lock, mtx_plain) != thrd_success)
+  {
+    js_symtab_free(pool->symbols);
+    free(pool);
+    return NULL;
+  }
+  pool->refs = 1;
+  return pool;
+}
+
+js_compile_pool *js_compile_pool_retain(js_compile_pool *pool)
+{
+  if (pool)
+  {
+    mtx_lock(&pool->lock);
+    ++pool->refs;
+    mtx_unlock(&pool->lock);
+  }
+  return pool;
+}
+
+static void pool_entry_destroy(pool_entry *e)
+{
+  if (e->kind == POOL_REGEX)
+  {
+    js_regex_free(&e->re);
+    free(e->pattern);
+  }
+  else if (e->kind == POOL_KEYS)
+  {
+    for (size_t i = 0; i < e->name_count; ++i)
+      free(e->names[i]);
+    free(e->names);
+    js_key_matcher_free(e->keys);
+  }
+  else
+  {
+    for (size_t i = 0; i < e->table.count; ++i)
+      free(e->table.values[i]);
+    free(e->table.values);
+  }
+  free(e);
+}
+
+void js_compile_pool_release(js_compile_pool *pool)
+{
+  if (!pool)
+    return;
+  mtx_lock(&pool->lock);
+  size_t left = --pool->refs;
+  mtx_unlock(&pool->lock);
+  if (left > 0)
+    return;
+  for (size_t b = 0; b < JS_POOL_BUCKETS; ++b)
+  {
+    pool_entry *e = pool->buckets[b];
+    while (e)
+    {
+      pool_entry *next = e->next;
+      pool_entry_destroy(e);
+      e = next;
+    }
+  }
+  js_symtab_free(pool->symbols);
+  mtx_destroy(&pool->lock);
+  free(pool);
+}
+
+size_t js_compile_pool_size(const js_compile_pool *pool)
+{
+  return pool ? pool->size : 0;
+}
+
+js_symtab *js_compile_pool_symbols(js_compile_pool *pool)
+{
+  return pool ? pool->symbols : NULL;
+}
+
+// Costo stimato di una regex compilata: l'automa di regcomp cresce circa
+// linearmente con la lunghezza del pattern.
+#define JS_REGEX_BASE_BYTES 2560
+#define JS_REGEX_BYTES_PER_CHAR 200
+
+size_t js_compile_pool_bytes(js_compile_pool *pool)
+{
+  if (!pool)
+    return 0;
+  mtx_lock(&pool->lock);
+  size_t bytes = sizeof(js_compile_pool);
+  for (size_t b = 0; b < JS_POOL_BUCKETS; ++b)
+  {
+    for (const pool_entry *e = pool->buckets[b]; e; e = e->next)
+    {
+      bytes += sizeof(pool_entry);
+      if (e->kind == POOL_REGEX)
+      {
+        size_t len = strlen(e->pattern);
+        bytes += len + 1 + JS_REGEX_BASE_BYTES + JS_REGEX_BYTES_PER_CHAR * len;
+      }
+      else if (e->kind == POOL_KEYS)
+      {
+        bytes += e->name_count * sizeof(char *) + js_key_matcher_bytes(e->keys);
+        for (size_t i = 0; i < e->name_count; ++i)
+          bytes += strlen(e->names[i]) + 1;
+      }
+      else
+      {
+        bytes += e->table.count * sizeof(char *);
+        for (size_t i = 0; i < e->table.count; ++i)
+          bytes += strlen(e->table.values[i]) + 1;
+      }
+    }
+  }
+  mtx_unlock(&pool->lock);
+  return bytes + js_symtab_bytes(pool->symbols);
+}
+
+// FNV-1a a 64 bit su un intervallo di byte.
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  for (size_t i = 0; i < len; ++i)
+  {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static uint64_t hash_mix(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+#define HASH_SEED 0xcbf29ce484222325ULL
+
+// Registra un'acquisizione di voce del pool nell'unità compilata.
+static bool track_entry(js_compiled *c, pool_entry *e)
+{
+  if (c->entry_count == c->entry_cap)
+  {
+    size_t new_cap = c->entry_cap ? c->entry_cap * 2 : 16;
+    pool_entry **ne = (pool_entry **)realloc(c->entries, new_cap * sizeof(pool_entry *));
+    if (!ne)
+      return false;
+    c->entries = ne;
+    c->entry_cap = new_cap;
+  }
+  c->entries[c->entry_count++] = e;
+  return true;
+}
+
+// Restituisce (creandola se necessario) la regex condivisa per `pattern`.
+static const js_regex *pool_regex(js_compiled *c, const char *pattern)
+{
+  js_compile_pool *pool = c->pool;
+  uint64_t h = hash_bytes(HASH_SEED, pattern, strlen(pattern));
+  pool_entry **bucket = &pool->buckets[h % JS_POOL_BUCKETS];
+  mtx_lock(&pool->lock);
+  pool_entry *e = *bucket;
+  while (e && !(e->kind == POOL_REGEX && e->hash == h && strcmp(e->pattern, pattern) == 0))
+    e = e->next;
+  if (!e)
+  {
+    e = (pool_entry *)calloc(1, sizeof(pool_entry));
+    if (e)
+      e->pattern = dup_str(pattern);
+    if (!e || !e->pattern)
+    {
+      free(e);
+      mtx_unlock(&pool->lock);
+      return NULL;
+    }
+    e->kind = POOL_REGEX;
+    e->hash = h;
+    js_regex_compile(&e->re, pattern);
+    e->next = *bucket;
+    *bucket = e;
+    ++pool->size;
+  }
+  ++e->refs;
+  mtx_unlock(&pool->lock);
+  if (!track_entry(c, e))
+    return NULL;
+  return &e->re;
+}
+
+static bool same_table(const js_enum_table *a, char **sorted, size_t count)
+{
+  if (a->count != count)
+    return false;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (strcmp(a->values[i], sorted[i]) != 0)
+      return false;
+  }
+  return true;
+}
+
+// Restituisce la tabella condivisa per un enum di sole stringhe, NULL se
+// l'enum contiene altri tipi (in quel caso si usa il confronto generico).
+static const js_enum_table *pool_enum(js_compiled *c, const cJSON *enm, bool *oom)
+{
+  size_t count = (size_t)cJSON_GetArraySize(enm);
+  if (count == 0)
+    return NULL;
+  const cJSON *it = NULL;
+  cJSON_ArrayForEach(it, enm)
+  {
+    if (!cJSON_IsString(it))
+      return NULL;
+  }
+
+  char **sorted = (char **)malloc(count * sizeof(char *));
+  if (!sorted)
+  {
+    *oom = true;
+    return NULL;
+  }
+  size_t n = 0;
+  cJSON_ArrayForEach(it, enm)
+  {
+    sorted[n++] = it->valuestring;
+  }
+  qsort(sorted, count, sizeof(char *), cmp_str_ptr);
+  uint64_t h = HASH_SEED;
+  for (size_t i = 0; i < count; ++i)
+    h = hash_mix(hash_bytes(h, sorted[i], strlen(sorted[i]) + 1));
+
+  js_compile_pool *pool = c->pool;
+  pool_entry **bucket = &pool->buckets[h % JS_POOL_BUCKETS];
+  mtx_lock(&pool->lock);
+  pool_entry *e = *bucket;
+  while (e && !(e->kind == POOL_ENUM && e->hash == h && same_table(&e->table, sorted, count)))
+    e = e->next;
+  if (!e)
+  {
+    e = (pool_entry *)calloc(1, sizeof(pool_entry));
+    bool failed = !e;
+    if (e)
+    {
+      e->kind = POOL_ENUM;
+      e->hash = h;
+      e->table.values = (char **)calloc(count, sizeof(char *));
+      failed = !e->table.values;
+      for (size_t i = 0; !failed && i < count; ++i)
+      {
+        e->table.values[i] = dup_str(sorted[i]);
+        if (!e->table.values[i])
+          failed = true;
+        else
+          e->table.count = i + 1;
+      }
+    }
+    if (failed)
+    {
+      if (e)
+        pool_entry_destroy(e);
+      mtx_unlock(&pool->lock);
+      free(sorted);
+      *oom = true;
+      return NULL;
+    }
+    e->next = *bucket;
+    *bucket = e;
+    ++pool->size;
+  }
+  ++e->refs;
+  mtx_unlock(&pool->lock);
+  free(sorted);
+  if (!track_entry(c, e))
+  {
+    *oom = true;
+    return NULL;
+  }
+  return &e->table;
+}
+
+static bool same_names(const pool_entry *e, const char *const *names, size_t pattern_count, size_t count)
+{
+  if (e->pattern_count != pattern_count || e->name_count != count)
+    return false;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (strcmp(e->names[i], names[i]) != 0)
+      return false;
+  }
+  return true;
+}
+
+// Restituisce l'automa condiviso per i `pattern_count` pattern seguiti dai
+// nomi in `names`: schemi diversi con le stesse proprietà (campi comuni
+// ripetuti in molti componenti) usano un solo automa. NULL se l'automa non è
+// costruibile; `*oom` segnala la memoria insufficiente.
+static const js_key_matcher *pool_keys(js_compiled *c, const char *const *names, size_t pattern_count, size_t count,
+                                       bool *oom)
+{
+  uint64_t h = hash_mix(HASH_SEED ^ pattern_count);
+  for (size_t i = 0; i < count; ++i)
+    h = hash_mix(hash_bytes(h, names[i], strlen(names[i]) + 1));
+
+  js_compile_pool *pool = c->pool;
+  pool_entry **bucket = &pool->buckets[h % JS_POOL_BUCKETS];
+  mtx_lock(&pool->lock);
+  pool_entry *e = *bucket;
+  while (e && !(e->kind == POOL_KEYS && e->hash == h && same_names(e, names, pattern_count, count)))
+    e = e->next;
+  if (!e)
+  {
+    e = (pool_entry *)calloc(1, sizeof(pool_entry));
+    bool failed = !e;
+    if (e)
+    {
+      e->kind = POOL_KEYS;
+      e->hash = h;
+      e->pattern_count = pattern_count;
+      e->names = (char **)calloc(count, sizeof(char *));
+      failed = !e->names;
+      for (size_t i = 0; !failed && i < count; ++i)
+      {
+        e->names[i] = dup_str(names[i]);
+        if (!e->names[i])
+          failed = true;
+        else
+          e->name_count = i + 1;
+      }
+      if (!failed)
+        e->keys = js_key_matcher_build(names, pattern_count, names + pattern_count, count - pattern_count);
+    }
+    if (failed)
+    {
+      if (e)
+        pool_entry_destroy(e);
+      mtx_unlock(&pool->lock);
+      *oom = true;
+      return NULL;
+    }
+    e->next = *bucket;
+    *bucket = e;
+    ++pool->size;
+  }
+  ++e->refs;
+  mtx_unlock(&pool->lock);
+  if (!track_entry(c, e))
+  {
+    *oom = true;
+    return NULL;
+  }
+  return e->keys;
+}
+
+// Rilascia una voce del pool, distruggendola all'ultimo riferimento.
+static void pool_entry_release(js_compile_pool *pool, pool_entry *e)
+{
+  mtx_lock(&pool->lock);
+  if (--e->refs == 0)
+  {
+    pool_entry **link = &pool->buckets[e->hash % JS_POOL_BUCKETS];
+    while (*link != e)
+      link = &(*link)->next;
+    *link = e->next;
+    --pool->size;
+    pool_entry_destroy(e);
+  }
+  mtx_unlock(&pool->lock);
+}
+
+// Legge un vincolo intero non negativo; -1 se assente o non numerico.
+static long long read_limit(const cJSON *schema, const char *keyword)
+{
+  const cJSON *v = cJSON_GetObjectItemCaseSensitive(schema, keyword);
+  if (!cJSON_IsNumber(v) || v->valuedouble < 0)
+    return -1;
+  if (v->valuedouble >= 9.2e18)
+    return LLONG_MAX;
+  return (long long)v->valuedouble;
+}
+
+void js_size_limits_read(const cJSON *schema, js_size_limits *out)
+{
+  out->min_length = read_limit(schema, "minLength");
+  out->max_length = read_limit(schema, "maxLength");
+  out->min_items = read_limit(schema, "minItems");
+  out->max_items = read_limit(schema, "maxItems");
+  out->min_properties = read_limit(schema, "minProperties");
+  out->max_properties = read_limit(schema, "maxProperties");
+}
+
+struct js_prop_stats
+{
+  size_t count;
+  atomic_uint_least64_t hot;
+  atomic_uint total;
+  cJSON **props;
+  atomic_uint *rejects;
+};
+
+// Ricalcolo delle proprietà anticipate: a ogni rifiuto fino a
+// JS_PROP_RESORT, poi ogni JS_PROP_RESORT rifiuti. Ogni JS_PROP_DECAY i
+// contatori vengono dimezzati, così un cambiamento del traffico prevale sulla
+// storia passata.
+#define JS_PROP_RESORT 16
+#define JS_PROP_DECAY 1024
+
+// Statistiche delle proprietà di `schema`, NULL se ne ha meno di due o se
+// gli indici non entrano nei campi di `hot`.
+static js_prop_stats *prop_stats_create(const cJSON *schema, bool *oom)
+{
+  cJSON *props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+  size_t count = 0;
+  for (const cJSON *p = cJSON_IsObject(props) ? props->child : NULL; p; p = p->next)
+  {
+    if (p->string && cJSON_IsObject(p))
+      ++count;
+  }
+  if (count < 2 || count >= 0xFFFF)
+    return NULL;
+  js_prop_stats *s = (js_prop_stats *)malloc(sizeof(js_prop_stats) + count * (sizeof(cJSON *) + sizeof(atomic_uint)));
+  if (!s)
+  {
+    *oom = true;
+    return NULL;
+  }
+  s->count = count;
+  atomic_init(&s->hot, 0);
+  atomic_init(&s->total, 0);
+  s->props = (cJSON **)(s + 1);
+  s->rejects = (atomic_uint *)(s->props + count);
+  size_t i = 0;
+  for (cJSON *p = props->child; p; p = p->next)
+  {
+    if (p->string && cJSON_IsObject(p))
+    {
+      s->props[i] = p;
+      atomic_init(&s->rejects[i], 0);
+      ++i;
+    }
+  }
+  return s;
+}
+
+static size_t prop_stats_bytes(const js_prop_stats *s)
+{
+  return s ? sizeof(js_prop_stats) + s->count * (sizeof(cJSON *) + sizeof(atomic_uint)) : 0;
+}
+
+size_t js_prop_stats_count(const js_prop_stats *s)
+{
+  return s ? s->count : 0;
+}
+
+cJSON *js_prop_stats_prop(const js_prop_stats *s, size_t i)
+{
+  return s->props[i];
+}
+
+uint64_t js_prop_stats_hot(const js_prop_stats *s)
+{
+  return s ? (uint64_t)atomic_load_explicit(&((js_prop_stats *)s)->hot, memory_order_relaxed) : 0;
+}
+
+void js_prop_stats_reject(js_prop_stats *s, size_t i)
+{
+  if (!s || i >= s->count)
+    return;
+  atomic_fetch_add_explicit(&s->rejects[i], 1, memory_order_relaxed);
+  unsigned total = atomic_fetch_add_explicit(&s->total, 1, memory_order_relaxed) + 1;
+  if (total > JS_PROP_RESORT && total % JS_PROP_RESORT)
+    return;
+  // i thread concorrenti possono perdere qualche incremento o ricalcolare
+  // insieme: l'ordine è solo una stima e ogni pubblicazione è completa
+  bool decay = total % JS_PROP_DECAY == 0;
+  size_t best[JS_PROP_HOT];
+  unsigned best_count[JS_PROP_HOT];
+  size_t n = 0;
+  for (size_t j = 0; j < s->count; ++j)
+  {
+    unsigned c = atomic_load_explicit(&s->rejects[j], memory_order_relaxed);
+    if (decay)
+      atomic_store_explicit(&s->rejects[j], c / 2, memory_order_relaxed);
+    if (!c || (n == JS_PROP_HOT && c <= best_count[n - 1]))
+      continue;
+    // a parità di rifiuti resta prima la proprietà che viene prima nello schema
+    size_t k = n < JS_PROP_HOT ? n++ : n - 1;
+    while (k > 0 && best_count[k - 1] < c)
+    {
+      best[k] = best[k - 1];
+      best_count[k] = best_count[k - 1];
+      --k;
+    }
+    best[k] = j;
+    best_count[k] = c;
+  }
+  uint64_t hot = 0;
+  for (size_t k = 0; k < n; ++k)
+    hot |= (uint64_t)(best[k] + 1) << (16 * k);
+  atomic_store_explicit(&s->hot, hot, memory_order_relaxed);
+}
+
+static void free_node(js_compiled_node *n)
+{
+  free(n->pattern_props);
+  free(n->prop_stats);
+}
+
+// Con meno proprietà e senza patternProperties il confronto lineare tra i
+// simboli dei nomi costa meno di una tabella di transizione.
+#define JS_KEY_MATCHER_MIN_PROPS 8
+
+// Costruisce l'automa delle chiavi di `n`. Un automa non costruibile (pattern
+// fuori dal sottoinsieme, limiti di dimensione) non è un errore: il
+// validatore usa le regex dei singoli pattern; false solo se manca memoria.
+static bool compile_key_matcher(js_compiled *c, js_compiled_node *n, const cJSON *schema)
+{
+  cJSON *props = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+  size_t literal_count = cJSON_IsObject(props) ? (size_t)cJSON_GetArraySize(props) : 0;
+  if (n->pattern_prop_count == 0 && literal_count < JS_KEY_MATCHER_MIN_PROPS)
+    return true;
+  for (size_t i = 0; i < n->pattern_prop_count; ++i)
+  {
+    // un pattern non valido viene segnalato dal percorso con le regex
+    if (!n->pattern_props[i].re->valid)
+      return true;
+  }
+  const char **names = (const char **)malloc((n->pattern_prop_count + literal_count + 1) * sizeof(char *));
+  if (!names)
+    return false;
+  for (size_t i = 0; i < n->pattern_prop_count; ++i)
+    names[i] = n->pattern_props[i].pattern;
+  size_t lit = 0;
+  for (const cJSON *p = literal_count ? props->child : NULL; p; p = p->next)
+  {
+    if (p->string)
+      names[n->pattern_prop_count + lit++] = p->string;
+  }
+  bool oom = false;
+  n->keys = pool_keys(c, names, n->pattern_prop_count, n->pattern_prop_count + lit, &oom);
+  free(names);
+  return !oom;
+}
+
+// Compila i dati di un singolo oggetto schema (pattern, patternProperties,
+// enum, vincoli dimensionali).
+static bool compile_node(js_compiled *c, js_compiled_node *n, const cJSON *schema)
+{
+  memset(n, 0, sizeof(*n));
+  n->schema = schema;
+  js_size_limits_read(schema, &n->limits);
+
+  cJSON *pattern = cJSON_GetObjectItemCaseSensitive(schema, "pattern");
+  if (cJSON_IsString(pattern))
+  {
+    n->pattern = pool_regex(c, pattern->valuestring);
+    if (!n->pattern)
+      return false;
+  }
+
+  cJSON *pp = cJSON_GetObjectItemCaseSensitive(schema, "patternProperties");
+  if (cJSON_IsObject(pp))
+  {
+    size_t count = (size_t)cJSON_GetArraySize(pp);
+    if (count > 0)
+    {
+      n->pattern_props = (js_pattern_prop *)calloc(count, sizeof(js_pattern_prop));
+      if (!n->pattern_props)
+        return false;
+      cJSON *it = NULL;
+      cJSON_ArrayForEach(it, pp)
+      {
+        if (!it->string)
+          continue;
+        js_pattern_prop *p = &n->pattern_props[n->pattern_prop_count++];
+        p->pattern = it->string;
+        p->schema = it;
+        p->re = pool_regex(c, it->string);
+        if (!p->re)
+          return false;
+      }
+    }
+  }
+
+  if (!compile_key_matcher(c, n, schema))
+    return false;
+
+  bool oom = false;
+  n->prop_stats = prop_stats_create(schema, &oom);
+  if (oom)
+    return false;
+
+  cJSON *enm = cJSON_GetObjectItemCaseSensitive(schema, "enum");
+  if (cJSON_IsArray(enm))
+  {
+    n->enum_strings = pool_enum(c, enm, &oom);
+    if (oom)
+      return false;
+  }
+  return true;
+}
+
+static bool push_alias(js_compiled *c, const cJSON *schema, size_t canonical)
+{
+  if (c->alias_count == c->alias_cap)
+  {
+    size_t new_cap = c->alias_cap ? c->alias_cap * 2 : 32;
+    js_alias *na = (js_alias *)realloc(c->aliases, new_cap * sizeof(js_alias));
+    if (!na)
+      return false;
+    c->aliases = na;
+    c->alias_cap = new_cap;
+  }
+  c->aliases[c->alias_count].schema = schema;
+  c->aliases[c->alias_count].canonical = canonical;
+  ++c->alias_count;
+  return true;
+}
+
+// Tabella hash strutturale -> nodo canonico usata durante la compilazione.
+typedef struct cons_table
+{
+  uint64_t *hashes;
+  size_t *slots; // indice in c->nodes + 1 (0 = vuoto)
+  size_t cap;
+  size_t count;
+} cons_table;
+
+static bool cons_grow(cons_table *t)
+{
+  size_t new_cap = t->cap ? t->cap * 2 : 64;
+  uint64_t *nh = (uint64_t *)calloc(new_cap, sizeof(uint64_t));
+  size_t *ns = (size_t *)calloc(new_cap, sizeof(size_t));
+  if (!nh || !ns)
+  {
+    free(nh);
+    free(ns);
+    return false;
+  }
+  for (size_t i = 0; i < t->cap; ++i)
+  {
+    if (!t->slots[i])
+      continue;
+    size_t j = (size_t)(t->hashes[i] & (new_cap - 1));
+    while (ns[j])
+      j = (j + 1) & (new_cap - 1);
+    nh[j] = t->hashes[i];
+    ns[j] = t->slots[i];
+  }
+  free(t->hashes);
+  free(t->slots);
+  t->hashes = nh;
+  t->slots = ns;
+  t->cap = new_cap;
+  return true;
+}
+
+typedef struct compile_state
+{
+  js_compiled *c;
+  cons_table cons;
+} compile_state;
+
+// Registra `node` come canonico oppure come alias di un nodo già compilato
+// con identico contenuto (hash-consing).
+static bool intern_object(compile_state *st, const cJSON *node, uint64_t h)
+{
+  js_compiled *c = st->c;
+  if (st->cons.cap)
+  {
+    size_t i = (size_t)(h & (st->cons.cap - 1));
+    while (st->cons.slots[i])
+    {
+      size_t idx = st->cons.slots[i] - 1;
+      if (st->cons.hashes[i] == h && cJSON_Compare(c->nodes[idx].schema, node, true))
+        return push_alias(c, node, idx);
+      i = (i + 1) & (st->cons.cap - 1);
+    }
+  }
+
+  if (c->count == c->cap)
+  {
+    size_t new_cap = c->cap ? c->cap * 2 : 32;
+    js_compiled_node *nn = (js_compiled_node *)realloc(c->nodes, new_cap * sizeof(js_compiled_node));
+    if (!nn)
+      return false;
+    c->nodes = nn;
+    c->cap = new_cap;
+  }
+  if (!compile_node(c, &c->nodes[c->count], node))
+  {
+    free_node(&c->nodes[c->count]);
+    return false;
+  }
+  ++c->count;
+
+  if ((st->cons.count + 1) * 2 > st->cons.cap && !cons_grow(&st->cons))
+    return false;
+  size_t i = (size_t)(h & (st->cons.cap - 1));
+  while (st->cons.slots[i])
+    i = (i + 1) & (st->cons.cap - 1);
+  st->cons.hashes[i] = h;
+  st->cons.slots[i] = c->count;
+  ++st->cons.count;
+  return true;
+}
+
+static uint64_t hash_scalar(const cJSON *node)
+{
+  uint64_t h = HASH_SEED;
+  int type = node->type & 0xFF;
+  h = hash_bytes(h, &type, sizeof(type));
+  if (cJSON_IsString(node) || cJSON_IsRaw(node))
+  {
+    if (node->valuestring)
+      h = hash_bytes(h, node->valuestring, strlen(node->valuestring));
+  }
+  else if (cJSON_IsNumber(node))
+  {
+    double d = node->valuedouble;
+    if (d == 0)
+      d = 0; // -0 e 0 hanno lo stesso hash
+    h = hash_bytes(h, &d, sizeof(d));
+  }
+  return h;
+}
+
+// Combina l'hash di un membro di oggetto: la somma commutativa rende il
+// risultato indipendente dall'ordine delle chiavi.
+static uint64_t hash_member(const cJSON *member, uint64_t value_hash)
+{
+  uint64_t kh = member->string ? hash_bytes(HASH_SEED, member->string, strlen(member->string)) : 0;
+  return hash_mix(kh ^ (value_hash * 31));
+}
+
+static uint64_t hash_element(uint64_t h, uint64_t value_hash)
+{
+  return hash_mix(h ^ value_hash) + 0x9e3779b97f4a7c15ULL;
+}
+
+// Visita in post-ordine: calcola l'hash strutturale di ogni nodo una sola
+// volta e registra ogni oggetto incontrato.
+static bool compile_walk(compile_state *st, const cJSON *node, uint64_t *hash_out)
+{
+  uint64_t h = hash_scalar(node);
+  if (cJSON_IsObject(node) || cJSON_IsArray(node))
+  {
+    uint64_t acc = 0;
+    const cJSON *child = NULL;
+    for (child = node->child; child; child = child->next)
+    {
+      uint64_t ch;
+      // i valori stringa internati sono anch'essi cJSON_IsReference
+      if ((child->type & cJSON_IsReference) && !cJSON_IsString(child))
+        ch = hash_mix((uint64_t)(uintptr_t)child->child); // contenuto di un'altra unità
+      else if (!compile_walk(st, child, &ch))
+        return false;
+      if (cJSON_IsObject(node))
+        acc += hash_member(child, ch);
+      else
+        h = hash_element(h, ch);
+    }
+    if (cJSON_IsObject(node))
+    {
+      h = hash_mix(h ^ acc);
+      if (!intern_object(st, node, h))
+        return false;
+    }
+  }
+  *hash_out = h;
+  return true;
+}
+
+
+js_compiled *js_compile_schema(const cJSON *schema, js_compile_pool *pool)
+{
+  js_compiled *c = (js_compiled *)calloc(1, sizeof(js_compiled));
+  if (!c)
+    return NULL;
+  c->pool = pool ? js_compile_pool_retain(pool) : js_compile_pool_create();
+  if (!c->pool)
+  {
+    free(c);
+    return NULL;
+  }
+  compile_state st;
+  memset(&st, 0, sizeof(st));
+  st.c = c;
+  uint64_t h = 0;
+  bool ok = !schema || compile_walk(&st, schema, &h);
+  free(st.cons.hashes);
+  free(st.cons.slots);
+  if (!ok)
+  {
+    js_compiled_free(c);
+    return NULL;
+  }
+  return c;
+}
+
+void js_compiled_free(js_compiled *c)
+{
+  if (!c)
+    return;
+  for (size_t i = 0; i < c->count; ++i)
+    free_node(&c->nodes[i]);
+  for (size_t i = 0; i < c->entry_count; ++i)
+    pool_entry_release(c->pool, c->entries[i]);
+  free(c->entries);
+  free(c->nodes);
+  free(c->aliases);
+  js_compile_pool_release(c->pool);
+  free(c);
+}
+
+size_t js_compiled_count(const js_compiled *c)
+{
+  return c ? c->count : 0;
+}
+
+size_t js_compiled_shared_count(const js_compiled *c)
+{
+  return c ? c->alias_count : 0;
+}
+
+size_t js_compiled_bytes(const js_compiled *c)
+{
+  if (!c)
+    return 0;
+  size_t bytes = sizeof(js_compiled) + c->cap * sizeof(js_compiled_node) + c->alias_cap * sizeof(js_alias) +
+                 c->entry_cap * sizeof(pool_entry *);
+  for (size_t i = 0; i < c->count; ++i)
+    bytes += c->nodes[i].pattern_prop_count * sizeof(js_pattern_prop) + prop_stats_bytes(c->nodes[i].prop_stats);
+  return bytes;
+}
+
+js_schema_index *js_schema_index_create(size_t hint)
+{
+  js_schema_index *idx = (js_schema_index *)calloc(1, sizeof(js_schema_index));
+  if (!idx)
+    return NULL;
+  if (!ptrmap_init(&idx->map, hint))
+  {
+    free(idx);
+    return NULL;
+  }
+  return idx;
+}
+
+void js_schema_index_free(js_schema_index *idx)
+{
+  if (!idx)
+    return;
+  ptrmap_free(&idx->map);
+  free(idx);
+}
+
+bool js_schema_index_add(js_schema_index *idx, const js_compiled *unit)
+{
+  if (!idx || !unit)
+    return false;
+  for (size_t i = 0; i < unit->count; ++i)
+  {
+    if (!ptrmap_put(&idx->map, unit->nodes[i].schema, &unit->nodes[i]))
+      return false;
+  }
+  for (size_t i = 0; i < unit->alias_count; ++i)
+  {
+    if (!ptrmap_put(&idx->map, unit->aliases[i].schema, &unit->nodes[unit->aliases[i].canonical]))
+      return false;
+  }
+  return true;
+}
+
+bool js_schema_index_alias(js_schema_index *idx, const cJSON *alias, const cJSON *target)
+{
+  if (!idx)
+    return false;
+  void *node = ptrmap_get(&idx->map, target);
+  return node ? ptrmap_put(&idx->map, alias, node) : false;
+}
+
+const js_compiled_node *js_schema_index_lookup(const js_schema_index *idx, const cJSON *schema)
+{
+  return idx ? (const js_compiled_node *)ptrmap_get(&idx->map, schema) : NULL;
+}
+
+size_t js_schema_index_bytes(const js_schema_index *idx)
+{
+  return idx ? sizeof(js_schema_index) + idx->map.cap * sizeof(ptrmap_entry) : 0;
+}
+
+uint64_t js_hash_node(const cJSON *node)
+{
+  if (!node)
+    return 0;
+  uint64_t h = hash_scalar(node);
+  if (cJSON_IsObject(node))
+  {
+    uint64_t acc = 0;
+    const cJSON *it = NULL;
+    for (it = node->child; it; it = it->next)
+      acc += hash_member(it, js_hash_node(it));
+    h = hash_mix(h ^ acc);
+  }
+  else if (cJSON_IsArray(node))
+  {
+    const cJSON *it = NULL;
+    for (it = node->child; it; it = it->next)
+      h = hash_element(h, js_hash_node(it));
+  }
+  return h;
+}
@@ -0,0 +1,809 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // F_OFD_SETLK
+#endif
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "shm_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_MAGIC 0x5253414fu // "OASR"
+#define RING_VERSION 2
+#define RING_ALIGN 64
+// Controlli a vuoto prima di addormentarsi sul futex: con un flusso continuo
+// di richieste la parte in attesa trova il lavoro senza system call. Con un
+// solo processore il controllo a vuoto toglierebbe tempo all'altra parte.
+#define RING_SPIN 4096
+// Fine della pila degli slot liberi.
+#define RING_NONE 0xffffffffu
+
+// Stato di uno slot nei 2 bit bassi della parola `owner`; sopra, il
+// produttore che lo tiene (indice nei bit 8-15, generazione nei 32 alti).
+#define SLOT_FREE 0u   // nella pila dei liberi o appena preso
+#define SLOT_HELD 1u   // del produttore: riservato o esito raccolto
+#define SLOT_QUEUED 2u // pubblicato, del validatore
+#define SLOT_DONE 3u   // esito nell'anello di completamento del produttore
+#define SLOT_STATE(v) ((unsigned)((v)&3u))
+#define SLOT_CLIENT(v) ((unsigned)(((v) >> 8) & 0xffu))
+#define SLOT_GEN(v) ((uint32_t)((v) >> 32))
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() ((void)0)
+#endif
+
+// Anello di completamento di un produttore: scritto in coda dal validatore,
+// letto in testa dal produttore. Le voci (indici di slot) stanno nell'area
+// dei completamenti, 2 * `slots` per produttore: oltre agli esiti in corso
+// può restare una voce del produttore precedente con lo stesso indice.
+// `state` è la generazione (incrementata a ogni registrazione) per 2, più 1
+// finché il produttore è registrato; un produttore vivo tiene anche il lock
+// OFD sul byte del proprio indice nel file del segmento, che il kernel
+// rilascia quando il processo termina, anche per un crash.
+typedef struct ring_client
+{
+  alignas(RING_ALIGN) atomic_uint state;
+  atomic_ullong tail;
+  atomic_uint futex;
+  atomic_uint waiters;
+  alignas(RING_ALIGN) atomic_ullong head;
+} ring_client;
+
+// Voce dell'anello delle richieste: numero di sequenza (posizione + 1
+// quando è pubblicata, posizione + slots quando è libera per il giro
+// successivo) e slot pubblicato.
+typedef struct ring_cell
+{
+  atomic_ullong seq;
+  atomic_uint slot;
+  uint32_t pad;
+} ring_cell;
+
+typedef struct ring_header
+{
+  atomic_uint magic; // scritto per ultimo alla creazione
+  uint32_t version;
+  uint32_t slots;
+  uint32_t pad;
+  uint64_t slot_size;
+  uint64_t slot_stride;
+  uint64_t cells_offset;
+  uint64_t completions_offset;
+  uint64_t slots_offset;
+  uint64_t total_size;
+  atomic_uint closed;
+  // pila degli slot liberi: indice in cima (RING_NONE se vuota) nei 32 bit
+  // bassi, contatore delle modifiche contro l'ABA in quelli alti
+  alignas(RING_ALIGN) atomic_ullong free_top;
+  atomic_uint free_futex;
+  atomic_uint free_waiters;
+  // prossima posizione da pubblicare (produttori)
+  alignas(RING_ALIGN) atomic_ullong tail;
+  // prossima posizione da validare e attesa del validatore
+  alignas(RING_ALIGN) atomic_ullong head;
+  atomic_uint submit_futex;
+  atomic_uint submit_waiters;
+  ring_client clients[SHM_RING_MAX_CLIENTS];
+} ring_header;
+
+// Slot: descrittore, esito e body di una richiesta. Uno slot passa dalla
+// pila dei liberi al produttore, al validatore (tramite l'anello delle
+// richieste), di nuovo al produttore (tramite il suo anello di
+// completamento) e torna nella pila.
+typedef struct ring_slot
+{
+  atomic_uint next; // slot successivo nella pila dei liberi
+  uint32_t pad0;
+  atomic_ullong owner; // stato e produttore (SLOT_*)
+  uint64_t tag;
+  uint64_t len;
+  uint32_t mode;
+  int32_t code;
+  char spec_id[SHM_RING_ID_MAX];
+  char method[SHM_RING_METHOD_MAX];
+  char path[SHM_RING_PATH_MAX];
+  char reason[SHM_RING_REASON_MAX];
+  alignas(RING_ALIGN) char body[];
+} ring_slot;
+
+struct shm_ring
+{
+  ring_header *h;
+  size_t size;
+  uint32_t mask;
+  uint32_t cmask; // anelli di completamento
+  ring_cell *cells;
+  uint32_t *completions;
+  char *slots;
+  int spin;
+  int client; // indice del produttore, -1 per il validatore
+  uint64_t owner; // produttore: indice e generazione come in ring_slot.owner
+  int fd;         // file del segmento, per i lock dei produttori
+  char *name;     // solo il validatore, per shm_unlink
+};
+
+static size_t align_up(size_t n)
+{
+  return (n + RING_ALIGN - 1) & ~(size_t)(RING_ALIGN - 1);
+}
+
+static char *error_dup(const char *prefix, const char *name, int err)
+{
+  char buf[512];
+  snprintf(buf, sizeof(buf), "%s '%s'%s%s", prefix, name, err ? ": " : "", err ? strerror(err) : "");
+  char *s = (char *)malloc(strlen(buf) + 1);
+  if (s)
+    strcpy(s, buf);
+  return s;
+}
+
+static ring_slot *slot_at(const shm_ring *r, uint32_t slot)
+{
+  return (ring_slot *)(r->slots + (size_t)(slot & r->mask) * r->h->slot_stride);
+}
+
+static int spin_count(void)
+{
+  return sysconf(_SC_NPROCESSORS_ONLN) > 1 ? RING_SPIN : 0;
+}
+
+static void copy_field(char *dst, size_t cap, const char *src)
+{
+  size_t n = src ? strlen(src) : 0;
+  if (n >= cap)
+    n = cap - 1;
+  memcpy(dst, src ? src : "", n);
+  dst[n] = '\0';
+}
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+// Il segmento è condiviso tra processi: futex non privati.
+static void futex_wait(atomic_uint *addr, unsigned val, double ms)
+{
+  struct timespec ts, *tp = NULL;
+  if (ms >= 0)
+  {
+    ts.tv_sec = (time_t)(ms / 1000.0);
+    ts.tv_nsec = (long)((ms - (double)ts.tv_sec * 1000.0) * 1e6);
+    tp = &ts;
+  }
+  syscall(SYS_futex, (unsigned *)addr, FUTEX_WAIT, val, tp, NULL, 0);
+}
+
+static void futex_wake(atomic_uint *addr, int count)
+{
+  syscall(SYS_futex, (unsigned *)addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+// Sveglia chi attende su `futex` dopo che lo stato è stato pubblicato. La
+// barriera fa da coppia con quella di wait_until: o chi attende vede il
+// nuovo stato, o chi notifica vede chi attende; senza attese nessuna
+// system call.
+static void notify(atomic_uint *futex, atomic_uint *waiters, int count)
+{
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(waiters, memory_order_relaxed) == 0)
+    return;
+  atomic_fetch_add(futex, 1);
+  futex_wake(futex, count);
+}
+
+typedef bool (*ring_ready)(shm_ring *r, void *arg);
+
+// Attende che `ready` sia vero, prima controllando a vuoto e poi sul futex,
+// fino a `timeout_ms` (-1 = senza limite). false allo scadere del tempo, se
+// un segnale interrompe l'attesa o, per i produttori, se il validatore ha
+// chiuso l'anello.
+static bool wait_until(shm_ring *r, atomic_uint *futex, atomic_uint *waiters, ring_ready ready, void *arg,
+                       int timeout_ms)
+{
+  for (int i = 0; i < r->spin; ++i)
+  {
+    if (ready(r, arg))
+      return true;
+    cpu_relax();
+  }
+  double deadline = timeout_ms >= 0 ? now_ms() + timeout_ms : 0;
+  for (;;)
+  {
+    if (r->client >= 0 && atomic_load(&r->h->closed))
+      return false;
+    double left = -1;
+    if (timeout_ms >= 0)
+    {
+      left = deadline - now_ms();
+      if (left <= 0)
+        return ready(r, arg);
+    }
+    unsigned v = atomic_load(futex);
+    atomic_fetch_add(waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    bool ok = ready(r, arg);
+    errno = 0;
+    if (!ok)
+    {
+      futex_wait(futex, v, left);
+      ok = ready(r, arg);
+    }
+    atomic_fetch_sub(waiters, 1);
+    if (ok)
+      return true;
+    // EINTR: il chiamante controlla i segnali
+    if (errno == EINTR)
+      return false;
+  }
+}
+
+shm_ring *shm_ring_create(const char *name, size_t slots, size_t slot_size, char **error_msg)
+{
+  *error_msg = NULL;
+  if (!name || name[0] != '/' || !name[1] || strchr(name + 1, '/'))
+  {
+    *error_msg = error_dup("nome del segmento non valido (atteso /nome)", name ? name : "", 0);
+    return NULL;
+  }
+  size_t n = 2;
+  while (n < slots && n < SHM_RING_MAX_SLOTS)
+    n *= 2;
+  if (slot_size == 0)
+    slot_size = SHM_RING_DEFAULT_SLOT_SIZE;
+  if (slot_size > SHM_RING_MAX_SLOT_SIZE)
+    slot_size = SHM_RING_MAX_SLOT_SIZE;
+  size_t stride = align_up(sizeof(ring_slot) + slot_size + 1);
+  size_t cells_offset = align_up(sizeof(ring_header));
+  size_t completions_offset = cells_offset + align_up(n * sizeof(ring_cell));
+  size_t slots_offset = completions_offset + align_up((size_t)SHM_RING_MAX_CLIENTS * 2 * n * sizeof(uint32_t));
+  if (stride > (SIZE_MAX - slots_offset) / n)
+  {
+    *error_msg = error_dup("anello troppo grande per il segmento", name, 0);
+    return NULL;
+  }
+  size_t total = slots_offset + stride * n;
+
+  shm_ring *r = (shm_ring *)calloc(1, sizeof(shm_ring));
+  char *name_copy = (char *)malloc(strlen(name) + 1);
+  if (!r || !name_copy)
+  {
+    free(r);
+    free(name_copy);
+    *error_msg = error_dup("memoria insufficiente per il segmento", name, 0);
+    return NULL;
+  }
+  strcpy(name_copy, name);
+  // un segmento rimasto da un validatore terminato non viene riusato: i suoi
+  // slot possono essere a metà
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 || ftruncate(fd, (off_t)total) != 0)
+  {
+    *error_msg = error_dup("impossibile creare il segmento", name, errno);
+    if (fd >= 0)
+    {
+      close(fd);
+      shm_unlink(name);
+    }
+    free(r);
+    free(name_copy);
+    return NULL;
+  }
+  void *base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+  {
+    *error_msg = error_dup("impossibile mappare il segmento", name, errno);
+    close(fd);
+    shm_unlink(name);
+    free(r);
+    free(name_copy);
+    return NULL;
+  }
+
+  // ftruncate azzera il segmento: contatori, produttori e completamenti
+  // partono da zero
+  r->h = (ring_header *)base;
+  r->size = total;
+  r->mask = (uint32_t)(n - 1);
+  r->cmask = (uint32_t)(2 * n - 1);
+  r->cells = (ring_cell *)((char *)base + cells_offset);
+  r->completions = (uint32_t *)((char *)base + completions_offset);
+  r->slots = (char *)base + slots_offset;
+  r->spin = spin_count();
+  r->client = -1;
+  r->fd = fd;
+  r->name = name_copy;
+  r->h->version = RING_VERSION;
+  r->h->slots = (uint32_t)n;
+  r->h->slot_size = slot_size;
+  r->h->slot_stride = stride;
+  r->h->cells_offset = cells_offset;
+  r->h->completions_offset = completions_offset;
+  r->h->slots_offset = slots_offset;
+  r->h->total_size = total;
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    atomic_init(&r->cells[i].seq, i);
+    atomic_init(&slot_at(r, i)->next, i + 1 < n ? i + 1 : RING_NONE);
+  }
+  atomic_init(&r->h->free_top, 0);
+  atomic_store_explicit(&r->h->magic, RING_MAGIC, memory_order_release);
+  return r;
+}
+
+static bool request_ready(shm_ring *r, void *arg)
+{
+  uint64_t pos = *(uint64_t *)arg;
+  return atomic_load_explicit(&r->cells[pos & r->mask].seq, memory_order_acquire) == pos + 1;
+}
+
+bool shm_ring_next(shm_ring *r, shm_ring_request *out, int timeout_ms)
+{
+  uint64_t pos = atomic_load_explicit(&r->h->head, memory_order_relaxed);
+  if (!wait_until(r, &r->h->submit_futex, &r->h->submit_waiters, request_ready, &pos, timeout_ms))
+    return false;
+  ring_cell *cell = &r->cells[pos & r->mask];
+  uint32_t slot = atomic_load_explicit(&cell->slot, memory_order_relaxed) & r->mask;
+  atomic_store_explicit(&cell->seq, pos + r->h->slots, memory_order_release);
+  ring_slot *s = slot_at(r, slot);
+  // i campi vengono dal produttore: terminatori e lunghezza non sono fidati
+  s->spec_id[SHM_RING_ID_MAX - 1] = '\0';
+  s->method[SHM_RING_METHOD_MAX - 1] = '\0';
+  s->path[SHM_RING_PATH_MAX - 1] = '\0';
+  out->slot = slot;
+  out->spec_id = s->spec_id;
+  out->method = s->method;
+  out->path = s->path;
+  out->mode = s->mode;
+  out->body = s->body;
+  out->truncated = s->len > r->h->slot_size;
+  out->len = out->truncated ? (size_t)r->h->slot_size : (size_t)s->len;
+  s->body[out->len] = '\0';
+  atomic_store_explicit(&r->h->head, pos + 1, memory_order_relaxed);
+  return true;
+}
+
+// Rimette lo slot nella pila dei liberi (Treiber, con contatore contro
+// l'ABA). Chi lo chiama ha portato `owner` a SLOT_FREE.
+static void push_free(shm_ring *r, uint32_t slot)
+{
+  ring_slot *s = slot_at(r, slot);
+  uint64_t top = atomic_load_explicit(&r->h->free_top, memory_order_relaxed);
+  uint64_t next;
+  do
+  {
+    atomic_store_explicit(&s->next, (uint32_t)top, memory_order_relaxed);
+    next = ((top >> 32) + 1) << 32 | slot;
+  } while (!atomic_compare_exchange_weak_explicit(&r->h->free_top, &top, next, memory_order_release,
+                                                  memory_order_relaxed));
+}
+
+// Libera lo slot se è ancora nello stato `expected`: tra validatore,
+// produttore e recupero lo restituisce uno solo.
+static bool free_slot(shm_ring *r, uint32_t slot, uint64_t expected)
+{
+  if (!atomic_compare_exchange_strong(&slot_at(r, slot)->owner, &expected, SLOT_FREE))
+    return false;
+  push_free(r, slot);
+  notify(&r->h->free_futex, &r->h->free_waiters, 1);
+  return true;
+}
+
+// true se il produttore che ha registrato lo slot con `owner` è ancora lo
+// stesso: stesso indice, stessa generazione e ancora registrato.
+static bool owner_registered(const shm_ring *r, uint64_t owner)
+{
+  unsigned c = SLOT_CLIENT(owner);
+  return c < SHM_RING_MAX_CLIENTS &&
+         atomic_load(&r->h->clients[c].state) == ((SLOT_GEN(owner) << 1) | 1u);
+}
+
+void shm_ring_complete(shm_ring *r, const shm_ring_request *req, int code, const char *reason)
+{
+  ring_slot *s = slot_at(r, req->slot);
+  s->code = code;
+  copy_field(s->reason, SHM_RING_REASON_MAX, reason);
+  uint64_t owner = (atomic_load_explicit(&s->owner, memory_order_relaxed) & ~(uint64_t)3) | SLOT_DONE;
+  atomic_store_explicit(&s->owner, owner, memory_order_release);
+  if (!owner_registered(r, owner))
+  {
+    // il produttore se n'è andato: lo slot torna subito tra i liberi
+    free_slot(r, req->slot, owner);
+    return;
+  }
+  unsigned c = SLOT_CLIENT(owner);
+  ring_client *cl = &r->h->clients[c];
+  uint64_t tail = atomic_load_explicit(&cl->tail, memory_order_relaxed);
+  r->completions[(size_t)c * 2 * r->h->slots + (tail & r->cmask)] = req->slot;
+  atomic_store_explicit(&cl->tail, tail + 1, memory_order_release);
+  notify(&cl->futex, &cl->waiters, 1);
+}
+
+// Lock OFD sul byte `c` del file del segmento: il produttore `c` lo tiene
+// finché è in vita.
+static bool client_lock(int fd, int cmd, unsigned c, short type, struct flock *fl)
+{
+  memset(fl, 0, sizeof(*fl));
+  fl->l_type = type;
+  fl->l_whence = SEEK_SET;
+  fl->l_start = (off_t)c;
+  fl->l_len = 1;
+  return fcntl(fd, cmd, fl) == 0;
+}
+
+// true se nessun processo tiene il lock del produttore `c`.
+static bool client_gone(const shm_ring *r, unsigned c)
+{
+  if ((int)c == r->client)
+    return false;
+  struct flock fl;
+  return client_lock(r->fd, F_OFD_GETLK, c, F_WRLCK, &fl) && fl.l_type == F_UNLCK;
+}
+
+size_t shm_ring_reclaim(shm_ring *r)
+{
+  ring_header *h = r->h;
+  // registrazioni rimaste da produttori terminati senza shm_ring_detach;
+  // la compare-and-swap fallisce se nel frattempo un nuovo produttore ha
+  // preso il lock e l'indice
+  for (unsigned c = 0; c < SHM_RING_MAX_CLIENTS; ++c)
+  {
+    unsigned st = atomic_load(&h->clients[c].state);
+    if ((st & 1u) && client_gone(r, c))
+      atomic_compare_exchange_strong(&h->clients[c].state, &st, st & ~1u);
+  }
+  size_t freed = 0;
+  for (uint32_t i = 0; i < h->slots; ++i)
+  {
+    uint64_t owner = atomic_load(&slot_at(r, i)->owner);
+    unsigned st = SLOT_STATE(owner);
+    if ((st == SLOT_HELD || st == SLOT_DONE) && !owner_registered(r, owner) && free_slot(r, i, owner))
+      ++freed;
+  }
+  return freed;
+}
+
+void shm_ring_destroy(shm_ring *r)
+{
+  if (!r)
+    return;
+  atomic_store(&r->h->closed, 1);
+  atomic_fetch_add(&r->h->free_futex, 1);
+  futex_wake(&r->h->free_futex, INT_MAX);
+  for (size_t c = 0; c < SHM_RING_MAX_CLIENTS; ++c)
+  {
+    atomic_fetch_add(&r->h->clients[c].futex, 1);
+    futex_wake(&r->h->clients[c].futex, INT_MAX);
+  }
+  munmap(r->h, r->size);
+  close(r->fd);
+  if (r->name)
+    shm_unlink(r->name);
+  free(r->name);
+  free(r);
+}
+
+shm_ring *shm_ring_attach(const char *name, char **error_msg)
+{
+  *error_msg = NULL;
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0)
+  {
+    *error_msg = error_dup("impossibile aprire il segmento", name, errno);
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ring_header))
+  {
+    close(fd);
+    *error_msg = error_dup("segmento non valido", name, 0);
+    return NULL;
+  }
+  void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+  {
+    *error_msg = error_dup("impossibile mappare il segmento", name, errno);
+    close(fd);
+    return NULL;
+  }
+  ring_header *h = (ring_header *)base;
+  const char *problem = NULL;
+  if (atomic_load_explicit(&h->magic, memory_order_acquire) != RING_MAGIC || h->version != RING_VERSION ||
+      h->total_size != (uint64_t)st.st_size || h->slots < 2 || (h->slots & (h->slots - 1)) != 0)
+    problem = "segmento non valido o di un'altra versione";
+  else if (atomic_load(&h->closed))
+    problem = "validatore terminato per il segmento";
+  shm_ring *r = problem ? NULL : (shm_ring *)calloc(1, sizeof(shm_ring));
+  if (!r)
+  {
+    munmap(base, (size_t)st.st_size);
+    close(fd);
+    *error_msg = error_dup(problem ? problem : "memoria insufficiente per il segmento", name, 0);
+    return NULL;
+  }
+  r->h = h;
+  r->size = (size_t)st.st_size;
+  r->mask = h->slots - 1;
+  r->cmask = 2 * h->slots - 1;
+  r->cells = (ring_cell *)((char *)base + h->cells_offset);
+  r->completions = (uint32_t *)((char *)base + h->completions_offset);
+  r->slots = (char *)base + h->slots_offset;
+  r->spin = spin_count();
+  r->client = -1;
+  r->fd = fd;
+  // l'indice è di chi ne ottiene il lock: quello di un produttore terminato
+  // è di nuovo libero anche se la sua registrazione è rimasta
+  for (int c = 0; c < SHM_RING_MAX_CLIENTS && r->client < 0; ++c)
+  {
+    struct flock fl;
+    if (client_lock(fd, F_OFD_SETLK, (unsigned)c, F_WRLCK, &fl))
+      r->client = c;
+  }
+  if (r->client < 0)
+  {
+    shm_ring_detach(r);
+    *error_msg = error_dup("troppi produttori collegati al segmento", name, 0);
+    return NULL;
+  }
+  ring_client *cl = &h->clients[r->client];
+  unsigned gen = (atomic_load(&cl->state) >> 1) + 1;
+  atomic_store(&cl->state, (gen << 1) | 1u);
+  r->owner = (uint64_t)(gen & 0x7fffffffu) << 32 | (uint64_t)r->client << 8;
+  // gli esiti rimasti al produttore precedente con lo stesso indice non
+  // verranno raccolti: i loro slot, e quelli che teneva, tornano liberi
+  atomic_store(&cl->head, atomic_load_explicit(&cl->tail, memory_order_acquire));
+  shm_ring_reclaim(r);
+  return r;
+}
+
+void shm_ring_detach(shm_ring *r)
+{
+  if (!r)
+    return;
+  if (r->client >= 0)
+  {
+    // gli slot ancora tenuti vengono recuperati dal validatore
+    ring_client *cl = &r->h->clients[r->client];
+    atomic_store(&cl->state, atomic_load(&cl->state) & ~1u);
+  }
+  munmap(r->h, r->size);
+  close(r->fd); // rilascia il lock dell'indice
+  free(r);
+}
+
+size_t shm_ring_slot_size(const shm_ring *r)
+{
+  return (size_t)r->h->slot_size;
+}
+
+// Prende lo slot in cima alla pila dei liberi. Il campo `next` letto può
+// essere già cambiato se lo slot è stato preso e restituito nel frattempo:
+// il contatore nella cima fa allora fallire la compare-and-swap.
+static bool claim_slot(shm_ring *r, void *arg)
+{
+  uint64_t top = atomic_load_explicit(&r->h->free_top, memory_order_acquire);
+  for (;;)
+  {
+    uint32_t slot = (uint32_t)top;
+    if (slot == RING_NONE)
+      return false;
+    uint32_t next = atomic_load_explicit(&slot_at(r, slot)->next, memory_order_relaxed);
+    uint64_t next_top = ((top >> 32) + 1) << 32 | next;
+    if (atomic_compare_exchange_weak_explicit(&r->h->free_top, &top, next_top, memory_order_acquire,
+                                              memory_order_acquire))
+    {
+      *(uint32_t *)arg = slot & r->mask;
+      return true;
+    }
+  }
+}
+
+long shm_ring_reserve(shm_ring *r, char **body, int timeout_ms)
+{
+  uint32_t slot = 0;
+  if (atomic_load(&r->h->closed) ||
+      !wait_until(r, &r->h->free_futex, &r->h->free_waiters, claim_slot, &slot, timeout_ms))
+    return -1;
+  ring_slot *s = slot_at(r, slot);
+  atomic_store(&s->owner, r->owner | SLOT_HELD);
+  *body = s->body;
+  return (long)slot;
+}
+
+void shm_ring_submit(shm_ring *r, long slot, const char *spec_id, const char *method, const char *path,
+                     unsigned mode, size_t len, uint64_t tag)
+{
+  ring_slot *s = slot_at(r, (uint32_t)slot);
+  copy_field(s->spec_id, SHM_RING_ID_MAX, spec_id);
+  copy_field(s->method, SHM_RING_METHOD_MAX, method);
+  copy_field(s->path, SHM_RING_PATH_MAX, path);
+  s->mode = mode;
+  s->len = len;
+  s->tag = tag;
+  s->code = 0;
+  s->reason[0] = '\0';
+  atomic_store_explicit(&s->owner, r->owner | SLOT_QUEUED, memory_order_relaxed);
+
+  // l'anello ha una voce per slot: una voce libera c'è sempre, al più un
+  // altro produttore la sta ancora pubblicando
+  ring_header *h = r->h;
+  uint64_t pos = atomic_load_explicit(&h->tail, memory_order_relaxed);
+  ring_cell *cell;
+  for (;;)
+  {
+    cell = &r->cells[pos & r->mask];
+    int64_t diff = (int64_t)(atomic_load_explicit(&cell->seq, memory_order_acquire) - pos);
+    if (diff == 0)
+    {
+      if (atomic_compare_exchange_weak_explicit(&h->tail, &pos, pos + 1, memory_order_relaxed,
+                                                memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+    {
+      cpu_relax();
+      pos = atomic_load_explicit(&h->tail, memory_order_relaxed);
+    }
+    else
+    {
+      pos = atomic_load_explicit(&h->tail, memory_order_relaxed);
+    }
+  }
+  atomic_store_explicit(&cell->slot, (uint32_t)slot, memory_order_relaxed);
+  atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+  notify(&h->submit_futex, &h->submit_waiters, 1);
+}
+
+// true se c'è un esito di questo produttore; salta le voci lasciate da un
+// produttore precedente con lo stesso indice, i cui slot vengono recuperati
+// da shm_ring_reclaim.
+static bool completion_ready(shm_ring *r, void *arg)
+{
+  (void)arg;
+  ring_client *cl = &r->h->clients[r->client];
+  uint64_t head = atomic_load_explicit(&cl->head, memory_order_relaxed);
+  while (atomic_load_explicit(&cl->tail, memory_order_acquire) > head)
+  {
+    uint32_t slot = r->completions[(size_t)r->client * 2 * r->h->slots + (head & r->cmask)];
+    if (atomic_load_explicit(&slot_at(r, slot)->owner, memory_order_acquire) == (r->owner | SLOT_DONE))
+      return true;
+    atomic_store_explicit(&cl->head, ++head, memory_order_release);
+  }
+  return false;
+}
+
+bool shm_ring_wait(shm_ring *r, shm_ring_completion *out, int timeout_ms)
+{
+  ring_client *cl = &r->h->clients[r->client];
+  if (!wait_until(r, &cl->futex, &cl->waiters, completion_ready, NULL, timeout_ms))
+    return false;
+  uint64_t head = atomic_load_explicit(&cl->head, memory_order_relaxed);
+  uint32_t slot = r->completions[(size_t)r->client * 2 * r->h->slots + (head & r->cmask)] & r->mask;
+  ring_slot *s = slot_at(r, slot);
+  atomic_store(&s->owner, r->owner | SLOT_HELD);
+  s->reason[SHM_RING_REASON_MAX - 1] = '\0';
+  out->slot = slot;
+  out->tag = s->tag;
+  out->code = s->code;
+  out->reason = s->reason;
+  atomic_store_explicit(&cl->head, head + 1, memory_order_release);
+  return true;
+}
+
+void shm_ring_release(shm_ring *r, uint32_t slot)
+{
+  free_slot(r, slot & r->mask, r->owner | SLOT_HELD);
+}
+
+#else
+
+shm_ring *shm_ring_create(const char *name, size_t slots, size_t slot_size, char **error_msg)
+{
+  (void)name;
+  (void)slots;
+  (void)slot_size;
+  *error_msg = NULL;
+  return NULL;
+}
+
+bool shm_ring_next(shm_ring *r, shm_ring_request *out, int timeout_ms)
+{
+  (void)r;
+  (void)out;
+  (void)timeout_ms;
+  return false;
+}
+
+void shm_ring_complete(shm_ring *r, const shm_ring_request *req, int code, const char *reason)
+{
+  (void)r;
+  (void)req;
+  (void)code;
+  (void)reason;
+}
+
+size_t shm_ring_reclaim(shm_ring *r)
+{
+  (void)r;
+  return 0;
+}
+
+void shm_ring_destroy(shm_ring *r)
+{
+  (void)r;
+}
+
+shm_ring *shm_ring_attach(const char *name, char **error_msg)
+{
+  (void)name;
+  *error_msg = NULL;
+  return NULL;
+}
+
+void shm_ring_detach(shm_ring *r)
+{
+  (void)r;
+}
+
+size_t shm_ring_slot_size(const shm_ring *r)
+{
+  (void)r;
+  return 0;
+}
+
+long shm_ring_reserve(shm_ring *r, char **body, int timeout_ms)
+{
+  (void)r;
+  (void)body;
+  (void)timeout_ms;
+  return -1;
+}
+
+void shm_ring_submit(shm_ring *r, long slot, const char *spec_id, const char *method, const char *path,
+                     unsigned mode, size_t len, uint64_t tag)
+{
+  (void)r;
+  (void)slot;
+  (void)spec_id;
+  (void)method;
+  (void)path;
+  (void)mode;
+  (void)len;
+  (void)tag;
+}
+
+bool shm_ring_wait(shm_ring *r, shm_ring_completion *out, int timeout_ms)
+{
+  (void)r;
+  (void)out;
+  (void)timeout_ms;
+  return false;
+}
+
+void shm_ring_release(shm_ring *r, uint32_t slot)
+{
+  (void)r;
+  (void)slot;
+}
+
+#endif
@@ -0,0 +1,463 @@
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "spec_registry.h"
+#include "fileutil.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
+
+// Versione compilata in memoria, condivisa dagli id con lo stesso contenuto.
+// Il testo da cui è stata compilata viene conservato: l'hash seleziona le
+// candidate, il confronto dei byte decide la condivisione, perché una
+// collisione farebbe validare un id con la specifica di un altro.
+typedef struct reg_entry
+{
+  uint64_t hash;
+  char *text;
+  size_t len;
+  oas_spec *spec;
+  size_t bytes;
+  size_t pins;  // acquisizioni non ancora rilasciate
+  size_t users; // id che la usano come versione corrente
+  struct reg_entry *prev; // lista LRU: in testa la più recente
+  struct reg_entry *next;
+} reg_entry;
+
+// Id registrato e ultimo stato osservato del suo file.
+typedef struct reg_source
+{
+  char *id;
+  char *path;
+  uint64_t id_hash;
+  bool seen; // il file è già stato letto almeno una volta
+  uint64_t hash;
+  time_t mtime;
+  long mtime_nsec;
+  long long size;
+  unsigned long long inode;
+  reg_entry *entry; // NULL se la versione non è in memoria
+} reg_source;
+
+struct spec_registry
+{
+  reg_source *sources;
+  size_t source_count;
+  size_t source_cap;
+  reg_entry *lru_head;
+  reg_entry *lru_tail;
+  size_t resident;
+  size_t resident_bytes;
+  size_t budget;
+  bool prune; // specifiche potate al caricamento
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t reloads;
+  uint64_t shared;
+  mtx_t lock;
+};
+
+static char *dup_str(const char *s)
+{
+  size_t len = strlen(s);
+  char *out = (char *)malloc(len + 1);
+  if (out)
+    memcpy(out, s, len + 1);
+  return out;
+}
+
+// Messaggio di errore allocato, da liberare con free.
+static char *error_printf(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return NULL;
+  char *s = (char *)malloc((size_t)n + 1);
+  if (!s)
+    return NULL;
+  va_start(ap, fmt);
+  vsnprintf(s, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  return s;
+}
+
+// FNV-1a a 64 bit.
+static uint64_t hash_bytes(const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i)
+  {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+spec_registry *spec_registry_create(size_t budget_bytes, bool prune)
+{
+  spec_registry *r = (spec_registry *)calloc(1, sizeof(spec_registry));
+  if (!r)
+    return NULL;
+  if (mtx_init(&r->lock, mtx_plain) != thrd_success)
+  {
+    free(r);
+    return NULL;
+  }
+  r->budget = budget_bytes;
+  r->prune = prune;
+  return r;
+}
+
+static void lru_unlink(spec_registry *r, reg_entry *e)
+{
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    r->lru_head = e->next;
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    r->lru_tail = e->prev;
+  e->prev = e->next = NULL;
+}
+
+static void lru_push_front(spec_registry *r, reg_entry *e)
+{
+  e->prev = NULL;
+  e->next = r->lru_head;
+  if (r->lru_head)
+    r->lru_head->prev = e;
+  r->lru_head = e;
+  if (!r->lru_tail)
+    r->lru_tail = e;
+}
+
+static void entry_destroy(spec_registry *r, reg_entry *e)
+{
+  lru_unlink(r, e);
+  --r->resident;
+  r->resident_bytes -= e->bytes;
+  oas_spec_free(e->spec);
+  free(e->text);
+  free(e);
+}
+
+// Una versione che nessun id usa più e che non è acquisita non è
+// raggiungibile se non tramite l'hash: viene liberata subito.
+static void entry_drop_if_unused(spec_registry *r, reg_entry *e)
+{
+  if (e->users == 0 && e->pins == 0)
+    entry_destroy(r, e);
+}
+
+// Libera le versioni meno recenti non acquisite finché la memoria rientra nel
+// budget. Una versione acquisita resta anche se da sola supera il budget.
+static void enforce_budget(spec_registry *r)
+{
+  if (r->budget == 0)
+    return;
+  reg_entry *e = r->lru_tail;
+  while (e && r->resident_bytes > r->budget)
+  {
+    reg_entry *prev = e->prev;
+    if (e->pins == 0)
+    {
+      for (size_t i = 0; i < r->source_count; ++i)
+        if (r->sources[i].entry == e)
+          r->sources[i].entry = NULL;
+      entry_destroy(r, e);
+      ++r->evictions;
+    }
+    e = prev;
+  }
+}
+
+void spec_registry_free(spec_registry *r)
+{
+  if (!r)
+    return;
+  reg_entry *e = r->lru_head;
+  while (e)
+  {
+    reg_entry *next = e->next;
+    oas_spec_free(e->spec);
+    free(e->text);
+    free(e);
+    e = next;
+  }
+  for (size_t i = 0; i < r->source_count; ++i)
+  {
+    free(r->sources[i].id);
+    free(r->sources[i].path);
+  }
+  free(r->sources);
+  mtx_destroy(&r->lock);
+  free(r);
+}
+
+static reg_source *find_source(spec_registry *r, const char *id)
+{
+  uint64_t h = hash_bytes(id, strlen(id));
+  for (size_t i = 0; i < r->source_count; ++i)
+    if (r->sources[i].id_hash == h && strcmp(r->sources[i].id, id) == 0)
+      return &r->sources[i];
+  return NULL;
+}
+
+bool spec_registry_add(spec_registry *r, const char *id, const char *path)
+{
+  mtx_lock(&r->lock);
+  bool ok = false;
+  if (find_source(r, id))
+    goto out;
+  if (r->source_count == r->source_cap)
+  {
+    size_t ncap = r->source_cap ? r->source_cap * 2 : 16;
+    reg_source *ns = (reg_source *)realloc(r->sources, ncap * sizeof(reg_source));
+    if (!ns)
+      goto out;
+    r->sources = ns;
+    r->source_cap = ncap;
+  }
+  reg_source *s = &r->sources[r->source_count];
+  memset(s, 0, sizeof(*s));
+  s->id = dup_str(id);
+  s->path = dup_str(path);
+  if (!s->id || !s->path)
+  {
+    free(s->id);
+    free(s->path);
+    goto out;
+  }
+  s->id_hash = hash_bytes(id, strlen(id));
+  ++r->source_count;
+  ok = true;
+out:
+  mtx_unlock(&r->lock);
+  return ok;
+}
+
+long spec_registry_add_list(spec_registry *r, const char *list_path, char **error_msg)
+{
+  *error_msg = NULL;
+  size_t len = 0;
+  char *text = read_entire_file(list_path, &len);
+  if (!text)
+  {
+    *error_msg = error_printf("lettura di '%s' non riuscita", list_path);
+    return -1;
+  }
+  // cartella dell'elenco, per i percorsi relativi
+  const char *slash = strrchr(list_path, '/');
+  size_t dir_len = slash ? (size_t)(slash - list_path) + 1 : 0;
+
+  long added = 0;
+  size_t line_no = 0;
+  for (char *line = text, *nl; line; line = nl ? nl + 1 : NULL)
+  {
+    nl = strchr(line, '\n');
+    if (nl)
+      *nl = '\0';
+    ++line_no;
+    char *id = line + strspn(line, " \t\r");
+    if (*id == '\0' || *id == '#')
+      continue;
+    char *sep = id + strcspn(id, " \t");
+    char *path = sep + strspn(sep, " \t");
+    *sep = '\0';
+    size_t plen = strcspn(path, "\r");
+    while (plen > 0 && (path[plen - 1] == ' ' || path[plen - 1] == '\t'))
+      --plen;
+    path[plen] = '\0';
+    if (*path == '\0')
+    {
+      *error_msg = error_printf("riga %zu di '%s': manca il percorso della specifica", line_no, list_path);
+      free(text);
+      return -1;
+    }
+    char *full = NULL;
+    if (path[0] != '/' && dir_len > 0)
+    {
+      full = (char *)malloc(dir_len + plen + 1);
+      if (full)
+      {
+        memcpy(full, list_path, dir_len);
+        memcpy(full + dir_len, path, plen + 1);
+      }
+    }
+    bool ok = spec_registry_add(r, id, full ? full : path);
+    free(full);
+    if (!ok)
+    {
+      *error_msg = error_printf("id '%s' duplicato in '%s'", id, list_path);
+      free(text);
+      return -1;
+    }
+    ++added;
+  }
+  free(text);
+  return added;
+}
+
+static reg_entry *find_entry(spec_registry *r, uint64_t hash, const char *text, size_t len)
+{
+  for (reg_entry *e = r->lru_head; e; e = e->next)
+    if (e->hash == hash && e->len == len && memcmp(e->text, text, len) == 0)
+      return e;
+  return NULL;
+}
+
+// Sostituisce la versione corrente dell'id.
+static void source_set_entry(spec_registry *r, reg_source *s, reg_entry *e)
+{
+  if (s->entry == e)
+    return;
+  reg_entry *old = s->entry;
+  s->entry = e;
+  ++e->users;
+  if (old)
+  {
+    --old->users;
+    entry_drop_if_unused(r, old);
+  }
+}
+
+const oas_spec *spec_registry_acquire(spec_registry *r, const char *id, char **error_msg)
+{
+  *error_msg = NULL;
+  mtx_lock(&r->lock);
+  reg_source *s = find_source(r, id);
+  if (!s)
+  {
+    mtx_unlock(&r->lock);
+    *error_msg = error_printf("specifica '%s' non registrata", id);
+    return NULL;
+  }
+
+  // Il file invariato (data al nanosecondo, dimensione, inode) non viene
+  // riletto.
+  struct stat st;
+  bool have_stat = stat(s->path, &st) == 0;
+  if (s->entry && have_stat && st.st_mtime == s->mtime && STAT_MTIME_NSEC(st) == s->mtime_nsec &&
+      (long long)st.st_size == s->size && (unsigned long long)st.st_ino == s->inode)
+  {
+    reg_entry *e = s->entry;
+    ++r->hits;
+    ++e->pins;
+    lru_unlink(r, e);
+    lru_push_front(r, e);
+    mtx_unlock(&r->lock);
+    return e->spec;
+  }
+
+  size_t len = 0;
+  char *text = read_entire_file(s->path, &len);
+  if (!text)
+  {
+    mtx_unlock(&r->lock);
+    *error_msg = error_printf("lettura di '%s' non riuscita", s->path);
+    return NULL;
+  }
+  uint64_t hash = hash_bytes(text, len);
+  bool changed = s->seen && hash != s->hash;
+
+  reg_entry *e = find_entry(r, hash, text, len);
+  if (e)
+  {
+    free(text);
+    ++r->hits;
+    if (s->entry != e && e->users > 0)
+      ++r->shared;
+    lru_unlink(r, e);
+  }
+  else
+  {
+    // La compilazione avviene sotto il lock: gli altri id attendono, ma una
+    // stessa specifica non viene mai compilata due volte in parallelo.
+    oas_prune_opts prune = {r->prune, NULL, NULL};
+    oas_spec *spec = oas_spec_load_text(text, len, NULL, &prune, error_msg);
+    e = spec ? (reg_entry *)calloc(1, sizeof(reg_entry)) : NULL;
+    if (!e)
+    {
+      free(text);
+      oas_spec_free(spec);
+      mtx_unlock(&r->lock);
+      if (!*error_msg)
+        *error_msg = dup_str("memoria insufficiente");
+      return NULL;
+    }
+    ++r->misses;
+    if (changed)
+      ++r->reloads;
+    e->hash = hash;
+    e->text = text;
+    e->len = len;
+    e->spec = spec;
+    e->bytes = spec->memory_bytes + len + 1;
+    ++r->resident;
+    r->resident_bytes += e->bytes;
+  }
+  // Lo stato del file viene registrato solo ora che il suo contenuto ha una
+  // versione compilata: un file diventato non valido non passa dal
+  // controllo rapido e riceve l'errore a ogni richiesta finché non viene
+  // corretto, invece di essere validato in silenzio con la versione
+  // precedente.
+  s->seen = true;
+  s->hash = hash;
+  if (have_stat)
+  {
+    s->mtime = st.st_mtime;
+    s->mtime_nsec = STAT_MTIME_NSEC(st);
+    s->size = (long long)st.st_size;
+    s->inode = (unsigned long long)st.st_ino;
+  }
+  lru_push_front(r, e);
+  ++e->pins;
+  source_set_entry(r, s, e);
+  enforce_budget(r);
+  mtx_unlock(&r->lock);
+  return e->spec;
+}
+
+void spec_registry_release(spec_registry *r, const oas_spec *spec)
+{
+  if (!spec)
+    return;
+  mtx_lock(&r->lock);
+  for (reg_entry *e = r->lru_head; e; e = e->next)
+  {
+    if (e->spec != spec)
+      continue;
+    --e->pins;
+    if (e->users == 0)
+      entry_drop_if_unused(r, e);
+    else
+      enforce_budget(r);
+    break;
+  }
+  mtx_unlock(&r->lock);
+}
+
+void spec_registry_get_stats(spec_registry *r, spec_registry_stats *out)
+{
+  mtx_lock(&r->lock);
+  out->hits = r->hits;
+  out->misses = r->misses;
+  out->evictions = r->evictions;
+  out->reloads = r->reloads;
+  out->shared = r->shared;
+  out->registered = r->source_count;
+  out->resident = r->resident;
+  out->resident_bytes = r->resident_bytes;
+  out->budget_bytes = r->budget;
+  mtx_unlock(&r->lock);
+}
@@ -0,0 +1,252 @@
+#if !defined(_MSC_VER)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "spec_reload.h"
+#include "fileutil.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Intervallo di attesa del thread tra due controlli (millisecondi).
+#define SPEC_RELOAD_TICK_MS 200
+
+// Stato del file osservato dal controllo periodico (senza inotify): data di
+// modifica al nanosecondo, dimensione e inode, come nel registro delle
+// specifiche. Due scritture nello stesso secondo differiscono almeno in una
+// di queste, e la sostituzione con rename cambia l'inode.
+typedef struct file_state
+{
+  bool present;
+  time_t mtime;
+  long mtime_nsec;
+  long long size;
+  unsigned long long inode;
+} file_state;
+
+static file_state file_observe(const char *path)
+{
+  file_state f;
+  memset(&f, 0, sizeof(f));
+  struct stat st;
+  if (stat(path, &st) == 0)
+  {
+    f.present = true;
+    f.mtime = st.st_mtime;
+    f.mtime_nsec = STAT_MTIME_NSEC(st);
+    f.size = (long long)st.st_size;
+    f.inode = (unsigned long long)st.st_ino;
+  }
+  return f;
+}
+
+static bool file_state_equal(const file_state *a, const file_state *b)
+{
+  return a->mtime == b->mtime && a->mtime_nsec == b->mtime_nsec && a->size == b->size && a->inode == b->inode;
+}
+
+struct spec_reloader
+{
+  oas_spec_slot *slot;
+  char *path;
+  bool watch;
+  atomic_bool reload_requested;
+  atomic_bool stop;
+  thrd_t thread;
+  int inotify_fd;
+  file_state last;
+};
+
+static void sleep_ms(long ms)
+{
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+  thrd_sleep(&ts, NULL);
+}
+
+// Ricarica la specifica partendo dalla versione pubblicata. Solo questo thread
+// pubblica, quindi la versione corrente non può essere liberata nel frattempo.
+static void do_reload(spec_reloader *r)
+{
+  const oas_spec *prev = oas_spec_slot_peek(r->slot);
+  char *err = NULL;
+  oas_spec *next = oas_spec_load_file(r->path, prev, NULL, &err);
+  if (!next)
+  {
+    fprintf(stderr, "Ricaricamento di '%s' non riuscito: %s. Resta attiva la versione %llu.\n",
+            r->path, err ? err : "errore sconosciuto",
+            prev ? (unsigned long long)prev->version : 0ULL);
+    free(err);
+    return;
+  }
+  unsigned long long version = (unsigned long long)next->version;
+  size_t recompiled = next->recompiled_count;
+  size_t total = next->component_count;
+  size_t symbols = js_symtab_count(next->symbols);
+  size_t memory = next->memory_bytes;
+  oas_spec_publish(r->slot, next);
+  fprintf(stderr, "Specifica ricaricata: versione %llu, componenti ricompilati %zu/%zu, simboli %zu, memoria %.1f KiB.\n",
+          version, recompiled, total, symbols, memory / 1024.0);
+}
+
+#ifdef __linux__
+// Apre un watch sulla directory del file: gli editor spesso salvano
+// scrivendo un file temporaneo e rinominandolo sopra l'originale.
+static int open_inotify(const char *path)
+{
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  char dir[4096];
+  const char *slash = strrchr(path, '/');
+  if (slash)
+  {
+    size_t len = (size_t)(slash - path);
+    if (len == 0)
+      len = 1;
+    if (len >= sizeof(dir))
+    {
+      close(fd);
+      return -1;
+    }
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+  }
+  else
+  {
+    strcpy(dir, ".");
+  }
+  if (inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Consuma gli eventi inotify pendenti; true se riguardano il file osservato.
+static bool drain_inotify(spec_reloader *r)
+{
+  const char *base = strrchr(r->path, '/');
+  base = base ? base + 1 : r->path;
+  bool hit = false;
+  union
+  {
+    struct inotify_event ev; // garantisce l'allineamento del buffer
+    char buf[4096];
+  } u;
+  char *buf = u.buf;
+  for (;;)
+  {
+    ssize_t n = read(r->inotify_fd, buf, sizeof(u.buf));
+    if (n <= 0)
+      break;
+    for (char *p = buf; p < buf + n;)
+    {
+      struct inotify_event *ev = (struct inotify_event *)p;
+      if (ev->len > 0 && strcmp(ev->name, base) == 0)
+        hit = true;
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+  return hit;
+}
+#endif
+
+static int reloader_main(void *arg)
+{
+  spec_reloader *r = (spec_reloader *)arg;
+  while (!atomic_load(&r->stop))
+  {
+    bool changed = false;
+#ifdef __linux__
+    if (r->inotify_fd >= 0)
+    {
+      struct pollfd pfd = {r->inotify_fd, POLLIN, 0};
+      if (poll(&pfd, 1, SPEC_RELOAD_TICK_MS) > 0)
+        changed = drain_inotify(r);
+    }
+    else
+#endif
+    {
+      sleep_ms(SPEC_RELOAD_TICK_MS);
+      if (r->watch)
+      {
+        file_state now = file_observe(r->path);
+        if (now.present && !file_state_equal(&now, &r->last))
+        {
+          r->last = now;
+          changed = true;
+        }
+      }
+    }
+    if (atomic_exchange(&r->reload_requested, false))
+      changed = true;
+    if (changed && !atomic_load(&r->stop))
+      do_reload(r);
+  }
+  return 0;
+}
+
+spec_reloader *spec_reloader_start(oas_spec_slot *slot, const char *path, bool watch_file)
+{
+  spec_reloader *r = (spec_reloader *)calloc(1, sizeof(spec_reloader));
+  if (!r)
+    return NULL;
+  size_t len = strlen(path);
+  r->path = (char *)malloc(len + 1);
+  if (!r->path)
+  {
+    free(r);
+    return NULL;
+  }
+  memcpy(r->path, path, len + 1);
+  r->slot = slot;
+  r->watch = watch_file;
+  r->inotify_fd = -1;
+  r->last = file_observe(path);
+  atomic_init(&r->reload_requested, false);
+  atomic_init(&r->stop, false);
+#ifdef __linux__
+  if (watch_file)
+    r->inotify_fd = open_inotify(path);
+#endif
+  if (thrd_create(&r->thread, reloader_main, r) != thrd_success)
+  {
+#ifdef __linux__
+    if (r->inotify_fd >= 0)
+      close(r->inotify_fd);
+#endif
+    free(r->path);
+    free(r);
+    return NULL;
+  }
+  return r;
+}
+
+void spec_reloader_request(spec_reloader *r)
+{
+  if (r)
+    atomic_store(&r->reload_requested, true);
+}
+
+void spec_reloader_stop(spec_reloader *r)
+{
+  if (!r)
+    return;
+  atomic_store(&r->stop, true);
+  thrd_join(r->thread, NULL);
+#ifdef __linux__
+  if (r->inotify_fd >= 0)
+    close(r->inotify_fd);
+#endif
+  free(r->path);
+  free(r);
+}
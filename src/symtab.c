@@ -0,0 +1,327 @@
+#include "symtab.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#define SYM_CHUNK_MIN 4096
+#define SYM_CHUNK_SIZE (64 * 1024)
+
+// Stringa internata: il nome segue l'intestazione, così dal puntatore al nome
+// si risale al simbolo senza ricerche.
+typedef struct sym_entry
+{
+  uint64_t hash;
+  uint32_t id;
+  uint32_t len;
+  uint32_t mark; // ultimo js_symtab_intern_dom che l'ha usata
+  char name[];
+} sym_entry;
+
+// Tabella a indirizzamento aperto pubblicata ai lettori. Gli slot vengono
+// scritti una sola volta; quando la tabella cresce ne viene pubblicata una
+// copia più grande e la precedente resta in vita fino a js_symtab_free,
+// perché un lettore potrebbe ancora scandirla.
+typedef struct sym_table
+{
+  size_t cap;
+  _Atomic(sym_entry *) slots[];
+} sym_table;
+
+// Blocco dell'area da cui vengono allocate le voci.
+typedef struct sym_chunk
+{
+  struct sym_chunk *next;
+  size_t used;
+  size_t cap;
+  alignas(max_align_t) unsigned char data[];
+} sym_chunk;
+
+struct js_symtab
+{
+  _Atomic(sym_table *) table;
+  sym_table **retired;
+  size_t retired_count;
+  size_t retired_cap;
+  sym_chunk *chunks;
+  size_t count;
+  size_t bytes;
+  uint32_t marks; // ultimo contrassegno assegnato a js_symtab_intern_dom
+  mtx_t lock;
+};
+
+// FNV-1a a 64 bit con un rimescolamento finale per i bit bassi.
+static uint64_t sym_hash(const char *s, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i)
+  {
+    h ^= (unsigned char)s[i];
+    h *= 0x100000001b3ULL;
+  }
+  h ^= h >> 32;
+  return h;
+}
+
+static sym_table *table_create(size_t cap)
+{
+  sym_table *tb = (sym_table *)malloc(sizeof(sym_table) + cap * sizeof(_Atomic(sym_entry *)));
+  if (!tb)
+    return NULL;
+  tb->cap = cap;
+  for (size_t i = 0; i < cap; ++i)
+    atomic_init(&tb->slots[i], NULL);
+  return tb;
+}
+
+js_symtab *js_symtab_create(void)
+{
+  js_symtab *t = (js_symtab *)calloc(1, sizeof(js_symtab));
+  if (!t)
+    return NULL;
+  sym_table *tb = table_create(256);
+  if (!tb || mtx_init(&t->lock, mtx_plain) != thrd_success)
+  {
+    free(tb);
+    free(t);
+    return NULL;
+  }
+  atomic_init(&t->table, tb);
+  t->bytes = sizeof(js_symtab) + sizeof(sym_table) + tb->cap * sizeof(sym_entry *);
+  return t;
+}
+
+void js_symtab_free(js_symtab *t)
+{
+  if (!t)
+    return;
+  free(atomic_load(&t->table));
+  for (size_t i = 0; i < t->retired_count; ++i)
+    free(t->retired[i]);
+  free(t->retired);
+  sym_chunk *c = t->chunks;
+  while (c)
+  {
+    sym_chunk *next = c->next;
+    free(c);
+    c = next;
+  }
+  mtx_destroy(&t->lock);
+  free(t);
+}
+
+static sym_entry *table_find(const sym_table *tb, const char *s, size_t len, uint64_t h)
+{
+  size_t mask = tb->cap - 1;
+  for (size_t i = (size_t)h & mask;; i = (i + 1) & mask)
+  {
+    sym_entry *e = atomic_load_explicit(&tb->slots[i], memory_order_acquire);
+    if (!e)
+      return NULL;
+    if (e->hash == h && e->len == len && memcmp(e->name, s, len) == 0)
+      return e;
+  }
+}
+
+static void table_insert(sym_table *tb, sym_entry *e)
+{
+  size_t mask = tb->cap - 1;
+  size_t i = (size_t)e->hash & mask;
+  while (atomic_load_explicit(&tb->slots[i], memory_order_relaxed))
+    i = (i + 1) & mask;
+  atomic_store_explicit(&tb->slots[i], e, memory_order_release);
+}
+
+// Alloca `size` byte allineati dall'area della tabella.
+static void *chunk_alloc(js_symtab *t, size_t size)
+{
+  size = (size + alignof(sym_entry) - 1) & ~(alignof(sym_entry) - 1);
+  sym_chunk *c = t->chunks;
+  if (!c || c->cap - c->used < size)
+  {
+    // i blocchi crescono fino a SYM_CHUNK_SIZE, così le specifiche piccole
+    // non pagano un blocco intero; le stringhe lunghe ricevono un blocco
+    // proprio, senza sprecare il resto di quello corrente
+    size_t cap = c && c->cap < SYM_CHUNK_SIZE ? c->cap * 2 : SYM_CHUNK_SIZE;
+    if (!c)
+      cap = SYM_CHUNK_MIN;
+    bool own = size > cap / 4;
+    if (own)
+      cap = size;
+    sym_chunk *nc = (sym_chunk *)malloc(sizeof(sym_chunk) + cap);
+    if (!nc)
+      return NULL;
+    nc->used = 0;
+    nc->cap = cap;
+    t->bytes += sizeof(sym_chunk) + cap;
+    if (c && own)
+    {
+      nc->next = c->next;
+      c->next = nc;
+    }
+    else
+    {
+      nc->next = c;
+      t->chunks = nc;
+    }
+    c = nc;
+  }
+  void *p = c->data + c->used;
+  c->used += size;
+  return p;
+}
+
+// Sostituisce la tabella pubblicata con una di capacità doppia.
+static bool table_grow(js_symtab *t)
+{
+  sym_table *old = atomic_load_explicit(&t->table, memory_order_relaxed);
+  if (t->retired_count == t->retired_cap)
+  {
+    size_t ncap = t->retired_cap ? t->retired_cap * 2 : 8;
+    sym_table **nr = (sym_table **)realloc(t->retired, ncap * sizeof(sym_table *));
+    if (!nr)
+      return false;
+    t->retired = nr;
+    t->retired_cap = ncap;
+  }
+  sym_table *tb = table_create(old->cap * 2);
+  if (!tb)
+    return false;
+  for (size_t i = 0; i < old->cap; ++i)
+  {
+    sym_entry *e = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+    if (e)
+      table_insert(tb, e);
+  }
+  atomic_store_explicit(&t->table, tb, memory_order_release);
+  t->retired[t->retired_count++] = old;
+  t->bytes += sizeof(sym_table) + tb->cap * sizeof(sym_entry *);
+  return true;
+}
+
+// Come js_symtab_intern; con `mark` diverso da zero contrassegna la voce e
+// conta in `*distinct` quelle contrassegnate per la prima volta.
+static const char *intern_marked(js_symtab *t, const char *s, size_t len, uint32_t mark, size_t *distinct)
+{
+  if (!t || len > UINT32_MAX)
+    return NULL;
+  uint64_t h = sym_hash(s, len);
+  mtx_lock(&t->lock);
+  sym_table *tb = atomic_load_explicit(&t->table, memory_order_relaxed);
+  sym_entry *e = table_find(tb, s, len, h);
+  if (!e)
+  {
+    if ((t->count + 1) * 2 > tb->cap)
+    {
+      if (!table_grow(t))
+        goto out;
+      tb = atomic_load_explicit(&t->table, memory_order_relaxed);
+    }
+    e = (sym_entry *)chunk_alloc(t, sizeof(sym_entry) + len + 1);
+    if (!e)
+      goto out;
+    e->hash = h;
+    e->len = (uint32_t)len;
+    e->mark = 0;
+    e->id = t->count < JS_SYMBOL_MAX ? (uint32_t)(t->count + 1) : 0;
+    memcpy(e->name, s, len);
+    e->name[len] = '\0';
+    table_insert(tb, e);
+    ++t->count;
+  }
+  if (mark && e->mark != mark)
+  {
+    e->mark = mark;
+    ++*distinct;
+  }
+out:
+  mtx_unlock(&t->lock);
+  return e ? e->name : NULL;
+}
+
+const char *js_symtab_intern(js_symtab *t, const char *s, size_t len)
+{
+  return intern_marked(t, s, len, 0, NULL);
+}
+
+js_symbol js_symtab_lookup(const js_symtab *t, const char *s, size_t len)
+{
+  if (!t)
+    return 0;
+  const sym_table *tb = atomic_load_explicit(&((js_symtab *)t)->table, memory_order_acquire);
+  const sym_entry *e = table_find(tb, s, len, sym_hash(s, len));
+  return e ? e->id : 0;
+}
+
+js_symbol js_symbol_of(const char *interned)
+{
+  const sym_entry *e = (const sym_entry *)(const void *)(interned - offsetof(sym_entry, name));
+  return e->id;
+}
+
+size_t js_symtab_count(const js_symtab *t)
+{
+  return t ? t->count : 0;
+}
+
+size_t js_symtab_bytes(const js_symtab *t)
+{
+  return t ? t->bytes : 0;
+}
+
+// Interna `first` e i suoi fratelli, scendendo nei figli.
+static size_t intern_siblings(js_symtab *t, cJSON *first, uint32_t mark, size_t *distinct)
+{
+  size_t saved = 0;
+  for (cJSON *item = first; item; item = item->next)
+  {
+    if (item->string && !(item->type & cJSON_StringIsConst))
+    {
+      size_t len = strlen(item->string);
+      const char *s = intern_marked(t, item->string, len, mark, distinct);
+      if (s)
+      {
+        cJSON_free(item->string);
+        item->string = (char *)s;
+        item->type |= cJSON_StringIsConst;
+        saved += len + 1;
+      }
+    }
+    if (item->type & cJSON_IsReference)
+      continue;
+    if (cJSON_IsString(item) && item->valuestring)
+    {
+      size_t len = strlen(item->valuestring);
+      const char *s = intern_marked(t, item->valuestring, len, mark, distinct);
+      if (s)
+      {
+        cJSON_free(item->valuestring);
+        item->valuestring = (char *)s;
+        item->type |= cJSON_IsReference;
+        saved += len + 1;
+      }
+    }
+    else if (item->child)
+    {
+      saved += intern_siblings(t, item->child, mark, distinct);
+    }
+  }
+  return saved;
+}
+
+size_t js_symtab_intern_dom(js_symtab *t, cJSON *root, size_t *distinct)
+{
+  size_t unused = 0;
+  if (!distinct)
+    distinct = &unused;
+  *distinct = 0;
+  if (!t || !root)
+    return 0;
+  mtx_lock(&t->lock);
+  if (++t->marks == 0)
+    ++t->marks; // 0 = nessun contrassegno
+  uint32_t mark = t->marks;
+  mtx_unlock(&t->lock);
+  return intern_siblings(t, root, mark, distinct);
+}
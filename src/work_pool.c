@@ -0,0 +1,133 @@
+#include "work_pool.h"
+#include <stdlib.h>
+#include <threads.h>
+
+struct work_pool
+{
+  thrd_t *threads;
+  unsigned thread_count;
+  mtx_t lock;
+  cnd_t work_cond; // nuovo lavoro o chiusura
+  cnd_t done_cond; // l'ultimo thread ha terminato il lavoro
+  void (*fn)(void *);
+  void *arg;
+  unsigned long generation; // incrementato a ogni lavoro
+  unsigned pending;         // thread che non hanno ancora terminato
+  bool busy;
+  bool stop;
+};
+
+static int worker_main(void *arg)
+{
+  work_pool *p = (work_pool *)arg;
+  unsigned long seen = 0;
+  mtx_lock(&p->lock);
+  for (;;)
+  {
+    while (!p->stop && p->generation == seen)
+      cnd_wait(&p->work_cond, &p->lock);
+    if (p->stop)
+      break;
+    seen = p->generation;
+    void (*fn)(void *) = p->fn;
+    void *fn_arg = p->arg;
+    mtx_unlock(&p->lock);
+    fn(fn_arg);
+    mtx_lock(&p->lock);
+    if (--p->pending == 0)
+      cnd_signal(&p->done_cond);
+  }
+  mtx_unlock(&p->lock);
+  return 0;
+}
+
+work_pool *work_pool_create(unsigned threads)
+{
+  if (threads == 0)
+    return NULL;
+  work_pool *p = (work_pool *)calloc(1, sizeof(work_pool));
+  if (!p)
+    return NULL;
+  p->threads = (thrd_t *)calloc(threads, sizeof(thrd_t));
+  if (!p->threads || mtx_init(&p->lock, mtx_plain) != thrd_success)
+  {
+    free(p->threads);
+    free(p);
+    return NULL;
+  }
+  if (cnd_init(&p->work_cond) != thrd_success)
+  {
+    mtx_destroy(&p->lock);
+    free(p->threads);
+    free(p);
+    return NULL;
+  }
+  if (cnd_init(&p->done_cond) != thrd_success)
+  {
+    cnd_destroy(&p->work_cond);
+    mtx_destroy(&p->lock);
+    free(p->threads);
+    free(p);
+    return NULL;
+  }
+  for (unsigned i = 0; i < threads; ++i)
+  {
+    if (thrd_create(&p->threads[i], worker_main, p) != thrd_success)
+      break;
+    ++p->thread_count;
+  }
+  if (p->thread_count == 0)
+  {
+    work_pool_free(p);
+    return NULL;
+  }
+  return p;
+}
+
+void work_pool_free(work_pool *p)
+{
+  if (!p)
+    return;
+  mtx_lock(&p->lock);
+  p->stop = true;
+  cnd_broadcast(&p->work_cond);
+  mtx_unlock(&p->lock);
+  for (unsigned i = 0; i < p->thread_count; ++i)
+    thrd_join(p->threads[i], NULL);
+  cnd_destroy(&p->done_cond);
+  cnd_destroy(&p->work_cond);
+  mtx_destroy(&p->lock);
+  free(p->threads);
+  free(p);
+}
+
+unsigned work_pool_threads(const work_pool *p)
+{
+  return p ? p->thread_count : 0;
+}
+
+bool work_pool_run(work_pool *p, void (*fn)(void *), void *arg)
+{
+  mtx_lock(&p->lock);
+  if (p->busy)
+  {
+    mtx_unlock(&p->lock);
+    return false;
+  }
+  p->busy = true;
+  p->fn = fn;
+  p->arg = arg;
+  p->pending = p->thread_count;
+  ++p->generation;
+  cnd_broadcast(&p->work_cond);
+  mtx_unlock(&p->lock);
+
+  fn(arg);
+
+  mtx_lock(&p->lock);
+  while (p->pending > 0)
+    cnd_wait(&p->done_cond, &p->lock);
+  p->busy = false;
+  mtx_unlock(&p->lock);
+  return true;
+}